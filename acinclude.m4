@@ -455,6 +455,12 @@ AM_CONDITIONAL(BOXTYPE_GENERIC, test "$BOXTYPE" = "generic")
 AM_CONDITIONAL(BOXTYPE_DUCKBOX, test "$BOXTYPE" = "duckbox")
 AM_CONDITIONAL(BOXTYPE_ARMBOX, test "$BOXTYPE" = "armbox")
 
+dnl the box types with fb_generic.cpp
+AM_CONDITIONAL(HAVE_FB_GENERIC, test "$BOXTYPE" = "coolstream" ||
+				test "$BOXTYPE" = "tripledragon" ||
+				test "$BOXTYPE" = "generic" ||
+				test "$BOXTYPE" = "armbox")
+
 AM_CONDITIONAL(BOXMODEL_CS_HD1, test "$BOXMODEL" = "hd1")
 AM_CONDITIONAL(BOXMODEL_CS_HD2, test "$BOXMODEL" = "hd2")
 
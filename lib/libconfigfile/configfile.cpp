@@ -41,11 +41,101 @@ CConfigFile::CConfigFile(const char p_delimiter, const bool p_saveDefaults)
 	unknownKeyQueryedFlag = false;
 	delimiter = p_delimiter;
 	saveDefaults = p_saveDefaults;
+	indexUsed = 0;
+}
+
+CConfigFile::CConfigFile(const CConfigFile & other)
+{
+	indexUsed = 0;
+	*this = other;
+}
+
+CConfigFile & CConfigFile::operator=(const CConfigFile & other)
+{
+	if (this != &other) {
+		configData = other.configData;
+		delimiter = other.delimiter;
+		saveDefaults = other.saveDefaults;
+		modifiedFlag = other.modifiedFlag;
+		unknownKeyQueryedFlag = other.unknownKeyQueryedFlag;
+		indexRebuild();
+	}
+	return *this;
 }
 
 void CConfigFile::clear()
 {
 	configData.clear();
+	index.clear();
+	indexUsed = 0;
+}
+
+//
+// private index methods
+//
+uint32_t CConfigFile::hashKey(const std::string & key)
+{
+	uint32_t h = 2166136261U;	/* FNV-1a */
+	for (std::string::size_type i = 0; i < key.length(); i++)
+		h = (h ^ (unsigned char) key[i]) * 16777619U;
+	return h;
+}
+
+void CConfigFile::indexRebuild()
+{
+	size_t size = 64;
+	while (size < 2 * configData.size())
+		size <<= 1;
+	index.assign(size, IndexEntry());
+	for (size_t i = 0; i < size; i++)
+		index[i].used = false;
+	indexUsed = 0;
+	for (ConfigDataMap::iterator it = configData.begin(); it != configData.end(); ++it)
+		indexAdd(hashKey(it->first), it);
+}
+
+void CConfigFile::indexAdd(const uint32_t hash, const ConfigDataMap::iterator & it)
+{
+	if (2 * (indexUsed + 1) > index.size()) {
+		/* adds this one, too */
+		indexRebuild();
+		return;
+	}
+	size_t mask = index.size() - 1;
+	size_t i = hash & mask;
+	while (index[i].used)
+		i = (i + 1) & mask;
+	index[i].hash = hash;
+	index[i].it = it;
+	index[i].used = true;
+	index[i].cached = 0;
+	indexUsed++;
+}
+
+/* the entry is valid until the next indexAdd() */
+CConfigFile::IndexEntry * CConfigFile::lookup(const std::string & key, const uint32_t hash)
+{
+	if (index.empty())
+		return NULL;
+	size_t mask = index.size() - 1;
+	for (size_t i = hash & mask; index[i].used; i = (i + 1) & mask)
+		if (index[i].hash == hash && index[i].it->first == key)
+			return &index[i];
+	return NULL;
+}
+
+/* like configData[key], for writing: drops the converted values */
+std::string & CConfigFile::value(const std::string & key)
+{
+	uint32_t hash = hashKey(key);
+	IndexEntry * e = lookup(key, hash);
+	if (e) {
+		e->cached = 0;
+		return e->it->second;
+	}
+	ConfigDataMap::iterator it = configData.insert(std::make_pair(key, std::string())).first;
+	indexAdd(hash, it);
+	return it->second;
 }
 
 //
@@ -73,10 +163,14 @@ bool CConfigFile::loadConfig(const char * const filename, char _delimiter)
 				std::string::size_type j = s.find('#');
 				if (j == std::string::npos)
 					j = s.length();
-				configData[s.substr(0, i)] = s.substr(i + 1, j - (i + 1));
+				/* saved files are sorted, so the hint makes this cheap */
+				ConfigDataMap::iterator it = configData.insert(configData.end(),
+						std::make_pair(s.substr(0, i), std::string()));
+				it->second = s.substr(i + 1, j - (i + 1));
 			}
 		}
 		configFile.close();
+		indexRebuild();
 		return true;
 	}
 	else
@@ -136,28 +230,28 @@ bool CConfigFile::saveConfig(const std::string & filename, char _delimiter)
 void CConfigFile::storeBool(const std::string & key, const bool val)
 {
 	if (val == true)
-		configData[key] = std::string("true");
+		value(key) = std::string("true");
 	else
-		configData[key] = std::string("false");
+		value(key) = std::string("false");
 }
 
 void CConfigFile::storeInt32(const std::string & key, const int32_t val)
 {
 	std::stringstream s;
 	s << val;
-	s >> configData[key];
+	s >> value(key);
 }
 
 void CConfigFile::storeInt64(const std::string & key, const int64_t val)
 {
 	std::stringstream s;
 	s << val;
-	s >> configData[key];
+	s >> value(key);
 }
 
 void CConfigFile::storeString(const std::string & key, const std::string & val)
 {
-	configData[key] = val;
+	value(key) = val;
 }
 
 
@@ -172,18 +266,22 @@ bool CConfigFile::getBool(const char * const key, const bool defaultVal)
 
 bool CConfigFile::getBool(const std::string & key, const bool defaultVal)
 {
-	if (configData.find(key) == configData.end())
+	IndexEntry * e = lookup(key);
+	if (!e)
 	{
 		if (saveDefaults) {
 			unknownKeyQueryedFlag = true;
 			storeBool(key, defaultVal);
 		}
-		else {
-			return defaultVal;
-		}
+		return defaultVal;
 	}
 
-	return !((configData[key] == "false") || (configData[key] == "0"));
+	if (!(e->cached & CACHED_BOOL)) {
+		const std::string & val = e->it->second;
+		e->b = !((val == "false") || (val == "0"));
+		e->cached |= CACHED_BOOL;
+	}
+	return e->b;
 }
 
 int32_t CConfigFile::getInt32(const char * const key, const int32_t defaultVal)
@@ -193,22 +291,27 @@ int32_t CConfigFile::getInt32(const char * const key, const int32_t defaultVal)
 
 int32_t CConfigFile::getInt32(const std::string & key, const int32_t defaultVal)
 {
-	if (configData.find(key) == configData.end())
+	IndexEntry * e = lookup(key);
+	if (!e)
 	{
 		if (saveDefaults) {
 			unknownKeyQueryedFlag = true;
 			storeInt32(key, defaultVal);
 		}
-		else {
-			return defaultVal;
-		}
+		return defaultVal;
 	}
 
-	if (configData[key] == "false")
-		return 0;
-	if (configData[key] == "true")
-		return 1;
-	return atoi(configData[key].c_str());
+	if (!(e->cached & CACHED_INT32)) {
+		const std::string & val = e->it->second;
+		if (val == "false")
+			e->i32 = 0;
+		else if (val == "true")
+			e->i32 = 1;
+		else
+			e->i32 = atoi(val.c_str());
+		e->cached |= CACHED_INT32;
+	}
+	return e->i32;
 }
 
 int64_t CConfigFile::getInt64(const char * const key, const int64_t defaultVal)
@@ -218,22 +321,27 @@ int64_t CConfigFile::getInt64(const char * const key, const int64_t defaultVal)
 
 int64_t CConfigFile::getInt64(const std::string & key, const int64_t defaultVal)
 {
-	if (configData.find(key) == configData.end())
+	IndexEntry * e = lookup(key);
+	if (!e)
 	{
 		if (saveDefaults) {
 			unknownKeyQueryedFlag = true;
 			storeInt64(key, defaultVal);
 		}
-		else {
-			return defaultVal;
-		}
+		return defaultVal;
 	}
 
-	if (configData[key] == "false")
-		return 0;
-	if (configData[key] == "true")
-		return 1;
-	return atoll(configData[key].c_str());
+	if (!(e->cached & CACHED_INT64)) {
+		const std::string & val = e->it->second;
+		if (val == "false")
+			e->i64 = 0;
+		else if (val == "true")
+			e->i64 = 1;
+		else
+			e->i64 = atoll(val.c_str());
+		e->cached |= CACHED_INT64;
+	}
+	return e->i64;
 }
 
 std::string CConfigFile::getString(const char * const key, const std::string & defaultVal)
@@ -243,23 +351,22 @@ std::string CConfigFile::getString(const char * const key, const std::string & d
 
 std::string CConfigFile::getString(const std::string & key, const std::string & defaultVal)
 {
-	if (configData.find(key) == configData.end())
+	IndexEntry * e = lookup(key);
+	if (!e)
 	{
 		if (saveDefaults) {
 			unknownKeyQueryedFlag = true;
 			storeString(key, defaultVal);
 		}
-		else {
-			return defaultVal;
-		}
+		return defaultVal;
 	}
 
-	return configData[key];
+	return e->it->second;
 }
 
 std::vector <int32_t> CConfigFile::getInt32Vector(const std::string & key)
 {
-	std::string val = configData[key];
+	std::string val = value(key);
 	std::vector <int32_t> vec;
 	uint16_t length = 0;
 	uint16_t pos = 0;
@@ -289,7 +396,7 @@ std::vector <int32_t> CConfigFile::getInt32Vector(const std::string & key)
 
 std::vector <std::string> CConfigFile::getStringVector(const std::string & key)
 {
-	std::string val = configData[key];
+	std::string val = value(key);
 	std::vector <std::string> vec;
 	uint16_t length = 0;
 	uint16_t pos = 0;
@@ -422,7 +529,7 @@ void CConfigFile::setInt32Vector(const std::string & key, const std::vector<int3
 	if (oldVal != s.str() || unknownKeyQueryedFlag)
 	{
 		modifiedFlag = true;
-		configData[key] = s.str();
+		value(key) = s.str();
 	}
 	unknownKeyQueryedFlag = tmpUnknownKeyQueryedFlag;
 }
@@ -447,15 +554,18 @@ void CConfigFile::setStringVector(const std::string & key, const std::vector<std
 	if (oldVal != newVal || unknownKeyQueryedFlag)
 	{
 		modifiedFlag = true;
-		configData[key] = newVal;
+		value(key) = newVal;
 	}
 	unknownKeyQueryedFlag = tmpUnknownKeyQueryedFlag;
 }
 
 bool CConfigFile::deleteKey(const std::string & key)
 {
-	bool ret = configData.erase(key) != 0;
-	if (ret)
-		modifiedFlag = true;
-	return ret;
+	IndexEntry * e = lookup(key);
+	if (!e)
+		return false;
+	configData.erase(e->it);
+	indexRebuild();
+	modifiedFlag = true;
+	return true;
 }
@@ -42,6 +42,36 @@ class CConfigFile
 	bool modifiedFlag;
 	bool unknownKeyQueryedFlag;
 
+	/* hash index of configData. the map keeps the saved file sorted,
+	   but each get/set did up to four lookups with string compares.
+	   the entries keep the converted values of the typed getters, every
+	   write of the value goes through value() and drops them */
+	enum
+	{
+		CACHED_BOOL	= 1,
+		CACHED_INT32	= 2,
+		CACHED_INT64	= 4
+	};
+	struct IndexEntry
+	{
+		uint32_t hash;
+		bool used;
+		uint8_t cached;
+		bool b;
+		int32_t i32;
+		int64_t i64;
+		ConfigDataMap::iterator it;
+	};
+	std::vector<IndexEntry> index;
+	size_t indexUsed;
+
+	static uint32_t hashKey(const std::string & key);
+	void indexRebuild();
+	void indexAdd(const uint32_t hash, const ConfigDataMap::iterator & it);
+	IndexEntry * lookup(const std::string & key, const uint32_t hash);
+	IndexEntry * lookup(const std::string & key) { return lookup(key, hashKey(key)); }
+	std::string & value(const std::string & key);
+
 	void storeBool(const std::string & key, const bool val);
 	void storeInt32(const std::string & key, const int32_t val);
 	void storeInt64(const std::string & key, const int64_t val);
@@ -49,6 +79,9 @@ class CConfigFile
 
  public:
 	CConfigFile(const char p_delimiter, const bool p_saveDefaults = true);
+	/* the index points into configData, it is rebuilt for a copy */
+	CConfigFile(const CConfigFile & other);
+	CConfigFile & operator=(const CConfigFile & other);
 
 	bool loadConfig(const char * const filename, char _delimiter = '=');
 	bool loadConfig(const std::string & filename, char _delimiter = '=');
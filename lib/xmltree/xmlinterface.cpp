@@ -45,6 +45,10 @@
 #endif /* USE_LIBXML */
 #include <fcntl.h>
 #include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <vector>
+#include <map>
 
 unsigned long xmlGetNumericAttribute(const xmlNodePtr node, const char *name, const int base)
 {
@@ -72,6 +76,69 @@ xmlNodePtr xmlGetNextOccurence(xmlNodePtr cur, const char * s)
 		cur = xmlNextNode(cur);
 	return cur;
 }
+
+/* interned names are never freed, a document type has only a few of them */
+#define XML_INTERN_BUCKETS 256
+
+struct xml_interned
+{
+	xml_interned *next;
+	char name[1];
+};
+
+static xml_interned *xml_intern_table[XML_INTERN_BUCKETS];
+static pthread_mutex_t xml_intern_lock = PTHREAD_MUTEX_INITIALIZER;
+
+const char *xmlIntern(const char *name)
+{
+	unsigned int hash = 5381;
+	for (const char *p = name; *p; p++)
+		hash = hash * 33 + (unsigned char)*p;
+
+	pthread_mutex_lock(&xml_intern_lock);
+	xml_interned **bucket = &xml_intern_table[hash % XML_INTERN_BUCKETS];
+	xml_interned *entry;
+	for (entry = *bucket; entry; entry = entry->next)
+		if (strcmp(entry->name, name) == 0)
+			break;
+	if (!entry) {
+		size_t len = strlen(name);
+		entry = (xml_interned *) malloc(sizeof(xml_interned) + len);
+		memcpy(entry->name, name, len + 1);
+		entry->next = *bucket;
+		*bucket = entry;
+	}
+	pthread_mutex_unlock(&xml_intern_lock);
+	return entry->name;
+}
+
+const char *xmlGetAttribute(const char **atts, const char *name)
+{
+	for (; atts && *atts; atts += 2)
+		if (*atts == name || strcmp(*atts, name) == 0)
+			return atts[1];
+	return NULL;
+}
+
+unsigned long xmlGetNumericAttribute(const char **atts, const char *name, const int base)
+{
+	const char *ptr = xmlGetAttribute(atts, name);
+
+	if (!ptr)
+		return 0;
+
+	return strtoul(ptr, 0, base);
+}
+
+long xmlGetSignedNumericAttribute(const char **atts, const char *name, const int base)
+{
+	const char *ptr = xmlGetAttribute(atts, name);
+
+	if (!ptr)
+		return 0;
+
+	return strtol(ptr, 0, base);
+}
 #if USE_PUGIXML
 std::string to_utf8(unsigned int cp)
 {
@@ -262,6 +329,38 @@ xmlDocPtr parseXmlFile(const char * filename, bool,const char* encoding)
 	return tree_parser;
 }
 
+/* pugixml has no streaming mode, the tree is walked instead */
+static void xmlSaxWalk(xmlNodePtr node, CXMLSaxHandler &handler, std::vector<const char *> &atts)
+{
+	for (; node; node = node.next_sibling()) {
+		if (node.type() == pugi::node_element) {
+			atts.clear();
+			for (pugi::xml_attribute a = node.first_attribute(); a; a = a.next_attribute()) {
+				atts.push_back(xmlIntern(a.name()));
+				atts.push_back(a.value());
+			}
+			atts.push_back(NULL);
+			const char *name = xmlIntern(node.name());
+			handler.StartElement(name, &atts[0]);
+			xmlSaxWalk(node.first_child(), handler, atts);
+			handler.EndElement(name);
+		} else if (node.type() == pugi::node_pcdata || node.type() == pugi::node_cdata)
+			handler.CharacterData(node.value(), strlen(node.value()));
+	}
+}
+
+bool parseXmlFileSax(const char *filename, CXMLSaxHandler &handler, bool warning_by_nonexistence, const char *encoding)
+{
+	xmlDocPtr doc = parseXmlFile(filename, warning_by_nonexistence, encoding);
+	if (!doc)
+		return false;
+
+	std::vector<const char *> atts;
+	xmlSaxWalk(doc->first_child(), handler, atts);
+	delete doc;
+	return true;
+}
+
 #else /* USE_LIBXML */
 xmlDocPtr parseXml(const char * data,const char *encoding)
 {
@@ -339,4 +438,96 @@ xmlDocPtr parseXmlFile(const char * filename, bool warning_by_nonexistence /* =
 	}
 	return tree_parser;
 }
+
+class XMLSaxParser : public XML_Parser
+{
+  private:
+    CXMLSaxHandler &handler;
+    std::vector<const char *> atts;
+    std::vector<const char *> stack;
+    /* attribute names come from the name table of the parser, so each of
+       them is interned only once per file */
+    std::map<const XML_Char *, const char *> names;
+
+  protected:
+    virtual void StartElementHandler(const XML_Char *name, const XML_Char **patts)
+    {
+	atts.clear();
+	for (const XML_Char **a = patts; a && *a; a += 2) {
+		std::map<const XML_Char *, const char *>::iterator it = names.find(*a);
+		if (it == names.end())
+			it = names.insert(std::make_pair(*a, xmlIntern(*a))).first;
+		atts.push_back(it->second);
+		atts.push_back(a[1]);
+	}
+	atts.push_back(NULL);
+	stack.push_back(xmlIntern(name));
+	handler.StartElement(stack.back(), &atts[0]);
+    }
+    virtual void EndElementHandler(const XML_Char * /*name*/)
+    {
+	if (stack.empty())
+		return;
+	const char *name = stack.back();
+	stack.pop_back();
+	handler.EndElement(name);
+    }
+    virtual void CharacterDataHandler(const XML_Char *s, int len)
+    {
+	handler.CharacterData(s, len);
+    }
+
+  public:
+    XMLSaxParser(const XML_Char *encoding, CXMLSaxHandler &h) : XML_Parser(encoding), handler(h)
+    {
+	startElementHandler=endElementHandler=characterDataHandler=1;
+    }
+};
+
+#define XML_SAX_CHUNK 32768
+
+bool parseXmlFileSax(const char *filename, CXMLSaxHandler &handler, bool warning_by_nonexistence, const char *encoding)
+{
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+	{
+		if (warning_by_nonexistence)
+			perror(filename);
+		return false;
+	}
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+	XMLSaxParser parser(encoding, handler);
+	bool ret = true;
+	bool done;
+	do
+	{
+		/* read directly into the buffer of the parser, no copy */
+		void *buffer = parser.GetBuffer(XML_SAX_CHUNK);
+		ssize_t length = buffer ? read(fd, buffer, XML_SAX_CHUNK) : -1;
+		if (length < 0)
+		{
+			perror(filename);
+			ret = false;
+			break;
+		}
+		done = (length == 0);
+
+		if (!parser.ParseBuffer(length, done))
+		{
+			fprintf(stderr, "%s: Error parsing \"%s\": %s at line %d\n",
+				__FUNCTION__,
+				filename,
+				parser.ErrorString(parser.GetErrorCode()),
+				parser.GetCurrentLineNumber());
+			ret = false;
+			break;
+		}
+	}
+	while (!done);
+
+	posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	close(fd);
+	return ret;
+}
 #endif /* USE_LIBXML */
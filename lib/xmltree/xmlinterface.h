@@ -93,4 +93,29 @@ std::string convert_UTF8_To_UTF8_XML(const char *s);
 xmlDocPtr parseXml(const char *data,const char *encoding = NULL);
 xmlDocPtr parseXmlFile(const char * filename, bool warning_by_nonexistence = true,const char *encoding = NULL);
 
+/* streaming (SAX style) parsing: no tree is built, the handler gets the
+ * elements while the file is read, so memory use does not depend on the
+ * size of the file. element and attribute names are interned, handlers can
+ * compare them by pointer with names from xmlIntern(). attribute values and
+ * character data are only valid during the call */
+class CXMLSaxHandler
+{
+	public:
+		virtual ~CXMLSaxHandler() {}
+		/* atts: name/value pairs, terminated by NULL */
+		virtual void StartElement(const char *name, const char **atts) = 0;
+		virtual void EndElement(const char * /*name*/) {}
+		/* text of the current element, may come in several pieces */
+		virtual void CharacterData(const char * /*s*/, int /*len*/) {}
+};
+
+/* the unique copy of a name, valid until exit */
+const char *xmlIntern(const char *name);
+
+const char *xmlGetAttribute                (const char **atts, const char *name);
+unsigned long xmlGetNumericAttribute       (const char **atts, const char *name, const int base);
+long xmlGetSignedNumericAttribute          (const char **atts, const char *name, const int base);
+
+bool parseXmlFileSax(const char *filename, CXMLSaxHandler &handler, bool warning_by_nonexistence = true, const char *encoding = NULL);
+
 #endif /* __xmlinterface_h__ */
@@ -0,0 +1,50 @@
+/*
+	Neutrino-GUI  -   DBoxII-Project
+
+	helpers of the check programs, built and run with "make check".
+	each program is one translation unit and includes this once.
+
+	License: GPL
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#ifndef __check_h__
+#define __check_h__
+
+#include <stdio.h>
+
+/* exit code of a check that could not run, e.g. no input */
+#define CHECK_ERROR	99
+
+/* failed checks so far */
+static int failed = 0;
+
+static inline void check(bool ok, const char *what)
+{
+	if (!ok) {
+		printf("FAIL: %s\n", what);
+		failed++;
+	}
+}
+
+/* prints the result line, returns the exit code for main() */
+static inline int check_result(void)
+{
+	printf("%s\n", failed ? "FAILED" : "OK");
+	return failed ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,322 @@
+/*
+	Neutrino-GUI  -   DBoxII-Project
+
+	persistent meta data (tag) database for the audioplayer
+
+	License: GPL
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <vector>
+#include <OpenThreads/ScopedLock>
+
+#include <global.h>
+#include <system/set_threadname.h>
+#include "basedec.h"
+#include "audiometadb.h"
+
+#define AUDIOMETADB_FILE	CONFIGDIR "/audiometa.db"
+#define AUDIOMETADB_VERSION	"#audiometadb 1"
+/* background threads reading tags */
+#define AUDIOMETADB_THREADS	3
+/* entries not used in this session are dropped above this count */
+#define AUDIOMETADB_MAX		20000
+
+CAudioMetaDB::CAudioMetaDB()
+{
+	generation = 0;
+	workers = 0;
+	dirty = false;
+	Load();
+}
+
+CAudioMetaDB * CAudioMetaDB::getInstance()
+{
+	static CAudioMetaDB * MetaDB = NULL;
+	if (MetaDB == NULL)
+		MetaDB = new CAudioMetaDB();
+	return MetaDB;
+}
+
+/* fields are tab separated, so tabs and line breaks in tags are replaced */
+static void put_string(FILE *f, const std::string &s)
+{
+	fputc('\t', f);
+	for (std::string::const_iterator it = s.begin(); it != s.end(); ++it)
+		fputc((*it == '\t' || *it == '\n' || *it == '\r') ? ' ' : *it, f);
+}
+
+void CAudioMetaDB::Load()
+{
+	FILE *f = fopen(AUDIOMETADB_FILE, "r");
+	if (!f)
+		return;
+
+	char *line = NULL;
+	size_t len = 0;
+	ssize_t read;
+	bool version_ok = false;
+	while ((read = getline(&line, &len, f)) != -1) {
+		if (read > 0 && line[read - 1] == '\n')
+			line[--read] = 0;
+		if (!version_ok) {
+			if (strcmp(line, AUDIOMETADB_VERSION))
+				break;
+			version_ok = true;
+			continue;
+		}
+		std::vector<char *> field;
+		char *p = line;
+		field.push_back(p);
+		while ((p = strchr(p, '\t')) != NULL) {
+			*p++ = 0;
+			field.push_back(p);
+		}
+		if (field.size() != 21)
+			continue;
+
+		entry e;
+		e.mtime = strtol(field[1], NULL, 10);
+		e.size = strtoll(field[2], NULL, 10);
+		e.valid = atoi(field[3]);
+		e.checked = false;
+		e.meta.type = atoi(field[4]);
+		e.meta.filesize = strtol(field[5], NULL, 10);
+		e.meta.bitrate = strtoul(field[6], NULL, 10);
+		e.meta.avg_bitrate = strtoul(field[7], NULL, 10);
+		e.meta.samplerate = strtoul(field[8], NULL, 10);
+#ifndef ENABLE_FFMPEGDEC
+		e.meta.layer = (enum mad_layer) atoi(field[9]);
+		e.meta.mode = (enum mad_mode) atoi(field[10]);
+#endif
+		e.meta.total_time = strtol(field[11], NULL, 10);
+		e.meta.audio_start_pos = strtol(field[12], NULL, 10);
+		e.meta.vbr = atoi(field[13]) & 1;
+		e.meta.hasInfoOrXingTag = atoi(field[13]) & 2;
+		e.meta.type_info = field[14];
+		e.meta.artist = field[15];
+		e.meta.title = field[16];
+		e.meta.album = field[17];
+		e.meta.date = field[18];
+		e.meta.genre = field[19];
+		e.meta.track = field[20];
+		entries[field[0]] = e;
+	}
+	free(line);
+	fclose(f);
+	printf("[audiometadb] %d entries loaded\n", (int) entries.size());
+}
+
+void CAudioMetaDB::Save()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(mutex);
+	if (!dirty)
+		return;
+
+	if (entries.size() > AUDIOMETADB_MAX) {
+		for (entry_map_t::iterator it = entries.begin(); it != entries.end();) {
+			if (!it->second.checked)
+				entries.erase(it++);
+			else
+				++it;
+		}
+	}
+
+	std::string tmpname = AUDIOMETADB_FILE ".tmp";
+	FILE *f = fopen(tmpname.c_str(), "w");
+	if (!f) {
+		perror(tmpname.c_str());
+		return;
+	}
+	fprintf(f, "%s\n", AUDIOMETADB_VERSION);
+	for (entry_map_t::iterator it = entries.begin(); it != entries.end(); ++it) {
+		const entry &e = it->second;
+		int layer = 0, mode = 0;
+#ifndef ENABLE_FFMPEGDEC
+		layer = e.meta.layer;
+		mode = e.meta.mode;
+#endif
+		fputs(it->first.c_str(), f);
+		fprintf(f, "\t%ld\t%lld\t%d\t%d\t%ld\t%u\t%u\t%u\t%d\t%d\t%ld\t%ld\t%d",
+			(long) e.mtime, (long long) e.size, e.valid, e.meta.type,
+			e.meta.filesize, e.meta.bitrate, e.meta.avg_bitrate, e.meta.samplerate,
+			layer, mode, (long) e.meta.total_time, e.meta.audio_start_pos,
+			(e.meta.vbr ? 1 : 0) | (e.meta.hasInfoOrXingTag ? 2 : 0));
+		put_string(f, e.meta.type_info);
+		put_string(f, e.meta.artist);
+		put_string(f, e.meta.title);
+		put_string(f, e.meta.album);
+		put_string(f, e.meta.date);
+		put_string(f, e.meta.genre);
+		put_string(f, e.meta.track);
+		fputc('\n', f);
+	}
+	if (fclose(f) == 0 && rename(tmpname.c_str(), AUDIOMETADB_FILE) == 0)
+		dirty = false;
+	else
+		unlink(tmpname.c_str());
+}
+
+/* mutex must be held. drops the entry if the file was changed */
+bool CAudioMetaDB::Check(entry_map_t::iterator &it)
+{
+	if (it->second.checked)
+		return true;
+
+	struct stat st;
+	if (stat(it->first.c_str(), &st) == 0 && st.st_mtime == it->second.mtime && st.st_size == it->second.size) {
+		it->second.checked = true;
+		return true;
+	}
+	entries.erase(it);
+	dirty = true;
+	return false;
+}
+
+bool CAudioMetaDB::Lookup(CAudiofile * const file)
+{
+	if (file->FileType == CFile::STREAM_AUDIO)
+		return false;
+
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(mutex);
+	entry_map_t::iterator it = entries.find(file->Filename);
+	if (it == entries.end() || !Check(it) || !it->second.valid)
+		return false;
+
+	file->MetaData = it->second.meta;
+	return true;
+}
+
+void CAudioMetaDB::Store(const CAudiofile * const file, bool valid)
+{
+	if (file->FileType == CFile::STREAM_AUDIO)
+		return;
+
+	entry e;
+	struct stat st;
+	if (stat(file->Filename.c_str(), &st) == 0) {
+		e.mtime = st.st_mtime;
+		e.size = st.st_size;
+	} else {
+		/* only remembered for this session */
+		e.mtime = 0;
+		e.size = -1;
+		valid = false;
+	}
+	e.valid = valid;
+	e.checked = true;
+	if (valid) {
+		e.meta = file->MetaData;
+		/* temporary covers are deleted with the playlist entry */
+		e.meta.cover.clear();
+		e.meta.cover_temporary = false;
+		e.meta.changed = false;
+	}
+
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(mutex);
+	entries[file->Filename] = e;
+	generation++;
+	dirty = true;
+}
+
+void CAudioMetaDB::Queue(const CAudiofile * const file)
+{
+	if (file->FileType == CFile::STREAM_AUDIO)
+		return;
+
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(mutex);
+	entry_map_t::iterator it = entries.find(file->Filename);
+	/* known, or known to fail */
+	if (it != entries.end() && Check(it))
+		return;
+	if (!queued.insert(file->Filename).second)
+		return;
+
+	CAudiofile f(file->Filename, file->FileType);
+	queue.push_back(f);
+	if (workers < AUDIOMETADB_THREADS && workers < (int) queue.size()) {
+		pthread_t thrWorker;
+		if (pthread_create(&thrWorker, NULL, WorkerThread, this) == 0) {
+			pthread_detach(thrWorker);
+			workers++;
+		}
+	}
+	cond.signal();
+}
+
+unsigned int CAudioMetaDB::getGeneration()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(mutex);
+	return generation;
+}
+
+bool CAudioMetaDB::isScanning()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(mutex);
+	return workers > 0;
+}
+
+void* CAudioMetaDB::WorkerThread(void *arg)
+{
+	set_threadname("audio:metadb");
+	((CAudioMetaDB *) arg)->Work();
+	pthread_exit(0);
+	return NULL;
+}
+
+void CAudioMetaDB::Work()
+{
+	mutex.lock();
+	for (;;) {
+		if (queue.empty()) {
+			/* linger a bit for the rest of a directory */
+			cond.wait(&mutex, 2000);
+			if (queue.empty())
+				break;
+		}
+		CAudiofile file = queue.front();
+		queue.pop_front();
+		mutex.unlock();
+
+		/* serialised per decoder type in there */
+		bool ok = CBaseDec::GetMetaDataBase(&file, true);
+
+		mutex.lock();
+		/* reading stores the result, not so a hit in the decoder's cache */
+		if (entries.find(file.Filename) == entries.end()) {
+			mutex.unlock();
+			Store(&file, ok);
+			mutex.lock();
+		}
+		queued.erase(file.Filename);
+	}
+	workers--;
+	bool last = (workers == 0);
+	mutex.unlock();
+
+	if (last)
+		Save();
+}
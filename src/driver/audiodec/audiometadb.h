@@ -0,0 +1,83 @@
+/*
+	Neutrino-GUI  -   DBoxII-Project
+
+	persistent meta data (tag) database for the audioplayer
+
+	License: GPL
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#ifndef __AUDIO_META_DB__
+#define __AUDIO_META_DB__
+
+#include <string>
+#include <map>
+#include <set>
+#include <deque>
+#include <sys/types.h>
+
+#include <OpenThreads/Mutex>
+#include <OpenThreads/Condition>
+#include <driver/audiofile.h>
+
+/* tags of local audio files, kept across restarts. an entry is valid as
+ * long as mtime and size of the file did not change, this is checked once
+ * per entry and session. files not yet in the database can be queued, they
+ * are read by a few background threads, so the GUI never has to wait for
+ * the tags of a whole directory */
+class CAudioMetaDB
+{
+	private:
+		struct entry
+		{
+			time_t		mtime;
+			off_t		size;
+			bool		valid;		/* false: reading the tags failed */
+			bool		checked;	/* mtime and size checked this session */
+			CAudioMetaData	meta;
+		};
+		typedef std::map<std::string, entry> entry_map_t;
+
+		OpenThreads::Mutex	mutex;
+		OpenThreads::Condition	cond;
+		entry_map_t		entries;
+		std::deque<CAudiofile>	queue;
+		std::set<std::string>	queued;
+		unsigned int		generation;
+		int			workers;
+		bool			dirty;
+
+		CAudioMetaDB();
+		void Load();
+		bool Check(entry_map_t::iterator &it);
+		static void* WorkerThread(void *arg);
+		void Work();
+	public:
+		static CAudioMetaDB * getInstance();
+
+		/* fill in the tags if there is an up to date entry */
+		bool Lookup(CAudiofile * const file);
+		/* store the result of reading the tags of file */
+		void Store(const CAudiofile * const file, bool valid);
+		/* read the tags in background, if not known yet */
+		void Queue(const CAudiofile * const file);
+		/* changes whenever an entry was added by the background threads */
+		unsigned int getGeneration();
+		bool isScanning();
+		void Save();
+};
+
+#endif
@@ -0,0 +1,285 @@
+/*
+	Neutrino-GUI  -   DBoxII-Project
+
+	PCM output with read-ahead ring for the audio decoders
+
+	License: GPL
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <OpenThreads/ScopedLock>
+
+#include <zapit/include/audio.h>
+#include <system/set_threadname.h>
+#include "audioout.h"
+
+extern cAudio * audioDecoder;
+
+/* 48kHz, 16 bit stereo */
+#define BYTES_PER_SECOND	(48000 * 2 * 2)
+#define MAX_SECONDS		30
+/* max. size per WriteClip call to the hardware */
+#define WRITE_CHUNK		(16 * 1024)
+
+CAudioOut::CAudioOut()
+{
+	ring = NULL;
+	size = 0;
+	wpos = rpos = 0;
+	memset(&last, 0, sizeof(last));
+	memset(&hwfmt, 0, sizeof(hwfmt));
+	last_valid = false;
+	open = false;
+	eos = false;
+	paused = false;
+	close_req = false;
+	started = false;
+	writing = false;
+	generation = 0;
+}
+
+CAudioOut::~CAudioOut()
+{
+	if (started) {
+		mutex.lock();
+		started = false;
+		cond.broadcast();
+		mutex.unlock();
+		join();
+	}
+	delete[] ring;
+}
+
+CAudioOut * CAudioOut::getInstance()
+{
+	static CAudioOut * AudioOut = NULL;
+	if (AudioOut == NULL)
+		AudioOut = new CAudioOut();
+	return AudioOut;
+}
+
+bool CAudioOut::SameFormat(const clip_format_t &a, const clip_format_t &b)
+{
+	return a.channels == b.channels && a.samplerate == b.samplerate &&
+		a.bits == b.bits && a.little_endian == b.little_endian;
+}
+
+void CAudioOut::SetBuffer(int seconds)
+{
+	if (seconds < 0)
+		seconds = 0;
+	if (seconds > MAX_SECONDS)
+		seconds = MAX_SECONDS;
+	unsigned int new_size = seconds * BYTES_PER_SECOND;
+	if (new_size == size)
+		return;
+
+	Flush(true);
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(mutex);
+	/* data written after the flush may be on its way to the hardware */
+	generation++;
+	while (writing)
+		cond.wait(&mutex);
+	delete[] ring;
+	ring = NULL;
+	size = 0;
+	wpos = rpos = 0;
+	if (new_size) {
+		ring = new unsigned char[new_size];
+		size = new_size;
+	}
+	printf("[audioout] read-ahead %d s (%u bytes)\n", seconds, size);
+	if (size && !started) {
+		started = true;
+		start();
+	}
+}
+
+int CAudioOut::PrepareClipPlay(int channels, int samplerate, int bits, int little_endian)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(mutex);
+	if (!size)
+		return audioDecoder->PrepareClipPlay(channels, samplerate, bits, little_endian);
+
+	clip_format_t fmt;
+	fmt.pos = wpos;
+	fmt.channels = channels;
+	fmt.samplerate = samplerate;
+	fmt.bits = bits;
+	fmt.little_endian = little_endian;
+	/* same format as before: keep the clip running */
+	if (!last_valid || !SameFormat(fmt, last)) {
+		formats.push_back(fmt);
+		cond.broadcast();
+	}
+	last = fmt;
+	last_valid = true;
+	eos = false;
+	return 0;
+}
+
+int CAudioOut::WriteClip(unsigned char * buf, int len)
+{
+	mutex.lock();
+	if (!size) {
+		mutex.unlock();
+		return audioDecoder->WriteClip(buf, len);
+	}
+	unsigned int gen = generation;
+	int done = 0;
+	while (done < len && gen == generation && size) {
+		unsigned int space = size - (unsigned int)(wpos - rpos);
+		if (!space) {
+			cond.wait(&mutex, 100);
+			continue;
+		}
+		unsigned int off = wpos % size;
+		unsigned int n = len - done;
+		if (n > space)
+			n = space;
+		if (n > size - off)
+			n = size - off;
+		memcpy(ring + off, buf + done, n);
+		wpos += n;
+		done += n;
+		cond.broadcast();
+	}
+	mutex.unlock();
+	/* data dropped by Flush() counts as written */
+	return len;
+}
+
+int CAudioOut::StopClip()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(mutex);
+	if (!size)
+		return audioDecoder->StopClip();
+	/* the clip is stopped when the ring runs empty, unless the next file
+	 * continues it before */
+	eos = true;
+	cond.broadcast();
+	return 0;
+}
+
+void CAudioOut::Flush(bool close)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(mutex);
+	if (!size)
+		return;
+	generation++;
+	cond.broadcast();
+	/* the space of a chunk on its way to the hardware is free after it */
+	while (writing)
+		cond.wait(&mutex);
+	rpos = wpos;
+	formats.clear();
+	if (last_valid)
+		hwfmt = last;
+	if (close) {
+		last_valid = false;
+		eos = false;
+		close_req = true;
+	}
+	cond.broadcast();
+	/* wait for the thread to stop the hardware clip */
+	for (int i = 0; i < 20 && close_req && started; i++)
+		cond.wait(&mutex, 100);
+}
+
+void CAudioOut::Pause(bool pause)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(mutex);
+	paused = pause;
+	cond.broadcast();
+}
+
+void CAudioOut::run()
+{
+	set_threadname("audio:out");
+	mutex.lock();
+	while (started) {
+		if (close_req || (eos && open && wpos == rpos)) {
+			if (open) {
+				mutex.unlock();
+				audioDecoder->StopClip();
+				mutex.lock();
+				open = false;
+			}
+			if (close_req) {
+				close_req = false;
+				cond.broadcast();
+				continue;
+			}
+		}
+		if (paused || wpos == rpos) {
+			cond.wait(&mutex, 100);
+			continue;
+		}
+		/* format change due at the read position */
+		while (!formats.empty() && formats.front().pos <= rpos) {
+			if (open && !SameFormat(formats.front(), hwfmt)) {
+				mutex.unlock();
+				audioDecoder->StopClip();
+				mutex.lock();
+				open = false;
+			}
+			hwfmt = formats.front();
+			formats.pop_front();
+		}
+		if (!open) {
+			clip_format_t fmt = hwfmt;
+			mutex.unlock();
+			audioDecoder->PrepareClipPlay(fmt.channels, fmt.samplerate, fmt.bits, fmt.little_endian);
+			mutex.lock();
+			open = true;
+			continue;
+		}
+
+		unsigned int len = (unsigned int)(wpos - rpos);
+		if (!formats.empty() && formats.front().pos - rpos < len)
+			len = (unsigned int)(formats.front().pos - rpos);
+		if (len > size - rpos % size)
+			len = size - rpos % size;
+		if (len > WRITE_CHUNK)
+			len = WRITE_CHUNK;
+		unsigned char * data = ring + rpos % size;
+		unsigned int gen = generation;
+
+		/* the decoder never writes into [rpos, rpos + len) until rpos moves,
+		 * Flush() and SetBuffer() wait for writing */
+		writing = true;
+		mutex.unlock();
+		int ret = audioDecoder->WriteClip(data, len);
+		mutex.lock();
+		writing = false;
+		if (ret != (int) len)
+			fprintf(stderr, "[audioout] PCM write error (%d/%u)\n", ret, len);
+		if (gen == generation)
+			rpos += len;
+		cond.broadcast();
+	}
+	if (open) {
+		audioDecoder->StopClip();
+		open = false;
+	}
+	mutex.unlock();
+}
@@ -0,0 +1,91 @@
+/*
+	Neutrino-GUI  -   DBoxII-Project
+
+	PCM output with read-ahead ring for the audio decoders
+
+	License: GPL
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#ifndef __AUDIO_OUT__
+#define __AUDIO_OUT__
+
+#include <stdint.h>
+#include <deque>
+
+#include <OpenThreads/Thread>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/Condition>
+
+/* decoders write their PCM data here instead of directly to the audio
+ * decoder. with a buffer set, the data goes through a ring that is fed to
+ * the hardware by an own thread: the decoder of the next file can start
+ * while the ring still plays the end of the previous one, and an unchanged
+ * clip format keeps the hardware clip open, so there is no gap between
+ * files. without buffer the calls are passed through unchanged */
+class CAudioOut : public OpenThreads::Thread
+{
+	private:
+		typedef struct clip_format
+		{
+			uint64_t	pos;	/* ring position the format starts at */
+			int		channels;
+			int		samplerate;
+			int		bits;
+			int		little_endian;
+		} clip_format_t;
+
+		OpenThreads::Mutex	mutex;
+		OpenThreads::Condition	cond;
+		unsigned char *		ring;
+		unsigned int		size;
+		uint64_t		wpos;
+		uint64_t		rpos;
+		std::deque<clip_format_t> formats;	/* pending format changes */
+		clip_format_t		last;		/* format of the decoder */
+		clip_format_t		hwfmt;		/* format of the data at rpos */
+		bool			last_valid;
+		bool			open;
+		bool			eos;
+		bool			paused;
+		bool			close_req;
+		bool			started;
+		/* run() sends data from the ring without the mutex, the ring
+		 * space it sends is neither reused nor freed until it is done */
+		bool			writing;
+		unsigned int		generation;
+
+		CAudioOut();
+		void run();
+		static bool SameFormat(const clip_format_t &a, const clip_format_t &b);
+	public:
+		~CAudioOut();
+		static CAudioOut * getInstance();
+
+		/* read-ahead in seconds of 48kHz stereo, 0 = write through */
+		void SetBuffer(int seconds);
+
+		/* same interface as cAudio */
+		int PrepareClipPlay(int channels, int samplerate, int bits, int little_endian);
+		int WriteClip(unsigned char * buf, int len);
+		int StopClip();
+
+		/* drop buffered data, with close also stop the hardware clip */
+		void Flush(bool close = false);
+		void Pause(bool pause);
+};
+
+#endif
@@ -40,6 +40,7 @@
 #include <zapit/client/zapittools.h>
 
 #include "basedec.h"
+#include "audiometadb.h"
 #ifdef ENABLE_FFMPEGDEC
 #include "ffmpegdec.h"
 #else
@@ -57,6 +58,11 @@
 unsigned int CBaseDec::mSamplerate=0;
 OpenThreads::Mutex CBaseDec::metaDataMutex;
 std::map<const std::string,CAudiofile> CBaseDec::metaDataCache;
+#ifndef ENABLE_FFMPEGDEC
+/* the decoders are singletons which keep the file being read in the
+   instance, the tag scanner of CAudioMetaDB reads from several threads */
+static OpenThreads::Mutex mp3MetaMutex, oggMetaMutex, wavMetaMutex, cdrMetaMutex;
+#endif
 
 void ShoutcastCallback(void *arg)
 {
@@ -85,6 +91,10 @@ CBaseDec::RetCode CBaseDec::DecoderBase(CAudiofile* const in,
 		Status = INTERNAL_ERR;
 	}
 
+	/* local files are read front to back, let the kernel read ahead more */
+	if ( Status == OK && in->FileType != CFile::STREAM_AUDIO )
+		posix_fadvise( fileno( fp ), 0, 0, POSIX_FADV_SEQUENTIAL );
+
 	if ( Status == OK )
 	{
 #ifndef ENABLE_FFMPEGDEC
@@ -205,6 +215,12 @@ bool CBaseDec::GetMetaDataBase(CAudiofile* const in, const bool nice)
 	if (LookupMetaData(in))
 		return true;
 
+	if (CAudioMetaDB::getInstance()->Lookup(in))
+	{
+		CacheMetaData(in);
+		return true;
+	}
+
 	bool Status = true;
 #ifndef ENABLE_FFMPEGDEC
 	if (in->FileType == CFile::FILE_MP3 || in->FileType == CFile::FILE_OGG
@@ -227,27 +243,32 @@ bool CBaseDec::GetMetaDataBase(CAudiofile* const in, const bool nice)
 #ifndef ENABLE_FFMPEGDEC
 			if(in->FileType == CFile::FILE_MP3)
 			{
+				OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(mp3MetaMutex);
 				Status = CMP3Dec::getInstance()->GetMetaData(fp, nice,
 						&in->MetaData);
 			}
 			else if(in->FileType == CFile::FILE_OGG)
 			{
+				OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(oggMetaMutex);
 				Status = COggDec::getInstance()->GetMetaData(fp, nice,
 						&in->MetaData);
 			}
 			else if(in->FileType == CFile::FILE_WAV)
 			{
+				OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(wavMetaMutex);
 				Status = CWavDec::getInstance()->GetMetaData(fp, nice,
 						&in->MetaData);
 			}
 			else if(in->FileType == CFile::FILE_CDR)
 			{
+				OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(cdrMetaMutex);
 				Status = CCdrDec::getInstance()->GetMetaData(fp, nice,
 						&in->MetaData);
 			}
 #ifdef ENABLE_FLAC
 			else if (in->FileType == CFile::FILE_FLAC)
 			{
+				/* own instance, it keeps the stream state */
 				CFlacDec FlacDec;
 				Status = FlacDec.GetMetaData(fp, nice, &in->MetaData);
 			}
@@ -263,6 +284,7 @@ bool CBaseDec::GetMetaDataBase(CAudiofile* const in, const bool nice)
 #endif
 			if (Status)
 				CacheMetaData(in);
+			CAudioMetaDB::getInstance()->Store(in, Status);
 			if ( fclose( fp ) == EOF )
 			{
 				fprintf( stderr, "Could not close file %s.\n",
@@ -39,6 +39,7 @@
 #include <zapit/include/audio.h>
 #include <eitd/edvbstring.h> // UTF8
 #include "ffmpegdec.h"
+#include "audioout.h"
 
 extern "C" {
 #include <libavutil/opt.h>
@@ -61,7 +62,6 @@ extern "C" {
 #include <driver/netfile.h>
 #include <system/helpers.h>
 
-extern cAudio * audioDecoder;
 
 //#define FFDEC_DEBUG
 
@@ -255,9 +255,9 @@ CBaseDec::RetCode CFfmpegDec::Decoder(FILE *_in, int /*OutputFd*/, State* state,
 	mChannels = av_get_channel_layout_nb_channels(AV_CH_LAYOUT_STEREO);
 
 #if !HAVE_ARM_HARDWARE
-	audioDecoder->PrepareClipPlay(mChannels, mSampleRate, 16, 1);
+	CAudioOut::getInstance()->PrepareClipPlay(mChannels, mSampleRate, 16, 1);
 #else
-	audioDecoder->PrepareClipPlay(mChannels, mSampleRate, 16, 0);
+	CAudioOut::getInstance()->PrepareClipPlay(mChannels, mSampleRate, 16, 0);
 #endif
 
 	AVFrame *frame = NULL;
@@ -396,7 +396,7 @@ CBaseDec::RetCode CFfmpegDec::Decoder(FILE *_in, int /*OutputFd*/, State* state,
 				int outbuf_size = av_samples_get_buffer_size(&out_samples, mChannels, //c->channels,
 									  outsamples, AV_SAMPLE_FMT_S16, 1);
 
-				if(audioDecoder->WriteClip((unsigned char*) outbuf, outbuf_size) != outbuf_size)
+				if(CAudioOut::getInstance()->WriteClip((unsigned char*) outbuf, outbuf_size) != outbuf_size)
 				{
 					fprintf(stderr,"%s: PCM write error (%s).\n", ProgName, strerror(errno));
 					Status=WRITE_ERR;
@@ -415,7 +415,7 @@ CBaseDec::RetCode CFfmpegDec::Decoder(FILE *_in, int /*OutputFd*/, State* state,
 #endif
 	} while (*state!=STOP_REQ && Status==OK);
 
-	audioDecoder->StopClip();
+	CAudioOut::getInstance()->StopClip();
 	meta_data_valid = false;
 
 	swr_free(&swr);
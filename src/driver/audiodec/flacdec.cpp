@@ -35,13 +35,13 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <flacdec.h>
+#include "audioout.h"
 #include <linux/soundcard.h>
 #include <algorithm>
 #include <sstream>
 
 #include <zapit/include/audio.h>
 #include <driver/netfile.h>
-extern cAudio *audioDecoder;
 
 #define ProgName "FlacDec"
 // nr of msecs to skip in ff/rev mode
@@ -151,7 +151,7 @@ FLAC__StreamDecoderWriteStatus flac_write(const FLAC__StreamDecoder * /*vf*/, co
 				return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
 		}
 		printf("SetDSP: mBps=%d, fmt = %d, Sample rate = %d, channels = %d\n", flacdec->mBps, fmt, flacdec->mSampleRate, flacdec->mChannels);
-		audioDecoder->PrepareClipPlay(flacdec->mChannels, flacdec->mSampleRate, flacdec->mBps, fmt == AFMT_S16_LE ? 1 : 0);
+		CAudioOut::getInstance()->PrepareClipPlay(flacdec->mChannels, flacdec->mSampleRate, flacdec->mBps, fmt == AFMT_S16_LE ? 1 : 0);
 #if 0
 #ifdef DBOX
 		if (flacdec->SetDSP(flacdec->mOutputFd, fmt, flacdec->mSampleRate, flacdec->mChannels)) //FLAC__stream_decoder_get_channels (vf)))
@@ -358,7 +358,7 @@ FLAC__StreamDecoderWriteStatus flac_write(const FLAC__StreamDecoder * /*vf*/, co
 				cnt = flacdec->mBuffersize;
 
 			//if (write(flacdec->mOutputFd, &u8buffer[j], cnt) != (ssize_t)cnt)
-			if (audioDecoder->WriteClip(&u8buffer[j], cnt) != cnt)
+			if (CAudioOut::getInstance()->WriteClip(&u8buffer[j], cnt) != cnt)
 			{
 				/* if a pipe closed when writing to stdout, we let it go without an error message */
 				return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
@@ -524,7 +524,7 @@ CBaseDec::RetCode CFlacDec::Decoder(FILE *in, const int /*OutputFd*/, State* con
 	FLAC__stream_decoder_delete(mFlacDec);
 	mFlacDec = NULL;
 
-	audioDecoder->StopClip();
+	CAudioOut::getInstance()->StopClip();
 
 	/* and drive home ;) */
 	return Status;
@@ -55,14 +55,14 @@
 #include <neutrino.h>
 #include <zapit/include/audio.h>
 #include "mp3dec.h"
+#include "audioout.h"
 #include <driver/netfile.h>
 #include <driver/display.h>
-extern cAudio * audioDecoder;
 
 //#define SPECTRUM
 
 #ifdef SPECTRUM
-void sanalyzer_render_freq(short data[1024]);
+void sanalyzer_feed(const short *pcm, int frames);
 #endif
 /* libid3tag extension: This is neccessary in order to call fclose
    on the file. Normally libid3tag closes the file implicit.
@@ -367,7 +367,6 @@ void CMP3Dec::CreateInfo(CAudioMetaData* m, int FrameNumber)
  ****************************************************************************/
 #define INPUT_BUFFER_SIZE	(2*8192) //(5*8192) /* enough to skip big id3 tags */
 #define OUTPUT_BUFFER_SIZE      8192
-#define SPECTRUM_CNT 4
 CBaseDec::RetCode CMP3Dec::Decoder(FILE *InputFp, const int /*OutputFd*/,
 								   State* const state,
 								   CAudioMetaData* meta_data,
@@ -387,12 +386,8 @@ CBaseDec::RetCode CMP3Dec::Decoder(FILE *InputFp, const int /*OutputFd*/,
 	unsigned long		FrameCount=0;
 
 #ifdef SPECTRUM
-        bool update_lcd = false;
-        int i = 0, j = 0;
-        signed short data[1024];
 	if(g_settings.spectrum)
 		CVFD::getInstance ()->Lock ();
-	int scnt = 0;
 #endif
         signed short ll, rr;
 
@@ -663,7 +658,7 @@ q		 * next mad_frame_decode() invocation. (See the comments marked
 				break;
 			}
 #endif
-			audioDecoder->PrepareClipPlay(2, Frame.header.samplerate, 16, 1);
+			CAudioOut::getInstance()->PrepareClipPlay(2, Frame.header.samplerate, 16, 1);
 
 			if ( !meta_data )
 			{
@@ -744,29 +739,12 @@ q		 * next mad_frame_decode() invocation. (See the comments marked
                                         *(((signed short *)OutputPtr) + 1) = rr;
 
 					OutputPtr += 4;
-#ifdef SPECTRUM
-#define DDIFF 0
-					if(g_settings.spectrum) {
-#if HAVE_DBOX2
-					if(scnt == SPECTRUM_CNT-2)
-#endif
-					{
-                                        	j += 4;
-                                        	if((i < 512) && (j > DDIFF)) {
-//if(i == 0) printf("Filling on j = %d\n", j);
-                                                        int tmp = (ll+rr)/2;
-                                                        data[i] = (signed short)tmp;
-                                        	        i++;
-                                        	}
-					}
-					}
-#endif
 
 					/* Flush the buffer if it is full. */
 					if (OutputPtr == OutputBufferEnd)
 					{
 						//if (write(OutputFd, OutputBuffer, OUTPUT_BUFFER_SIZE) != OUTPUT_BUFFER_SIZE)
-						if(audioDecoder->WriteClip(OutputBuffer, OUTPUT_BUFFER_SIZE) != OUTPUT_BUFFER_SIZE)
+						if(CAudioOut::getInstance()->WriteClip(OutputBuffer, OUTPUT_BUFFER_SIZE) != OUTPUT_BUFFER_SIZE)
 						{
 							fprintf(stderr,"%s: PCM write error in stereo (%s).\n", ProgName, strerror(errno));
 							Status = WRITE_ERR;
@@ -777,24 +755,8 @@ q		 * next mad_frame_decode() invocation. (See the comments marked
 
 						OutputPtr = OutputBuffer;
 #ifdef SPECTRUM
-						if(g_settings.spectrum) {
-                                                	i = 0;
-                                                	j = 0;
-                                                	update_lcd = true;
-
-//gettimeofday (&tv2, NULL);
-//int ms = (tv2.tv_sec - tv1.tv_sec) * 1000 + (tv2.tv_usec - tv1.tv_usec) / 1000;
-//if(ms)printf("Write takes %dms\n", ms);
-                                                	//sanalyzer_render_vu(data);
-							scnt++;
-#if HAVE_DBOX2
-							if(scnt >= SPECTRUM_CNT)
-#endif
-							{
-								scnt = 0;
-                                                		sanalyzer_render_freq(data);
-							}
-						}
+						if(g_settings.spectrum)
+							sanalyzer_feed((signed short *) OutputBuffer, OUTPUT_BUFFER_SIZE / 4);
 #endif
 					}
 				}
@@ -813,29 +775,12 @@ q		 * next mad_frame_decode() invocation. (See the comments marked
 					*(((signed short *)OutputPtr) + 1) = *((signed short *)OutputPtr) = ll;
 
 					OutputPtr += 4;
-#ifdef SPECTRUM
-#define DDIFF 1024
-					if(g_settings.spectrum) {
-#if HAVE_DBOX2
-					if(scnt == SPECTRUM_CNT-2)
-#endif
-					{
-                                        	j += 4;
-                                        	if((i < 512) && (j > DDIFF)) {
-//if(i == 0) printf("Filling on j = %d\n", j);
-                                                        int tmp = (ll+rr)/2;
-                                                        data[i] = (signed short)tmp;
-                                        	        i++;
-                                        	}
-					}
-					}
-#endif
 
 					/* Flush the buffer if it is full. */
 					if (OutputPtr == OutputBufferEnd)
 					{
 						//if (write(OutputFd, OutputBuffer, OUTPUT_BUFFER_SIZE) != OUTPUT_BUFFER_SIZE)
-						if(audioDecoder->WriteClip(OutputBuffer, OUTPUT_BUFFER_SIZE) != OUTPUT_BUFFER_SIZE)
+						if(CAudioOut::getInstance()->WriteClip(OutputBuffer, OUTPUT_BUFFER_SIZE) != OUTPUT_BUFFER_SIZE)
 						{
 							fprintf(stderr,"%s: PCM write error in mono (%s).\n", ProgName, strerror(errno));
 							Status = WRITE_ERR;
@@ -846,21 +791,8 @@ q		 * next mad_frame_decode() invocation. (See the comments marked
 
 						OutputPtr = OutputBuffer;
 #ifdef SPECTRUM
-						if(g_settings.spectrum) {
-                                                	i = 0;
-                                                	j = 0;
-                                                	update_lcd = true;
-
-//gettimeofday (&tv2, NULL);
-//int ms = (tv2.tv_sec - tv1.tv_sec) * 1000 + (tv2.tv_usec - tv1.tv_usec) / 1000;
-//if(ms)printf("Write takes %dms\n", ms);
-#if HAVE_DBOX2
-							if(scnt >= SPECTRUM_CNT)
-#endif
-							{
-                                                		sanalyzer_render_freq(data);
-							}
-						}
+						if(g_settings.spectrum)
+							sanalyzer_feed((signed short *) OutputBuffer, OUTPUT_BUFFER_SIZE / 4);
 #endif
 					}
 				}
@@ -890,13 +822,13 @@ q		 * next mad_frame_decode() invocation. (See the comments marked
 		ssize_t	BufferSize=OutputPtr-OutputBuffer;
 
 		//if(write(OutputFd, OutputBuffer, BufferSize)!=BufferSize)
-		if(audioDecoder->WriteClip(OutputBuffer, BufferSize) != BufferSize)
+		if(CAudioOut::getInstance()->WriteClip(OutputBuffer, BufferSize) != BufferSize)
   		{
 			fprintf(stderr,"%s: PCM write error at the end (%s).\n", ProgName,strerror(errno));
 			Status=WRITE_ERR;
 		}
 	}
-	audioDecoder->StopClip();
+	CAudioOut::getInstance()->StopClip();
 #ifdef SPECTRUM
 	CVFD::getInstance ()->Unlock ();
 #endif
@@ -39,10 +39,10 @@
 #include <zapit/include/audio.h>
 
 #include "oggdec.h"
+#include "audioout.h"
 
 #include <driver/netfile.h>
 
-extern cAudio * audioDecoder;
 
 #define ProgName "OggDec"
 // nr of msecs to skip in ff/rev mode
@@ -94,9 +94,9 @@ CBaseDec::RetCode COggDec::Decoder(FILE *in, const int OutputFd, State* const st
   SetMetaData(&vf, meta_data);
 
 #if __BYTE_ORDER == __LITTLE_ENDIAN || USE_TREMOR
-  audioDecoder->PrepareClipPlay(ov_info(&vf,0)->channels, ov_info(&vf,0)->rate, 16, 1);
+  CAudioOut::getInstance()->PrepareClipPlay(ov_info(&vf,0)->channels, ov_info(&vf,0)->rate, 16, 1);
 #else
-  audioDecoder->PrepareClipPlay(ov_info(&vf,0)->channels, ov_info(&vf,0)->rate, 16, 0);
+  CAudioOut::getInstance()->PrepareClipPlay(ov_info(&vf,0)->channels, ov_info(&vf,0)->rate, 16, 0);
 #endif
 
   /* up and away ... */
@@ -202,7 +202,7 @@ CBaseDec::RetCode COggDec::Decoder(FILE *in, const int OutputFd, State* const st
   Status = WRITE_ERR;
   pthread_join(OutputThread, NULL);
   //printf("COggDec::Decoder: OutputThread join done\n");
-  audioDecoder->StopClip();
+  CAudioOut::getInstance()->StopClip();
   for(int i = 0 ; i < DECODE_SLOTS ; i++)
 	  free(mPcmSlots[i]);
 
@@ -225,7 +225,7 @@ void* COggDec::OutputDsp(void * arg)
 			usleep(10000);
 		}
 		//if (write(dec->mOutputFd, dec->mPcmSlots[dec->mReadSlot], dec->mSlotSize) != dec->mSlotSize)
-		if (audioDecoder->WriteClip((unsigned char *)dec->mPcmSlots[dec->mReadSlot], dec->mSlotSize) != dec->mSlotSize)
+		if (CAudioOut::getInstance()->WriteClip((unsigned char *)dec->mPcmSlots[dec->mReadSlot], dec->mSlotSize) != dec->mSlotSize)
 		{
 			fprintf(stderr,"%s: PCM write error (%s).\n", ProgName, strerror(errno));
 			dec->Status=WRITE_ERR;
@@ -0,0 +1,451 @@
+/*
+	Neutrino-GUI  -   DBoxII-Project
+
+	fixed point spectrum analyzer and VU meter kernels
+
+	The 512 point real FFT is done as a 256 point complex FFT of the even
+	and odd samples, followed by a split step. All butterflies work on 16
+	bit integers with separate real and imaginary arrays, so eight of them
+	fit in one NEON or SSE2 register. Each stage scales by 1/2, so nothing
+	can overflow.
+
+	Build with -DSPECTRUM_BENCHMARK for a standalone micro benchmark:
+	g++ -O2 -DSPECTRUM_BENCHMARK -o spectrum-bench spectrum.cpp -lpthread
+
+	License: GPL
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SPECTRUM_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SPECTRUM_SSE2
+#endif
+
+#include "spectrum.h"
+
+/* complex FFT size */
+#define FFT_N		(SPECTRUM_SAMPLES / 2)
+/* first stage done with vectors */
+#define SIMD_H		8
+#define DB_MIN		-100
+
+#define ALIGNED		__attribute__((aligned(16)))
+
+/* Hann window, Q15 */
+static short window[SPECTRUM_SAMPLES] ALIGNED;
+/* twiddles of the stage with half size h at [h .. 2h - 1], Q15 */
+static short tw_re[FFT_N] ALIGNED;
+static short tw_im[FFT_N] ALIGNED;
+/* twiddles of the real split step, Q15 */
+static short rtw_re[FFT_N];
+static short rtw_im[FFT_N];
+static unsigned char bitrev[FFT_N];
+/* 1000 * 10 * log10(1 + i / 128) */
+static short log_frac[128];
+/* reference levels in milli dB */
+static int ref_fft;
+static int ref_vu;
+
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+
+/* 1000 * 10 * log10(p) */
+static inline int mdb(uint32_t p)
+{
+	if (!p)
+		return -1000000000;
+	int e = 31 - __builtin_clz(p);
+	uint32_t m = (e >= 7) ? (p >> (e - 7)) : (p << (7 - e));
+	return e * 30103 / 10 + log_frac[m & 0x7f];
+}
+
+static inline short to_db(uint32_t p, int ref)
+{
+	int db = (mdb(p) - ref) / 1000;
+	if (db > 0)
+		return 0;
+	if (db < DB_MIN)
+		return DB_MIN;
+	return db;
+}
+
+/* (a * b) >> 16, with a Q15 b that is a * b / 2 */
+static inline short mulhi(short a, short b)
+{
+	return (a * b) >> 16;
+}
+
+static inline void butterfly(short *re, short *im, int i, int j, short wr, short wi)
+{
+	int tr = mulhi(re[j], wr) - mulhi(im[j], wi);
+	int ti = mulhi(re[j], wi) + mulhi(im[j], wr);
+	int ar = re[i] >> 1;
+	int ai = im[i] >> 1;
+	re[j] = ar - tr;
+	im[j] = ai - ti;
+	re[i] = ar + tr;
+	im[i] = ai + ti;
+}
+
+/* the window also scales by 1/2, so the packed complex input stays below
+ * full scale */
+static void window_c(const short *in, short *out)
+{
+	for (int i = 0; i < SPECTRUM_SAMPLES; i++)
+		out[i] = mulhi(in[i], window[i]);
+}
+
+static void stages_c(short *re, short *im, int h)
+{
+	for (; h < FFT_N; h <<= 1)
+		for (int g = 0; g < FFT_N; g += 2 * h)
+			for (int k = 0; k < h; k++)
+				butterfly(re, im, g + k, g + k + h, tw_re[h + k], tw_im[h + k]);
+}
+
+#if defined(SPECTRUM_NEON)
+/* vqdmulh is (2 * a * b) >> 16, b is never -32768 */
+#define VMULHI(a, b)	vshrq_n_s16(vqdmulhq_s16(a, b), 1)
+
+static void window_simd(const short *in, short *out)
+{
+	for (int i = 0; i < SPECTRUM_SAMPLES; i += 8)
+		vst1q_s16(out + i, VMULHI(vld1q_s16(in + i), vld1q_s16(window + i)));
+}
+
+static void stages_simd(short *re, short *im, int h)
+{
+	for (; h < FFT_N; h <<= 1)
+		for (int g = 0; g < FFT_N; g += 2 * h)
+			for (int k = 0; k < h; k += 8) {
+				int i = g + k, j = g + k + h;
+				int16x8_t wr = vld1q_s16(tw_re + h + k);
+				int16x8_t wi = vld1q_s16(tw_im + h + k);
+				int16x8_t xr = vld1q_s16(re + j);
+				int16x8_t xi = vld1q_s16(im + j);
+				int16x8_t tr = vqsubq_s16(VMULHI(xr, wr), VMULHI(xi, wi));
+				int16x8_t ti = vqaddq_s16(VMULHI(xr, wi), VMULHI(xi, wr));
+				int16x8_t ar = vshrq_n_s16(vld1q_s16(re + i), 1);
+				int16x8_t ai = vshrq_n_s16(vld1q_s16(im + i), 1);
+				vst1q_s16(re + j, vqsubq_s16(ar, tr));
+				vst1q_s16(im + j, vqsubq_s16(ai, ti));
+				vst1q_s16(re + i, vqaddq_s16(ar, tr));
+				vst1q_s16(im + i, vqaddq_s16(ai, ti));
+			}
+}
+
+static void vu_simd(const short *pcm, int frames, int64_t *l, int64_t *r)
+{
+	int64x2_t accl = vdupq_n_s64(0);
+	int64x2_t accr = vdupq_n_s64(0);
+	int i = 0;
+	for (; i + 8 <= frames; i += 8) {
+		int16x8x2_t v = vld2q_s16(pcm + 2 * i);
+		accl = vpadalq_s32(accl, vmull_s16(vget_low_s16(v.val[0]), vget_low_s16(v.val[0])));
+		accl = vpadalq_s32(accl, vmull_s16(vget_high_s16(v.val[0]), vget_high_s16(v.val[0])));
+		accr = vpadalq_s32(accr, vmull_s16(vget_low_s16(v.val[1]), vget_low_s16(v.val[1])));
+		accr = vpadalq_s32(accr, vmull_s16(vget_high_s16(v.val[1]), vget_high_s16(v.val[1])));
+	}
+	*l = vgetq_lane_s64(accl, 0) + vgetq_lane_s64(accl, 1);
+	*r = vgetq_lane_s64(accr, 0) + vgetq_lane_s64(accr, 1);
+	for (; i < frames; i++) {
+		*l += pcm[2 * i] * pcm[2 * i];
+		*r += pcm[2 * i + 1] * pcm[2 * i + 1];
+	}
+}
+#elif defined(SPECTRUM_SSE2)
+static void window_simd(const short *in, short *out)
+{
+	for (int i = 0; i < SPECTRUM_SAMPLES; i += 8) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(in + i));
+		__m128i w = _mm_load_si128((const __m128i *)(window + i));
+		_mm_storeu_si128((__m128i *)(out + i), _mm_mulhi_epi16(x, w));
+	}
+}
+
+static void stages_simd(short *re, short *im, int h)
+{
+	for (; h < FFT_N; h <<= 1)
+		for (int g = 0; g < FFT_N; g += 2 * h)
+			for (int k = 0; k < h; k += 8) {
+				int i = g + k, j = g + k + h;
+				__m128i wr = _mm_load_si128((const __m128i *)(tw_re + h + k));
+				__m128i wi = _mm_load_si128((const __m128i *)(tw_im + h + k));
+				__m128i xr = _mm_load_si128((const __m128i *)(re + j));
+				__m128i xi = _mm_load_si128((const __m128i *)(im + j));
+				__m128i tr = _mm_subs_epi16(_mm_mulhi_epi16(xr, wr), _mm_mulhi_epi16(xi, wi));
+				__m128i ti = _mm_adds_epi16(_mm_mulhi_epi16(xr, wi), _mm_mulhi_epi16(xi, wr));
+				__m128i ar = _mm_srai_epi16(_mm_load_si128((const __m128i *)(re + i)), 1);
+				__m128i ai = _mm_srai_epi16(_mm_load_si128((const __m128i *)(im + i)), 1);
+				_mm_store_si128((__m128i *)(re + j), _mm_subs_epi16(ar, tr));
+				_mm_store_si128((__m128i *)(im + j), _mm_subs_epi16(ai, ti));
+				_mm_store_si128((__m128i *)(re + i), _mm_adds_epi16(ar, tr));
+				_mm_store_si128((__m128i *)(im + i), _mm_adds_epi16(ai, ti));
+			}
+}
+
+static void vu_simd(const short *pcm, int frames, int64_t *l, int64_t *r)
+{
+	const __m128i mask = _mm_set1_epi32(0xffff);
+	const __m128i zero = _mm_setzero_si128();
+	__m128i accl = zero;
+	__m128i accr = zero;
+	int i = 0;
+	for (; i + 4 <= frames; i += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(pcm + 2 * i));
+		/* one channel per 32 bit lane, the other half zero */
+		__m128i vl = _mm_and_si128(v, mask);
+		__m128i vr = _mm_srli_epi32(v, 16);
+		__m128i sl = _mm_madd_epi16(vl, vl);
+		__m128i sr = _mm_madd_epi16(vr, vr);
+		/* squares are positive, widen to 64 bit */
+		accl = _mm_add_epi64(accl, _mm_unpacklo_epi32(sl, zero));
+		accl = _mm_add_epi64(accl, _mm_unpackhi_epi32(sl, zero));
+		accr = _mm_add_epi64(accr, _mm_unpacklo_epi32(sr, zero));
+		accr = _mm_add_epi64(accr, _mm_unpackhi_epi32(sr, zero));
+	}
+	int64_t tmp[2];
+	_mm_storeu_si128((__m128i *)tmp, accl);
+	*l = tmp[0] + tmp[1];
+	_mm_storeu_si128((__m128i *)tmp, accr);
+	*r = tmp[0] + tmp[1];
+	for (; i < frames; i++) {
+		*l += pcm[2 * i] * pcm[2 * i];
+		*r += pcm[2 * i + 1] * pcm[2 * i + 1];
+	}
+}
+#endif
+
+static void vu_c(const short *pcm, int frames, int64_t *l, int64_t *r)
+{
+	*l = *r = 0;
+	for (int i = 0; i < frames; i++) {
+		*l += pcm[2 * i] * pcm[2 * i];
+		*r += pcm[2 * i + 1] * pcm[2 * i + 1];
+	}
+}
+
+/* power of the bins, scaled by 1/2 */
+static void analyze(const short *in, uint32_t *power, bool simd)
+{
+	short tmp[SPECTRUM_SAMPLES] ALIGNED;
+	short re[FFT_N] ALIGNED;
+	short im[FFT_N] ALIGNED;
+
+#if defined(SPECTRUM_NEON) || defined(SPECTRUM_SSE2)
+	if (simd)
+		window_simd(in, tmp);
+	else
+#endif
+		window_c(in, tmp);
+
+	/* even samples are the real, odd ones the imaginary part */
+	for (int n = 0; n < FFT_N; n++) {
+		re[bitrev[n]] = tmp[2 * n];
+		im[bitrev[n]] = tmp[2 * n + 1];
+	}
+
+#if defined(SPECTRUM_NEON) || defined(SPECTRUM_SSE2)
+	if (simd) {
+		/* the short stages do not fill a vector */
+		for (int h = 1; h < SIMD_H; h <<= 1)
+			for (int g = 0; g < FFT_N; g += 2 * h)
+				for (int k = 0; k < h; k++)
+					butterfly(re, im, g + k, g + k + h, tw_re[h + k], tw_im[h + k]);
+		stages_simd(re, im, SIMD_H);
+	} else
+#endif
+		stages_c(re, im, 1);
+
+	/* split into the spectrum of the real input:
+	 * X[k] = (Z[k] + Z*[N-k]) / 2 + W^k (Z[k] - Z*[N-k]) / 2i */
+	for (int k = 0; k < FFT_N; k++) {
+		int c = (FFT_N - k) & (FFT_N - 1);
+		int er = (re[k] + re[c]) >> 1;
+		int ei = (im[k] - im[c]) >> 1;
+		int or_ = (im[k] + im[c]) >> 1;
+		int oi = (re[c] - re[k]) >> 1;
+		int xr = er + ((or_ * rtw_re[k] - oi * rtw_im[k]) >> 15);
+		int xi = ei + ((or_ * rtw_im[k] + oi * rtw_re[k]) >> 15);
+		power[k] = ((uint32_t)(xr * xr) >> 1) + ((uint32_t)(xi * xi) >> 1);
+	}
+}
+
+static void spectrum_init(void)
+{
+	for (int i = 0; i < SPECTRUM_SAMPLES; i++)
+		window[i] = (short) lrint(32767.0 * 0.5 * (1.0 - cos(2.0 * M_PI * i / (SPECTRUM_SAMPLES - 1))));
+	for (int h = 1; h < FFT_N; h <<= 1)
+		for (int k = 0; k < h; k++) {
+			tw_re[h + k] = (short) lrint(32767.0 * cos(M_PI * k / h));
+			tw_im[h + k] = (short) lrint(-32767.0 * sin(M_PI * k / h));
+		}
+	for (int k = 0; k < FFT_N; k++) {
+		rtw_re[k] = (short) lrint(32767.0 * cos(2.0 * M_PI * k / SPECTRUM_SAMPLES));
+		rtw_im[k] = (short) lrint(-32767.0 * sin(2.0 * M_PI * k / SPECTRUM_SAMPLES));
+	}
+	for (int n = 0; n < FFT_N; n++) {
+		int r = 0;
+		for (int b = 1, m = FFT_N >> 1; b < FFT_N; b <<= 1, m >>= 1)
+			if (n & b)
+				r |= m;
+		bitrev[n] = r;
+	}
+	for (int i = 0; i < 128; i++)
+		log_frac[i] = (short) lrint(10000.0 * log10(1.0 + i / 128.0));
+
+	/* full scale: a sine at the center of a bin, resp. a square wave */
+	short sine[SPECTRUM_SAMPLES];
+	uint32_t power[FFT_N];
+	for (int i = 0; i < SPECTRUM_SAMPLES; i++)
+		sine[i] = (short) lrint(32767.0 * sin(2.0 * M_PI * 64 * i / SPECTRUM_SAMPLES));
+	analyze(sine, power, false);
+	ref_fft = mdb(power[64]);
+	ref_vu = mdb(32767u * 32767u);
+}
+
+static void bins_to_db(const uint32_t *power, short *db)
+{
+	for (int k = 0; k < FFT_N; k++)
+		db[k] = to_db(power[k], ref_fft);
+}
+
+static void vu_to_db(int64_t l, int64_t r, int frames, int *left, int *right)
+{
+	if (frames <= 0) {
+		*left = *right = DB_MIN;
+		return;
+	}
+	*left = to_db((uint32_t)(l / frames), ref_vu);
+	*right = to_db((uint32_t)(r / frames), ref_vu);
+}
+
+void spectrum_analyze_c(const short *in, short *db)
+{
+	uint32_t power[FFT_N];
+	pthread_once(&init_once, spectrum_init);
+	analyze(in, power, false);
+	bins_to_db(power, db);
+}
+
+void spectrum_vu_c(const short *pcm, int frames, int *left, int *right)
+{
+	int64_t l, r;
+	pthread_once(&init_once, spectrum_init);
+	vu_c(pcm, frames, &l, &r);
+	vu_to_db(l, r, frames, left, right);
+}
+
+#if defined(SPECTRUM_NEON) || defined(SPECTRUM_SSE2)
+void spectrum_analyze(const short *in, short *db)
+{
+	uint32_t power[FFT_N];
+	pthread_once(&init_once, spectrum_init);
+	analyze(in, power, true);
+	bins_to_db(power, db);
+}
+
+void spectrum_vu(const short *pcm, int frames, int *left, int *right)
+{
+	int64_t l, r;
+	pthread_once(&init_once, spectrum_init);
+	vu_simd(pcm, frames, &l, &r);
+	vu_to_db(l, r, frames, left, right);
+}
+#else
+void spectrum_analyze(const short *in, short *db)
+{
+	spectrum_analyze_c(in, db);
+}
+
+void spectrum_vu(const short *pcm, int frames, int *left, int *right)
+{
+	spectrum_vu_c(pcm, frames, left, right);
+}
+#endif
+
+#ifdef SPECTRUM_BENCHMARK
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+	int loops = (argc > 1) ? atoi(argv[1]) : 100000;
+	short mono[SPECTRUM_SAMPLES];
+	short stereo[2 * 1152];
+	short db_c[SPECTRUM_BINS], db_simd[SPECTRUM_BINS];
+	int l_c, r_c, l_simd, r_simd;
+
+	srand(1);
+	for (int i = 0; i < SPECTRUM_SAMPLES; i++)
+		mono[i] = (short)(12000.0 * sin(2.0 * M_PI * 21.3 * i / SPECTRUM_SAMPLES) +
+				  6000.0 * sin(2.0 * M_PI * 97.0 * i / SPECTRUM_SAMPLES) +
+				  (rand() % 2001) - 1000);
+	for (int i = 0; i < 1152; i++) {
+		stereo[2 * i] = (short)(rand() % 65536 - 32768);
+		stereo[2 * i + 1] = (short)((rand() % 65536 - 32768) / 8);
+	}
+
+	spectrum_analyze_c(mono, db_c);
+	spectrum_analyze(mono, db_simd);
+	int maxdiff = 0;
+	for (int k = 0; k < SPECTRUM_BINS; k++)
+		if (abs(db_c[k] - db_simd[k]) > maxdiff)
+			maxdiff = abs(db_c[k] - db_simd[k]);
+	spectrum_vu_c(stereo, 1152, &l_c, &r_c);
+	spectrum_vu(stereo, 1152, &l_simd, &r_simd);
+	printf("bins 21/64/97: %d %d %d dB, max diff c/simd %d dB\n", db_c[21], db_c[64], db_c[97], maxdiff);
+	printf("vu: c %d/%d dB, simd %d/%d dB\n", l_c, r_c, l_simd, r_simd);
+
+	double t = now();
+	for (int i = 0; i < loops; i++)
+		spectrum_analyze_c(mono, db_c);
+	double t_c = now() - t;
+	t = now();
+	for (int i = 0; i < loops; i++)
+		spectrum_analyze(mono, db_simd);
+	double t_simd = now() - t;
+	printf("fft %d: c %.0f ns, simd %.0f ns per block\n", SPECTRUM_SAMPLES,
+		t_c * 1e9 / loops, t_simd * 1e9 / loops);
+
+	t = now();
+	for (int i = 0; i < loops; i++)
+		spectrum_vu_c(stereo, 1152, &l_c, &r_c);
+	t_c = now() - t;
+	t = now();
+	for (int i = 0; i < loops; i++)
+		spectrum_vu(stereo, 1152, &l_simd, &r_simd);
+	t_simd = now() - t;
+	printf("vu 1152 frames: c %.0f ns, simd %.0f ns per block\n",
+		t_c * 1e9 / loops, t_simd * 1e9 / loops);
+	return 0;
+}
+#endif
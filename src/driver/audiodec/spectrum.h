@@ -0,0 +1,45 @@
+/*
+	Neutrino-GUI  -   DBoxII-Project
+
+	fixed point spectrum analyzer and VU meter kernels
+
+	License: GPL
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#ifndef __SPECTRUM_H__
+#define __SPECTRUM_H__
+
+/* real FFT size in samples, gives SPECTRUM_SAMPLES / 2 frequency bins */
+#define SPECTRUM_SAMPLES	512
+#define SPECTRUM_BINS		(SPECTRUM_SAMPLES / 2)
+
+/* all kernels work on 16 bit integers and are vectorized with NEON or SSE2
+ * when the compiler targets it, with a plain C fallback otherwise */
+
+/* loudness of each bin of a block of SPECTRUM_SAMPLES mono samples, in dB
+ * relative to a full scale sine (0 .. -100). a Hann window is applied */
+void spectrum_analyze(const short *in, short *db);
+
+/* VU meter over interleaved 16 bit stereo, in dB relative to full scale
+ * (0 .. -100) */
+void spectrum_vu(const short *pcm, int frames, int *left, int *right);
+
+/* the same without SIMD, for comparison */
+void spectrum_analyze_c(const short *in, short *db);
+void spectrum_vu_c(const short *pcm, int frames, int *left, int *right);
+
+#endif
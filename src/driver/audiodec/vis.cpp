@@ -1,18 +1,11 @@
 #include <sys/time.h>
 #include <sys/types.h>
-#include <sys/stat.h>
-#include <sys/socket.h>
-#include <sys/un.h>
 #include <unistd.h>
-#include <dirent.h>
-#include <errno.h>
-#include <pthread.h>
 
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 
-#include <math.h>
 #ifdef HAVE_CONFIG_H
 #include <config.h>
 #endif
@@ -28,81 +21,40 @@
 #include <driver/lcdd.h>
 #endif
 
-#include "int_fft.c"
-
-typedef signed short gint16;
-typedef int gint;
-typedef float gfloat;
-typedef double gdouble;
+#include "spectrum.h"
 
 #define NUM_BANDS 16
 #define WIDTH (120/NUM_BANDS)
 #define HEIGHT 64
 #define FALL 2
 #define FALLOFF 1
+/* the display does not show more, so analyze at most every ... */
+#define INTERVAL_MS 40
 
-#if 0
 static int bar_heights[NUM_BANDS];
 static int falloffs[NUM_BANDS];
-static gdouble scale = 0;
-
-static gint xscale128[] = { 0, 1, 2, 3, 4, 6, 8, 9, 10, 14, 20, 27, 37, 50, 67, 94, 127 };
-static gint xscale256[] = { 0, 1, 2, 3, 5, 7, 10, 14, 20, 28, 40, 54, 74, 101, 137, 187, 255 };
-static gint xscale512[] = { 0, 2, 4, 6, 10, 14, 20, 28, 40, 56, 80, 108, 148, 202, 274, 374, 510 };
-#endif
-//#define DEBUG
-#if HAVE_DBOX2
-#define SAMPLES 256
-#define LOG 8
-#define xscale xscale128
-#else
-#define SAMPLES 512
-#define LOG 9
-#define xscale xscale256
-#endif
+static int xscale[] = { 0, 1, 2, 3, 5, 7, 10, 14, 20, 28, 40, 54, 74, 101, 137, 187, 255 };
 
-#if 0
-static void do_fft(gint16 out_data[], gint16 in_data[])
-{
-	gint16 im[SAMPLES];
+static short block[SPECTRUM_SAMPLES];
+static int block_fill = 0;
+static struct timeval last_render;
 
-	memset(im, 0, sizeof(im));
-	window(in_data, SAMPLES);
-	fix_fft(in_data, im, LOG, 0);
-	fix_loud(out_data, in_data, im, SAMPLES/2, 0);
-}
-#endif
-//static int threshold = -60;
-void sanalyzer_render_freq (gint16 /*in_data*/[])
+static int threshold = -60;
+void sanalyzer_render_freq (short in_data[])
 {
-#if 0
-  gint i, c;
-  gint y;
-  gint16 freq_data[1024];
+  int i, c;
+  int y;
+  short freq_data[SPECTRUM_BINS];
   static int fl = 0;
 
-#ifdef DEBUG
-struct timeval tv1, tv2;
-gettimeofday (&tv1, NULL);
-#endif
-  do_fft (freq_data, in_data);
+  spectrum_analyze (in_data, freq_data);
 
+#if 0 // FIXME: no bar drawing in CVFD
   CVFD::getInstance ()->Clear ();
-#ifdef DEBUG
-//gettimeofday (&tv1, NULL);
 #endif
   for (i = 0; i < NUM_BANDS; i++) {
 	y = 0;
 
-#if 0 // using max value
-        for (c = xscale[i]; c < xscale[i + 1]; c++) {
-          if(freq_data[c] > threshold) {
-            int val = freq_data[c]-threshold;
-            if (val > y)
-                y = val;
-          }
-        }
-#else
         int val = 0;
         int cnt = 0;
         for (c = xscale[i]; c < xscale[i + 1]; c++) {
@@ -112,7 +64,6 @@ gettimeofday (&tv1, NULL);
           }
         }
         if(cnt) y = val/cnt;
-#endif
 
 	if (y > HEIGHT - 1)
 		y = HEIGHT - 1;
@@ -135,61 +86,65 @@ gettimeofday (&tv1, NULL);
 	}
 	else
 	  falloffs[i] = 0;
+#if 0
   	CVFD::getInstance ()->drawBar (i*WIDTH, 64-falloffs[i]-5, WIDTH, 2);
 	y = bar_heights[i];
   	CVFD::getInstance ()->drawBar (i*WIDTH, 64-y, WIDTH, y);
+#endif
   }
 
-#ifdef DEBUG
-gettimeofday (&tv2, NULL);
-printf("Calc takes %dns\n", (tv2.tv_sec - tv1.tv_sec) * 1000000 + (tv2.tv_usec - tv1.tv_usec));
-#endif
+#if 0
   CVFD::getInstance ()->Update ();
 #endif
 }
-#if 0
-void sanalyzer_render_vu (gint16 in_data[2][512])
+
+void sanalyzer_render_vu (const short *pcm, int frames)
 {
-  long delay_value;
-  int a = 0,b = 0, c;
-  float max = 32767.50;
-  float db_min = (float) -91;
-  float channel_data[2] = { 0.0, 0.0};
+  int a, b;
   static int olda = 0, oldb = 0;
-return;
-#ifdef DEBUG
-//struct timeval tv1, tv2;
-//gettimeofday (&tv1, NULL);
-#endif
-  for (c = 0; c < 512; c += 2) {
-	channel_data[0] += (float) (in_data[0][c] * in_data[0][c]);
-	channel_data[1] += (float) (in_data[1][c] * in_data[1][c]);
-  }
-  channel_data[0] = 20 * log10 (sqrt (channel_data[0] / 256.0) / max);
-  channel_data[1] = 20 * log10 (sqrt (channel_data[1] / 256.0) / max);
-
-  a = channel_data[0] + 91;
-  b = channel_data[1] + 91;
-//printf ("channel0: %d\n", a);
-//printf ("channel1: %d\n", b);
-#ifdef DEBUG
-//gettimeofday (&tv2, NULL);
-//printf("Calc takes %dms\n", (tv2.tv_sec - tv1.tv_sec) * 1000 + (tv2.tv_usec - tv1.tv_usec) / 1000);
-#endif
+
+  spectrum_vu (pcm, frames, &a, &b);
+  a += 91;
+  b += 91;
   if(a != olda || b != oldb) {
+	olda = a;
+	oldb = b;
+#if 0
   	CVFD::getInstance ()->Clear ();
   	CVFD::getInstance ()->drawBar (0, 8, a, 20);
   	CVFD::getInstance ()->drawBar (0, 36, b, 20);
-#ifdef DEBUG
-//gettimeofday (&tv1, NULL);
-#endif
   	CVFD::getInstance ()->Update ();
-#ifdef DEBUG
-//gettimeofday (&tv2, NULL);
-//int ms = (tv2.tv_sec - tv1.tv_sec) * 1000 + (tv2.tv_usec - tv1.tv_usec) / 1000;
-//if(ms) printf("Update takes %dms\n", ms);
 #endif
   }
-  return;
 }
-#endif
+
+/* decoder output, interleaved 16 bit stereo. only one block per interval is
+ * analyzed, and nothing at all while the spectrum is off */
+void sanalyzer_feed (const short *pcm, int frames)
+{
+  if (!g_settings.spectrum) {
+	block_fill = 0;
+	return;
+  }
+
+  if (block_fill == 0) {
+	struct timeval now;
+	gettimeofday (&now, NULL);
+	long ms = (now.tv_sec - last_render.tv_sec) * 1000 + (now.tv_usec - last_render.tv_usec) / 1000;
+	if (ms >= 0 && ms < INTERVAL_MS)
+		return;
+	last_render = now;
+  }
+
+  int n = SPECTRUM_SAMPLES - block_fill;
+  if (n > frames)
+	n = frames;
+  for (int i = 0; i < n; i++)
+	block[block_fill + i] = (pcm[2 * i] + pcm[2 * i + 1]) / 2;
+  block_fill += n;
+
+  if (block_fill == SPECTRUM_SAMPLES) {
+	block_fill = 0;
+	sanalyzer_render_freq (block);
+  }
+}
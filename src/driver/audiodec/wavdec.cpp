@@ -40,8 +40,8 @@
 #include <zapit/include/audio.h>
 
 #include "wavdec.h"
+#include "audioout.h"
 
-extern cAudio * audioDecoder;
 
 #define ProgName "WavDec"
 // nr of msecs to skip in ff/rev mode
@@ -111,9 +111,9 @@ CBaseDec::RetCode CWavDec::Decoder(FILE *in, int /*OutputFd*/, State* state, CAu
 	}
 #endif
 #if __BYTE_ORDER == __LITTLE_ENDIAN
-	audioDecoder->PrepareClipPlay(mChannels, meta_data->samplerate, mBitsPerSample, 1);
+	CAudioOut::getInstance()->PrepareClipPlay(mChannels, meta_data->samplerate, mBitsPerSample, 1);
 #else
-	audioDecoder->PrepareClipPlay(mChannels, meta_data->samplerate, mBitsPerSample, 0);
+	CAudioOut::getInstance()->PrepareClipPlay(mChannels, meta_data->samplerate, mBitsPerSample, 0);
 #endif
 	int actSecsToSkip = (*secondsToSkip != 0) ? *secondsToSkip : MSECS_TO_SKIP / 1000;
 	unsigned int oldSecsToSkip = *secondsToSkip;
@@ -166,14 +166,14 @@ CBaseDec::RetCode CWavDec::Decoder(FILE *in, int /*OutputFd*/, State* state, CAu
 
 		bytes = fread(buffer, 1, buffersize, in);
 		//if (write(OutputFd, buffer, bytes) != bytes)
-		if(audioDecoder->WriteClip((unsigned char*) buffer, bytes) != bytes)
+		if(CAudioOut::getInstance()->WriteClip((unsigned char*) buffer, bytes) != bytes)
 		{
 			fprintf(stderr,"%s: PCM write error (%s).\n", ProgName, strerror(errno));
 			Status=WRITE_ERR;
 		}
 		*time_played = (meta_data->bitrate!=0) ? (ftell(in)-header_size)*8/meta_data->bitrate : 0;
 	} while (bytes > 0 && *state!=STOP_REQ && Status==OK);
-	audioDecoder->StopClip();
+	CAudioOut::getInstance()->StopClip();
 	free(buffer);
 	return Status;
 }
@@ -36,21 +36,33 @@
 #endif
 #include <global.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <fcntl.h>
 #include <sched.h>
+#include <OpenThreads/ScopedLock>
 
 #include <neutrino.h>
 #include <driver/audioplay.h>
+#include <driver/audiodec/audioout.h>
 #include <driver/netfile.h>
 #include <eitd/edvbstring.h> // UTF8
 #include <system/set_threadname.h>
 
+/* start of the next file the kernel should read ahead */
+#define PREFETCH_SIZE (1024 * 1024)
+
 void CAudioPlayer::stop()
 {
 	state = CBaseDec::STOP_REQ;
+	setNext(NULL);
+	/* unblock a decoder waiting for space in the output ring */
+	CAudioOut::getInstance()->Pause(false);
+	CAudioOut::getInstance()->Flush();
 	if(thrPlay)
 		pthread_join(thrPlay,NULL);
 	thrPlay = 0;
+	CAudioOut::getInstance()->Flush(true);
 	state = CBaseDec::STOP;
 }
 void CAudioPlayer::pause()
@@ -59,6 +71,7 @@ void CAudioPlayer::pause()
       state=CBaseDec::PAUSE;
    else if(state==CBaseDec::PAUSE)
       state=CBaseDec::PLAY;
+   CAudioOut::getInstance()->Pause(state==CBaseDec::PAUSE);
 }
 void CAudioPlayer::ff(unsigned int seconds)
 {
@@ -67,6 +80,8 @@ void CAudioPlayer::ff(unsigned int seconds)
 		state=CBaseDec::FF;
 	else if(state==CBaseDec::FF)
 		state=CBaseDec::PLAY;
+	/* drop buffered audio from before the jump */
+	CAudioOut::getInstance()->Flush();
 }
 void CAudioPlayer::rev(unsigned int seconds)
 {
@@ -75,6 +90,7 @@ void CAudioPlayer::rev(unsigned int seconds)
 		state=CBaseDec::REV;
 	else if(state==CBaseDec::REV)
 		state=CBaseDec::PLAY;
+	CAudioOut::getInstance()->Flush();
 }
 CAudioPlayer* CAudioPlayer::getInstance()
 {
@@ -90,23 +106,27 @@ void* CAudioPlayer::PlayThread( void* /*dummy*/ )
 {
 	int soundfd = -1;
 	set_threadname("audio:play");
-	/* Decode stdin to stdout. */
-	CBaseDec::RetCode Status =
-		CBaseDec::DecoderBase( &getInstance()->m_Audiofile, soundfd,
+	CBaseDec::RetCode Status;
+	/* go on with the next file without leaving the thread, the output
+	   ring still plays the end of the last one meanwhile */
+	do {
+		/* Decode stdin to stdout. */
+		Status = CBaseDec::DecoderBase( &getInstance()->m_Audiofile, soundfd,
 				&getInstance()->state,
 				&getInstance()->m_played_time,
 				&getInstance()->m_SecondsToSkip );
 
-	if (Status != CBaseDec::OK)
-	{
-		fprintf( stderr, "Error during decoding: %s.\n",
-				( Status == CBaseDec::READ_ERR ) ? "READ_ERR" :
-				( Status == CBaseDec::WRITE_ERR ) ? "WRITE_ERR" :
-				( Status == CBaseDec::DSPSET_ERR ) ? "DSPSET_ERR" :
-				( Status == CBaseDec::DATA_ERR ) ? "DATA_ERR" :
-				( Status == CBaseDec::INTERNAL_ERR ) ? "INTERNAL_ERR" :
-				"unknown" );
-	}
+		if (Status != CBaseDec::OK)
+		{
+			fprintf( stderr, "Error during decoding: %s.\n",
+					( Status == CBaseDec::READ_ERR ) ? "READ_ERR" :
+					( Status == CBaseDec::WRITE_ERR ) ? "WRITE_ERR" :
+					( Status == CBaseDec::DSPSET_ERR ) ? "DSPSET_ERR" :
+					( Status == CBaseDec::DATA_ERR ) ? "DATA_ERR" :
+					( Status == CBaseDec::INTERNAL_ERR ) ? "INTERNAL_ERR" :
+					"unknown" );
+		}
+	} while (Status == CBaseDec::OK && getInstance()->startNextFile());
 
 	getInstance()->state = CBaseDec::STOP;
 	pthread_exit(0);
@@ -118,6 +138,7 @@ bool CAudioPlayer::play(const CAudiofile* file, const bool highPrio)
 	if (state != CBaseDec::STOP)
 		stop();
 	getInstance()->clearFileData();
+	CAudioOut::getInstance()->SetBuffer(g_settings.audioplayer_buffer);
 
 	/* + transfer information from CAudiofile to member variable,
 		 so that it does not have to be gathered again
@@ -125,7 +146,11 @@ bool CAudioPlayer::play(const CAudiofile* file, const bool highPrio)
 		 crash if the file currently played was deleted from the
 		 playlist
 	*/
+	m_Mutex.lock();
 	m_Audiofile = *file;
+	m_has_next = false;
+	m_track_changed = false;
+	m_Mutex.unlock();
 
 	state = CBaseDec::PLAY;
 	pthread_attr_t attr;
@@ -153,6 +178,72 @@ bool CAudioPlayer::play(const CAudiofile* file, const bool highPrio)
 	return ret;
 }
 
+void CAudioPlayer::setNext(const CAudiofile* file)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(m_Mutex);
+	m_has_next = (file != NULL && file->FileType != CFile::STREAM_AUDIO);
+	if (!m_has_next)
+	{
+		m_Nextfile.clear();
+		return;
+	}
+	m_Nextfile = *file;
+
+	char *fname = strdup(file->Filename.c_str());
+	pthread_t thrPrefetch;
+	if (pthread_create(&thrPrefetch, NULL, PrefetchThread, fname) == 0)
+		pthread_detach(thrPrefetch);
+	else
+		free(fname);
+}
+
+/* get the start of the next file into the page cache while the current
+   one plays, so a slow disk or NFS server does not stall the change */
+void* CAudioPlayer::PrefetchThread(void* arg)
+{
+	char *fname = (char *) arg;
+	set_threadname("audio:prefetch");
+	int fd = open(fname, O_RDONLY | O_CLOEXEC);
+	if (fd > -1)
+	{
+		posix_fadvise(fd, 0, PREFETCH_SIZE, POSIX_FADV_WILLNEED);
+		close(fd);
+	}
+	free(fname);
+	pthread_exit(0);
+	return NULL;
+}
+
+bool CAudioPlayer::startNextFile()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(m_Mutex);
+	if (!m_has_next || state == CBaseDec::STOP_REQ)
+		return false;
+	m_Audiofile = m_Nextfile;
+	m_Nextfile.clear();
+	m_has_next = false;
+	m_played_time = 0;
+	m_sc_buffered = 0;
+	m_SecondsToSkip = 0;
+	m_track_changed = true;
+	state = CBaseDec::PLAY;
+	return true;
+}
+
+bool CAudioPlayer::hasTrackChanged()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(m_Mutex);
+	bool ret = m_track_changed;
+	m_track_changed = false;
+	return ret;
+}
+
+std::string CAudioPlayer::getFilename()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(m_Mutex);
+	return m_Audiofile.Filename;
+}
+
 CAudioPlayer::CAudioPlayer()
 {
 	init();
@@ -164,6 +255,8 @@ void CAudioPlayer::init()
 	state = CBaseDec::STOP;
 	thrPlay = 0;
 	m_SecondsToSkip = 0;
+	m_has_next = false;
+	m_track_changed = false;
 }
 
 void CAudioPlayer::sc_callback(void *arg)
@@ -215,6 +308,7 @@ void CAudioPlayer::clearFileData()
 
 CAudioMetaData CAudioPlayer::getMetaData()
 {
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(m_Mutex);
 	CAudioMetaData m = m_Audiofile.MetaData;
 	m_Audiofile.MetaData.changed=false;
 	return m;
@@ -27,6 +27,7 @@
 #define __AUDIO_PLAY__
 
 #include <pthread.h>
+#include <OpenThreads/Mutex>
 #include <driver/audiodec/basedec.h>
 #include <driver/audiofile.h>
 #include <driver/audiometadata.h>
@@ -40,15 +41,28 @@ private:
 	pthread_t	thrPlay;
 	CBaseDec::State state;
 	static void* PlayThread(void*);
+	static void* PrefetchThread(void*);
 	void clearFileData();
+	bool startNextFile();
 	unsigned int m_SecondsToSkip;
 
+	/* next file for gapless playback */
+	OpenThreads::Mutex m_Mutex;
+	CAudiofile m_Nextfile;
+	bool m_has_next;
+	bool m_track_changed;
+
 protected: 
 	CAudiofile m_Audiofile;
 
 public:
 	static CAudioPlayer* getInstance();
 	bool play(const CAudiofile*, const bool highPrio=false);
+	/* file to continue with when the current one ends, NULL to clear */
+	void setNext(const CAudiofile*);
+	/* the player went on to the next file on its own */
+	bool hasTrackChanged();
+	std::string getFilename();
 	void stop();
 	void pause();
 	void init();
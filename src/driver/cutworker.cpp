@@ -0,0 +1,236 @@
+/*
+	Neutrino-GUI  -   DBoxII-Project
+
+	background copy of recording spans for the movie cutter
+
+	License: GPL
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/syscall.h>
+
+#include <OpenThreads/ScopedLock>
+#include <driver/abstime.h>
+#include <driver/cutworker.h>
+#include <system/set_threadname.h>
+
+/* read/write fallback buffer */
+#define CUT_BUF_SIZE (1395*188)
+/* bytes per kernel call, small enough to cancel quickly */
+#define COPY_CHUNK (8*1024*1024)
+
+static ssize_t copy_file_range64(int fd_in, off64_t *off_in, int fd_out, off64_t *off_out, size_t len)
+{
+#ifdef __NR_copy_file_range
+	return syscall(__NR_copy_file_range, fd_in, off_in, fd_out, off_out, len, 0);
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+CCutWorker::CCutWorker()
+{
+	srcfd = dstfd = -1;
+	offset = length = copied = 0;
+	cancel = failed = running = started = false;
+	method = COPY_RANGE;
+	pipefd[0] = pipefd[1] = -1;
+	buf = NULL;
+}
+
+CCutWorker::~CCutWorker()
+{
+	Cancel();
+	Wait();
+	if (pipefd[0] >= 0) {
+		close(pipefd[0]);
+		close(pipefd[1]);
+	}
+	delete[] buf;
+}
+
+bool CCutWorker::Start(int src, int dst, off64_t off, off64_t len)
+{
+	srcfd = src;
+	dstfd = dst;
+	offset = off;
+	length = len;
+	copied = 0;
+	cancel = false;
+	failed = false;
+	running = true;
+	if (start()) {
+		running = false;
+		return false;
+	}
+	started = true;
+	return true;
+}
+
+void CCutWorker::Cancel()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+	cancel = true;
+}
+
+bool CCutWorker::Cancelled()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+	return cancel;
+}
+
+bool CCutWorker::Running()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+	return running;
+}
+
+bool CCutWorker::Wait()
+{
+	if (started) {
+		started = false;
+		join();
+	}
+	return !failed;
+}
+
+off64_t CCutWorker::Copied()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+	return copied;
+}
+
+ssize_t CCutWorker::copyRange(off64_t pos, size_t len)
+{
+	return copy_file_range64(srcfd, &pos, dstfd, NULL, len);
+}
+
+ssize_t CCutWorker::copySplice(off64_t pos, size_t len)
+{
+	if (pipefd[0] < 0 && pipe(pipefd))
+		return -1;
+
+	ssize_t in = splice(srcfd, &pos, pipefd[1], NULL, len, SPLICE_F_MOVE);
+	if (in <= 0)
+		return in;
+	ssize_t left = in;
+	while (left > 0) {
+		ssize_t out = splice(pipefd[0], NULL, dstfd, NULL, left, SPLICE_F_MOVE);
+		if (out < 0 && errno == EINTR)
+			continue;
+		if (out <= 0) {
+			if (out < 0 && errno != EINVAL)
+				return -1;
+			/* target does not take splice, flush the pipe by hand */
+			printf("CCutWorker::%s: splice to target failed, using read/write\n", __func__);
+			method = COPY_RW;
+			if (!buf)
+				buf = new unsigned char[CUT_BUF_SIZE];
+			while (left > 0) {
+				ssize_t r = read(pipefd[0], buf, left > CUT_BUF_SIZE ? CUT_BUF_SIZE : left);
+				if (r <= 0 || write(dstfd, buf, r) != r)
+					return -1;
+				left -= r;
+			}
+			break;
+		}
+		left -= out;
+	}
+	return in;
+}
+
+ssize_t CCutWorker::copyRW(off64_t pos, size_t len)
+{
+	if (!buf)
+		buf = new unsigned char[CUT_BUF_SIZE];
+	ssize_t r = pread64(srcfd, buf, len > CUT_BUF_SIZE ? CUT_BUF_SIZE : len, pos);
+	if (r <= 0)
+		return r;
+	ssize_t done = 0;
+	while (done < r) {
+		ssize_t w = write(dstfd, buf + done, r - done);
+		if (w < 0 && errno == EINTR)
+			continue;
+		if (w <= 0)
+			return -1;
+		done += w;
+	}
+	return r;
+}
+
+void CCutWorker::run()
+{
+	set_threadname("moviecut");
+	int64_t start = time_monotonic_ms();
+	off64_t pos = offset;
+	off64_t end = offset + length;
+	copy_method_t used = method;
+
+	while (pos < end && !Cancelled()) {
+		size_t len = (end - pos) > COPY_CHUNK ? COPY_CHUNK : end - pos;
+		ssize_t r;
+		if (method == COPY_RANGE) {
+			r = copyRange(pos, len);
+			if (r < 0 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP || errno == EBADF)) {
+				printf("CCutWorker::%s: copy_file_range: %s, using splice\n", __func__, strerror(errno));
+				method = COPY_SPLICE;
+				continue;
+			}
+		} else if (method == COPY_SPLICE) {
+			r = copySplice(pos, len);
+			if (r < 0 && (errno == ENOSYS || errno == EINVAL)) {
+				printf("CCutWorker::%s: splice: %s, using read/write\n", __func__, strerror(errno));
+				method = COPY_RW;
+				continue;
+			}
+		} else
+			r = copyRW(pos, len);
+
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r < 0) {
+			perror("CCutWorker");
+			failed = true;
+			break;
+		}
+		if (r == 0)	/* EOF */
+			break;
+		pos += r;
+		OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+		copied += r;
+	}
+	if (Cancelled())
+		failed = true;
+
+	int64_t ms = time_monotonic_ms() - start;
+	const char * mname[] = { "copy_file_range", "splice", "read/write" };
+	printf("CCutWorker::%s: %" PRId64 " bytes in %" PRId64 " ms (%" PRId64 " KB/s), %s%s\n", __func__, pos - offset, ms,
+			ms ? (pos - offset) / ms : 0, mname[used], used != method ? " with fallback" : "");
+
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+	running = false;
+}
@@ -0,0 +1,76 @@
+/*
+	Neutrino-GUI  -   DBoxII-Project
+
+	background copy of recording spans for the movie cutter
+
+	License: GPL
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#ifndef __cutworker_h__
+#define __cutworker_h__
+
+#include <sys/types.h>
+
+#include <OpenThreads/Thread>
+#include <OpenThreads/Mutex>
+
+/* copies a packet aligned span of a recording in the background. data is
+ * moved in the kernel with copy_file_range (server side copy on NFS 4.2,
+ * reflink on btrfs/xfs), falls back to splice and then to read/write */
+class CCutWorker : public OpenThreads::Thread
+{
+	public:
+		enum copy_method_t {
+			COPY_RANGE,
+			COPY_SPLICE,
+			COPY_RW
+		};
+	private:
+		int		srcfd;
+		int		dstfd;
+		off64_t		offset;
+		off64_t		length;
+		off64_t		copied;
+		bool		cancel;		/* set by the gui thread, under mutex */
+		bool		failed;
+		bool		running;
+		bool		started;	/* start() done, not joined yet */
+		copy_method_t	method;
+		int		pipefd[2];
+		unsigned char *	buf;
+		OpenThreads::Mutex mutex;
+
+		void run();
+		bool Cancelled();
+		ssize_t copyRange(off64_t pos, size_t len);
+		ssize_t copySplice(off64_t pos, size_t len);
+		ssize_t copyRW(off64_t pos, size_t len);
+	public:
+		CCutWorker();
+		~CCutWorker();
+		bool Start(int src, int dst, off64_t off, off64_t len);
+		void Cancel();
+		bool Running();
+		/* join once after Start(), false on error or cancel */
+		bool Wait();
+		off64_t Copied();
+		copy_method_t Method() { return method; }
+		/* method to try first, before Start() */
+		void SetMethod(copy_method_t m) { method = m; }
+};
+
+#endif
@@ -28,6 +28,7 @@
 
 #include <driver/fb_generic.h>
 #include <driver/fb_accel.h>
+#include <driver/fb_kernels.h>
 
 CFbAccel::CFbAccel()
 {
@@ -81,16 +82,7 @@ void CFbAccel::paintBoxRel(const int x, const int y, const int dx, const int dy,
 
 void CFbAccel::paintRect(const int x, const int y, const int dx, const int dy, const fb_pixel_t col)
 {
-	int line = 0;
-	fb_pixel_t *fbp = getFrameBufferPointer() + (swidth * y);
-	int pos;
-	while (line < dy)
-	{
-		for (pos = x; pos < x + dx; pos++)
-			*(fbp + pos) = col;
-		fbp += swidth;
-		line++;
-	}
+	fb_fill_rect(getFrameBufferPointer() + x + swidth * y, swidth, col, dx, dy);
 	mark(x, y, x+dx, y+dy);
 	blit();
 }
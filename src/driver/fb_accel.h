@@ -185,6 +185,53 @@ class CFbAccelGLFB
 		fb_pixel_t * getBackBufferPointer() const;
 };
 
+/* renders into memory, for tests and benchmarks without a display.
+   a frame ends when nothing was painted for a while, the painted area
+   and time are counted per frame and reported, frames can be saved */
+class CFbAccelHeadless
+	: public OpenThreads::Thread, public CFbAccel
+{
+	private:
+		void run(void);
+		void frameDone(void);
+		bool savePng(const std::string &file, const fb_pixel_t *data);
+		bool thread_running;
+		OpenThreads::Condition cond;
+		OpenThreads::Mutex mutex;
+		fb_pixel_t *backbuffer;
+		unsigned int width, height;
+		std::string dump_dir;
+		uint32_t last_crc;
+		/* current frame */
+		uint64_t frame_start;
+		uint64_t last_paint;
+		uint64_t frame_pixels;
+		unsigned int frame_ops;
+		/* since the last report */
+		unsigned int frames;
+		uint64_t paint_time;
+		uint64_t pixels;
+		unsigned int ops;
+		unsigned int dumped;
+		uint64_t last_report;
+		/* since start */
+		uint64_t total_pixels;
+		unsigned int total_ops;
+	public:
+		CFbAccelHeadless();
+		~CFbAccelHeadless();
+		void init(const char * const);
+		int setMode(unsigned int xRes, unsigned int yRes, unsigned int bpp);
+		void mark(int x, int y, int dx, int dy);
+		void blit2FB(void *fbbuff, uint32_t width, uint32_t height, uint32_t xoff, uint32_t yoff, uint32_t xp, uint32_t yp, bool transp);
+		void blitBox2FB(const fb_pixel_t* boxBuf, uint32_t width, uint32_t height, uint32_t xoff, uint32_t yoff);
+		void fbCopyArea(uint32_t width, uint32_t height, uint32_t dst_x, uint32_t dst_y, uint32_t src_x, uint32_t src_y);
+		fb_pixel_t * getBackBufferPointer() const;
+		/* for the replay check */
+		void getPainted(uint64_t &pixels, unsigned int &paints);
+		bool saveScreen(const std::string &file);
+};
+
 class CFbAccelTD
 	: public CFbAccel
 {
@@ -0,0 +1,284 @@
+/*
+	Framebuffer in memory, without any display hardware.
+
+	Selected with NEUTRINO_HEADLESS=<width>x<height> in the environment
+	(any other value: 1280x720). With NEUTRINO_HEADLESS_DUMP=<directory>
+	every frame, which differs from the one before, is saved as PNG there.
+	Screens can be replayed with the remote control emulation of nhttpd
+	(/control/rcem) or rcsim, or without the GUI with fb_replay.
+
+	License: GPL
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <driver/fb_generic.h>
+#include <driver/fb_accel.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <png.h>
+#include <zlib.h>
+
+#include <driver/abstime.h>
+#include <system/set_threadname.h>
+#include <gui/color.h>
+
+#define LOGTAG "[fb_headless] "
+
+/* nothing painted for so long: the frame is complete (ms) */
+#define FRAME_IDLE	40
+/* seconds between statistics */
+#define REPORT_INTERVAL	10
+
+CFbAccelHeadless::CFbAccelHeadless()
+{
+	fb_name = "headless framebuffer";
+	backbuffer = NULL;
+	thread_running = false;
+	width = 1280;
+	height = 720;
+	last_crc = 0;
+	frame_start = last_paint = frame_pixels = 0;
+	frame_ops = 0;
+	frames = 0;
+	paint_time = pixels = 0;
+	ops = dumped = 0;
+	last_report = 0;
+	total_pixels = 0;
+	total_ops = 0;
+}
+
+void CFbAccelHeadless::init(const char *)
+{
+	fd = -1;
+	const char *size = getenv("NEUTRINO_HEADLESS");
+	unsigned int w, h;
+	if (size && sscanf(size, "%ux%u", &w, &h) == 2 && w >= 720 && h >= 576 && w <= 4096 && h <= 2160) {
+		width = w;
+		height = h;
+	}
+	const char *dir = getenv("NEUTRINO_HEADLESS_DUMP");
+	if (dir && *dir)
+		dump_dir = dir;
+
+	/* front and back buffer */
+	available = width * height * sizeof(fb_pixel_t) * 2;
+	lbb = lfb = new fb_pixel_t[available / sizeof(fb_pixel_t)];
+	memset(lfb, 0, available);
+	setMode(width, height, 8 * sizeof(fb_pixel_t));
+	printf(LOGTAG "%ux%u, frames %s%s\n", width, height, dump_dir.empty() ? "not saved" : "saved to ", dump_dir.c_str());
+
+	/* Windows Colors */
+	int tr = 0xff;
+	paletteSetColor(0x1, 0x010101, tr);
+	paletteSetColor(0x2, 0x800000, tr);
+	paletteSetColor(0x3, 0x008000, tr);
+	paletteSetColor(0x4, 0x808000, tr);
+	paletteSetColor(0x5, 0x000080, tr);
+	paletteSetColor(0x6, 0x800080, tr);
+	paletteSetColor(0x7, 0x008080, tr);
+	paletteSetColor(0x8, 0xA0A0A0, tr);
+	paletteSetColor(0x9, 0x505050, tr);
+	paletteSetColor(0xA, 0xFF0000, tr);
+	paletteSetColor(0xB, 0x00FF00, tr);
+	paletteSetColor(0xC, 0xFFFF00, tr);
+	paletteSetColor(0xD, 0x0000FF, tr);
+	paletteSetColor(0xE, 0xFF00FF, tr);
+	paletteSetColor(0xF, 0x00FFFF, tr);
+	paletteSetColor(0x10, 0xFFFFFF, tr);
+	paletteSetColor(0x11, 0x000000, tr);
+	paletteSetColor(COL_BACKGROUND, 0x000000, 0x0);
+
+	paletteSet();
+
+	useBackground(false);
+	m_transparent = m_transparent_default;
+
+	thread_running = true;
+	OpenThreads::Thread::start();
+}
+
+CFbAccelHeadless::~CFbAccelHeadless()
+{
+	if (thread_running) {
+		mutex.lock();
+		thread_running = false;
+		cond.signal();
+		mutex.unlock();
+		OpenThreads::Thread::join();
+	}
+	/* the base class would munmap it */
+	delete[] lfb;
+	lbb = lfb = NULL;
+}
+
+/* the size is fixed, only the back buffer pointer is set */
+int CFbAccelHeadless::setMode(unsigned int, unsigned int, unsigned int)
+{
+	xRes = screeninfo.xres = screeninfo.xres_virtual = width;
+	yRes = screeninfo.yres = height;
+	screeninfo.yres_virtual = height * 2;
+	bpp = screeninfo.bits_per_pixel = 8 * sizeof(fb_pixel_t);
+	stride = width * sizeof(fb_pixel_t);
+	swidth = width;
+	backbuffer = lfb + swidth * yRes;
+	return 0;
+}
+
+fb_pixel_t * CFbAccelHeadless::getBackBufferPointer() const
+{
+	return backbuffer;
+}
+
+/* all painting ends here: fonts, boxes, lines and icons mark the area they
+   changed. overlapping paints are counted twice */
+void CFbAccelHeadless::mark(int xs, int ys, int xe, int ye)
+{
+	uint64_t area = (uint64_t)((xe > xs) ? xe - xs : 1) * ((ye > ys) ? ye - ys : 1);
+	uint64_t now = time_monotonic_us();
+	mutex.lock();
+	if (!frame_start) {
+		frame_start = now;
+		cond.signal();
+	}
+	last_paint = now;
+	frame_pixels += area;
+	frame_ops++;
+	total_pixels += area;
+	total_ops++;
+	mutex.unlock();
+}
+
+void CFbAccelHeadless::blit2FB(void *fbbuff, uint32_t _width, uint32_t _height, uint32_t xoff, uint32_t yoff, uint32_t xp, uint32_t yp, bool transp)
+{
+	CFrameBuffer::blit2FB(fbbuff, _width, _height, xoff, yoff, xp, yp, transp);
+	mark(xoff, yoff, xoff + _width, yoff + _height);
+}
+
+void CFbAccelHeadless::blitBox2FB(const fb_pixel_t* boxBuf, uint32_t _width, uint32_t _height, uint32_t xoff, uint32_t yoff)
+{
+	CFrameBuffer::blitBox2FB(boxBuf, _width, _height, xoff, yoff);
+	mark(xoff, yoff, xoff + _width, yoff + _height);
+}
+
+void CFbAccelHeadless::fbCopyArea(uint32_t _width, uint32_t _height, uint32_t dst_x, uint32_t dst_y, uint32_t src_x, uint32_t src_y)
+{
+	CFrameBuffer::fbCopyArea(_width, _height, dst_x, dst_y, src_x, src_y);
+	if (dst_y < yRes)
+		mark(dst_x, dst_y, dst_x + _width, dst_y + _height);
+}
+
+void CFbAccelHeadless::run()
+{
+	set_threadname("fb::headless");
+	fb_pixel_t *copy = NULL;
+	mutex.lock();
+	last_report = time_monotonic_us();
+	while (thread_running) {
+		cond.wait(&mutex, frame_start ? FRAME_IDLE : REPORT_INTERVAL * 1000);
+		uint64_t now = time_monotonic_us();
+		if (frame_start && now - last_paint >= FRAME_IDLE * 1000) {
+			frames++;
+			paint_time += last_paint - frame_start;
+			pixels += frame_pixels;
+			ops += frame_ops;
+			frame_start = 0;
+			frame_pixels = 0;
+			frame_ops = 0;
+			if (!dump_dir.empty()) {
+				/* the gui may paint again meanwhile, save a copy */
+				if (!copy)
+					copy = new fb_pixel_t[width * height];
+				memcpy(copy, lfb, width * height * sizeof(fb_pixel_t));
+				unsigned int nr = frames;
+				mutex.unlock();
+				uint32_t crc = crc32(0L, (const Bytef *) copy, width * height * sizeof(fb_pixel_t));
+				if (crc != last_crc) {
+					char name[32];
+					snprintf(name, sizeof(name), "/frame-%06u.png", dumped + nr);
+					if (savePng(dump_dir + name, copy))
+						last_crc = crc;
+				}
+				mutex.lock();
+			}
+		}
+		if (now - last_report >= REPORT_INTERVAL * 1000000ULL) {
+			if (frames) {
+				printf(LOGTAG "%u frames, %.2f ms painting per frame (%.1f fps), %" PRIu64 " pixels and %u paints per frame, icon cache %d kB\n",
+					frames, paint_time / 1000.0 / frames,
+					paint_time ? frames * 1000000.0 / paint_time : 0.0,
+					pixels / frames, ops / frames, cache_size / 1024);
+				dumped += frames;
+			}
+			frames = 0;
+			paint_time = pixels = 0;
+			ops = 0;
+			last_report = now;
+		}
+	}
+	mutex.unlock();
+	delete[] copy;
+}
+
+void CFbAccelHeadless::getPainted(uint64_t &_pixels, unsigned int &paints)
+{
+	mutex.lock();
+	_pixels = total_pixels;
+	paints = total_ops;
+	mutex.unlock();
+}
+
+/* the screen as it is now, the caller does not paint meanwhile */
+bool CFbAccelHeadless::saveScreen(const std::string &file)
+{
+	return savePng(file, lfb);
+}
+
+bool CFbAccelHeadless::savePng(const std::string &file, const fb_pixel_t *data)
+{
+	FILE *fp = fopen(file.c_str(), "wb");
+	if (!fp) {
+		fprintf(stderr, LOGTAG "%s: %m\n", file.c_str());
+		return false;
+	}
+	png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	png_infop info = png ? png_create_info_struct(png) : NULL;
+	if (!info || setjmp(png_jmpbuf(png))) {
+		png_destroy_write_struct(&png, info ? &info : NULL);
+		fclose(fp);
+		unlink(file.c_str());
+		return false;
+	}
+	png_init_io(png, fp);
+	png_set_compression_level(png, Z_BEST_SPEED);
+	png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_RGB_ALPHA,
+			PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_write_info(png, info);
+	/* fb_pixel_t is ARGB, in memory BGRA */
+	png_set_bgr(png);
+	for (unsigned int y = 0; y < height; y++)
+		png_write_row(png, (png_bytep)(data + y * width));
+	png_write_end(png, info);
+	png_destroy_write_struct(&png, &info);
+	fclose(fp);
+	return true;
+}
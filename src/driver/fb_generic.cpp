@@ -32,8 +32,10 @@
 
 #include <driver/fb_generic.h>
 #include <driver/fb_accel.h>
+#include <driver/fb_kernels.h>
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <fcntl.h>
 #include <signal.h>
 #include <sys/ioctl.h>
@@ -103,6 +105,8 @@ CFrameBuffer::CFrameBuffer()
 	m_transparent	 = m_transparent_default;
 	q_circle = NULL;
 	initQCircle();
+	memset(corner_table, 0, sizeof(corner_table));
+	gradient_cache_pixels = 0;
 	corner_tl = false;
 	corner_tr = false;
 	corner_bl = false;
@@ -122,6 +126,12 @@ CFrameBuffer* CFrameBuffer::getInstance()
 	static CFrameBuffer* frameBuffer = NULL;
 
 	if (!frameBuffer) {
+		/* no display, see fb_accel_headless.cpp */
+		if (getenv("NEUTRINO_HEADLESS"))
+			frameBuffer = new CFbAccelHeadless();
+		else {
+/* fb_replay is built without the hardware backends */
+#ifndef FB_HEADLESS_ONLY
 #if HAVE_SPARK_HARDWARE
 		frameBuffer = new CFbAccelSTi();
 #endif
@@ -142,6 +152,8 @@ CFrameBuffer* CFrameBuffer::getInstance()
 #if HAVE_ARM_HARDWARE
 		frameBuffer = new CFbAccelARM();
 #endif
+#endif
+		}
 		if (!frameBuffer)
 			frameBuffer = new CFrameBuffer();
 		printf("[neutrino] %s Instance created\n", frameBuffer->fb_name);
@@ -228,6 +240,9 @@ CFrameBuffer::~CFrameBuffer()
 		delete[] q_circle;
 		q_circle = NULL;
 	}
+	for (int i = 0; i <= CORNER_TABLE_MAX; i++)
+		delete[] corner_table[i];
+	clearGradientCache();
 
 	if (lfb)
 		munmap(lfb, available);
@@ -461,10 +476,7 @@ void CFrameBuffer::paletteSet(struct fb_cmap *map)
 
 void CFrameBuffer::paintHLineRelInternal2Buf(const int& x, const int& dx, const int& y, const int& box_dx, const fb_pixel_t& col, fb_pixel_t* buf)
 {
-	fb_pixel_t * pos = buf + x + box_dx * y;
-	fb_pixel_t * dest = (fb_pixel_t *)pos;
-	for (int i = 0; i < dx; i++)
-		*(dest++) = col;
+	fb_fill_row(buf + x + box_dx * y, col, dx);
 }
 
 fb_pixel_t* CFrameBuffer::paintBoxRel2Buf(const int dx, const int dy, const int w_align, const int offs_align, const fb_pixel_t col, fb_pixel_t* buf/* = NULL*/, int radius/* = 0*/, int type/* = CORNER_ALL*/)
@@ -508,16 +520,8 @@ fb_pixel_t* CFrameBuffer::paintBoxRel2Buf(const int dx, const int dy, const int
 			paintHLineRelInternal2Buf(ofl+offs_align, dx-ofl-ofr, line, w_align, col, pixBuf);
 			line++;
 		}
-	} else {
-		fb_pixel_t *bp = pixBuf;
-		int line = 0;
-		while (line < dy) {
-			for (int pos = offs_align; pos < dx+offs_align; pos++)
-				*(bp + pos) = col;
-			bp += w_align;
-			line++;
-		}
-	}
+	} else
+		fb_fill_rect(pixBuf + offs_align, w_align, col, dx, dy);
 	return pixBuf;
 }
 
@@ -530,7 +534,6 @@ fb_pixel_t* CFrameBuffer::paintBoxRel(const int x, const int y, const int dx, co
 
 	checkFbArea(x, y, dx, dy, true);
 
-	fb_pixel_t MASK = 0xFFFFFFFF;
 	int _dx = dx;
 	int w_align;
 	int offs_align;
@@ -553,41 +556,53 @@ fb_pixel_t* CFrameBuffer::paintBoxRel(const int x, const int y, const int dx, co
 	offs_align = 0;
 #endif
 
-	fb_pixel_t* boxBuf    = paintBoxRel2Buf(_dx, dy, w_align, offs_align, MASK, NULL, radius, type);
+	if (_dx < 1 || dy < 1) {
+		dprintf(DEBUG_INFO, "[CFrameBuffer] [%s - %d]: radius %d, dx %d dy %d\n", __func__, __LINE__, radius, _dx, dy);
+		checkFbArea(x, y, dx, dy, false);
+		return NULL;
+	}
+
+	bool vertical = (gradientData->direction == gradientVertical);
+	fb_pixel_t *gra = gradientData->gradientBuf;
+	int gsize = vertical ? dy : _dx;
+
+	fb_pixel_t *boxBuf = (fb_pixel_t*) cs_malloc_uncached(w_align*dy*sizeof(fb_pixel_t));
 	if (boxBuf == NULL) {
+		dprintf(DEBUG_NORMAL, "[%s #%d] Error cs_malloc_uncached\n", __func__, __LINE__);
 		checkFbArea(x, y, dx, dy, false);
 		return NULL;
 	}
-	fb_pixel_t *bp        = boxBuf;
-	fb_pixel_t *gra       = gradientData->gradientBuf;
-	gradientData->boxBuf  = boxBuf;
-	gradientData->x       = x - offs_align;
-	gradientData->dx      = w_align;
 
-	if (gradientData->direction == gradientVertical) {
-		// vertical
-		for (int pos = offs_align; pos < _dx+offs_align; pos++) {
-			for(int count = 0; count < dy; count++) {
-				if (*(bp + pos) == MASK)
-					*(bp + pos) = (fb_pixel_t)(*(gra + count));
-				bp += w_align;
-			}
-			bp = boxBuf;
+	if (!getGradientBox(boxBuf, _dx, dy, w_align, offs_align, radius, type, vertical, gra, gsize)) {
+		memset((void*)boxBuf, '\0', w_align*dy*sizeof(fb_pixel_t));
+		int rad = radius;
+		if (type && rad) {
+			setCornerFlags(type);
+			rad = limitRadius(_dx, dy, rad);
 		}
-	} else {
-		// horizontal
+		/* the visible part of every line gets the gradient, vertical:
+		   one color per line, horizontal: starting with the first color
+		   at the first visible pixel of the line */
 		for (int line = 0; line < dy; line++) {
-			int gra_pos = 0;
-			for (int pos = 0; pos < w_align; pos++) {
-				if ((*(bp + pos) == MASK) && (pos >= offs_align) && (gra_pos < _dx)) {
-					*(bp + pos) = (fb_pixel_t)(*(gra + gra_pos));
-					gra_pos++;
-				}
-			}
-			bp += w_align;
+			int ofl = 0, ofr = 0;
+			if (type && rad)
+				calcCorners(NULL, &ofl, &ofr, dy, line, rad, type);
+			int w = _dx - ofl - ofr;
+			if (w < 1)
+				continue;
+			fb_pixel_t *bp = boxBuf + line * w_align + offs_align + ofl;
+			if (vertical)
+				fb_fill_row(bp, gra[line], w);
+			else
+				memcpy(bp, gra, w * sizeof(fb_pixel_t));
 		}
+		storeGradientBox(boxBuf, _dx, dy, w_align, offs_align, radius, type, vertical, gra, gsize);
 	}
 
+	gradientData->boxBuf  = boxBuf;
+	gradientData->x       = x - offs_align;
+	gradientData->dx      = w_align;
+
 	if ((gradientData->mode & pbrg_noPaint) == pbrg_noPaint) {
 		checkFbArea(x, y, dx, dy, false);
 		return boxBuf;
@@ -606,6 +621,63 @@ fb_pixel_t* CFrameBuffer::paintBoxRel(const int x, const int y, const int dx, co
 	return NULL;
 }
 
+bool CFrameBuffer::getGradientBox(fb_pixel_t *boxBuf, const int dx, const int dy, const int w_align, const int offs_align,
+				  const int radius, const int type, const bool direction, const fb_pixel_t *gra, const int gsize)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(cache_mutex);
+	for (std::list<gradient_box>::iterator it = gradient_cache.begin(); it != gradient_cache.end(); ++it) {
+		if (it->dx != dx || it->dy != dy || it->w_align != w_align || it->offs_align != offs_align ||
+		    it->radius != radius || it->type != type || it->direction != direction ||
+		    memcmp(&it->gradient[0], gra, gsize * sizeof(fb_pixel_t)))
+			continue;
+		memcpy(boxBuf, it->box, w_align * dy * sizeof(fb_pixel_t));
+		/* most recently used first */
+		if (it != gradient_cache.begin())
+			gradient_cache.splice(gradient_cache.begin(), gradient_cache, it);
+		return true;
+	}
+	return false;
+}
+
+void CFrameBuffer::storeGradientBox(const fb_pixel_t *boxBuf, const int dx, const int dy, const int w_align, const int offs_align,
+				    const int radius, const int type, const bool direction, const fb_pixel_t *gra, const int gsize)
+{
+	size_t pixels = w_align * dy;
+	if (pixels > GRADIENT_CACHE_PIXELS / 4)
+		return;
+
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(cache_mutex);
+	while (!gradient_cache.empty() && gradient_cache_pixels + pixels > GRADIENT_CACHE_PIXELS) {
+		gradient_box &old = gradient_cache.back();
+		gradient_cache_pixels -= old.w_align * old.dy;
+		delete[] old.box;
+		gradient_cache.pop_back();
+	}
+
+	gradient_cache.push_front(gradient_box());
+	gradient_box &g = gradient_cache.front();
+	g.dx         = dx;
+	g.dy         = dy;
+	g.w_align    = w_align;
+	g.offs_align = offs_align;
+	g.radius     = radius;
+	g.type       = type;
+	g.direction  = direction;
+	g.gradient.assign(gra, gra + gsize);
+	g.box        = new fb_pixel_t[pixels];
+	memcpy(g.box, boxBuf, pixels * sizeof(fb_pixel_t));
+	gradient_cache_pixels += pixels;
+}
+
+void CFrameBuffer::clearGradientCache()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(cache_mutex);
+	for (std::list<gradient_box>::iterator it = gradient_cache.begin(); it != gradient_cache.end(); ++it)
+		delete[] it->box;
+	gradient_cache.clear();
+	gradient_cache_pixels = 0;
+}
+
 void CFrameBuffer::paintBoxRel(const int x, const int y, const int dx, const int dy, const fb_pixel_t col, int radius, int type)
 {
 	/* draw a filled rectangle (with additional round corners) */
@@ -630,7 +702,11 @@ void CFrameBuffer::paintBoxRel(const int x, const int y, const int dx, const int
 		while (line < dy) {
 			int ofl, ofr;
 			if (calcCorners(NULL, &ofl, &ofr, dy, line, radius, type)) {
-				//printf("3: x %d y %d dx %d dy %d rad %d line %d\n", x, y, dx, dy, radius, line);
+				/* the part between the corners at once */
+				int end = (type & CORNER_BOTTOM) ? dy - radius : dy;
+				fb_fill_rect(getFrameBufferPointer() + x + swidth * (y + line), swidth, col, dx, end - line);
+				line = end;
+				continue;
 			}
 
 			if (dx-ofr-ofl < 1) {
@@ -646,17 +722,8 @@ void CFrameBuffer::paintBoxRel(const int x, const int y, const int dx, const int
 			paintHLineRelInternal(x+ofl, dx-ofl-ofr, y+line, col);
 			line++;
 		}
-	} else {
-		fb_pixel_t *fbp = getFrameBufferPointer() + (swidth * y);
-		int line = 0;
-		while (line < dy) {
-			for (int pos = x; pos < x + dx; pos++)
-				*(fbp + pos) = col;
-
-			fbp += swidth;
-			line++;
-		}
-	}
+	} else
+		fb_fill_rect(getFrameBufferPointer() + x + swidth * y, swidth, col, dx, dy);
 	checkFbArea(x, y, dx, dy, false);
 }
 
@@ -681,9 +748,7 @@ void CFrameBuffer::paintVLineRel(int x, int y, int dy, const fb_pixel_t col)
 
 void CFrameBuffer::paintHLineRelInternal(int x, int dx, int y, const fb_pixel_t col)
 {
-	fb_pixel_t * dest = getFrameBufferPointer() + x + swidth * y;
-	for (int i = 0; i < dx; i++)
-		*(dest++) = col;
+	fb_fill_row(getFrameBufferPointer() + x + swidth * y, col, dx);
 }
 
 void CFrameBuffer::paintHLineRel(int x, int dx, int y, const fb_pixel_t col)
@@ -982,9 +1047,7 @@ void CFrameBuffer::paintPixel(const int x, const int y, const fb_pixel_t col)
 
 void CFrameBuffer::paintShortHLineRelInternal(const int& x, const int& dx, const int& y, const fb_pixel_t& col)
 {
-	fb_pixel_t *dest = getFrameBufferPointer() + x + swidth * y;
-	for (int i = 0; i < dx; i++)
-		*(dest++) = col;
+	fb_fill_row(getFrameBufferPointer() + x + swidth * y, col, dx);
 }
 
 int CFrameBuffer::limitRadius(const int& dx, const int& dy, int& radius)
@@ -1045,32 +1108,63 @@ void CFrameBuffer::initQCircle()
 	memcpy(q_circle, _q_circle, sizeof(_q_circle));
 }
 
-bool CFrameBuffer::calcCorners(int *ofs, int *ofl, int *ofr, const int& dy, const int& line, const int& radius, const int& type)
-{
 /* just an multiplicator for all math to reduce rounding errors */
 #define MUL 32768
-	int scl, _ofs = 0;
+
+/* offset of a corner line from the side of the box, d is the distance
+   of the line to the end of the corner (radius...1) */
+int CFrameBuffer::calcCornerOffset(const int& radius, const int& d)
+{
+	int scf = (540 * MUL) / ((radius < 1) ? 1 : radius);
+	int scl = scf * d / MUL;
+	if ((scf * d % MUL) >= (MUL / 2)) /* round up */
+		scl++;
+	return radius - (q_circle[scl] * MUL / scf);
+}
+
+/* the offsets only depend on the radius, so they are calculated once for
+   every radius in use. the tables are never changed after they are set */
+const int *CFrameBuffer::getCornerTable(const int& radius)
+{
+	if (radius < 1 || radius > CORNER_TABLE_MAX)
+		return NULL;
+	const int *table = corner_table[radius];
+	if (table)
+		return table;
+
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(cache_mutex);
+	if (corner_table[radius] == NULL) {
+		int *t = new int[radius + 1];
+		t[0] = radius;
+		for (int d = 1; d <= radius; d++)
+			t[d] = calcCornerOffset(radius, d);
+		__sync_synchronize();
+		corner_table[radius] = t;
+	}
+	return corner_table[radius];
+}
+
+bool CFrameBuffer::calcCorners(int *ofs, int *ofl, int *ofr, const int& dy, const int& line, const int& radius, const int& type)
+{
+	int d, _ofs = 0;
 	bool ret = false;
 	if (ofl != NULL) *ofl = 0;
 	if (ofr != NULL) *ofr = 0;
-	int scf = (540 * MUL) / ((radius < 1) ? 1 : radius);
 	/* one of the top corners */
 	if (line < radius && (type & CORNER_TOP)) {
 		/* uper round corners */
-		scl = scf * (radius - line) / MUL;
-		if ((scf * (radius - line) % MUL) >= (MUL / 2)) /* round up */
-			scl++;
-		_ofs =  radius - (q_circle[scl] * MUL / scf);
+		d = radius - line;
+		const int *table = getCornerTable(radius);
+		_ofs = (table && d >= 1 && d <= radius) ? table[d] : calcCornerOffset(radius, d);
 		if (ofl != NULL) *ofl = corner_tl ? _ofs : 0;
 		if (ofr != NULL) *ofr = corner_tr ? _ofs : 0;
 	}
 	/* one of the bottom corners */
 	else if ((line >= dy - radius) && (type & CORNER_BOTTOM)) {
 		/* lower round corners */
-		scl = scf * (radius - (dy - (line + 1))) / MUL;
-		if ((scf * (radius - (dy - (line + 1))) % MUL) >= (MUL / 2)) /* round up */
-			scl++;
-		_ofs =  radius - (q_circle[scl] * MUL / scf);
+		d = radius - (dy - (line + 1));
+		const int *table = getCornerTable(radius);
+		_ofs = (table && d >= 1 && d <= radius) ? table[d] : calcCornerOffset(radius, d);
 		if (ofl != NULL) *ofl = corner_bl ? _ofs : 0;
 		if (ofr != NULL) *ofr = corner_br ? _ofs : 0;
 	}
@@ -1159,6 +1253,13 @@ void CFrameBuffer::paintLine(int xa, int ya, int xb, int yb, const fb_pixel_t co
 	int End;
 	int step;
 
+	if (dy == 0) {
+		/* the rows of rounded corners, same pixels as below */
+		paintHLineRelInternal((xa < xb) ? xa : xb, dx + 1, ya, col);
+		mark(xa, ya, xb, yb);
+		return;
+	}
+
 	if ( dx > dy )
 	{
 		int	p = 2 * dy - dx;
@@ -1686,28 +1787,9 @@ void CFrameBuffer::blit2FB(void *fbbuff, uint32_t width, uint32_t height, uint32
 	fb_pixel_t*  data = (fb_pixel_t *) fbbuff;
 
 	fb_pixel_t * d = getFrameBufferPointer() + xoff + swidth * yoff;
-	fb_pixel_t * d2;
 
 	for (int count = 0; count < yc; count++ ) {
-		fb_pixel_t *pixpos = &data[(count + yp) * width];
-		d2 = (fb_pixel_t *) d;
-		for (int count2 = 0; count2 < xc; count2++ ) {
-			fb_pixel_t pix = *(pixpos + xp);
-			if ((pix & 0xff000000) == 0xff000000)
-				*d2 = pix;
-			else {
-				uint8_t *in = (uint8_t *)(pixpos + xp);
-				uint8_t *out = (uint8_t *)d2;
-				int a = in[3];	/* TODO: big/little endian */
-				*out = (*out + ((*in - *out) * a) / 256);
-				in++; out++;
-				*out = (*out + ((*in - *out) * a) / 256);
-				in++; out++;
-				*out = (*out + ((*in - *out) * a) / 256);
-			}
-			d2++;
-			pixpos++;
-		}
+		fb_blend_row(d, &data[(count + yp) * width + xp], xc);
 		d += swidth;
 	}
 }
@@ -1725,13 +1807,8 @@ void CFrameBuffer::blitBox2FB(const fb_pixel_t* boxBuf, uint32_t width, uint32_t
 
 	uint32_t line = 0;
 	while (line < yc) {
-		fb_pixel_t *pixpos = &data[line * xc];
-		for (uint32_t pos = xoff; pos < xoff + xc; pos++) {
-			//don't paint backgroundcolor (*pixpos = 0x00000000)
-			if (*pixpos)
-				*(fbp + pos) = *pixpos;
-			pixpos++;
-		}
+		//don't paint backgroundcolor (*pixpos = 0x00000000)
+		fb_copy_row_nonzero(fbp + xoff, &data[line * xc], xc);
 		fbp += swidth;
 		line++;
 	}
@@ -31,6 +31,7 @@
 
 #include <string>
 #include <vector>
+#include <list>
 #include <map>
 #include <OpenThreads/Mutex>
 #include <OpenThreads/ScopedLock>
@@ -139,6 +140,23 @@ class CFrameBuffer : public sigc::trackable
 		int *q_circle;
 		bool corner_tl, corner_tr, corner_bl, corner_br;
 
+		/* corner offsets by radius, see getCornerTable() */
+#define CORNER_TABLE_MAX 540
+		const int *corner_table[CORNER_TABLE_MAX + 1];
+		/* rendered gradient boxes, most recently used first. the components
+		   paint the same boxes with the same colors again and again */
+#define GRADIENT_CACHE_PIXELS (1024 * 1024)
+		struct gradient_box
+		{
+			int dx, dy, w_align, offs_align, radius, type;
+			bool direction;
+			std::vector<fb_pixel_t> gradient;
+			fb_pixel_t *box;
+		};
+		std::list<gradient_box> gradient_cache;
+		size_t gradient_cache_pixels;
+		OpenThreads::Mutex cache_mutex;
+
 		void * int_convertRGB2FB(unsigned char *rgbbuff, unsigned long x, unsigned long y, int transp, bool alpha);
 		int m_transparent_default, m_transparent;
 		// Unlocked versions (no mutex)
@@ -152,6 +170,13 @@ class CFrameBuffer : public sigc::trackable
 		void initQCircle();
 		inline int calcCornersOffset(const int& dy, const int& line, const int& radius, const int& type) { int ofs = 0; calcCorners(&ofs, NULL, NULL, dy, line, radius, type); return ofs; }
 		bool calcCorners(int *ofs, int *ofl, int *ofr, const int& dy, const int& line, const int& radius, const int& type);
+		int calcCornerOffset(const int& radius, const int& d);
+		const int *getCornerTable(const int& radius);
+		bool getGradientBox(fb_pixel_t *boxBuf, const int dx, const int dy, const int w_align, const int offs_align,
+				    const int radius, const int type, const bool direction, const fb_pixel_t *gra, const int gsize);
+		void storeGradientBox(const fb_pixel_t *boxBuf, const int dx, const int dy, const int w_align, const int offs_align,
+				      const int radius, const int type, const bool direction, const fb_pixel_t *gra, const int gsize);
+		void clearGradientCache();
 
 	public:
 		///gradient direction
@@ -0,0 +1,176 @@
+/*
+	Neutrino-GUI  -   DBoxII-Project
+
+	pixel row kernels of the software paint paths: fill, copy of the
+	non transparent pixels and alpha blending. SSE2 or NEON is used
+	if the compiler targets it, else plain C with four pixels per step.
+
+	License: GPL
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#ifndef __fb_kernels_h__
+#define __fb_kernels_h__
+
+#include <stdint.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define FB_KERNELS_SSE2
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define FB_KERNELS_NEON
+#endif
+
+/* dst[0..n) = col */
+static inline void fb_fill_row(uint32_t *dst, uint32_t col, int n)
+{
+#if defined(FB_KERNELS_SSE2)
+	__m128i c = _mm_set1_epi32((int)col);
+	for (; n >= 8; n -= 8, dst += 8) {
+		_mm_storeu_si128((__m128i *)dst, c);
+		_mm_storeu_si128((__m128i *)(dst + 4), c);
+	}
+	if (n >= 4) {
+		_mm_storeu_si128((__m128i *)dst, c);
+		dst += 4;
+		n -= 4;
+	}
+#elif defined(FB_KERNELS_NEON)
+	uint32x4_t c = vdupq_n_u32(col);
+	for (; n >= 8; n -= 8, dst += 8) {
+		vst1q_u32(dst, c);
+		vst1q_u32(dst + 4, c);
+	}
+	if (n >= 4) {
+		vst1q_u32(dst, c);
+		dst += 4;
+		n -= 4;
+	}
+#else
+	for (; n >= 4; n -= 4, dst += 4) {
+		dst[0] = col;
+		dst[1] = col;
+		dst[2] = col;
+		dst[3] = col;
+	}
+#endif
+	while (n-- > 0)
+		*dst++ = col;
+}
+
+/* dy rows of dx pixels, stride in pixels. every row is written, the
+   source of a row copy would be the (uncached) framebuffer itself */
+static inline void fb_fill_rect(uint32_t *dst, int stride, uint32_t col, int dx, int dy)
+{
+	if (dx < 1)
+		return;
+	for (int line = 0; line < dy; line++, dst += stride)
+		fb_fill_row(dst, col, dx);
+}
+
+/* copy the pixels which are not 0, i.e. leave the background where the
+   box is transparent */
+static inline void fb_copy_row_nonzero(uint32_t *dst, const uint32_t *src, int n)
+{
+#if defined(FB_KERNELS_SSE2)
+	__m128i zero = _mm_setzero_si128();
+	for (; n >= 4; n -= 4, dst += 4, src += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i *)src);
+		int m = _mm_movemask_epi8(_mm_cmpeq_epi32(s, zero));
+		if (m == 0)
+			_mm_storeu_si128((__m128i *)dst, s);
+		else if (m != 0xffff)
+			for (int i = 0; i < 4; i++)
+				if (src[i])
+					dst[i] = src[i];
+	}
+#elif defined(FB_KERNELS_NEON)
+	for (; n >= 4; n -= 4, dst += 4, src += 4) {
+		uint32x4_t s = vld1q_u32(src);
+		uint32x4_t z = vceqq_u32(s, vdupq_n_u32(0));
+		uint32x2_t any = vorr_u32(vget_low_u32(z), vget_high_u32(z));
+		uint32x2_t all = vand_u32(vget_low_u32(z), vget_high_u32(z));
+		if ((vget_lane_u32(any, 0) | vget_lane_u32(any, 1)) == 0)
+			vst1q_u32(dst, s);
+		else if ((vget_lane_u32(all, 0) & vget_lane_u32(all, 1)) == 0)
+			for (int i = 0; i < 4; i++)
+				if (src[i])
+					dst[i] = src[i];
+	}
+#endif
+	for (; n > 0; n--, dst++, src++)
+		if (*src)
+			*dst = *src;
+}
+
+/* blend one ARGB pixel onto the framebuffer, alpha of the framebuffer pixel
+   is kept. same rounding as before the kernels, so the output is unchanged */
+static inline void fb_blend_pixel(uint32_t *dst, const uint32_t *src)
+{
+	uint32_t pix = *src;
+	if ((pix & 0xff000000) == 0xff000000) {
+		*dst = pix;
+		return;
+	}
+	int a = pix >> 24;
+	if (a == 0)
+		return;
+	uint8_t *in = (uint8_t *)src;
+	uint8_t *out = (uint8_t *)dst;
+	/* TODO: big/little endian */
+	out[0] = (out[0] + ((in[0] - out[0]) * a) / 256);
+	out[1] = (out[1] + ((in[1] - out[1]) * a) / 256);
+	out[2] = (out[2] + ((in[2] - out[2]) * a) / 256);
+}
+
+/* alpha blend a row. icons and pictures are mostly opaque or fully
+   transparent, four pixels of the same kind are handled at once */
+static inline void fb_blend_row(uint32_t *dst, const uint32_t *src, int n)
+{
+#if defined(FB_KERNELS_SSE2)
+	__m128i amask = _mm_set1_epi32((int)0xff000000);
+	__m128i zero = _mm_setzero_si128();
+	for (; n >= 4; n -= 4, dst += 4, src += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i *)src);
+		__m128i a = _mm_and_si128(s, amask);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(a, amask)) == 0xffff)
+			_mm_storeu_si128((__m128i *)dst, s);
+		else if (_mm_movemask_epi8(_mm_cmpeq_epi32(a, zero)) != 0xffff)
+			for (int i = 0; i < 4; i++)
+				fb_blend_pixel(dst + i, src + i);
+	}
+#elif defined(FB_KERNELS_NEON)
+	uint32x4_t amask = vdupq_n_u32(0xff000000);
+	for (; n >= 4; n -= 4, dst += 4, src += 4) {
+		uint32x4_t s = vld1q_u32(src);
+		uint32x4_t a = vandq_u32(s, amask);
+		uint32x4_t o = vceqq_u32(a, amask);
+		uint32x4_t t = vceqq_u32(a, vdupq_n_u32(0));
+		uint32x2_t opaque = vand_u32(vget_low_u32(o), vget_high_u32(o));
+		uint32x2_t transp = vand_u32(vget_low_u32(t), vget_high_u32(t));
+		if (vget_lane_u32(opaque, 0) & vget_lane_u32(opaque, 1))
+			vst1q_u32(dst, s);
+		else if ((vget_lane_u32(transp, 0) & vget_lane_u32(transp, 1)) == 0)
+			for (int i = 0; i < 4; i++)
+				fb_blend_pixel(dst + i, src + i);
+	}
+#endif
+	for (; n > 0; n--, dst++, src++)
+		fb_blend_pixel(dst, src);
+}
+
+#endif
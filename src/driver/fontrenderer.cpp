@@ -28,6 +28,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 // this method is recommended for FreeType >2.0.x:
 #include <ft2build.h>
@@ -259,14 +260,19 @@ FT_Error Font::getGlyphBitmap(FT_ULong glyph_index, FTC_SBit *sbit)
 int Font::setSize(int isize)
 {
 	int temp = font.width;
+	/* the width calculation must not see the new size with old advances
+	 * or the old size and face, the lookup is done under the same lock */
+	pthread_mutex_lock(&renderer->render_mutex);
 	font.width = font.height = isize;
 	scaler.width  = isize * 64;
 	scaler.height = isize * 64;
+	memset(cached_index, -1, sizeof(cached_index));
 
 	FT_Error err = FTC_Manager_LookupSize(renderer->cacheManager, &scaler, &size);
 	if (err != 0)
 	{
 		dprintf(DEBUG_NORMAL, "%s:FTC_Manager_LookupSize failed (0x%x)\n", __FUNCTION__, err);
+		pthread_mutex_unlock(&renderer->render_mutex);
 		return 0;
 	}
 	face = size->face;
@@ -292,6 +298,7 @@ return 0;
 	getGlyphBitmap(index, &glyph);
 	int hg=glyph->height;
 	int tg=glyph->top;
+	pthread_mutex_unlock(&renderer->render_mutex);
 
 	ascender=tM;
 	descender=tg-hg; //this is a negative value!
@@ -726,15 +733,32 @@ int Font::getRenderWidth(const char *text, const bool utf8_encoded)
 		if (unicode_value == -1)
 			break;
 
-		int index=FT_Get_Char_Index(face, unicode_value);
+		int index, xadvance;
+		if (unicode_value < FONT_ADVANCE_CACHE && cached_index[unicode_value] >= 0)
+		{
+			index = cached_index[unicode_value];
+			xadvance = cached_advance[unicode_value];
+		}
+		else
+		{
+			index = FT_Get_Char_Index(face, unicode_value);
+			xadvance = 0;
+			if (index && getGlyphBitmap(index, &glyph))
+			{
+				dprintf(DEBUG_NORMAL, "failed to get glyph bitmap.\n");
+				continue;
+			}
+			if (index)
+				xadvance = glyph->xadvance;
+			if (unicode_value < FONT_ADVANCE_CACHE)
+			{
+				cached_index[unicode_value] = index;
+				cached_advance[unicode_value] = xadvance;
+			}
+		}
 
 		if (!index)
 			continue;
-		if (getGlyphBitmap(index, &glyph))
-		{
-			dprintf(DEBUG_NORMAL, "failed to get glyph bitmap.\n");
-			continue;
-		}
 		//kerning
 		if (use_kerning)
 		{
@@ -742,7 +766,7 @@ int Font::getRenderWidth(const char *text, const bool utf8_encoded)
 			x += (kerning.x) >> 6; // kerning!
 		}
 
-		x+=glyph->xadvance+1;
+		x+=xadvance+1;
 		if(pen1>x)
 			x=pen1;
 		pen1=x;
@@ -54,6 +54,11 @@ class Font
 	int height,DigitHeight,DigitOffset,ascender,descender,upper,lower;
 	int fontwidth;
 	int maxdigitwidth;
+	/* glyph index and advance of the first code points for the width
+	   calculation, index -1 = not looked up yet. under render_mutex */
+#define FONT_ADVANCE_CACHE 256
+	int cached_index[FONT_ADVANCE_CACHE];
+	int cached_advance[FONT_ADVANCE_CACHE];
 	uint8_t fg_red, fg_green, fg_blue;
 	fb_pixel_t colors[256];
 	bool useFullBG;
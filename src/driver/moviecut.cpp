@@ -31,6 +31,7 @@
 #include <sys/un.h>
 #include <sys/stat.h>
 #include <sys/vfs.h>
+#include <sys/syscall.h>
 #include <errno.h>
 #include <math.h>
 #include <utime.h>
@@ -45,6 +46,10 @@
 
 #include <driver/screen_max.h>
 #include <driver/moviecut.h>
+#include <driver/abstime.h>
+#include <system/set_threadname.h>
+
+#include <OpenThreads/ScopedLock>
 
 #define PSI_SIZE 188*2
 #define BUF_SIZE 1395*188
@@ -69,6 +74,7 @@ CMovieCut::CMovieCut()
 {
 	frameBuffer = CFrameBuffer::getInstance();
 	timescale = NULL;
+	index = NULL;
 	percent = 0;
 	int dx = 256;
 	x = (((g_settings.screen_EndX- g_settings.screen_StartX)- dx) / 2) + g_settings.screen_StartX;
@@ -78,6 +84,134 @@ CMovieCut::CMovieCut()
 CMovieCut::~CMovieCut()
 {
 	delete timescale;
+	delete index;
+}
+
+/* search the first GOP in the data at offset, returns bytes to skip */
+off64_t CMovieCut::skipToGop(int srcfd, off64_t offset, off64_t until, unsigned char * buf)
+{
+	size_t toread = (until-offset) > BUF_SIZE ? BUF_SIZE : until - offset;
+	ssize_t r = pread64(srcfd, buf, toread, offset);
+	if (r <= 0)
+		return 0;
+	if (buf[0] != 0x47)
+		printf("CMovieCut::%s: buffer not aligned at %" PRId64 "\n", __func__, offset);
+	int gop = find_gop(buf, r);
+	if (gop < 0) {
+		printf("CMovieCut::%s: GOP not found\n", __func__);
+		return 0;
+	}
+	printf("CMovieCut::%s: GOP found at %" PRId64 " offset %d\n", __func__, (off64_t)(offset+gop), gop);
+	return gop;
+}
+
+/* copy a span in the background worker while handling input and progress.
+ * returns 1 when done, 0 if cancelled by user, -1 on error */
+int CMovieCut::copySpan(int srcfd, int dstfd, off64_t offset, off64_t len, off64_t done, off64_t total, int &was_cancel)
+{
+	if (len <= 0)
+		return 1;
+	if (!worker.Start(srcfd, dstfd, offset, len))
+		return -1;
+
+	bool user_cancel = false;
+	while (worker.Running()) {
+		int msg = getInput();
+		was_cancel = msg & 2;
+		if (msg & 4) {
+			user_cancel = true;
+			worker.Cancel();
+			break;
+		}
+		if (total > 0)
+			percent = (int) ((float)(done + worker.Copied())/(float)(total)*100.);
+		paintProgress(msg != 0);
+	}
+	bool ok = worker.Wait();
+	if (user_cancel)
+		return 0;
+	/* the worker stops at EOF, before that it is a read error */
+	off64_t copied = worker.Copied();
+	struct stat64 s;
+	if (ok && copied < len && !fstat64(srcfd, &s) && offset + copied < s.st_size) {
+		printf("CMovieCut::%s: short read at %" PRId64 ", file size %" PRId64 "\n", __func__, offset + copied, (int64_t) s.st_size);
+		return -1;
+	}
+	return ok ? 1 : -1;
+}
+
+bool CMovieCut::loadIndex(MI_MOVIE_INFO * minfo)
+{
+	delete index;
+	index = new CTsIndex();
+	segments.clear();
+	if (index->LoadOrBuild(minfo->file.Name))
+		return true;
+	printf("CMovieCut::%s: [%s] no index, using estimated positions\n", __func__, minfo->file.Name.c_str());
+	delete index;
+	index = NULL;
+	return false;
+}
+
+/* file offset for a bookmark in seconds, at an I-frame if indexed */
+off64_t CMovieCut::getOffset(int sec, off64_t secsize)
+{
+	if (index) {
+		off64_t offset = index->GetOffset(index->GetFirstTime() + (int64_t) sec * 1000);
+		if (offset >= 0)
+			return offset;
+	}
+	return ((off64_t) sec * secsize)/188 * 188;
+}
+
+void CMovieCut::addSegment(off64_t src, off64_t len, off64_t dst)
+{
+	if (!index || len <= 0)
+		return;
+	cut_segment_t seg;
+	seg.src = src;
+	seg.len = len;
+	seg.dst = dst;
+	segments.push_back(seg);
+}
+
+/* write index of the new file from the copied segments, returns its duration */
+uint32_t CMovieCut::saveIndex(const char * dpart)
+{
+	if (!index || segments.empty())
+		return 0;
+
+	CTsIndex nindex;
+	int64_t time = 0;
+	int count = index->Count();
+	for (std::vector<cut_segment_t>::iterator it = segments.begin(); it != segments.end(); ++it) {
+		off64_t end = it->src + it->len;
+		int64_t first = -1, last = 0;
+		CTsIndex::ts_index_entry_t entry;
+		int i;
+		for (i = 0; i < count && index->GetEntry(i, entry) && entry.offset < it->src; i++)
+			;
+		for (; i < count && index->GetEntry(i, entry) && entry.offset < end; i++) {
+			if (first < 0)
+				first = entry.time;
+			last = entry.time;
+			entry.offset = it->dst + entry.offset - it->src;
+			entry.time = time + entry.time - first;
+			nindex.Append(entry);
+		}
+		if (first < 0)
+			continue;
+		/* next segment starts where this one ends in time */
+		if (i < count && index->GetEntry(i, entry))
+			time += entry.time - first;
+		else
+			time += last - first;
+	}
+	segments.clear();
+	if (!nindex.Count())
+		return 0;
+	nindex.Save(CTsIndex::GetSidecarName(dpart));
+	return nindex.GetDuration();
 }
 
 void CMovieCut::paintProgress(bool refresh)
@@ -164,20 +298,26 @@ bool CMovieCut::truncateMovie(MI_MOVIE_INFO * minfo)
 	if (minfo->bookmarks.end == 0 || secsize == 0)
 		return false;
 
-	off64_t newsize = secsize * minfo->bookmarks.end;
+	loadIndex(minfo);
+	off64_t newsize = getOffset(minfo->bookmarks.end, secsize);
+	uint32_t duration = newsize/secsize*1000;
 
 	printf("CMovieCut::%s: [%s] truncate to %d sec, new size %" PRId64 "\n", __func__, minfo->file.Name.c_str(), minfo->bookmarks.end, newsize);
 	if (truncate(minfo->file.Name.c_str(), newsize)) {
 		perror(minfo->file.Name.c_str());
 		return false;
 	}
+	if (index) {
+		addSegment(0, newsize, 0);
+		duration = saveIndex(minfo->file.Name.c_str());
+	}
 	minfo->file.Size = newsize;
 	minfo->length = minfo->bookmarks.end/60;
 	minfo->bookmarks.end = 0;
 	reset_atime(minfo->file.Name.c_str(), minfo->file.Time);
 	CMovieInfo cmovie;
 	cmovie.saveMovieInfo(*minfo);
-	WriteHeader(minfo->file.Name.c_str(), newsize/secsize*1000);
+	WriteHeader(minfo->file.Name.c_str(), duration);
 	return true;
 }
 
@@ -241,13 +381,15 @@ int CMovieCut::read_psi(const char * spart, unsigned char * buf)
 	return -1;
 }
 
-void CMovieCut::save_info(MI_MOVIE_INFO * minfo, char * dpart, off64_t spos, off64_t secsize)
+void CMovieCut::save_info(MI_MOVIE_INFO * minfo, char * dpart, off64_t spos, off64_t secsize, uint32_t duration)
 {
 	CMovieInfo cmovie;
 	MI_MOVIE_INFO ninfo = *minfo;
+	if (duration == 0)
+		duration = spos/secsize*1000;
 	ninfo.file.Name = dpart;
 	ninfo.file.Size = spos;
-	ninfo.length = spos/secsize/60;
+	ninfo.length = duration/1000/60;
 	ninfo.bookmarks.end = 0;
 	ninfo.bookmarks.start = 0;
 	ninfo.bookmarks.lastPlayStop = 0;
@@ -258,7 +400,7 @@ void CMovieCut::save_info(MI_MOVIE_INFO * minfo, char * dpart, off64_t spos, off
 		}
 	}
 	cmovie.saveMovieInfo(ninfo);
-	WriteHeader(ninfo.file.Name.c_str(), spos/secsize*1000);
+	WriteHeader(ninfo.file.Name.c_str(), duration);
 	reset_atime(dpart, minfo->file.Time);
 }
 
@@ -324,11 +466,13 @@ bool CMovieCut::cutMovie(MI_MOVIE_INFO * minfo)
 	off64_t size = minfo->file.Size;
 	off64_t secsize = getSecondSize(minfo);
 	off64_t newsize = size;
+	/* with index all positions are at I-frames, no need to search GOPs */
+	bool indexed = loadIndex(minfo);
 
 	if (minfo->bookmarks.start != 0) {
 		books[bcount].pos = 0;
-		books[bcount].len = (minfo->bookmarks.start * secsize)/188 * 188;
-		if (books[bcount].len > SAFE_GOP)
+		books[bcount].len = getOffset(minfo->bookmarks.start, secsize);
+		if (!indexed && books[bcount].len > SAFE_GOP)
 			books[bcount].len -= SAFE_GOP;
 		books[bcount].ok = 1;
 		printf("CMovieCut::%s: start bookmark %d at %" PRId64 " len %" PRId64 "\n", __func__, bcount, books[bcount].pos, books[bcount].len);
@@ -336,9 +480,9 @@ bool CMovieCut::cutMovie(MI_MOVIE_INFO * minfo)
 	}
 	for (int book_nr = 0; book_nr < MI_MOVIE_BOOK_USER_MAX; book_nr++) {
 		if (minfo->bookmarks.user[book_nr].pos != 0 && minfo->bookmarks.user[book_nr].length > 0) {
-			books[bcount].pos = (minfo->bookmarks.user[book_nr].pos * secsize)/188 * 188;
-			books[bcount].len = (minfo->bookmarks.user[book_nr].length * secsize)/188 * 188;
-			if (books[bcount].len > SAFE_GOP)
+			books[bcount].pos = getOffset(minfo->bookmarks.user[book_nr].pos, secsize);
+			books[bcount].len = getOffset(minfo->bookmarks.user[book_nr].pos + minfo->bookmarks.user[book_nr].length, secsize) - books[bcount].pos;
+			if (!indexed && books[bcount].len > SAFE_GOP)
 				books[bcount].len -= SAFE_GOP;
 			books[bcount].ok = 1;
 			printf("CMovieCut::%s: jump bookmark %d at %" PRId64 " len %" PRId64 " -> skip to %" PRId64 "\n", __func__, bcount, books[bcount].pos, books[bcount].len, books[bcount].pos+books[bcount].len);
@@ -346,7 +490,7 @@ bool CMovieCut::cutMovie(MI_MOVIE_INFO * minfo)
 		}
 	}
 	if (minfo->bookmarks.end != 0) {
-		books[bcount].pos = ((off64_t) minfo->bookmarks.end * secsize)/188 * 188;
+		books[bcount].pos = getOffset(minfo->bookmarks.end, secsize);
 		books[bcount].len = size - books[bcount].pos;
 		books[bcount].ok = 1;
 		printf("CMovieCut::%s: end bookmark %d at %" PRId64 "\n", __func__, bcount, books[bcount].pos);
@@ -412,51 +556,31 @@ bool CMovieCut::cutMovie(MI_MOVIE_INFO * minfo)
 		perror(minfo->file.Name.c_str());
 		goto ret_err;
 	}
-	lseek64(srcfd, offset, SEEK_SET);
 
 	/* process all bookmarks */
 	while (true) {
 		off64_t until = bpos;
+		if (indexed)
+			need_gop = 0;
+		if (need_gop && offset < until) {
+			off64_t gop = skipToGop(srcfd, offset, until, buf);
+			newsize -= gop;
+			offset += gop;
+		}
+		addSegment(offset, until - offset, PSI_SIZE + spos);
 		printf("CMovieCut::%s: bookmark #%d reading from %" PRId64 " to %" PRId64 " (%" PRId64 ") want gop %d\n", __func__, bindex, offset, until, until - offset, need_gop);
-		/* read up to jump end */
-		while (offset < until) {
-			int msg = getInput();
-			was_cancel = msg & 2;
-			if (msg & 4) {
+		/* copy up to jump end */
+		if (offset < until) {
+			int res = copySpan(srcfd, dstfd, offset, until - offset, spos, newsize, was_cancel);
+			offset += worker.Copied();
+			spos += worker.Copied();
+			if (res == 0) {
 				unlink(dpart);
 				retval = true;
 				goto ret_err;
 			}
-			size_t toread = (until-offset) > BUF_SIZE ? BUF_SIZE : until - offset;
-			size_t r = read(srcfd, buf, toread);
-			if (r > 0) {
-				int wptr = 0;
-				if (r != toread) 
-					printf("CMovieCut::%s: short read at %" PRId64 ": %d\n", __func__, offset, (int)r);
-				if (buf[0] != 0x47)
-					printf("CMovieCut::%s: buffer not aligned at %" PRId64 "\n", __func__, offset);
-				if (need_gop) {
-					int gop = find_gop(buf, r);
-					if (gop >= 0) {
-						printf("CMovieCut::%s: GOP found at %" PRId64 " offset %d\n", __func__, (off64_t)(offset+gop), gop);
-						newsize -= gop;
-						wptr = gop;
-					} else
-						printf("CMovieCut::%s: GOP not found\n", __func__);
-					need_gop = 0;
-				}
-				offset += r;
-				spos += r - wptr;
-				percent = (int) ((float)(spos)/(float)(newsize)*100.);
-				paintProgress(msg != 0);
-				size_t wr = write(dstfd, &buf[wptr], r-wptr);
-				if (wr < (r-wptr)) {
-					perror(dpart);
-					goto ret_err;
-				}
-			} else if (offset < s.st_size) {
-				/* read error ? */
-				perror(minfo->file.Name.c_str());
+			if (res < 0) {
+				perror(dpart);
 				goto ret_err;
 			}
 		}
@@ -481,12 +605,11 @@ bool CMovieCut::cutMovie(MI_MOVIE_INFO * minfo)
 			printf("CMovieCut::%s: offset behind EOF: %" PRId64 " from %" PRId64 "\n", __func__, offset, s.st_size);
 			break;
 		}
-		lseek64(srcfd, offset, SEEK_SET);
 	}
 	tt1 = time(0);
 	printf("CMovieCut::%s: total written %" PRId64 " tooks %ld secs end time %s", __func__, spos, tt1-tt, ctime(&tt1));
 
-	save_info(minfo, dpart, spos, secsize);
+	save_info(minfo, dpart, spos, secsize, saveIndex(dpart));
 	retval = true;
 ret_err:
 	if (srcfd >= 0)
@@ -505,7 +628,6 @@ ret_err:
 bool CMovieCut::copyMovie(MI_MOVIE_INFO * minfo, bool onefile)
 {
 	struct mybook books[MI_MOVIE_BOOK_USER_MAX+2];
-	struct stat64 s;
 	char dpart[255];
 	unsigned char psi[PSI_SIZE];
 	int dstfd = -1, srcfd = -1;
@@ -513,18 +635,22 @@ bool CMovieCut::copyMovie(MI_MOVIE_INFO * minfo, bool onefile)
 	time_t tt = time(0);
 	bool need_gop = 0;
 	bool dst_done = 0;
-	bool was_cancel = false;
+	int was_cancel = 0;
 	bool retval = false;
 	int bcount = 0;
 	off64_t newsize = 0;
 
 	off64_t secsize = getSecondSize(minfo);
+	bool indexed = loadIndex(minfo);
 	for (int book_nr = 0; book_nr < MI_MOVIE_BOOK_USER_MAX; book_nr++) {
 		if (minfo->bookmarks.user[book_nr].pos != 0 && minfo->bookmarks.user[book_nr].length > 0) {
-			books[bcount].pos = (minfo->bookmarks.user[book_nr].pos * secsize)/188 * 188;
-			if (books[bcount].pos > SAFE_GOP)
+			books[bcount].pos = getOffset(minfo->bookmarks.user[book_nr].pos, secsize);
+			if (!indexed && books[bcount].pos > SAFE_GOP)
 				books[bcount].pos -= SAFE_GOP;
-			books[bcount].len = (minfo->bookmarks.user[book_nr].length * secsize)/188 * 188;
+			if (indexed)
+				books[bcount].len = getOffset(minfo->bookmarks.user[book_nr].pos + minfo->bookmarks.user[book_nr].length, secsize) - books[bcount].pos;
+			else
+				books[bcount].len = (minfo->bookmarks.user[book_nr].length * secsize)/188 * 188;
 			books[bcount].ok = 1;
 			printf("copy: jump bookmark %d at %" PRId64 " len %" PRId64 "\n", bcount, books[bcount].pos, books[bcount].len);
 			newsize += books[bcount].len;
@@ -553,7 +679,6 @@ bool CMovieCut::copyMovie(MI_MOVIE_INFO * minfo, bool onefile)
 		perror(minfo->file.Name.c_str());
 		goto ret_err;
 	}
-	stat64(minfo->file.Name.c_str(), &s);
 	for (int i = 0; i < bcount; i++) {
 		printf("\ncopy: processing bookmark %d at %" PRId64 " len %" PRId64 "\n", i, books[i].pos, books[i].len);
 
@@ -569,67 +694,43 @@ bool CMovieCut::copyMovie(MI_MOVIE_INFO * minfo, bool onefile)
 			spos = 0;
 			write(dstfd, psi, PSI_SIZE);
 		}
-		need_gop = 1;
+		need_gop = !indexed;
 
 		off64_t offset = books[i].pos;
-		lseek64(srcfd, offset, SEEK_SET);
 		off64_t until = books[i].pos + books[i].len;
-		printf("copy: read from %" PRId64 " to %" PRId64 " read size %d want gop %d\n", offset, until, BUF_SIZE, need_gop);
-		while (offset < until) {
-			size_t toread = (until-offset) > BUF_SIZE ? BUF_SIZE : until - offset;
-			int msg = getInput();
-			was_cancel = msg & 2;
-			if (msg & 4) {
+		if (need_gop) {
+			off64_t gop = skipToGop(srcfd, offset, until, buf);
+			newsize -= gop;
+			offset += gop;
+		}
+		addSegment(offset, until - offset, PSI_SIZE + spos);
+		printf("copy: read from %" PRId64 " to %" PRId64 " want gop %d\n", offset, until, need_gop);
+		if (offset < until) {
+			int res = copySpan(srcfd, dstfd, offset, until - offset, btotal, newsize, was_cancel);
+			spos += worker.Copied();
+			btotal += worker.Copied();
+			if (res == 0) {
 				unlink(dpart);
 				retval = true;
 				goto ret_err;
 			}
-			size_t r = read(srcfd, buf, toread);
-			if (r > 0) {
-				int wptr = 0;
-				if (r != toread)
-					printf("****** short read ? %d\n", (int)r);
-				if (buf[0] != 0x47)
-					printf("copy: buffer not aligned at %" PRId64 "\n", offset);
-				if (need_gop) {
-					int gop = find_gop(buf, r);
-					if (gop >= 0) {
-						printf("cut: GOP found at %" PRId64 " offset %d\n", (off64_t)(offset+gop), gop);
-						newsize -= gop;
-						wptr = gop;
-					} else
-						printf("cut: GOP needed, but not found\n");
-					need_gop = 0;
-				}
-				offset += r;
-				spos += r - wptr;
-				btotal += r;
-				percent = (int) ((float)(btotal)/(float)(newsize)*100.);
-				paintProgress(msg != 0);
-
-				size_t wr = write(dstfd, &buf[wptr], r-wptr);
-				if (wr < (r-wptr)) {
-					printf("write to %s failed\n", dpart);
-					unlink(dpart);
-					goto ret_err;
-				}
-			} else if (offset < s.st_size) {
-				/* read error ? */
-				perror(minfo->file.Name.c_str());
-				break;
+			if (res < 0) {
+				printf("copy to %s failed\n", dpart);
+				unlink(dpart);
+				goto ret_err;
 			}
-		} /* while(offset < until) */
+		}
 
 		if (!onefile) {
 			close(dstfd);
 			dstfd = -1;
-			save_info(minfo, dpart, spos, secsize);
+			save_info(minfo, dpart, spos, secsize, saveIndex(dpart));
 			time_t tt1 = time(0);
 			printf("copy: ********* %s: total written %" PRId64 " took %ld secs\n", dpart, spos, tt1-tt);
 		}
 	} /* for all books */
 	if (onefile) {
-		save_info(minfo, dpart, spos, secsize);
+		save_info(minfo, dpart, spos, secsize, saveIndex(dpart));
 		time_t tt1 = time(0);
 		printf("copy: ********* %s: total written %" PRId64 " took %ld secs\n", dpart, spos, tt1-tt);
 	}
@@ -20,7 +20,11 @@
 #ifndef __MOVIE_CUT__
 #define __MOVIE_CUT__
 
+#include <vector>
+
 #include <driver/movieinfo.h>
+#include <driver/tsindex.h>
+#include <driver/cutworker.h>
 #include <gui/components/cc.h>
 
 class CFrameBuffer;
@@ -33,6 +37,25 @@ class CMovieCut
 		int y;
 		int percent;
 
+		/* source range copied to dst, to rebuild the index of the new file */
+		typedef struct cut_segment
+		{
+			off64_t src;
+			off64_t len;
+			off64_t dst;
+		} cut_segment_t;
+		CTsIndex * index;
+		std::vector<cut_segment_t> segments;
+
+		CCutWorker worker;
+		off64_t skipToGop(int srcfd, off64_t offset, off64_t until, unsigned char * buf);
+		int copySpan(int srcfd, int dstfd, off64_t offset, off64_t len, off64_t done, off64_t total, int &was_cancel);
+
+		bool loadIndex(MI_MOVIE_INFO * minfo);
+		off64_t getOffset(int sec, off64_t secsize);
+		void addSegment(off64_t src, off64_t len, off64_t dst);
+		uint32_t saveIndex(const char * dpart);
+
 		void reset_atime(const char * path, time_t tt);
 		uint32_t getHeaderDurationMS(MI_MOVIE_INFO * minfo);
 		off64_t getSecondSize(MI_MOVIE_INFO * minfo);
@@ -41,7 +64,7 @@ class CMovieCut
 		int find_gop(unsigned char *buf, int r);
 		off64_t fake_read(int fd, unsigned char *buf, size_t size, off64_t fsize);
 		int read_psi(const char * spart, unsigned char * buf);
-		void save_info(MI_MOVIE_INFO * minfo, char * dpart, off64_t spos, off64_t secsize);
+		void save_info(MI_MOVIE_INFO * minfo, char * dpart, off64_t spos, off64_t secsize, uint32_t duration = 0);
 		void findNewName(const char * fname, char * dpart,size_t dpart_len);
 		static int compare_book(const void *x, const void *y);
 		int getInput();
@@ -13,6 +13,9 @@
 #include <errno.h>
 #include <cs_api.h>
 #include <sys/sysinfo.h>
+#include <dirent.h>
+#include <time.h>
+#include <system/set_threadname.h>
 
 #ifdef FBV_SUPPORT_GIF
 extern int fh_gif_getsize (const char *, int *, int *, int, int);
@@ -41,6 +44,11 @@ extern int fh_crw_load (const char *, unsigned char **, int *, int *);
 extern int fh_crw_id (const char *);
 #endif
 
+/* seconds between checks of the logo directories for changes */
+#define LOGO_INDEX_INTERVAL	10
+/* memory for logos decoded in advance */
+#define LOGO_CACHE_SIZE		(6 * 1024 * 1024)
+
 double CPictureViewer::m_aspect_ratio_correction;
 
 void CPictureViewer::add_format (int (*picsize) (const char *, int *, int *, int, int), int (*picread) (const char *, unsigned char **, int *, int *), int (*id) (const char *))
@@ -425,10 +433,35 @@ CPictureViewer::CPictureViewer ()
 	pthread_mutex_init(&logo_map_mutex, &attr);
 
 	init_handlers ();
+
+	logo_images_size = 0;
+	logo_thread_stop = false;
+	logo_thread = 0;
+	pthread_cond_init(&logo_cond, NULL);
+}
+
+/* only the global instance indexes and prefetches logos */
+void CPictureViewer::StartLogoThread()
+{
+	if (logo_thread)
+		return;
+	if (pthread_create(&logo_thread, NULL, logoThread, (void *) this)) {
+		perror("[CPictureViewer] pthread_create");
+		logo_thread = 0;
+	}
 }
 
 CPictureViewer::~CPictureViewer ()
 {
+	if (logo_thread) {
+		pthread_mutex_lock(&logo_map_mutex);
+		logo_thread_stop = true;
+		pthread_cond_signal(&logo_cond);
+		pthread_mutex_unlock(&logo_map_mutex);
+		pthread_join(logo_thread, NULL);
+	}
+	trimLogoImages(0);
+	pthread_cond_destroy(&logo_cond);
 	Cleanup();
 	CFormathandler *fh = fh_root;
 	while (fh) {
@@ -599,20 +632,20 @@ bool CPictureViewer::GetLogoName(const uint64_t& channel_id, const std::string&
 
 	std::string tmp;
 
-	for (int k = 0; k < 2; k++) {
+	for (int k = 0; k < 1; k++) {
 		if (dirs[k].length() < 1)
 			continue;
 		for (int i = 0; i < 2; i++)
 			for (int j = 0; j < 3; j++) {
 				tmp = dirs[k] + "/" + strLogoName[i] + strLogoExt[j];
-				if (!access(tmp.c_str(), R_OK))
+				if (logoExists(dirs[k], strLogoName[i] + strLogoExt[j]))
 					goto found;
 			}
 		if (!cc)
 			continue;
 		for (int i = 0; i < 2; i++) {
 			tmp = dirs[k] + "/" + strLogoE2[i];
-			if (!access(tmp.c_str(), R_OK))
+			if (logoExists(dirs[k], strLogoE2[i]))
 				goto found;
 		}
 	}
@@ -637,60 +670,285 @@ bool CPictureViewer::GetLogoName(const uint64_t& channel_id, const std::string&
 {
 	std::string fileType[] = { ".png", ".jpg" , ".gif" };
 
+	name = "";
+
+	pthread_mutex_lock(&logo_map_mutex);
+
+	if ((logo_hdd_dir != g_settings.logo_hdd_dir)) {
+		logo_map.clear();
+		logo_hdd_dir = g_settings.logo_hdd_dir;
+	}
+
+	std::map<uint64_t, logo_data>::iterator it = logo_map.find(channel_id);
+	if (it != logo_map.end()) {
+		bool found = !it->second.name.empty();
+		if (found) {
+			name = it->second.name;
+			if (width)
+				*width = it->second.width;
+			if (height)
+				*height = it->second.height;
+		}
+		pthread_mutex_unlock(&logo_map_mutex);
+		return found;
+	}
+
 	//get channel id as string
 	char strChnId[16];
 	snprintf(strChnId, 16, "%llx", channel_id & 0xFFFFFFFFFFFFULL);
 	strChnId[15] = '\0';
 
+	std::vector<std::string> dirs;
+	dirs.push_back(g_settings.logo_hdd_dir);
+	if(g_settings.logo_hdd_dir != LOGODIR_VAR)
+		dirs.push_back(LOGODIR_VAR);
+	if(g_settings.logo_hdd_dir != LOGODIR)
+		dirs.push_back(LOGODIR);
+
+	//check if file is available, name with real name is preferred
 	for (size_t i = 0; i<(sizeof(fileType) / sizeof(fileType[0])); i++){
-		std::vector<std::string> v_path;
-		std::string id_tmp_path;
-
-		//create filename with channel name (logo_hdd_dir)
-		id_tmp_path = g_settings.logo_hdd_dir + "/";
-		id_tmp_path += ChannelName + fileType[i];
-		v_path.push_back(id_tmp_path);
-
-		//create filename with id (logo_hdd_dir)
-		id_tmp_path = g_settings.logo_hdd_dir + "/";
-		id_tmp_path += strChnId + fileType[i];
-		v_path.push_back(id_tmp_path);
-
-		if(g_settings.logo_hdd_dir != LOGODIR_VAR){
-			//create filename with channel name (LOGODIR_VAR)
-			id_tmp_path = LOGODIR_VAR "/";
-			id_tmp_path += ChannelName + fileType[i];
-			v_path.push_back(id_tmp_path);
-
-			//create filename with id (LOGODIR_VAR)
-			id_tmp_path = LOGODIR_VAR "/";
-			id_tmp_path += strChnId + fileType[i];
-			v_path.push_back(id_tmp_path);
-		}
-		if(g_settings.logo_hdd_dir != LOGODIR){
-			//create filename with channel name (LOGODIR)
-			id_tmp_path = LOGODIR "/";
-			id_tmp_path += ChannelName + fileType[i];
-			v_path.push_back(id_tmp_path);
-
-			//create filename with id (LOGODIR)
-			id_tmp_path = LOGODIR "/";
-			id_tmp_path += strChnId + fileType[i];
-			v_path.push_back(id_tmp_path);
-		}
-		//check if file is available, name with real name is preferred, return true on success
-		for (size_t j = 0; j < v_path.size(); j++){
-			if (access(v_path[j].c_str(), R_OK) != -1){
-				if(width && height)
-					getSize(v_path[j].c_str(), width, height);
-				name = v_path[j];
-				return true;
+		for (size_t j = 0; j < dirs.size(); j++){
+			if (logoExists(dirs[j], ChannelName + fileType[i])){
+				name = dirs[j] + "/" + ChannelName + fileType[i];
+				goto found;
 			}
-		}	
+			if (logoExists(dirs[j], strChnId + fileType[i])){
+				name = dirs[j] + "/" + strChnId + fileType[i];
+				goto found;
+			}
+		}
 	}
+	logo_map[channel_id].name = "";
+	pthread_mutex_unlock(&logo_map_mutex);
 	return false;
+
+found:
+	int w, h;
+	getSize(name.c_str(), &w, &h);
+	if(width && height)
+		*width = w, *height = h;
+	logo_map[channel_id].name = name;
+	logo_map[channel_id].width = w;
+	logo_map[channel_id].height = h;
+	pthread_mutex_unlock(&logo_map_mutex);
+	return true;
+}
+#endif
+
+void CPictureViewer::PrefetchLogos(const std::vector<std::pair<uint64_t, std::string> > &channels)
+{
+	pthread_mutex_lock(&logo_map_mutex);
+	logo_queue.assign(channels.begin(), channels.end());
+	pthread_cond_signal(&logo_cond);
+	pthread_mutex_unlock(&logo_map_mutex);
+}
+
+/* logo_map_mutex must be locked */
+bool CPictureViewer::logoExists(const std::string &dir, const std::string &file)
+{
+	if (file.find('/') == std::string::npos) {
+		for (std::vector<logo_dir>::iterator it = logo_dirs.begin(); it != logo_dirs.end(); ++it)
+			if (it->path == dir)
+				return it->files.find(file) != it->files.end();
+	}
+	/* not read yet, or a name with path */
+	std::string tmp = dir + "/" + file;
+	return access(tmp.c_str(), R_OK) == 0;
+}
+
+/* a copy of a logo decoded in advance, false if there is none */
+bool CPictureViewer::getLogoImage(const std::string &name, unsigned char **buffer, int *x, int *y, int *bpp)
+{
+	bool ret = false;
+	pthread_mutex_lock(&logo_map_mutex);
+	std::map<std::string, logo_image>::iterator it = logo_images.find(name);
+	if (it != logo_images.end()) {
+		*buffer = (unsigned char *) malloc(it->second.size);
+		if (*buffer) {
+			memcpy(*buffer, it->second.buffer, it->second.size);
+			*x = it->second.x;
+			*y = it->second.y;
+			*bpp = it->second.bpp;
+			logo_images_lru.remove(name);
+			logo_images_lru.push_front(name);
+			ret = true;
+		}
+	}
+	pthread_mutex_unlock(&logo_map_mutex);
+	return ret;
 }
+
+/* logo_map_mutex must be locked, or the logo thread be gone */
+void CPictureViewer::trimLogoImages(size_t limit)
+{
+	while (logo_images_size > limit && !logo_images_lru.empty()) {
+		std::map<std::string, logo_image>::iterator it = logo_images.find(logo_images_lru.back());
+		if (it != logo_images.end()) {
+			free(it->second.buffer);
+			logo_images_size -= it->second.size;
+			logo_images.erase(it);
+		}
+		logo_images_lru.pop_back();
+	}
+}
+
+/* reads the logo directories, which are new or changed since the last check */
+void CPictureViewer::logoIndexCheck(void)
+{
+	std::vector<std::string> dirs;
+	dirs.push_back(g_settings.logo_hdd_dir);
+#if !HAVE_SH4_HARDWARE
+	if (g_settings.logo_hdd_dir != LOGODIR_VAR)
+		dirs.push_back(LOGODIR_VAR);
+	if (g_settings.logo_hdd_dir != LOGODIR)
+		dirs.push_back(LOGODIR);
 #endif
+
+	/* mtime of the directories at their last read, and if they are to be
+	   read again anyway */
+	std::map<std::string, std::pair<time_t, bool> > known;
+	pthread_mutex_lock(&logo_map_mutex);
+	for (std::vector<logo_dir>::iterator it = logo_dirs.begin(); it != logo_dirs.end(); ++it)
+		known[it->path] = std::make_pair(it->mtime, it->recheck);
+	pthread_mutex_unlock(&logo_map_mutex);
+
+	bool read = (known.size() != dirs.size());
+	std::vector<logo_dir> index(dirs.size());
+	std::vector<bool> reuse(dirs.size(), false);
+	time_t now = time(NULL);
+	for (size_t i = 0; i < dirs.size(); i++) {
+		index[i].path = dirs[i];
+		index[i].mtime = 0;
+		struct stat st;
+		if (stat(dirs[i].c_str(), &st) == 0)
+			index[i].mtime = st.st_mtime;
+		/* a change in the same second would go unnoticed, read such
+		   a directory again next time */
+		index[i].recheck = (index[i].mtime >= now - 1);
+		std::map<std::string, std::pair<time_t, bool> >::iterator k = known.find(dirs[i]);
+		if (k != known.end() && k->second.first == index[i].mtime && !k->second.second) {
+			reuse[i] = true;
+			continue;
+		}
+		read = true;
+		DIR *d = opendir(dirs[i].c_str());
+		if (!d)
+			continue;
+		struct dirent *e;
+		while ((e = readdir(d)) != NULL) {
+			if (strcmp(e->d_name, ".") && strcmp(e->d_name, ".."))
+				index[i].files.insert(e->d_name);
+		}
+		closedir(d);
+	}
+	if (!read)
+		return;
+
+	/* the looked up names stay valid, unless the files differ */
+	pthread_mutex_lock(&logo_map_mutex);
+	bool changed = (logo_dirs.size() != dirs.size());
+	for (size_t i = 0; i < dirs.size(); i++) {
+		std::vector<logo_dir>::iterator it = logo_dirs.begin();
+		while (it != logo_dirs.end() && it->path != dirs[i])
+			++it;
+		if (it == logo_dirs.end() || i >= logo_dirs.size() || logo_dirs[i].path != dirs[i])
+			changed = true;
+		if (it == logo_dirs.end())
+			continue;
+		if (reuse[i])
+			index[i].files.swap(it->files);
+		else if (index[i].files != it->files)
+			changed = true;
+	}
+	logo_dirs.swap(index);
+	if (changed) {
+		logo_map.clear();
+		trimLogoImages(0);
+	}
+	pthread_mutex_unlock(&logo_map_mutex);
+	if (changed)
+		dprintf(DEBUG_INFO, "[CPictureViewer] [%s - %d] logo index updated\n", __func__, __LINE__);
+}
+
+void CPictureViewer::prefetchLogo(const uint64_t channel_id, const std::string &ChanName)
+{
+	std::string name;
+	if (!GetLogoName(channel_id, ChanName, name))
+		return;
+
+	pthread_mutex_lock(&logo_map_mutex);
+	bool have = (logo_images.find(name) != logo_images.end());
+	pthread_mutex_unlock(&logo_map_mutex);
+	if (have)
+		return;
+
+	int x, y, bpp = 0;
+	CFormathandler *fh = fh_getsize(name.c_str(), &x, &y, INT_MAX, INT_MAX);
+	if (!fh)
+		return;
+	size_t size = x * y * 4;
+	/* a huge logo would push out all others */
+	if (size > LOGO_CACHE_SIZE / 8 || !checkfreemem(size))
+		return;
+	unsigned char *buffer = (unsigned char *) malloc(size);
+	if (buffer == NULL)
+		return;
+	if (loadImage(name, fh, &buffer, &x, &y, &bpp) != FH_ERROR_OK) {
+		free(buffer);
+		return;
+	}
+
+	pthread_mutex_lock(&logo_map_mutex);
+	if (logo_images.find(name) == logo_images.end()) {
+		logo_image &img = logo_images[name];
+		img.buffer = buffer;
+		img.x = x;
+		img.y = y;
+		img.bpp = bpp;
+		img.size = size;
+		logo_images_size += size;
+		logo_images_lru.push_front(name);
+		trimLogoImages(LOGO_CACHE_SIZE);
+	} else
+		free(buffer);
+	pthread_mutex_unlock(&logo_map_mutex);
+}
+
+void *CPictureViewer::logoThread(void *arg)
+{
+	set_threadname("n:logoindex");
+	((CPictureViewer *) arg)->logoRun();
+	return NULL;
+}
+
+void CPictureViewer::logoRun(void)
+{
+	logoIndexCheck();
+
+	pthread_mutex_lock(&logo_map_mutex);
+	while (!logo_thread_stop) {
+		if (logo_queue.empty()) {
+			struct timespec abs_wait;
+			clock_gettime(CLOCK_REALTIME, &abs_wait);
+			abs_wait.tv_sec += LOGO_INDEX_INTERVAL;
+			pthread_cond_timedwait(&logo_cond, &logo_map_mutex, &abs_wait);
+			if (logo_thread_stop)
+				break;
+			/* check the directories before looking up a new page */
+			pthread_mutex_unlock(&logo_map_mutex);
+			logoIndexCheck();
+			pthread_mutex_lock(&logo_map_mutex);
+			continue;
+		}
+		std::pair<uint64_t, std::string> chan = logo_queue.front();
+		logo_queue.pop_front();
+		pthread_mutex_unlock(&logo_map_mutex);
+		prefetchLogo(chan.first, chan.second);
+		pthread_mutex_lock(&logo_map_mutex);
+	}
+	pthread_mutex_unlock(&logo_map_mutex);
+}
+
 #if 0
 bool CPictureViewer::DisplayLogo (uint64_t channel_id, int posx, int posy, int width, int height)
 {
@@ -761,11 +1019,17 @@ bool CPictureViewer::DisplayImage(const std::string & name, int posx, int posy,
 	return false;
 }
 
-fb_pixel_t * CPictureViewer::int_getImage(const std::string & name, int *width, int *height, bool GetImage)
+int CPictureViewer::loadImage(const std::string & name, CFormathandler *fh, unsigned char **buffer, int *x, int *y, int *bpp)
 {
-	if (access(name.c_str(), R_OK) == -1)
-		return NULL;
+#ifdef FBV_SUPPORT_PNG
+	if ((name.find(".png") == (name.length() - 4)) && (fh_png_id(name.c_str())))
+		return png_load_ext(name.c_str(), buffer, x, y, bpp);
+#endif
+	return fh->get_pic(name.c_str (), buffer, x, y);
+}
 
+fb_pixel_t * CPictureViewer::int_getImage(const std::string & name, int *width, int *height, bool GetImage)
+{
 	int x, y, load_ret, bpp = 0;
 	CFormathandler *fh = NULL;
 	unsigned char * buffer = NULL;
@@ -777,64 +1041,66 @@ fb_pixel_t * CPictureViewer::int_getImage(const std::string & name, int *width,
 	else
 		mode_str = "getIcon";
 
-  	fh = fh_getsize(name.c_str(), &x, &y, INT_MAX, INT_MAX);
-	size_t bufsize = x * y * 4;
-	if (!checkfreemem(bufsize))
-		return NULL;
+	if (getLogoImage(name, &buffer, &x, &y, &bpp))
+		load_ret = FH_ERROR_OK;
+	else {
+		if (access(name.c_str(), R_OK) == -1)
+			return NULL;
 
-  	if (fh)
-  	{
+		fh = fh_getsize(name.c_str(), &x, &y, INT_MAX, INT_MAX);
+		size_t bufsize = x * y * 4;
+		if (!checkfreemem(bufsize))
+			return NULL;
+
+		if (!fh) {
+			dprintf(DEBUG_NORMAL,  "[CPictureViewer] [%s - %d] mode: %s, file: %s Error: %s, buffer = %p (Pos: %d %d, Dim: %d x %d)\n", __func__, __LINE__, mode_str.c_str(), name.c_str(), strerror(errno), buffer, x, y, *width, *height);
+			return NULL;
+		}
 		buffer = (unsigned char *) malloc(bufsize);//x * y * 4
 		if (buffer == NULL)
 		{
 			dprintf(DEBUG_NORMAL,  "[CPictureViewer] [%s - %d] mode %s: Error: malloc\n", __func__, __LINE__, mode_str.c_str());
 			return NULL;
 		}
-#ifdef FBV_SUPPORT_PNG
-		if ((name.find(".png") == (name.length() - 4)) && (fh_png_id(name.c_str())))
-			load_ret = png_load_ext(name.c_str(), &buffer, &x, &y, &bpp);
-		else
-#endif
-			load_ret = fh->get_pic(name.c_str (), &buffer, &x, &y);
+		load_ret = loadImage(name, fh, &buffer, &x, &y, &bpp);
 		dprintf(DEBUG_INFO,  "[CPictureViewer] [%s - %d] load_result: %d \n", __func__, __LINE__, load_ret);
+	}
 
-		if (load_ret == FH_ERROR_OK)
-		{
-			dprintf(DEBUG_INFO,  "[CPictureViewer] [%s - %d] mode %s, decoded %s, (Pos: %d %d) ,bpp = %d \n", __func__, __LINE__, mode_str.c_str(), name.c_str(), x, y, bpp);
-			// image size error
-			if((GetImage) && (*width < 1 || *height < 1)){
-				dprintf(DEBUG_NORMAL,  "[CPictureViewer] [%s - %d] mode: %s, file: %s (Pos: %d %d, Dim: %d x %d)\n", __func__, __LINE__, mode_str.c_str(), name.c_str(), x, y, *width, *height);
-				free(buffer);
-				buffer = NULL;
-				return NULL;
-			}
-			// resize only getImage
-			if ((GetImage) && (x != *width || y != *height))
-			{
-				dprintf(DEBUG_INFO,  "[CPictureViewer] [%s - %d] resize  %s to %d x %d \n", __func__, __LINE__, name.c_str(), *width, *height);
-				if (bpp == 4)
-					buffer = ResizeA(buffer, x, y, *width, *height);
-				else
-					buffer = Resize(buffer, x, y, *width, *height, COLOR);
-				x = *width;
-				y = *height;
-			}
-			if (bpp == 4)
-				ret = (fb_pixel_t *) CFrameBuffer::getInstance()->convertRGBA2FB(buffer, x, y);
-			else
-				ret = (fb_pixel_t *) CFrameBuffer::getInstance()->convertRGB2FB(buffer, x, y, convertSetupAlpha2Alpha(g_settings.theme.infobar_alpha));
-			*width = x;
-			*height = y;
-		}else{
-			dprintf(DEBUG_NORMAL,  "[CPictureViewer] [%s - %d] mode %s: Error decoding file %s\n", __func__, __LINE__, mode_str.c_str(), name.c_str());
+	if (load_ret == FH_ERROR_OK)
+	{
+		dprintf(DEBUG_INFO,  "[CPictureViewer] [%s - %d] mode %s, decoded %s, (Pos: %d %d) ,bpp = %d \n", __func__, __LINE__, mode_str.c_str(), name.c_str(), x, y, bpp);
+		// image size error
+		if((GetImage) && (*width < 1 || *height < 1)){
+			dprintf(DEBUG_NORMAL,  "[CPictureViewer] [%s - %d] mode: %s, file: %s (Pos: %d %d, Dim: %d x %d)\n", __func__, __LINE__, mode_str.c_str(), name.c_str(), x, y, *width, *height);
 			free(buffer);
 			buffer = NULL;
 			return NULL;
 		}
+		// resize only getImage
+		if ((GetImage) && (x != *width || y != *height))
+		{
+			dprintf(DEBUG_INFO,  "[CPictureViewer] [%s - %d] resize  %s to %d x %d \n", __func__, __LINE__, name.c_str(), *width, *height);
+			if (bpp == 4)
+				buffer = ResizeA(buffer, x, y, *width, *height);
+			else
+				buffer = Resize(buffer, x, y, *width, *height, COLOR);
+			x = *width;
+			y = *height;
+		}
+		if (bpp == 4)
+			ret = (fb_pixel_t *) CFrameBuffer::getInstance()->convertRGBA2FB(buffer, x, y);
+		else
+			ret = (fb_pixel_t *) CFrameBuffer::getInstance()->convertRGB2FB(buffer, x, y, convertSetupAlpha2Alpha(g_settings.theme.infobar_alpha));
+		*width = x;
+		*height = y;
+	}else{
+		dprintf(DEBUG_NORMAL,  "[CPictureViewer] [%s - %d] mode %s: Error decoding file %s\n", __func__, __LINE__, mode_str.c_str(), name.c_str());
 		free(buffer);
 		buffer = NULL;
-  	}else
-		dprintf(DEBUG_NORMAL,  "[CPictureViewer] [%s - %d] mode: %s, file: %s Error: %s, buffer = %p (Pos: %d %d, Dim: %d x %d)\n", __func__, __LINE__, mode_str.c_str(), name.c_str(), strerror(errno), buffer, x, y, *width, *height);
+		return NULL;
+	}
+	free(buffer);
+	buffer = NULL;
 	return ret;
 }
 
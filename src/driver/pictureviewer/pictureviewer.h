@@ -31,6 +31,8 @@
 #include <stdio.h>    /* printf       */
 #include <sys/time.h> /* gettimeofday */
 #include <map>
+#include <set>
+#include <list>
 #include <pthread.h>
 #include <inttypes.h>
 class CPictureViewer
@@ -69,6 +71,10 @@ class CPictureViewer
 	bool DisplayImage (const std::string & name, int posx, int posy, int width, int height, int transp=0 /*CFrameBuffer::TM_EMPTY*/);
 // 	bool DisplayLogo (uint64_t channel_id, int posx, int posy, int width, int height);
 	bool GetLogoName(const uint64_t& channel_id, const std::string& ChanName, std::string & name, int *width = NULL, int *height = NULL);
+	/* look up and decode the logos of these channels in background, so
+	   they are ready when painted. replaces an unfinished earlier request */
+	void PrefetchLogos(const std::vector<std::pair<uint64_t, std::string> > &channels);
+	void StartLogoThread();
 	fb_pixel_t * getImage (const std::string & name, int width, int height);
 	fb_pixel_t * getIcon (const std::string & name, int *width, int *height);
 	void getSize(const char *name, int* width, int *height);
@@ -118,6 +124,41 @@ class CPictureViewer
 	std::map<uint64_t, logo_data> logo_map;
 	pthread_mutex_t logo_map_mutex;
 
+	/* file names in the logo directories, so looking for a logo does not
+	   need to access the file system. the logo thread reads a directory
+	   again when its mtime changes */
+	struct logo_dir {
+		std::string path;
+		time_t mtime;
+		bool recheck;		/* read in the second of its mtime */
+		std::set<std::string> files;
+	};
+	std::vector<logo_dir> logo_dirs;
+	/* logos decoded in advance, in original size */
+	struct logo_image {
+		unsigned char *buffer;
+		int x;
+		int y;
+		int bpp;
+		size_t size;
+	};
+	std::map<std::string, logo_image> logo_images;
+	std::list<std::string> logo_images_lru;
+	size_t logo_images_size;
+	std::list<std::pair<uint64_t, std::string> > logo_queue;
+	pthread_cond_t logo_cond;
+	pthread_t logo_thread;
+	bool logo_thread_stop;
+
+	static void *logoThread(void *arg);
+	void logoRun(void);
+	void logoIndexCheck(void);
+	void prefetchLogo(const uint64_t channel_id, const std::string &ChanName);
+	bool logoExists(const std::string &dir, const std::string &file);
+	bool getLogoImage(const std::string &name, unsigned char **buffer, int *x, int *y, int *bpp);
+	void trimLogoImages(size_t limit);
+	int loadImage(const std::string &name, CFormathandler *fh, unsigned char **buffer, int *x, int *y, int *bpp);
+
 	CFormathandler * fh_getsize(const char *name,int *x,int *y, int width_wanted, int height_wanted);
 	void init_handlers(void);
 	void add_format(int (*picsize)(const char *,int *,int*,int,int),int (*picread)(const char *,unsigned char **,int*,int*), int (*id)(const char*));
@@ -58,6 +58,7 @@
 #include <driver/radiotext.h>
 #include <driver/streamts.h>
 #include <driver/abstime.h>
+#include <driver/tsring.h>
 #include <zapit/capmt.h>
 #include <zapit/channel.h>
 #include <zapit/getservices.h>
@@ -142,6 +143,7 @@ CRecordInstance::CRecordInstance(const CTimerd::RecordingInfo * const eventinfo,
 	cMovieInfo = new CMovieInfo();
 	recMovieInfo = new MI_MOVIE_INFO();
 	record = NULL;
+	tsring = NULL;
 	rec_stop_msg = g_Locale->getText(LOCALE_RECORDING_STOP);
 }
 
@@ -152,6 +154,7 @@ CRecordInstance::~CRecordInstance()
 	delete recMovieInfo;
 	delete cMovieInfo;
 	delete record;
+	delete tsring;
 }
 
 bool CRecordInstance::SaveXml()
@@ -286,12 +289,40 @@ record_error_msg_t CRecordInstance::Start(CZapitChannel * channel)
 
 	record->Open();
 
-	if(!record->Start(fd, (unsigned short ) allpids.PIDs.vpid, (unsigned short *) apids, numpids, channel_id)) {
+	/* index the recording. timeshift in ring mode is indexed on the way to
+	 * the file, drops old data and keeps no sidecar. other recordings are
+	 * written directly, the index follows the file */
+	int recfd = fd;
+	if (allpids.PIDs.vpid) {
+		int ring = autoshift ? g_settings.timeshift_ring * 1024 : 0;
+		tsring = new CTimeshiftRing(tsfile, ring);
+		tsring->SetVideo(allpids.PIDs.vpid, recMovieInfo->VideoType);
+		bool started;
+		if (ring) {
+			started = tsring->Start(fd);
+			if (started)
+				recfd = tsring->GetInput();
+		} else {
+			tsring->GetIndex()->OpenSidecar(CTsIndex::GetSidecarName(tsfile));
+			started = tsring->Follow();
+		}
+		if (!started) {
+			delete tsring;
+			tsring = NULL;
+			unlink(CTsIndex::GetSidecarName(tsfile).c_str());
+		}
+	}
+
+	if(!record->Start(recfd, (unsigned short ) allpids.PIDs.vpid, (unsigned short *) apids, numpids, channel_id)) {
 		record->Stop();
 		delete record;
 		record = NULL;
-		close(fd);
+		/* the pipe input in ring mode, the ring closes fd */
+		close(recfd);
+		delete tsring;
+		tsring = NULL;
 		unlink(tsfile.c_str());
+		unlink(CTsIndex::GetSidecarName(tsfile).c_str());
 		std::string xmlfile = std::string(filename) + ".xml";
 		unlink(xmlfile.c_str());
 		hintBox.hide();
@@ -337,6 +368,13 @@ bool CRecordInstance::Stop(bool remove_event)
 	SaveXml();
 	/* Stop do close fd - if started */
 	record->Stop();
+	/* write out what is left in the pipe and close the file, or index
+	 * the rest of the file */
+	if (tsring) {
+		tsring->Stop();
+		delete tsring;
+		tsring = NULL;
+	}
 
 	if(!autoshift)
 		CFEManager::getInstance()->unlockFrontend(frontend, true);//FIXME testing
@@ -349,6 +387,8 @@ bool CRecordInstance::Stop(bool remove_event)
 		snprintf(buf,sizeof(buf), "%s.xml", filename);
                 //autoshift_delete = false;
                 unlink(buf);
+		snprintf(buf,sizeof(buf), "%s.idx", filename);
+		unlink(buf);
         }
 	if(recording_id && remove_event) {
 		g_Timerd->stopTimerEvent(recording_id);
@@ -981,6 +1021,17 @@ const std::string CRecordManager::GetFileName(t_channel_id channel_id, bool time
 	return filename;
 }
 
+bool CRecordManager::GetTimeshiftSeekPosition(int position, int duration, int pos, bool absolute, int &newpos)
+{
+	bool ret = false;
+	mutex.lock();
+	CRecordInstance * inst = FindTimeshift();
+	if (inst && inst->GetTimeshiftRing())
+		ret = inst->GetTimeshiftRing()->GetSeekPosition(position, duration, pos, absolute, newpos);
+	mutex.unlock();
+	return ret;
+}
+
 /* return record mode mask, for channel_id not 0, or global */
 int CRecordManager::GetRecordMode(const t_channel_id channel_id)
 {
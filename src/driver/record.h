@@ -65,6 +65,7 @@ extern "C" {
 
 class CFrontend;
 class CZapitChannel;
+class CTimeshiftRing;
 
 //FIXME
 enum record_error_msg_t
@@ -109,6 +110,7 @@ class CRecordInstance
 		CMovieInfo *	cMovieInfo;
 		MI_MOVIE_INFO *	recMovieInfo;
 		cRecord *	record;
+		CTimeshiftRing * tsring;
 
 		virtual void GetPids(CZapitChannel * channel);
 		virtual void FillMovieInfo(CZapitChannel * channel, APIDList & apid_list);
@@ -136,6 +138,7 @@ class CRecordInstance
 		void GetRecordString(std::string& str, std::string &dur);
 		const char * GetFileName() { return filename; };
 		bool Timeshift() { return autoshift; };
+		CTimeshiftRing * GetTimeshiftRing() { return tsring; };
 		int tshift_mode;
 		void SetStopMessage(const char* text) {rec_stop_msg = text;} ;
 		int  GetStatus();
@@ -214,6 +217,7 @@ class CRecordManager : public CMenuTarget /*, public CChangeObserver*/
 
 		MI_MOVIE_INFO * GetMovieInfo(const t_channel_id channel_id, bool timeshift = true);
 		const std::string GetFileName(const t_channel_id channel_id, bool timeshift = true);
+		bool GetTimeshiftSeekPosition(int position, int duration, int pos, bool absolute, int &newpos);
 
 		bool RunStartScript(void);
 		bool RunStopScript(void);
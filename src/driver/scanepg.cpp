@@ -38,8 +38,19 @@
 #include <driver/scanepg.h>
 #include <driver/record.h>
 #include <driver/streamts.h>
+#include <driver/abstime.h>
 
 //#define EPG_RESCAN_TIME (24*60*60)
+/* EPG a transponder should have after the next rescan, to be skipped */
+#define EPG_SCAN_MIN_COVERAGE	(12*60*60)
+/* seconds between checks of a running scan */
+#define EPG_SCAN_CHECK		10
+/* no new events for so long and the transponder is covered: next one */
+#define EPG_SCAN_QUIET		30
+/* give up, if EIT is not complete after this time */
+#define EPG_SCAN_MAX_TIME	(10*60)
+/* a failed tune counts as so much more EPG, to try the others first */
+#define EPG_SCAN_FAIL_PENALTY	(6*60*60)
 
 extern CBouquetList * bouquetList;
 extern CBouquetList * TVfavList;
@@ -52,6 +63,8 @@ CEpgScan::CEpgScan()
 	standby = false;
 	rescan_timer = 0;
 	scan_in_progress = false;
+	scan_version = 0;
+	check_timer = 0;
 	Clear();
 }
 
@@ -102,6 +115,8 @@ void CEpgScan::Clear()
 	next_chid = 0;
 	allfav_done = false;
 	selected_done = false;
+	for (eit_tpstate_map_t::iterator it = tpstate.begin(); it != tpstate.end(); ++it)
+		it->second.channels.clear();
 }
 
 bool CEpgScan::Running()
@@ -113,7 +128,10 @@ void CEpgScan::AddBouquet(CChannelList * clist)
 {
 	for (unsigned i = 0; i < clist->Size(); i++) {
 		CZapitChannel * chan = clist->getChannelFromIndex(i);
-		if (!IS_WEBCHAN(chan->getChannelID()) && scanned.find(chan->getTransponderId()) == scanned.end())
+		if (IS_WEBCHAN(chan->getChannelID()))
+			continue;
+		tpstate[chan->getTransponderId()].channels.insert(chan->getEpgID() & 0xFFFFFFFFFFFFULL);
+		if (scanned.find(chan->getTransponderId()) == scanned.end())
 			scanmap.insert(eit_scanmap_pair_t(chan->getTransponderId(), chan->getChannelID()));
 	}
 }
@@ -234,6 +252,9 @@ void CEpgScan::Stop()
 		return;
 
 	INFO("stopping %s scan...", standby ? "standby" : "live");
+	active.clear();
+	next_chid = 0;
+	g_RCInput->killTimer(check_timer);
 	if (standby) {
 		standby = false;
 		CZapit::getInstance()->SetCurrentChannelID(live_channel_id);
@@ -256,13 +277,18 @@ int CEpgScan::handleMsg(const neutrino_msg_t msg, neutrino_msg_data_t data)
 		}
 		return messages_return::handled;
 	}
+	if ((msg == NeutrinoMessages::EVT_TIMER) && (data == check_timer)) {
+		CheckScan();
+		return messages_return::handled;
+	}
 	if (!CheckMode()) {
 		int ret = messages_return::handled;
 		if (msg == NeutrinoMessages::EVT_EIT_COMPLETE)
 			scan_in_progress = false;
-		else if (msg == NeutrinoMessages::EVT_BACK_ZAP_COMPLETE)
+		else if (msg == NeutrinoMessages::EVT_BACK_ZAP_COMPLETE) {
 			scan_in_progress = true;
-		else
+			next_chid = 0;
+		} else
 			ret = messages_return::unhandled;
 		return ret;
 	}
@@ -271,6 +297,8 @@ int CEpgScan::handleMsg(const neutrino_msg_t msg, neutrino_msg_data_t data)
 	if (msg == NeutrinoMessages::EVT_ZAP_COMPLETE) {
 		/* live channel changed, block scan channel change by timer */
 		scan_in_progress = true;
+		/* scans on the frontend live took are lost, the others go on */
+		DropLost();
 		AddTransponders();
 		INFO("EVT_ZAP_COMPLETE, scan map size: %zd\n", scanmap.size());
 #if 0
@@ -285,8 +313,14 @@ int CEpgScan::handleMsg(const neutrino_msg_t msg, neutrino_msg_data_t data)
 		t_channel_id chid = *(t_channel_id *)data;
 		newchan = CServiceManager::getInstance()->FindChannel(chid);
 		if (newchan) {
-			scanned.insert(newchan->getTransponderId());
-			scanmap.erase(newchan->getTransponderId());
+			transponder_id_t tpid = newchan->getTransponderId();
+			if (active.find(tpid) != active.end()) {
+				ScanDone(tpid, "EIT complete");
+			} else if (chid == CZapit::getInstance()->GetCurrentChannelID()) {
+				/* live channel read through */
+				scanned.insert(tpid);
+				scanmap.erase(tpid);
+			}
 		}
 		INFO("EIT read complete [" PRINTF_CHANNEL_ID_TYPE "], scan map size: %zd", chid, scanmap.size());
 
@@ -299,6 +333,7 @@ int CEpgScan::handleMsg(const neutrino_msg_t msg, neutrino_msg_data_t data)
 		INFO("EVT_BACK_ZAP_COMPLETE [" PRINTF_CHANNEL_ID_TYPE "]", chid);
 		if (next_chid) {
 			newchan = CServiceManager::getInstance()->FindChannel(next_chid);
+			next_chid = 0;
 			if (newchan) {
 				if(chid) {
 					if (!CRecordManager::getInstance()->RecordingStatus()) {
@@ -306,9 +341,17 @@ int CEpgScan::handleMsg(const neutrino_msg_t msg, neutrino_msg_data_t data)
 						if (standby && !g_Sectionsd->getIsScanningActive())
 							g_Sectionsd->setPauseScanning(false);
 						g_Sectionsd->setServiceChanged(newchan->getChannelID(), false, newchan->getRecordDemux());
+						ScanStarted(newchan);
+						/* more free frontends, more scans */
+						Next();
 					}
 				} else {
 					INFO("tune failed [%s]", newchan->getName().c_str());
+					tpstate[newchan->getTransponderId()].fails++;
+					{
+						OpenThreads::ScopedLock<OpenThreads::Mutex> lock(stats_mutex);
+						stats.failed++;
+					}
 					scanmap.erase(newchan->getTransponderId());
 					Next();
 				}
@@ -321,14 +364,20 @@ int CEpgScan::handleMsg(const neutrino_msg_t msg, neutrino_msg_data_t data)
 
 void CEpgScan::AddTimer()
 {
-	if (rescan_timer == 0)
+	if (rescan_timer == 0) {
 		rescan_timer = g_RCInput->addTimer((g_settings.epg_scan_rescan*60*60)*1000ULL*1000ULL, true);
+		OpenThreads::ScopedLock<OpenThreads::Mutex> lock(stats_mutex);
+		stats.next_rescan = time(NULL) + g_settings.epg_scan_rescan*60*60;
+	}
 	INFO("rescan timer id %d", rescan_timer);
 	INFO("rescan time is %d*60*60", g_settings.epg_scan_rescan);
 }
 
 void CEpgScan::EnterStandby()
 {
+	active.clear();
+	g_RCInput->killTimer(check_timer);
+	UpdateStats();
 	AddTimer();
 	if (standby) {
 		CZapit::getInstance()->SetCurrentChannelID(live_channel_id);
@@ -345,7 +394,9 @@ void CEpgScan::Next()
 #ifdef ENABLE_PIP
 	bool plocked = false;
 #endif
-	next_chid = 0;
+	/* one zap at a time, the next one after its EVT_BACK_ZAP_COMPLETE */
+	if (next_chid)
+		return;
 
 	if (!standby && CNeutrinoApp::getInstance()->getMode() == NeutrinoModes::mode_standby)
 		return;
@@ -358,9 +409,13 @@ void CEpgScan::Next()
 		AddSelected();
 
 	if (!CheckMode() || scanmap.empty()) {
-		EnterStandby();
+		if (active.empty())
+			EnterStandby();
 		return;
 	}
+	/* one scan thread of sectionsd per scan */
+	if (active.size() >= MAX_EIT_SCAN_THREADS)
+		return;
 
 	/* executed in neutrino thread - possible race with locks in zapit zap NOWAIT :
 	   send zapTo_NOWAIT -> EIT_COMPLETE from sectionsd -> zap and this at the same time
@@ -385,11 +440,40 @@ void CEpgScan::Next()
 		}
 #endif
 	}
+	/* frontends of running scans are not free either */
+	uint32_t busy_fe = BusyFrontends(true);
+	time_t now = time(NULL);
+	time_t needed = NeededCoverage(now);
+	/* transponders by the end of their EPG, the shortest first */
+	std::multimap<time_t, transponder_id_t> order;
 _repeat:
+	order.clear();
 	for (eit_scanmap_iterator_t it = scanmap.begin(); it != scanmap.end(); /* ++it*/) {
-		CZapitChannel * newchan = CServiceManager::getInstance()->FindChannel(it->second);
-		if (newchan == NULL) {
+		if (active.find(it->first) != active.end()) {
+			++it;
+			continue;
+		}
+		eit_tpstate_t &tp = tpstate[it->first];
+		bool known;
+		time_t coverage = GetCoverage(tp, known);
+		if (known && coverage >= needed) {
+			INFO("skip tp %" PRIx64 ", EPG long enough", it->first);
+			scanned.insert(it->first);
 			scanmap.erase(it++);
+			OpenThreads::ScopedLock<OpenThreads::Mutex> lock(stats_mutex);
+			stats.skipped++;
+			continue;
+		}
+		/* the ones without any EPG channel last */
+		if (!known)
+			coverage = needed;
+		order.insert(std::make_pair(coverage + (time_t) tp.fails * EPG_SCAN_FAIL_PENALTY, it->first));
+		++it;
+	}
+	for (std::multimap<time_t, transponder_id_t>::iterator it = order.begin(); it != order.end(); ++it) {
+		CZapitChannel * newchan = CServiceManager::getInstance()->FindChannel(scanmap[it->second]);
+		if (newchan == NULL) {
+			scanmap.erase(it->second);
 			continue;
 		}
 		if (CFEManager::getInstance()->canTune(newchan)) {
@@ -398,13 +482,13 @@ _repeat:
 			break;
 		} else
 			INFO("skip [%s], cannot tune", newchan->getName().c_str());
-		++it;
 	}
 	if (!next_chid && ((g_settings.epg_scan == SCAN_FAV) && AddFavorites()))
 		goto _repeat;
 	if (!next_chid && ((g_settings.epg_scan == SCAN_SEL) && AddSelected()))
 		goto _repeat;
 
+	BusyFrontends(false);
 	if (llocked)
 		CFEManager::getInstance()->unlockFrontend(live_fe);
 #ifdef ENABLE_PIP
@@ -413,8 +497,193 @@ _repeat:
 #endif
 
 	CFEManager::getInstance()->Unlock();
+	UpdateStats();
 	if (next_chid)
-		g_Zapit->zapTo_epg(next_chid, standby);
-	else 
+		g_Zapit->zapTo_epg(next_chid, standby, busy_fe);
+	else if (active.empty())
 		EnterStandby();
 }
+
+/* the frontends of the running scans as bit mask, lock or unlock them
+   for the check of the next transponder */
+uint32_t CEpgScan::BusyFrontends(bool lock)
+{
+	uint32_t mask = 0;
+	for (eit_scan_map_t::iterator it = active.begin(); it != active.end(); ++it) {
+		CFrontend *fe = it->second.fe;
+		if (lock)
+			CFEManager::getInstance()->lockFrontend(fe);
+		else
+			CFEManager::getInstance()->unlockFrontend(fe);
+		if (fe->getNumber() < 32)
+			mask |= 1U << fe->getNumber();
+	}
+	return mask;
+}
+
+/* end of the EPG of the transponder: of the channel with the shortest EPG,
+   0 if one has none. not known if no channel had EPG after the last scan */
+time_t CEpgScan::GetCoverage(eit_tpstate_t &tp, bool &known)
+{
+	time_t ret = 0;
+	known = false;
+	for (std::set<t_channel_id>::iterator it = tp.channels.begin(); it != tp.channels.end(); ++it) {
+		if (tp.noepg.find(*it) != tp.noepg.end())
+			continue;
+		time_t end = CEitManager::getInstance()->getEpgEnd(*it);
+		if (!known || end < ret)
+			ret = end;
+		known = true;
+	}
+	return ret;
+}
+
+time_t CEpgScan::NeededCoverage(time_t now)
+{
+	return now + g_settings.epg_scan_rescan*60*60 + EPG_SCAN_MIN_COVERAGE;
+}
+
+void CEpgScan::ScanStarted(CZapitChannel * chan)
+{
+	/* the demux of the scan is the one of its frontend */
+	CFrontend *fe = NULL;
+	for (int i = 0; i < CFEManager::getInstance()->getFrontendCount(); i++) {
+		CFrontend *f = CFEManager::getInstance()->getFE(i);
+		if (f && f->getNumber() + 1 == chan->getRecordDemux()) {
+			fe = f;
+			break;
+		}
+	}
+	if (fe == NULL) {
+		INFO("no frontend for demux %d, tp %" PRIx64 " not tracked", chan->getRecordDemux(), chan->getTransponderId());
+		return;
+	}
+	eit_scan_t &scan = active[chan->getTransponderId()];
+	scan.chid = chan->getChannelID();
+	scan.fe = fe;
+	scan.start = scan.changed = time_monotonic();
+	scan_version = CEitManager::getInstance()->getEventsVersion();
+	INFO("tp %" PRIx64 " scanned on frontend %d, %zd scans running", chan->getTransponderId(), fe->getNumber(), active.size());
+	if (check_timer == 0)
+		check_timer = g_RCInput->addTimer(EPG_SCAN_CHECK*1000ULL*1000ULL, false);
+	UpdateStats();
+}
+
+void CEpgScan::ScanDone(transponder_id_t tpid, const char *reason)
+{
+	eit_scan_map_t::iterator scan = active.find(tpid);
+	if (scan == active.end())
+		return;
+
+	eit_tpstate_t &tp = tpstate[tpid];
+	tp.last_scan = time(NULL);
+	tp.scans++;
+	tp.fails = 0;
+	/* channels without EPG dont hold back the transponder next time */
+	tp.noepg.clear();
+	for (std::set<t_channel_id>::iterator it = tp.channels.begin(); it != tp.channels.end(); ++it) {
+		if (CEitManager::getInstance()->getEpgEnd(*it) == 0)
+			tp.noepg.insert(*it);
+	}
+	INFO("tp %" PRIx64 " done (%s) after %d seconds, %zd of %zd channels without EPG",
+			tpid, reason, (int)(time_monotonic() - scan->second.start), tp.noepg.size(), tp.channels.size());
+
+	scanned.insert(tpid);
+	scanmap.erase(tpid);
+	active.erase(scan);
+	if (active.empty())
+		g_RCInput->killTimer(check_timer);
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(stats_mutex);
+	stats.scanned++;
+}
+
+/* scans never lock their frontend, live and record zaps take it when they
+   need it. such a scan is lost, its transponder stays in the scan map */
+bool CEpgScan::DropLost()
+{
+	bool dropped = false;
+	for (eit_scan_map_t::iterator it = active.begin(); it != active.end(); /* ++it */) {
+		if (it->second.fe->getTsidOnid() == it->first) {
+			++it;
+			continue;
+		}
+		INFO("scan of tp %" PRIx64 " interrupted", it->first);
+		active.erase(it++);
+		dropped = true;
+	}
+	if (active.empty())
+		g_RCInput->killTimer(check_timer);
+	return dropped;
+}
+
+/* sectionsd reads the other filters until it has seen everything twice,
+   stop earlier when the transponder has enough EPG and nothing new comes */
+void CEpgScan::CheckScan()
+{
+	bool done = DropLost();
+	if (active.empty()) {
+		if (done)
+			Next();
+		return;
+	}
+	time_t t = time_monotonic();
+	unsigned int version = CEitManager::getInstance()->getEventsVersion();
+	/* the version counts all events, a change holds back every scan */
+	bool changed = (version != scan_version);
+	scan_version = version;
+	time_t needed = NeededCoverage(time(NULL));
+	for (eit_scan_map_t::iterator it = active.begin(); it != active.end(); /* ++it */) {
+		transponder_id_t tpid = it->first;
+		eit_scan_t &scan = it->second;
+		++it;
+		if (changed)
+			scan.changed = t;
+		bool known;
+		time_t coverage = GetCoverage(tpstate[tpid], known);
+		bool covered = known && coverage >= needed;
+		if (covered && (t - scan.changed >= EPG_SCAN_QUIET))
+			ScanDone(tpid, "EPG long enough");
+		else if (t - scan.start >= EPG_SCAN_MAX_TIME)
+			ScanDone(tpid, "timeout");
+		else
+			continue;
+		done = true;
+		OpenThreads::ScopedLock<OpenThreads::Mutex> lock(stats_mutex);
+		stats.early++;
+	}
+	if (done)
+		Next();
+	else
+		UpdateStats();
+}
+
+void CEpgScan::UpdateStats()
+{
+	unsigned channels = 0, covered = 0, empty = 0;
+	time_t needed = NeededCoverage(time(NULL));
+	for (eit_tpstate_map_t::iterator it = tpstate.begin(); it != tpstate.end(); ++it) {
+		for (std::set<t_channel_id>::iterator cit = it->second.channels.begin(); cit != it->second.channels.end(); ++cit) {
+			time_t end = CEitManager::getInstance()->getEpgEnd(*cit);
+			channels++;
+			if (end == 0)
+				empty++;
+			else if (end >= needed)
+				covered++;
+		}
+	}
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(stats_mutex);
+	stats.pending = scanmap.size();
+	stats.channels = channels;
+	stats.covered = covered;
+	stats.empty = empty;
+	stats.current.clear();
+	for (eit_scan_map_t::iterator it = active.begin(); it != active.end(); ++it)
+		stats.current.push_back(it->first);
+}
+
+/* called from other threads, e.g. nhttpd */
+void CEpgScan::GetStats(epgscan_stats_t &s)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(stats_mutex);
+	s = stats;
+}
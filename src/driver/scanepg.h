@@ -21,11 +21,51 @@
 #define __SCAN_EPG__
 
 #include <zapit/zapit.h>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
 
 typedef std::map<transponder_id_t, t_channel_id> eit_scanmap_t;
 typedef std::pair<transponder_id_t, t_channel_id> eit_scanmap_pair_t;
 typedef eit_scanmap_t::iterator eit_scanmap_iterator_t;
 
+/* what is known about the EPG of a transponder */
+struct eit_tpstate_t
+{
+	std::set<t_channel_id> channels;	/* epg ids of the channels to scan */
+	std::set<t_channel_id> noepg;		/* had no events after the last scan */
+	time_t last_scan;
+	unsigned scans;
+	unsigned fails;
+	eit_tpstate_t() : last_scan(0), scans(0), fails(0) {}
+};
+typedef std::map<transponder_id_t, eit_tpstate_t> eit_tpstate_map_t;
+
+struct epgscan_stats_t
+{
+	unsigned pending;		/* transponders left in this round */
+	unsigned scanned;		/* transponders, counted since start */
+	unsigned early;			/* scans stopped before EIT complete */
+	unsigned skipped;		/* not scanned, EPG still long enough */
+	unsigned failed;		/* tune failed */
+	unsigned channels;		/* channels to scan */
+	unsigned covered;		/* channels with EPG for the next rescan */
+	unsigned empty;			/* channels without EPG */
+	std::vector<transponder_id_t> current;	/* transponders scanned now */
+	time_t next_rescan;
+	epgscan_stats_t() : pending(0), scanned(0), early(0), skipped(0), failed(0),
+		channels(0), covered(0), empty(0), next_rescan(0) {}
+};
+
+/* a scan running on a frontend of its own */
+struct eit_scan_t
+{
+	t_channel_id chid;
+	CFrontend *fe;
+	time_t start;
+	time_t changed;
+};
+typedef std::map<transponder_id_t, eit_scan_t> eit_scan_map_t;
+
 class CEpgScan
 {
 	public:
@@ -55,6 +95,23 @@ class CEpgScan
 		uint32_t rescan_timer;
 		bool scan_in_progress;
 
+		eit_tpstate_map_t tpstate;
+		/* scans running at once, at most one per free frontend */
+		eit_scan_map_t active;
+		unsigned int scan_version;
+		uint32_t check_timer;
+		OpenThreads::Mutex stats_mutex;
+		epgscan_stats_t stats;
+
+		time_t GetCoverage(eit_tpstate_t &tp, bool &known);
+		time_t NeededCoverage(time_t now);
+		void ScanStarted(CZapitChannel * chan);
+		void ScanDone(transponder_id_t tpid, const char *reason);
+		bool DropLost();
+		uint32_t BusyFrontends(bool lock);
+		void CheckScan();
+		void UpdateStats();
+
 		void AddBouquet(CChannelList * clist);
 		bool AddFavorites();
 		bool AddSelected();
@@ -75,6 +132,7 @@ class CEpgScan
 		void Stop();
 		bool Running();
 		void ConfigureEIT();
+		void GetStats(epgscan_stats_t &s);
 };
 
 #endif
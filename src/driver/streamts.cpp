@@ -57,6 +57,8 @@
 #include <driver/record.h>
 #include <driver/genpsi.h>
 #include <system/set_threadname.h>
+#include <system/metrics.h>
+#include <system/asynclog.h>
 #include <gui/movieplayer.h>
 
 #include <system/set_threadname.h>
@@ -143,8 +145,11 @@ bool CStreamInstance::Send(ssize_t r, unsigned char * _buf)
 				count -= ret;
 			}
 		} while ((count > 0) && (i-- > 0));
-		if (count)
-			printf("send err, fd %d: (%zd from %zd)\n", *it, r-count, r);
+		METRIC_ADD(METRIC_STREAM_BYTES, r - count);
+		if (count) {
+			ASYNCLOG_PRINTF(0, "send err, fd %d: (%zd from %zd)\n", *it, r-count, r);
+			METRIC_ADD(METRIC_STREAM_DROPS, 1);
+		}
 	}
 	return true;
 }
@@ -0,0 +1,699 @@
+/*
+	Neutrino-GUI  -   DBoxII-Project
+
+	TS time/offset index
+
+	License: GPL
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <algorithm>
+
+#include <OpenThreads/ScopedLock>
+#include <zapit/client/zapittypes.h>
+#include <driver/tsindex.h>
+
+#define TS_SIZE		188
+#define PTS_WRAP	(1LL << 33)
+/* PTS jumps bigger than this are treated as stream discontinuity */
+#define PTS_MAX_JUMP	(10 * 90000LL)
+/* add an entry at least once per second, even without I-frame */
+#define ENTRY_INTERVAL	90000LL
+
+/* sidecar file: header followed by entries, host byte order */
+#define IDX_MAGIC	"TSIX"
+#define IDX_VERSION	1
+#define IDX_FLAG_IFRAME	0x01
+
+typedef struct idx_header
+{
+	char		magic[4];
+	uint32_t	version;
+} idx_header_t;
+
+typedef struct idx_entry
+{
+	int64_t		offset;
+	uint32_t	time;
+	uint32_t	flags;
+} idx_entry_t;
+
+CTsIndex::CTsIndex()
+{
+	sidecar = -1;
+	vpid = -1;
+	vtype = VIDEO_MPEG2;
+	Reset();
+}
+
+CTsIndex::~CTsIndex()
+{
+	CloseSidecar();
+}
+
+void CTsIndex::Reset()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+	entries.clear();
+	rest_len = 0;
+	position = 0;
+	pmtpid = -1;
+	last_pts = 0;
+	time90 = 0;
+	last_entry = -ENTRY_INTERVAL;
+	have_pts = false;
+	pes_pending = false;
+	es_len = 0;
+}
+
+void CTsIndex::SetVideo(int pid, int channel_type)
+{
+	vpid = pid ? pid : -1;
+	switch (channel_type) {
+		case CHANNEL_MPEG4:
+			vtype = VIDEO_H264;
+			break;
+		case CHANNEL_HEVC:
+			vtype = VIDEO_HEVC;
+			break;
+		default:
+			vtype = VIDEO_MPEG2;
+			break;
+	}
+}
+
+void CTsIndex::Parse(const unsigned char * buf, int len, off64_t offset)
+{
+	if (rest_len && offset != position)
+		rest_len = 0;
+	position = offset + len;
+
+	if (rest_len) {
+		int need = TS_SIZE - rest_len;
+		if (len < need) {
+			memcpy(rest + rest_len, buf, len);
+			rest_len += len;
+			return;
+		}
+		memcpy(rest + rest_len, buf, need);
+		if (rest[0] == 0x47)
+			ParsePacket(rest, offset - rest_len);
+		buf += need;
+		len -= need;
+		offset += need;
+		rest_len = 0;
+	}
+
+	while (len >= TS_SIZE) {
+		if (buf[0] != 0x47) {
+			/* resync: next sync byte followed by another one */
+			int i;
+			for (i = 1; i < len; i++) {
+				if (buf[i] == 0x47 && (i + TS_SIZE >= len || buf[i + TS_SIZE] == 0x47))
+					break;
+			}
+			buf += i;
+			len -= i;
+			offset += i;
+			continue;
+		}
+		ParsePacket(buf, offset);
+		buf += TS_SIZE;
+		len -= TS_SIZE;
+		offset += TS_SIZE;
+	}
+	if (len > 0) {
+		memcpy(rest, buf, len);
+		rest_len = len;
+	}
+}
+
+void CTsIndex::ParsePacket(const unsigned char * packet, off64_t offset)
+{
+	int pid = ((packet[1] & 0x1f) << 8) | packet[2];
+	bool pusi = packet[1] & 0x40;
+
+	if (pid != 0 && pid != pmtpid && pid != vpid)
+		return;
+	if (!(packet[3] & 0x10))
+		return;
+
+	int start = 4;
+	if (packet[3] & 0x20)
+		start += packet[4] + 1;
+	if (start >= TS_SIZE)
+		return;
+
+	const unsigned char * data = packet + start;
+	int len = TS_SIZE - start;
+
+	if (pid == vpid) {
+		if (pusi) {
+			FinishPes();
+			AddPes(data, len, offset);
+		} else if (pes_pending && es_len < (int) sizeof(es)) {
+			int n = std::min(len, (int) sizeof(es) - es_len);
+			memcpy(es + es_len, data, n);
+			es_len += n;
+			if (es_len == (int) sizeof(es))
+				FinishPes();
+		}
+		return;
+	}
+	/* PSI only, if pid was not set from outside */
+	if (!pusi || (vpid > 0 && pmtpid < 0))
+		return;
+	int pointer = data[0];
+	if (pointer + 1 >= len)
+		return;
+	data += pointer + 1;
+	len -= pointer + 1;
+	if (pid == 0)
+		ParsePat(data, len);
+	else
+		ParsePmt(data, len);
+}
+
+void CTsIndex::ParsePat(const unsigned char * data, int len)
+{
+	if (len < 8 || data[0] != 0x00 || pmtpid > 0)
+		return;
+	int slen = ((data[1] & 0x0f) << 8) | data[2];
+	int end = std::min(3 + slen - 4, len);
+	for (int i = 8; i + 4 <= end; i += 4) {
+		int program = (data[i] << 8) | data[i + 1];
+		if (program == 0)
+			continue;
+		pmtpid = ((data[i + 2] & 0x1f) << 8) | data[i + 3];
+		break;
+	}
+}
+
+void CTsIndex::ParsePmt(const unsigned char * data, int len)
+{
+	if (len < 12 || data[0] != 0x02 || vpid > 0)
+		return;
+	int slen = ((data[1] & 0x0f) << 8) | data[2];
+	int end = std::min(3 + slen - 4, len);
+	int i = 12 + (((data[10] & 0x0f) << 8) | data[11]);
+	while (i + 5 <= end) {
+		int type = data[i];
+		int pid = ((data[i + 1] & 0x1f) << 8) | data[i + 2];
+		int eslen = ((data[i + 3] & 0x0f) << 8) | data[i + 4];
+		if (type == 0x01 || type == 0x02) {
+			vpid = pid;
+			vtype = VIDEO_MPEG2;
+		} else if (type == 0x1b) {
+			vpid = pid;
+			vtype = VIDEO_H264;
+		} else if (type == 0x24) {
+			vpid = pid;
+			vtype = VIDEO_HEVC;
+		}
+		if (vpid > 0) {
+			printf("CTsIndex::%s: video pid %x type %d\n", __func__, vpid, vtype);
+			break;
+		}
+		i += 5 + eslen;
+	}
+}
+
+void CTsIndex::AddPes(const unsigned char * data, int len, off64_t offset)
+{
+	if (len < 14 || data[0] || data[1] || data[2] != 0x01)
+		return;
+	if (!(data[7] & 0x80))
+		return;
+
+	int64_t pts = ((int64_t)(data[9] & 0x0e) << 29) | (data[10] << 22) | ((data[11] & 0xfe) << 14) |
+		(data[12] << 7) | (data[13] >> 1);
+	if (have_pts) {
+		int64_t delta = pts - last_pts;
+		if (delta < -PTS_WRAP / 2)
+			delta += PTS_WRAP;
+		else if (delta > PTS_WRAP / 2)
+			delta -= PTS_WRAP;
+		if (delta > PTS_MAX_JUMP || delta < -PTS_MAX_JUMP)
+			delta = 0;
+		time90 += delta;
+	}
+	have_pts = true;
+	last_pts = pts;
+
+	int hdrlen = 9 + data[8];
+	pes_pending = true;
+	pes_offset = offset;
+	pes_time = time90;
+	es_len = 0;
+	if (hdrlen < len) {
+		es_len = std::min(len - hdrlen, (int) sizeof(es));
+		memcpy(es, data + hdrlen, es_len);
+	}
+}
+
+void CTsIndex::FinishPes()
+{
+	if (!pes_pending)
+		return;
+	pes_pending = false;
+	bool iframe = IsIFrame();
+	if (iframe || pes_time - last_entry >= ENTRY_INTERVAL)
+		AddEntry(pes_time, pes_offset, iframe);
+}
+
+/* exp-golomb from the slice header, enough for first_mb and slice_type */
+static int read_ue(const unsigned char * data, int len, int &bit)
+{
+	int zeros = 0;
+	while (bit < len * 8 && !(data[bit / 8] & (0x80 >> (bit % 8)))) {
+		zeros++;
+		bit++;
+	}
+	bit++;
+	int val = 0;
+	for (int i = 0; i < zeros && bit < len * 8; i++, bit++)
+		val = (val << 1) | ((data[bit / 8] >> (7 - bit % 8)) & 1);
+	return (1 << zeros) - 1 + val;
+}
+
+bool CTsIndex::IsIFrame()
+{
+	for (int i = 0; i + 5 < es_len; i++) {
+		if (es[i] || es[i + 1] || es[i + 2] != 0x01)
+			continue;
+		const unsigned char * p = es + i + 3;
+		int left = es_len - i - 3;
+		if (vtype == VIDEO_MPEG2) {
+			if (p[0] == 0x00)	/* picture start code */
+				return ((p[2] >> 3) & 7) == 1;
+		} else if (vtype == VIDEO_H264) {
+			int nal = p[0] & 0x1f;
+			if (nal == 5)
+				return true;
+			if (nal == 9 && (p[1] >> 5) == 0)	/* AUD, I slices only */
+				return true;
+			if (nal == 1) {
+				int bit = 0;
+				read_ue(p + 1, left - 1, bit);
+				int slice_type = read_ue(p + 1, left - 1, bit);
+				return slice_type % 5 == 2 || slice_type % 5 == 4;
+			}
+		} else {
+			int nal = (p[0] >> 1) & 0x3f;
+			if (nal >= 16 && nal <= 21)	/* IRAP */
+				return true;
+			if (nal == 35 && (p[2] >> 5) == 0)	/* AUD, I slices only */
+				return true;
+			if (nal < 10)
+				return false;
+		}
+	}
+	return false;
+}
+
+void CTsIndex::AddEntry(int64_t time, off64_t offset, bool iframe)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+	ts_index_entry_t entry;
+	entry.time = time / 90;
+	entry.offset = offset;
+	entry.iframe = iframe;
+	/* B-frames may carry older PTS, keep the index sorted by time */
+	if (!entries.empty() && entries.back().time > entry.time)
+		entry.time = entries.back().time;
+	entries.push_back(entry);
+	last_entry = time;
+	if (sidecar >= 0 && !WriteEntry(sidecar, entry)) {
+		perror("CTsIndex: sidecar write");
+		close(sidecar);
+		sidecar = -1;
+	}
+}
+
+void CTsIndex::Append(const ts_index_entry_t &entry)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+	entries.push_back(entry);
+}
+
+void CTsIndex::Finish()
+{
+	FinishPes();
+}
+
+bool CTsIndex::WriteEntry(int fd, const ts_index_entry_t &entry)
+{
+	idx_entry_t e;
+	e.offset = entry.offset;
+	e.time = entry.time;
+	e.flags = entry.iframe ? IDX_FLAG_IFRAME : 0;
+	return write(fd, &e, sizeof(e)) == (ssize_t) sizeof(e);
+}
+
+std::string CTsIndex::GetSidecarName(const std::string &tsfile)
+{
+	std::string name = tsfile;
+	if (name.size() > 3 && name.compare(name.size() - 3, 3, ".ts") == 0)
+		name.erase(name.size() - 3);
+	return name + ".idx";
+}
+
+bool CTsIndex::OpenSidecar(const std::string &name)
+{
+	CloseSidecar();
+	int fd = open(name.c_str(), O_CREAT | O_TRUNC | O_WRONLY | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		perror(name.c_str());
+		return false;
+	}
+	idx_header_t hdr;
+	memcpy(hdr.magic, IDX_MAGIC, sizeof(hdr.magic));
+	hdr.version = IDX_VERSION;
+	if (write(fd, &hdr, sizeof(hdr)) != (ssize_t) sizeof(hdr)) {
+		perror(name.c_str());
+		close(fd);
+		return false;
+	}
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+	sidecar = fd;
+	return true;
+}
+
+void CTsIndex::CloseSidecar()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+	if (sidecar >= 0)
+		close(sidecar);
+	sidecar = -1;
+}
+
+bool CTsIndex::Load(const std::string &name)
+{
+	int fd = open(name.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+
+	idx_header_t hdr;
+	if (read(fd, &hdr, sizeof(hdr)) != (ssize_t) sizeof(hdr) || memcmp(hdr.magic, IDX_MAGIC, sizeof(hdr.magic)) || hdr.version != IDX_VERSION) {
+		printf("CTsIndex::%s: %s: bad header\n", __func__, name.c_str());
+		close(fd);
+		return false;
+	}
+	Reset();
+
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+	idx_entry_t buf[1024];
+	ssize_t len;
+	while ((len = read(fd, buf, sizeof(buf))) > 0) {
+		for (int i = 0; i < len / (int) sizeof(idx_entry_t); i++) {
+			ts_index_entry_t entry;
+			entry.offset = buf[i].offset;
+			entry.time = buf[i].time;
+			entry.iframe = buf[i].flags & IDX_FLAG_IFRAME;
+			entries.push_back(entry);
+		}
+	}
+	close(fd);
+	printf("CTsIndex::%s: %s: %d entries\n", __func__, name.c_str(), (int) entries.size());
+	return !entries.empty();
+}
+
+static bool read_entry(int fd, int num, idx_entry_t &e)
+{
+	off64_t pos = sizeof(idx_header_t) + (off64_t) num * sizeof(idx_entry_t);
+	return pread64(fd, &e, sizeof(e), pos) == (ssize_t) sizeof(e);
+}
+
+/* binary search in the sidecar file, for a single lookup without Load() */
+off64_t CTsIndex::FindOffset(const std::string &name, int64_t ms)
+{
+	int fd = open(name.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -1;
+
+	off64_t ret = -1;
+	struct stat64 st;
+	idx_header_t hdr;
+	idx_entry_t e;
+	if (fstat64(fd, &st) || read(fd, &hdr, sizeof(hdr)) != (ssize_t) sizeof(hdr) ||
+			memcmp(hdr.magic, IDX_MAGIC, sizeof(hdr.magic)) || hdr.version != IDX_VERSION) {
+		close(fd);
+		return -1;
+	}
+	int count = (st.st_size - sizeof(hdr)) / sizeof(idx_entry_t);
+	if (count > 0 && read_entry(fd, 0, e)) {
+		/* times are from the start of the stream */
+		ms += e.time;
+		int lo = 0, hi = count - 1;
+		while (lo < hi) {
+			int mid = (lo + hi + 1) / 2;
+			if (!read_entry(fd, mid, e))
+				break;
+			if ((int64_t) e.time <= ms)
+				lo = mid;
+			else
+				hi = mid - 1;
+		}
+		/* I-frame at or before, entries without are at least once per second */
+		for (int i = lo; i >= 0 && read_entry(fd, i, e); i--) {
+			if (e.flags & IDX_FLAG_IFRAME) {
+				ret = e.offset;
+				break;
+			}
+		}
+	}
+	close(fd);
+	return ret;
+}
+
+bool CTsIndex::Save(const std::string &name)
+{
+	std::string tmpname = name + ".tmp";
+	int fd = open(tmpname.c_str(), O_CREAT | O_TRUNC | O_WRONLY | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		perror(tmpname.c_str());
+		return false;
+	}
+	idx_header_t hdr;
+	memcpy(hdr.magic, IDX_MAGIC, sizeof(hdr.magic));
+	hdr.version = IDX_VERSION;
+	bool ok = write(fd, &hdr, sizeof(hdr)) == (ssize_t) sizeof(hdr);
+
+	mutex.lock();
+	for (ts_index_t::iterator it = entries.begin(); ok && it != entries.end(); ++it)
+		ok = WriteEntry(fd, *it);
+	mutex.unlock();
+	close(fd);
+
+	if (!ok || rename(tmpname.c_str(), name.c_str())) {
+		perror(name.c_str());
+		unlink(tmpname.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool CTsIndex::Build(const std::string &tsfile)
+{
+	int fd = open(tsfile.c_str(), O_RDONLY | O_LARGEFILE | O_CLOEXEC);
+	if (fd < 0) {
+		perror(tsfile.c_str());
+		return false;
+	}
+	Reset();
+	vpid = -1;
+
+	time_t start = time(0);
+	const int bufsize = 188 * 1024;
+	unsigned char * buf = new unsigned char[bufsize];
+	off64_t offset = 0;
+	ssize_t len;
+	while ((len = read(fd, buf, bufsize)) > 0) {
+		Parse(buf, len, offset);
+		offset += len;
+	}
+	Finish();
+	delete[] buf;
+	close(fd);
+
+	printf("CTsIndex::%s: %s: %d entries, %" PRId64 " bytes, took %ld secs\n", __func__, tsfile.c_str(), Count(), offset, time(0) - start);
+	if (!Count())
+		return false;
+	return Save(GetSidecarName(tsfile));
+}
+
+bool CTsIndex::LoadOrBuild(const std::string &tsfile)
+{
+	std::string name = GetSidecarName(tsfile);
+	struct stat64 ts, idx;
+	if (stat64(tsfile.c_str(), &ts))
+		return false;
+	/* sidecar older than the stream: recording was modified without it */
+	if (!stat64(name.c_str(), &idx) && idx.st_mtime + 60 >= ts.st_mtime && Load(name))
+		return true;
+	return Build(tsfile);
+}
+
+bool CTsIndex::GetSeekPosition(off64_t size, off64_t first_offset, int position, int duration, int pos, bool absolute, int &newpos)
+{
+	if (duration <= 0 || size <= 0 || Count() == 0)
+		return false;
+
+	/* position and absolute pos are in the player's scale, linear to the size:
+	 * they are turned into an offset, everything else is index time */
+	int64_t target;
+	if (absolute)
+		target = InterpolateTime((off64_t) pos * size / duration);
+	else
+		target = InterpolateTime((off64_t) position * size / duration) + pos;
+
+	off64_t offset = GetOffset(target);
+	if (offset < first_offset)
+		offset = GetFirstOffset();
+	if (offset < 0)
+		return false;
+
+	newpos = offset * duration / size;
+	printf("CTsIndex::%s: %d%s -> time %" PRId64 " offset %" PRId64 " pos %d\n", __func__, pos, absolute ? " (abs)" : "",
+			target, offset, newpos);
+	return true;
+}
+
+off64_t CTsIndex::GetOffset(int64_t ms, bool iframe_only)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+	if (entries.empty())
+		return -1;
+
+	int lo = 0, hi = entries.size() - 1;
+	while (lo < hi) {
+		int mid = (lo + hi + 1) / 2;
+		if (entries[mid].time <= ms)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	if (iframe_only) {
+		for (int i = lo; i >= 0; i--) {
+			if (entries[i].iframe)
+				return entries[i].offset;
+		}
+		/* nothing before, use the next I-frame */
+		for (int i = lo; i < (int) entries.size(); i++) {
+			if (entries[i].iframe)
+				return entries[i].offset;
+		}
+	}
+	return entries[lo].offset;
+}
+
+int64_t CTsIndex::GetTime(off64_t offset)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+	if (entries.empty())
+		return -1;
+
+	int lo = 0, hi = entries.size() - 1;
+	while (lo < hi) {
+		int mid = (lo + hi + 1) / 2;
+		if (entries[mid].offset <= offset)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	return entries[lo].time;
+}
+
+/* time at offset, between the entries around it. the player does not stop at
+ * entries, the time of the entry before could be a GOP or more off */
+int64_t CTsIndex::InterpolateTime(off64_t offset)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+	if (entries.empty())
+		return -1;
+
+	int lo = 0, hi = entries.size() - 1;
+	while (lo < hi) {
+		int mid = (lo + hi + 1) / 2;
+		if (entries[mid].offset <= offset)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	const ts_index_entry_t &a = entries[lo];
+	if (offset <= a.offset || lo + 1 == (int) entries.size())
+		return a.time;
+	const ts_index_entry_t &b = entries[lo + 1];
+	return a.time + (b.time - a.time) * (offset - a.offset) / (b.offset - a.offset);
+}
+
+int64_t CTsIndex::GetFirstTime()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+	if (entries.empty())
+		return -1;
+	return entries.front().time;
+}
+
+int64_t CTsIndex::GetDuration()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+	if (entries.empty())
+		return 0;
+	return entries.back().time - entries.front().time;
+}
+
+off64_t CTsIndex::GetFirstOffset()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+	if (entries.empty())
+		return -1;
+	return entries.front().offset;
+}
+
+void CTsIndex::DropBefore(off64_t offset)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+	while (!entries.empty() && entries.front().offset < offset)
+		entries.pop_front();
+}
+
+int CTsIndex::Count()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+	return entries.size();
+}
+
+bool CTsIndex::GetEntry(int num, ts_index_entry_t &entry)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+	if (num < 0 || num >= (int) entries.size())
+		return false;
+	entry = entries[num];
+	return true;
+}
@@ -0,0 +1,138 @@
+/*
+	Neutrino-GUI  -   DBoxII-Project
+
+	TS time/offset index
+
+	License: GPL
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#ifndef __tsindex_h__
+#define __tsindex_h__
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <deque>
+#include <string>
+
+#include <OpenThreads/Mutex>
+
+/* maps play time to packet aligned file offsets of a transport stream.
+ * entries are added for every video PES starting an I-frame, and at
+ * least once per second if no I-frame could be detected. data may be
+ * fed in pieces of any size, the video pid is taken from PAT/PMT if
+ * not set with SetVideo().
+ * recordings keep the index next to the .ts as .idx sidecar file, it is
+ * appended while recording and can be rebuilt from the .ts with Build() */
+class CTsIndex
+{
+	public:
+		typedef struct ts_index_entry
+		{
+			int64_t	time;	/* ms from start of stream */
+			off64_t	offset;	/* offset of the TS packet with PES header */
+			bool	iframe;
+		} ts_index_entry_t;
+
+	private:
+		typedef std::deque<ts_index_entry_t> ts_index_t;
+
+		OpenThreads::Mutex mutex;
+		ts_index_t entries;
+		int		sidecar;
+
+		unsigned char	rest[188];
+		int		rest_len;
+		off64_t		position;
+
+		int		vpid;
+		int		vtype;
+		int		pmtpid;
+
+		/* PTS tracking, in 90kHz units */
+		int64_t		last_pts;
+		int64_t		time90;
+		int64_t		last_entry;
+		bool		have_pts;
+
+		/* pending PES, waiting for enough ES data to find the picture type */
+		bool		pes_pending;
+		off64_t		pes_offset;
+		int64_t		pes_time;
+		unsigned char	es[256];
+		int		es_len;
+
+		void ParsePacket(const unsigned char * packet, off64_t offset);
+		void ParsePat(const unsigned char * data, int len);
+		void ParsePmt(const unsigned char * data, int len);
+		void AddPes(const unsigned char * data, int len, off64_t offset);
+		void FinishPes();
+		bool IsIFrame();
+		void AddEntry(int64_t time, off64_t offset, bool iframe);
+		bool WriteEntry(int fd, const ts_index_entry_t &entry);
+		int64_t InterpolateTime(off64_t offset);
+
+	public:
+		enum {
+			VIDEO_MPEG2,
+			VIDEO_H264,
+			VIDEO_HEVC
+		};
+		CTsIndex();
+		~CTsIndex();
+
+		void Reset();
+		/* pid and type as known from zapit, type is a CHANNEL_* video type */
+		void SetVideo(int pid, int channel_type);
+		/* feed stream data, offset is the file offset of buf[0] */
+		void Parse(const unsigned char * buf, int len, off64_t offset);
+		/* flush a pending PES at end of data */
+		void Finish();
+
+		static std::string GetSidecarName(const std::string &tsfile);
+		/* start writing new entries to sidecar file */
+		bool OpenSidecar(const std::string &name);
+		void CloseSidecar();
+		bool Load(const std::string &name);
+		/* offset of the I-frame at or before ms from stream start, read
+		 * from the sidecar file without loading it. -1 if not found */
+		static off64_t FindOffset(const std::string &name, int64_t ms);
+		bool Save(const std::string &name);
+		/* index a complete file and save the sidecar */
+		bool Build(const std::string &tsfile);
+		/* load the sidecar of tsfile, build it if missing */
+		bool LoadOrBuild(const std::string &tsfile);
+		void Append(const ts_index_entry_t &entry);
+
+		/* seek for players with a position linear to the file size:
+		 * translate a seek into the player's own position scale,
+		 * snapped to an I-frame not before first_offset */
+		bool GetSeekPosition(off64_t size, off64_t first_offset, int position, int duration, int pos, bool absolute, int &newpos);
+
+		/* offset of the last entry at or before time ms, -1 if empty */
+		off64_t GetOffset(int64_t ms, bool iframe_only = true);
+		/* time of the last entry at or before offset, -1 if empty */
+		int64_t GetTime(off64_t offset);
+		int64_t GetFirstTime();
+		int64_t GetDuration();
+		off64_t GetFirstOffset();
+		/* remove entries pointing before offset */
+		void DropBefore(off64_t offset);
+		int Count();
+		bool GetEntry(int num, ts_index_entry_t &entry);
+};
+
+#endif
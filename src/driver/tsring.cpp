@@ -0,0 +1,273 @@
+/*
+	Neutrino-GUI  -   DBoxII-Project
+
+	timeshift ring buffer
+
+	License: GPL
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <linux/falloc.h>
+
+#include <OpenThreads/ScopedLock>
+#include <system/set_threadname.h>
+#include <driver/tsring.h>
+
+/* packet and page aligned */
+#define SEGMENT_ALIGN	(188 * 4096)
+#define SEGMENT_MAX	(87 * SEGMENT_ALIGN)	/* ~64 MB */
+#define READ_SIZE	(188 * 348)
+#define PIPE_SIZE	(1024 * 1024)
+
+CTimeshiftRing::CTimeshiftRing(const std::string &fname, int size_mb)
+{
+	filename = fname;
+	fd = -1;
+	pipefd[0] = pipefd[1] = -1;
+	started = false;
+	can_punch = true;
+	parsed = 0;
+	dropped = 0;
+	ring_size = (off64_t) size_mb * 1024 * 1024;
+	/* keep at least 8 segments in the ring */
+	segment_size = ring_size / 8 / SEGMENT_ALIGN * SEGMENT_ALIGN;
+	if (segment_size > SEGMENT_MAX)
+		segment_size = SEGMENT_MAX;
+	if (segment_size < SEGMENT_ALIGN)
+		segment_size = SEGMENT_ALIGN;
+}
+
+CTimeshiftRing::~CTimeshiftRing()
+{
+	Stop();
+}
+
+bool CTimeshiftRing::Start(int file_fd)
+{
+	if (started)
+		return true;
+
+	if (pipe2(pipefd, O_CLOEXEC)) {
+		perror("[tsring] pipe");
+		return false;
+	}
+	/* room for the recorder while the file write waits for the disk */
+	fcntl(pipefd[1], F_SETPIPE_SZ, PIPE_SIZE);
+	fcntl(pipefd[0], F_SETFL, O_NONBLOCK);
+
+	fd = file_fd;
+	/* e.g. psi written before recording starts */
+	parsed = lseek64(fd, 0, SEEK_END);
+	if (parsed < 0)
+		parsed = 0;
+	printf("[tsring] start %s, ring %" PRId64 " MB, segment %" PRId64 " MB\n", filename.c_str(),
+			ring_size >> 20, segment_size >> 20);
+	started = true;
+	int ret = start();
+	if (ret) {
+		started = false;
+		close(pipefd[0]);
+		close(pipefd[1]);
+		pipefd[0] = pipefd[1] = -1;
+		fd = -1;
+	}
+	return (ret == 0);
+}
+
+bool CTimeshiftRing::Follow()
+{
+	if (started)
+		return true;
+
+	fd = open(filename.c_str(), O_RDONLY | O_LARGEFILE | O_CLOEXEC);
+	if (fd < 0) {
+		perror(filename.c_str());
+		return false;
+	}
+	parsed = 0;
+	printf("[tsring] follow %s\n", filename.c_str());
+	started = true;
+	int ret = start();
+	if (ret) {
+		started = false;
+		close(fd);
+		fd = -1;
+	}
+	return (ret == 0);
+}
+
+bool CTimeshiftRing::Stop()
+{
+	if (!started)
+		return false;
+
+	started = false;
+	int ret = join();
+	if (pipefd[0] >= 0)
+		close(pipefd[0]);
+	pipefd[0] = pipefd[1] = -1;
+	close(fd);
+	fd = -1;
+	return (ret == 0);
+}
+
+bool CTimeshiftRing::WriteOut(const unsigned char * buf, ssize_t len)
+{
+	while (len > 0) {
+		ssize_t ret = write(fd, buf, len);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		buf += ret;
+		len -= ret;
+	}
+	return true;
+}
+
+void CTimeshiftRing::run()
+{
+	set_threadname("tsring");
+	unsigned char * buf = new unsigned char[READ_SIZE];
+	bool write_ok = true;
+
+	if (pipefd[0] < 0) {
+		RunFollow(buf);
+		delete[] buf;
+		return;
+	}
+
+	/* after Stop(), drain what the recorder wrote before it closed the pipe */
+	while (true) {
+		struct pollfd pfd;
+		pfd.fd = pipefd[0];
+		pfd.events = POLLIN;
+		if (poll(&pfd, 1, 200) <= 0) {
+			if (!started)
+				break;
+			continue;
+		}
+		ssize_t len = read(pipefd[0], buf, READ_SIZE);
+		if (len < 0 && (errno == EINTR || errno == EAGAIN))
+			continue;
+		if (len <= 0)
+			break;
+
+		/* keep draining on write errors, the recorder must not block */
+		if (write_ok && !WriteOut(buf, len)) {
+			printf("[tsring] %s: write failed (%s)\n", filename.c_str(), strerror(errno));
+			write_ok = false;
+		}
+		if (!write_ok)
+			continue;
+		index.Parse(buf, len, parsed);
+		mutex.lock();
+		parsed += len;
+		mutex.unlock();
+		if (ring_size && can_punch)
+			DropSegments();
+	}
+	delete[] buf;
+}
+
+/* the recorder writes the file, read what it wrote so far. after Stop(),
+ * read up to the end once more */
+void CTimeshiftRing::RunFollow(unsigned char * buf)
+{
+	while (true) {
+		bool last = !started;
+		struct stat64 st;
+		if (fstat64(fd, &st))
+			st.st_size = parsed;
+		while (parsed < st.st_size) {
+			ssize_t len = pread64(fd, buf, READ_SIZE, parsed);
+			if (len < 0 && errno == EINTR)
+				continue;
+			if (len <= 0) {
+				/* the player falls back to seek without index */
+				printf("[tsring] %s: read failed (%s), no index\n", filename.c_str(),
+						len ? strerror(errno) : "end of file");
+				index.CloseSidecar();
+				unlink(CTsIndex::GetSidecarName(filename).c_str());
+				index.Reset();
+				return;
+			}
+			index.Parse(buf, len, parsed);
+			mutex.lock();
+			parsed += len;
+			mutex.unlock();
+		}
+		if (last)
+			break;
+		usleep(200000);
+	}
+	index.Finish();
+}
+
+void CTimeshiftRing::DropSegments()
+{
+	while (parsed - dropped > ring_size + segment_size) {
+		if (fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, dropped, segment_size)) {
+			/* e.g. NFS or FAT, timeshift keeps growing as before */
+			printf("[tsring] %s: punch hole failed (%s), ring disabled\n", filename.c_str(), strerror(errno));
+			can_punch = false;
+			return;
+		}
+		mutex.lock();
+		dropped += segment_size;
+		mutex.unlock();
+		index.DropBefore(dropped);
+	}
+}
+
+off64_t CTimeshiftRing::GetStart()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+	return dropped;
+}
+
+off64_t CTimeshiftRing::GetEnd()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+	return parsed;
+}
+
+/* the player scales its position with the size of the file, not with what is
+ * indexed so far. seek target and snapping are done in index time, the size
+ * is only used to find the player's current offset and to scale back */
+bool CTimeshiftRing::GetSeekPosition(int position, int duration, int pos, bool absolute, int &newpos)
+{
+	struct stat64 st;
+	if (fd < 0 || fstat64(fd, &st))
+		return false;
+	mutex.lock();
+	off64_t start = dropped;
+	mutex.unlock();
+	return index.GetSeekPosition(st.st_size, start, position, duration, pos, absolute, newpos);
+}
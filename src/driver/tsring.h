@@ -0,0 +1,86 @@
+/*
+	Neutrino-GUI  -   DBoxII-Project
+
+	timeshift ring buffer
+
+	License: GPL
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#ifndef __tsring_h__
+#define __tsring_h__
+
+#include <string>
+#include <sys/types.h>
+
+#include <OpenThreads/Thread>
+#include <OpenThreads/Mutex>
+#include <driver/tsindex.h>
+
+/* indexes a recording while it is written. with a ring size set (timeshift)
+ * it sits between recorder and file: the recorder writes into a pipe, the
+ * data is indexed on the way to the file, and the file is handled as a chain
+ * of fixed size segments. when the ring size is exceeded the oldest segment
+ * is punched out of the file, so disk usage stays bounded while all offsets
+ * the player knows about stay valid.
+ * without ring the recorder writes the file itself as before, and the index
+ * follows the file behind it, reading the data just written from the page
+ * cache. if that fails, the recording goes on without index */
+class CTimeshiftRing : public OpenThreads::Thread
+{
+	private:
+		std::string	filename;
+		int		fd;
+		int		pipefd[2];
+		bool		started;
+		bool		can_punch;
+		off64_t		ring_size;
+		off64_t		segment_size;
+		/* written by the ring thread, read by the player */
+		OpenThreads::Mutex mutex;
+		off64_t		parsed;
+		off64_t		dropped;
+		CTsIndex	index;
+
+		void run();
+		void RunFollow(unsigned char * buf);
+		bool WriteOut(const unsigned char * buf, ssize_t len);
+		void DropSegments();
+	public:
+		CTimeshiftRing(const std::string &fname, int size_mb);
+		~CTimeshiftRing();
+
+		void SetVideo(int pid, int channel_type) { index.SetVideo(pid, channel_type); }
+		/* ring mode: takes over the file fd, data written up to now is kept */
+		bool Start(int file_fd);
+		/* no ring: index the file the recorder writes, from its start */
+		bool Follow();
+		/* all data written to the input is flushed to the file, or all data
+		 * written to the followed file is indexed */
+		bool Stop();
+		/* ring mode: fd for the recorder, closed by the recorder */
+		int GetInput() { return pipefd[1]; }
+
+		CTsIndex * GetIndex() { return &index; }
+		/* first offset with valid data */
+		off64_t GetStart();
+		off64_t GetEnd();
+		/* translate a player seek into the player's own position scale,
+		 * snapped to an I-frame inside the ring */
+		bool GetSeekPosition(int position, int duration, int pos, bool absolute, int &newpos);
+};
+
+#endif
@@ -152,6 +152,7 @@ SIevent::SIevent(const t_original_network_id _original_network_id, const t_trans
 	eventID		    = _event_id;
 	table_id            = 0xFF; /* not set */
 	version 	    = 0xFF;
+	modified	    = 0;
 	running 	    = 0;
 }
 
@@ -173,6 +174,7 @@ SIevent::SIevent(const struct eit_event *e)
 
 	table_id = 0xFF; /* not set */
 	version = 0xFF;
+	modified = 0;
 	service_id = 0;
 	original_network_id = 0;
 	transport_stream_id = 0;
@@ -462,6 +464,19 @@ void SIevent::parseLinkageDescriptor(const uint8_t *buf, unsigned maxlen)
 	}
 }
 
+bool SIevent::sameContent(const SIevent &e) const
+{
+#ifdef FULL_CONTENT_CLASSIFICATION
+	if (classifications != e.classifications)
+		return false;
+#else
+	if (classifications.content != e.classifications.content || classifications.user != e.classifications.user)
+		return false;
+#endif
+	return langData == e.langData && components == e.components &&
+		ratings == e.ratings && linkage_descs == e.linkage_descs;
+}
+
 char SIevent::getFSK() const
 {
 	for (SIparentalRatings::const_iterator it = ratings.begin(); it != ratings.end(); ++it)
@@ -364,6 +364,8 @@ class SIevent
 		//time_t vps;
 		unsigned char table_id;
 		unsigned char version;
+		/* modification counter of the store at the last change */
+		unsigned int modified;
 
 		SIcomponents components;
 		SIparentalRatings ratings;
@@ -510,6 +512,7 @@ class SIevent
 			//vps = 0;
 			table_id = 0xFF; /* 0xFF means "not set" */
 			version = 0xFF;
+			modified = 0;
 			running = false;
 		}
 		SIevent(const struct eit_event *e);
@@ -557,6 +560,8 @@ class SIevent
 		}
 		int saveXML(FILE *file, const char *serviceName) const; // saves the event
 		char getFSK() const;
+		/* texts and descriptors equal, the times are not compared */
+		bool sameContent(const SIevent &e) const;
 
 		void dump(void) const; // dumps the event to stdout
 		void dumpSmall(void) const; // dumps the event to stdout (not all information)
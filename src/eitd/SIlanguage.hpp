@@ -36,6 +36,11 @@ public:
 	enum SILangDataIndex { langName = 0, langText, langExtendedText, langMax };
 	unsigned int lang;
 	std::string text[langMax];
+
+	bool operator==(const SILangData &d) const {
+		return lang == d.lang && text[langName] == d.text[langName] &&
+			text[langText] == d.text[langText] && text[langExtendedText] == d.text[langExtendedText];
+	}
 };
 
 class SIlanguage {
@@ -31,12 +31,20 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <string>
+#include <system/asynclog.h>
 
 extern bool sections_debug;
 
-#define dprintf(fmt, args...) do { if (sections_debug) { printdate_ms(stdout); printf(fmt, ## args); fflush(stdout); }} while (0)
-#define dputs(str)            do { if (sections_debug) { printdate_ms(stdout); puts(str);            fflush(stdout); }} while (0)
-#define xprintf(fmt, args...) do { printdate_ms(stderr); fprintf(stderr, fmt, ## args); } while (0)
+/* with the async log the date is added by its writer thread */
+#define dprintf(fmt, args...) do { if (sections_debug) { \
+	if (asynclog_enabled) ASYNCLOG_PRINTF(ASYNCLOG_DATE, fmt, ## args); \
+	else { printdate_ms(stdout); printf(fmt, ## args); fflush(stdout); }}} while (0)
+#define dputs(str)            do { if (sections_debug) { \
+	if (asynclog_enabled) ASYNCLOG_PRINTF(ASYNCLOG_DATE, "%s\n", str); \
+	else { printdate_ms(stdout); puts(str); fflush(stdout); }}} while (0)
+#define xprintf(fmt, args...) do { \
+	if (asynclog_enabled) ASYNCLOG_PRINTF(ASYNCLOG_DATE | ASYNCLOG_STDERR, fmt, ## args); \
+	else { printdate_ms(stderr); fprintf(stderr, fmt, ## args); }} while (0)
 
 /* dont add \n when using this */
 #define xcprintf(fmt, args...) do {			\
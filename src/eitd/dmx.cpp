@@ -38,6 +38,7 @@
 #include <map>
 
 #include <driver/abstime.h>
+#include <system/metrics.h>
 #include <dvbsi++/long_section.h>
 
 #include "dmx.h"
@@ -365,6 +366,7 @@ int DMX::getSection(uint8_t *buf, const unsigned timeoutInMSeconds, int &timeout
 	bad_count = 0;
 	/* there are channels with very low rate, neutrino change filter on timeouts while data not complete */
 	seen_section = true;
+	METRIC_ADD(METRIC_EIT_SECTIONS, 1);
 	//unlock();
 
 	// skip sections which are too short
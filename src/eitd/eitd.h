@@ -231,6 +231,31 @@ class CEitThread : public CEventsThread
 		CEitThread(std::string tname, unsigned short pid = 0x12);
 };
 
+/* EIT thread for a background scan on another demux. it sleeps until it
+   gets a service, and reports the scan complete once it read through its
+   filters */
+class CEitScanThread : public CEitThread
+{
+	private:
+		bool		started;
+		bool		busy;
+		/* scans given, the one a finished read belongs to */
+		unsigned int	scan_gen;
+		unsigned int	done_gen;
+		t_channel_id	done_service;
+
+		/* overloaded hooks */
+		bool shouldSleep();
+		bool checkSleep();
+		void beforeSleep();
+	public:
+		CEitScanThread(std::string tname);
+		void scan(int dnum, t_channel_id service);
+		bool isBusy();
+		int getDemux() { return dmx_num; }
+		bool isStarted() { return started; }
+};
+
 class CFreeSatThread : public CEventsThread
 {
 	private:
@@ -39,6 +39,8 @@
 #include <poll.h>
 #include <sys/time.h>
 #include <time.h>
+#include <deque>
+#include <set>
 #include <connection/basicsocket.h>
 #include <connection/basicserver.h>
 
@@ -49,12 +51,14 @@
 #include <system/set_threadname.h>
 #include <system/helpers.h>
 #include <system/set_threadname.h>
+#include <system/metrics.h>
 #include <OpenThreads/ScopedLock>
 
 #include "eitd.h"
 #include "sectionsd.h"
 #include "edvbstring.h"
 #include "xmlutil.h"
+#include "xmltv.h"
 #include "debug.h"
 
 #include <compatibility.h>
@@ -138,6 +142,7 @@ OpenThreads::Mutex filter_mutex;
 static CTimeThread threadTIME;
 static CEitThread threadEIT;
 static CCNThread threadCN;
+static CEitScanThread *threadScanEIT[MAX_EIT_SCAN_THREADS];
 
 #ifdef ENABLE_VIASATEPG
 // ViaSAT uses pid 0x39 instead of 0x12
@@ -236,14 +241,31 @@ static MySIeventUniqueKeysMetaOrderServiceUniqueKey mySIeventUniqueKeysMetaOrder
 static MySIservicesOrderUniqueKey mySIservicesOrderUniqueKey;
 static MySIservicesNVODorderUniqueKey mySIservicesNVODorderUniqueKey;
 
-/* needs write lock held! */
-static bool deleteEvent(const event_id_t uniqueKey)
+/* modification counter of the event store, for clients which mirror it.
+ * added and changed events get the counter value in SIevent::modified,
+ * deletions are kept in a list. all of them need the write lock */
+static unsigned int events_modified = 0;
+#define DELETED_EVENTS_MAX 8192
+static std::deque<std::pair<unsigned int, event_id_t> > deleted_events;
+/* deletions up to this counter value are not known anymore */
+static unsigned int deleted_events_lost = 0;
+
+/* needs write lock held! quiet: no note in the deleted list, for events
+ * which are replaced, or ended (clients drop them by their end time) */
+static bool deleteEvent(const event_id_t uniqueKey, bool quiet = false)
 {
 	bool ret = false;
 	// writeLockEvents();
 	MySIeventsOrderUniqueKey::iterator e = mySIeventsOrderUniqueKey.find(uniqueKey);
 
 	if (e != mySIeventsOrderUniqueKey.end()) {
+		if (!quiet) {
+			deleted_events.push_back(std::make_pair(++events_modified, uniqueKey));
+			if (deleted_events.size() > DELETED_EVENTS_MAX) {
+				deleted_events_lost = deleted_events.front().first;
+				deleted_events.pop_front();
+			}
+		}
 		if (!e->second->times.empty()) {
 			mySIeventsOrderFirstEndTimeServiceIDEventUniqueKey.erase(e->second);
 			mySIeventsOrderServiceUniqueKeyFirstStartTimeEventUniqueKey.erase(e->second);
@@ -260,12 +282,12 @@ static bool deleteEvent(const event_id_t uniqueKey)
 	return ret;
 }
 
-/* if cn == true (if called by cnThread), then myCurrentEvent and myNextEvent is updated, too */
-/*static*/ void addEvent(const SIevent &evt, const time_t zeit, bool cn = false)
+static void addEventLocked(const SIevent &evt, const time_t zeit);
+
+/* filter_mutex must be held. true if the EPG filter drops the event */
+static bool epgFilterDrops(const SIevent &evt)
 {
-	filter_mutex.lock();
 	bool EPG_filtered = checkEPGFilter(evt.original_network_id, evt.transport_stream_id, evt.service_id);
-	filter_mutex.unlock();
 
 	/* more readable in "plain english":
 	   if current/next are not to be filtered and table_id is current/next -> continue
@@ -278,13 +300,24 @@ static bool deleteEvent(const event_id_t uniqueKey)
 			(evt.table_id != 0xFF)) {
 		if (!epg_filter_is_whitelist && EPG_filtered) {
 			//dprintf("addEvent: blacklist and filter did match\n");
-			return;
+			return true;
 		}
 		if (epg_filter_is_whitelist && !EPG_filtered) {
 			//dprintf("addEvent: whitelist and filter did not match\n");
-			return;
+			return true;
 		}
 	}
+	return false;
+}
+
+/* if cn == true (if called by cnThread), then myCurrentEvent and myNextEvent is updated, too */
+/*static*/ void addEvent(const SIevent &evt, const time_t zeit, bool cn = false)
+{
+	filter_mutex.lock();
+	bool drop = epgFilterDrops(evt);
+	filter_mutex.unlock();
+	if (drop)
+		return;
 
 	if (cn) { // current-next => fill current or next event...
 //xprintf("addEvent: current %012" PRIx64 " event %012" PRIx64 " messaging_got_CN %d\n", messaging_current_servicekey, evt.get_channel_id(), messaging_got_CN);
@@ -344,6 +377,27 @@ xprintf("addEvent: ch %012" PRIx64 " running %d (%s) got_CN %d\n", evt.get_chann
 	}
 
 	writeLockEvents();
+	addEventLocked(evt, zeit);
+	unlockEvents();
+}
+
+/* for events read from files (EPG cache, XMLTV), which need no current/next
+ * handling. the EPG filter applies as in addEvent(), both locks are taken
+ * only once for all of them */
+void addEvents(const std::vector<SIevent> &evts, const time_t zeit)
+{
+	filter_mutex.lock();
+	writeLockEvents();
+	for (std::vector<SIevent>::const_iterator it = evts.begin(); it != evts.end(); ++it)
+		if (!epgFilterDrops(*it))
+			addEventLocked(*it, zeit);
+	unlockEvents();
+	filter_mutex.unlock();
+}
+
+/* needs write lock held! */
+static void addEventLocked(const SIevent &evt, const time_t zeit)
+{
 	MySIeventsOrderUniqueKey::iterator si = mySIeventsOrderUniqueKey.find(evt.uniqueKey());
 	bool already_exists = (si != mySIeventsOrderUniqueKey.end());
 	if (already_exists && (evt.table_id < si->second->table_id))
@@ -378,28 +432,52 @@ xprintf("addEvent: ch %012" PRIx64 " running %d (%s) got_CN %d\n", evt.get_chann
 		already_exists = false;
 
 	if ((already_exists) && (SIlanguage::getMode() == CSectionsdClient::LANGUAGE_MODE_OFF)) {
+		/* the same events are received again and again, only real
+		 * changes count as modification */
+#ifdef FULL_CONTENT_CLASSIFICATION
+		bool changed = !(si->second->classifications == evt.classifications);
+#else
+		bool changed = si->second->classifications.content != evt.classifications.content ||
+			si->second->classifications.user != evt.classifications.user;
+#endif
 		si->second->classifications = evt.classifications;
 #ifdef USE_ITEM_DESCRIPTION
 		si->second->itemDescription = evt.itemDescription;
 		si->second->item = evt.item;
 #endif
 		//si->second->vps = evt.vps;
-		if ((!evt.getExtendedText().empty()) && !evt.times.empty() &&
-				(evt.times.begin()->startzeit < zeit + secondsExtendedTextCache))
-			si->second->setExtendedText(0 /*"OFF"*/,evt.getExtendedText());
-		if (!evt.getText().empty())
-			si->second->setText(0 /*"OFF"*/,evt.getText());
-		if (!evt.getName().empty())
-			si->second->setName(0 /*"OFF"*/,evt.getName());
+		std::string s = evt.getExtendedText();
+		if ((!s.empty()) && !evt.times.empty() &&
+				(evt.times.begin()->startzeit < zeit + secondsExtendedTextCache) &&
+				s != si->second->getExtendedText()) {
+			si->second->setExtendedText(0 /*"OFF"*/, s);
+			changed = true;
+		}
+		s = evt.getText();
+		if (!s.empty() && s != si->second->getText()) {
+			si->second->setText(0 /*"OFF"*/, s);
+			changed = true;
+		}
+		s = evt.getName();
+		if (!s.empty() && s != si->second->getName()) {
+			si->second->setName(0 /*"OFF"*/, s);
+			changed = true;
+		}
+		if (changed)
+			si->second->modified = ++events_modified;
 	}
 	else {
+		/* an event received again is replaced as well, unless the
+		 * language mode is OFF. it counts as modified only if it differs */
+		bool unchanged = (si != mySIeventsOrderUniqueKey.end()) &&
+			evt.times == si->second->times && evt.sameContent(*si->second);
+		unsigned int old_modified = unchanged ? si->second->modified : 0;
 
 		SIevent *eptr = new SIevent(evt);
 
 		if (!eptr)
 		{
 			printf("[sectionsd::addEvent] new SIevent failed.\n");
-			unlockEvents();
 			return;
 		}
 
@@ -446,7 +524,6 @@ xprintf("addEvent: ch %012" PRIx64 " running %d (%s) got_CN %d\n", evt.get_chann
 						if ((*x)->table_id >= e->table_id)
 							continue;
 						/* else: keep the old event with the lower table_id */
-						unlockEvents();
 						delete eptr;
 						return;
 					}
@@ -462,7 +539,6 @@ xprintf("addEvent: ch %012" PRIx64 " running %d (%s) got_CN %d\n", evt.get_chann
 						/* don't add the higher table_id */
 						dprintf("%s: don't replace 0x%012" PRIx64 ".%02x with 0x%012" PRIx64 ".%02x\n",
 							__func__, x_key, (*x)->table_id, e_key, e->table_id);
-						unlockEvents();
 						delete eptr;
 						return;
 					}
@@ -486,9 +562,11 @@ xprintf("addEvent: ch %012" PRIx64 " running %d (%s) got_CN %d\n", evt.get_chann
 				to_delete.pop_back();
 			}
 		}
+		if (!unchanged)
+			METRIC_ADD(METRIC_EIT_EVENTS, 1);
 		// Damit in den nicht nach Event-ID sortierten Mengen
 		// Mehrere Events mit gleicher ID sind, diese vorher loeschen
-		deleteEvent(e->uniqueKey());
+		deleteEvent(e->uniqueKey(), true);
 		if ( !mySIeventsOrderFirstEndTimeServiceIDEventUniqueKey.empty() && mySIeventsOrderUniqueKey.size() >= max_events && max_events != 0 ) {
 			MySIeventsOrderFirstEndTimeServiceIDEventUniqueKey::iterator lastEvent =
 				mySIeventsOrderFirstEndTimeServiceIDEventUniqueKey.begin();
@@ -553,12 +631,14 @@ xprintf("addEvent: ch %012" PRIx64 " running %d (%s) got_CN %d\n", evt.get_chann
 
 					// Und die Zeiten im Event updaten
 					ie->second->times.insert(e->times.begin(), e->times.end());
+					ie->second->modified = ++events_modified;
 				}
 			}
 		}
 //		printf("Adding: %04x\n", (int) e->uniqueKey());
 
 		// normales Event
+		e->modified = unchanged ? old_modified : ++events_modified;
 		mySIeventsOrderUniqueKey.insert(std::make_pair(e->uniqueKey(), e));
 
 		if (!e->times.empty())
@@ -568,7 +648,6 @@ xprintf("addEvent: ch %012" PRIx64 " running %d (%s) got_CN %d\n", evt.get_chann
 			mySIeventsOrderFirstEndTimeServiceIDEventUniqueKey.insert(e);
 		}
 	}
-	unlockEvents();
 }
 
 static void addNVODevent(const SIevent &evt)
@@ -594,7 +673,7 @@ static void addNVODevent(const SIevent &evt)
 
 	// Damit in den nicht nach Event-ID sortierten Mengen
 	// mehrere Events mit gleicher ID sind, diese vorher loeschen
-	deleteEvent(e->uniqueKey());
+	deleteEvent(e->uniqueKey(), true);
 	if ( !mySIeventsOrderUniqueKey.empty() && mySIeventsOrderUniqueKey.size() >= max_events  && max_events != 0 ) {
 		//TODO: Set Old Events to 0 if limit is reached...
 		MySIeventsOrderFirstEndTimeServiceIDEventUniqueKey::iterator lastEvent =
@@ -610,6 +689,7 @@ static void addNVODevent(const SIevent &evt)
 		unlockMessaging();
 		deleteEvent((*lastEvent)->uniqueKey());
 	}
+	e->modified = ++events_modified;
 	mySIeventsOrderUniqueKey.insert(std::make_pair(e->uniqueKey(), e));
 
 	mySIeventsNVODorderUniqueKey.insert(std::make_pair(e->uniqueKey(), e));
@@ -649,7 +729,7 @@ static void removeOldEvents(const long seconds)
 		++e;
 	}
 	for (std::vector<event_id_t>::iterator i = to_delete.begin(); i != to_delete.end(); ++i)
-		deleteEvent(*i);
+		deleteEvent(*i, true);
 
 	xprintf("[sectionsd] Removed %d old events (%d left), zap detected %d.\n", (int)(total_events - mySIeventsOrderUniqueKey.size()), (int)mySIeventsOrderUniqueKey.size(), messaging_zap_detected);
 	unlockEvents();
@@ -844,6 +924,9 @@ static void wakeupAll()
 {
 	threadCN.change(0);
 	threadEIT.change(0);
+	for (int i = 0; i < MAX_EIT_SCAN_THREADS; i++)
+		if (threadScanEIT[i]->isBusy())
+			threadScanEIT[i]->change(0);
 #ifdef ENABLE_VIASATEPG
 	threadVSEIT.change(0);
 #endif
@@ -918,6 +1001,27 @@ static void commandPauseScanning(int connfd, char *data, const unsigned dataLeng
 	sendEmptyResponse(connfd, NULL, 0);
 }
 
+/* a scan on the same demux replaces the one before, else a free thread
+   takes it */
+static bool startScanThread(int dnum, t_channel_id service)
+{
+	CEitScanThread *idle = NULL;
+	for (int i = 0; i < MAX_EIT_SCAN_THREADS; i++) {
+		CEitScanThread *t = threadScanEIT[i];
+		if (t->isStarted() && t->getDemux() == dnum) {
+			idle = t;
+			break;
+		}
+		if (!idle && !t->isBusy())
+			idle = t;
+	}
+	if (!idle)
+		return false;
+	xprintf("[sectionsd] background scan of " PRINTF_CHANNEL_ID_TYPE " on demux #%d\n", service, dnum);
+	idle->scan(dnum, service);
+	return true;
+}
+
 static void commandserviceChanged(int connfd, char *data, const unsigned dataLength)
 {
 	sendEmptyResponse(connfd, NULL, 0);
@@ -932,6 +1036,9 @@ static void commandserviceChanged(int connfd, char *data, const unsigned dataLen
 	if (cmd->dnum) {
 		/* dont wakeup EIT, if we have max events allready */
 		if (max_events == 0  || (mySIeventsOrderUniqueKey.size() < max_events)) {
+			if (startScanThread(cmd->dnum, uniqueServiceKey))
+				return;
+			/* all scan threads busy, the live one reads it */
 			current_channel_id = uniqueServiceKey;
 			writeLockMessaging();
 			messaging_zap_detected = true;
@@ -1159,6 +1266,8 @@ static void deleteSIexceptEPG()
 {
 	threadCN.dropCachedSectionIDs();
 	threadEIT.dropCachedSectionIDs();
+	for (int i = 0; i < MAX_EIT_SCAN_THREADS; i++)
+		threadScanEIT[i]->dropCachedSectionIDs();
 #ifdef ENABLE_SDT
 	writeLockServices();
 	mySIservicesOrderUniqueKey.clear();
@@ -1194,6 +1303,9 @@ static void FreeMemory()
 	mySIeventsOrderServiceUniqueKeyFirstStartTimeEventUniqueKey.clear();
 	mySIeventsOrderUniqueKey.clear();
 	mySIeventsNVODorderUniqueKey.clear();
+	/* mirrors have to start again */
+	deleted_events.clear();
+	deleted_events_lost = ++events_modified;
 
 	unlockEvents();
 
@@ -1793,6 +1905,75 @@ void CEitThread::beforeSleep()
 		system(CONFIGDIR "/epgdone.sh");
 }
 
+/********************************************************************************/
+/* EIT thread for background scans on other demuxes				*/
+/********************************************************************************/
+CEitScanThread::CEitScanThread(std::string tname)
+	: CEitThread(tname)
+{
+	started = false;
+	busy = false;
+	scan_gen = done_gen = 0;
+	done_service = 0;
+	/* wakeup to check for a new scan, if the change came before the sleep */
+	sleep_time = 10;
+}
+
+void CEitScanThread::scan(int dnum, t_channel_id service)
+{
+	lock();
+	busy = true;
+	scan_gen++;
+	sendToSleepNow = false;
+	unlock();
+	setDemux(dnum);
+	if (started) {
+		setCurrentService(service);
+		return;
+	}
+	/* filters are added by the thread, it starts with them */
+	current_service = service;
+	started = Start();
+}
+
+bool CEitScanThread::isBusy()
+{
+	lock();
+	bool ret = busy;
+	unlock();
+	return ret;
+}
+
+bool CEitScanThread::shouldSleep()
+{
+	lock();
+	bool ret = (!busy || sendToSleepNow || !scanning);
+	done_service = (busy && sendToSleepNow && scanning) ? current_service : 0;
+	done_gen = scan_gen;
+	unlock();
+	return ret;
+}
+
+bool CEitScanThread::checkSleep()
+{
+	return (running && (!isBusy() || !scanning));
+}
+
+void CEitScanThread::beforeSleep()
+{
+	lock();
+	/* a new scan since shouldSleep() goes on after the sleep */
+	if (done_gen == scan_gen)
+		busy = false;
+	unlock();
+	if (done_service) {
+		eventServer->sendEvent(CSectionsdClient::EVT_EIT_COMPLETE,
+				CEventServer::INITID_SECTIONSD,
+				&done_service,
+				sizeof(done_service));
+	}
+}
+
 /********************************************************************************/
 /* CN thread to read current TS CN events 					*/
 /********************************************************************************/
@@ -2119,6 +2300,7 @@ static void *houseKeepingThread(void *)
 		dprintf("housekeeping.\n");
 
 		removeOldEvents(oldEventsAre); // alte Events
+		checkXMLTVSources();
 
 		ecount++;
 		if (ecount == EPG_SERVICE_FREQUENTLY_COUNT)
@@ -2276,6 +2458,13 @@ printf("SIevent size: %d\n", (int)sizeof(SIevent));
 	readDVBTimeFilter();
 	readEncodingFile();
 
+	/* scan threads start with their first scan */
+	for (int i = 0; i < MAX_EIT_SCAN_THREADS; i++) {
+		char name[32];
+		snprintf(name, sizeof(name), "eitScanThread%d", i);
+		threadScanEIT[i] = new CEitScanThread(name);
+	}
+
 	/* threads start left here for now, if any problems found, will be moved to Start() */
 	threadTIME.Start();
 	threadEIT.Start();
@@ -2321,6 +2510,9 @@ printf("SIevent size: %d\n", (int)sizeof(SIevent));
 	threadEIT.StopRun();
 	threadCN.StopRun();
 	threadTIME.StopRun();
+	for (int i = 0; i < MAX_EIT_SCAN_THREADS; i++)
+		if (threadScanEIT[i]->isStarted())
+			threadScanEIT[i]->StopRun();
 #ifdef ENABLE_VIASATEPG
 	threadVSEIT.StopRun();
 #endif
@@ -2352,6 +2544,14 @@ printf("SIevent size: %d\n", (int)sizeof(SIevent));
 
 	xprintf("join CN\n");
 	threadCN.Stop();
+
+	xprintf("join scan EIT\n");
+	for (int i = 0; i < MAX_EIT_SCAN_THREADS; i++) {
+		if (threadScanEIT[i]->isStarted())
+			threadScanEIT[i]->Stop();
+		delete threadScanEIT[i];
+		threadScanEIT[i] = NULL;
+	}
 #ifdef ENABLE_VIASATEPG
 	xprintf("join VSEIT\n");
 	threadVSEIT.Stop();
@@ -2459,6 +2659,53 @@ void CEitManager::getEventsServiceKey(t_channel_id serviceUniqueKey, CChannelEve
 	unlockEvents();
 }
 
+unsigned int CEitManager::getDeletedEvents(unsigned int since, std::vector<event_id_t> &deleted, bool &full)
+{
+	readLockEvents();
+	unsigned int ret = events_modified;
+	full = (since == 0 || since < deleted_events_lost || since > events_modified);
+	if (!full) {
+		std::deque<std::pair<unsigned int, event_id_t> >::reverse_iterator it;
+		for (it = deleted_events.rbegin(); it != deleted_events.rend() && it->first > since; ++it)
+			deleted.push_back(it->second);
+	}
+	unlockEvents();
+	return ret;
+}
+
+/* the store is read in parts, so the lock is not held while the client
+ * gets the data */
+bool CEitManager::getChangedEvents(unsigned int since, const std::set<t_channel_id> &channels, event_id_t &start, unsigned int max, CChannelEventList &eList)
+{
+	unsigned int count = 0;
+	readLockEvents();
+	MySIeventsOrderUniqueKey::iterator e = mySIeventsOrderUniqueKey.upper_bound(start);
+	for (; e != mySIeventsOrderUniqueKey.end() && count < max; ++e) {
+		start = e->first;
+		if (e->second->modified <= since)
+			continue;
+		if (!channels.empty() && channels.find(e->second->get_channel_id()) == channels.end())
+			continue;
+		for (SItimes::iterator t = e->second->times.begin(); t != e->second->times.end(); ++t) {
+			CChannelEvent aEvent;
+			aEvent.eventID = e->first;
+			aEvent.startTime = t->startzeit;
+			aEvent.duration = t->dauer;
+			aEvent.description = e->second->getName();
+			if (e->second->getText().empty())
+				aEvent.text = e->second->getExtendedText().substr(0, 120);
+			else
+				aEvent.text = e->second->getText();
+			aEvent.channelID = e->second->get_channel_id();
+			eList.push_back(aEvent);
+		}
+		count++;
+	}
+	bool more = (e != mySIeventsOrderUniqueKey.end());
+	unlockEvents();
+	return more;
+}
+
 /* invalidate current/next events, if current event times expired */
 void CEitManager::checkCurrentNextEvent(void)
 {
@@ -3003,6 +3250,45 @@ unsigned CEitManager::getEventsCount()
 	return anzEvents;
 }
 
+unsigned int CEitManager::getEventsVersion()
+{
+	readLockEvents();
+	unsigned int ret = events_modified;
+	unlockEvents();
+	return ret;
+}
+
+time_t CEitManager::getEpgEnd(const t_channel_id epg_id)
+{
+	t_channel_id chid = epg_id & 0xFFFFFFFFFFFFULL;
+	/* sorts behind all events of the channel */
+	SIevent *last = new SIevent(GET_ORIGINAL_NETWORK_ID_FROM_CHANNEL_ID(chid),
+			GET_TRANSPORT_STREAM_ID_FROM_CHANNEL_ID(chid),
+			GET_SERVICE_ID_FROM_CHANNEL_ID(chid), 0xFFFF);
+	last->times.insert(SItime((time_t) 0x7FFFFFFF, 0));
+	SIeventPtr eptr(last);
+
+	time_t ret = 0;
+	readLockEvents();
+	MySIeventsOrderServiceUniqueKeyFirstStartTimeEventUniqueKey::iterator e =
+		mySIeventsOrderServiceUniqueKeyFirstStartTimeEventUniqueKey.upper_bound(eptr);
+	if (e != mySIeventsOrderServiceUniqueKeyFirstStartTimeEventUniqueKey.begin()) {
+		--e;
+		if ((*e)->get_channel_id() == chid)
+			ret = (*e)->times.begin()->startzeit + (long)(*e)->times.begin()->dauer;
+	}
+	unlockEvents();
+#ifndef USE_BOOST_SHARED_PTR
+	delete last;
+#endif
+	return ret;
+}
+
+void CEitManager::setXMLTV(const std::list<std::string> &files, const xmltv_channel_map_t &channels)
+{
+	setXMLTVSources(files, channels);
+}
+
 void CEitManager::addChannelFilter(t_original_network_id onid, t_transport_stream_id tsid, t_service_id sid)
 {
 	OpenThreads::ScopedLock<OpenThreads::Mutex> slock(filter_mutex);
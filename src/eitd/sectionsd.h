@@ -28,11 +28,19 @@
 
 #include <sys/time.h>
 
+#include <set>
+#include <vector>
+
 #include <OpenThreads/Thread>
 #include <OpenThreads/Condition>
 #include <sectionsdclient/sectionsdclient.h>
 #include <connection/basicserver.h>
 
+#include "xmltv.h"
+
+/* background EPG scans read at once, each on the demux of its tuner */
+#define MAX_EIT_SCAN_THREADS	3
+
 class CEitManager : public OpenThreads::Thread, public OpenThreads::Mutex
 {
 	private:
@@ -57,6 +65,13 @@ class CEitManager : public OpenThreads::Thread, public OpenThreads::Mutex
 		void SetConfig(CSectionsdClient::epg_config &cfg) { config = cfg; };
 
 		void getEventsServiceKey(t_channel_id serviceUniqueKey, CChannelEventList &eList, char search = 0, std::string search_text = "", bool all_chann=false, int genre=0xFF,int fsk=0);
+		/* EPG dumps for clients, which mirror the store: returns the current
+		   modification counter and the events deleted after 'since'. full is
+		   set, if 'since' is 0 or too old, then all events have to be read */
+		unsigned int getDeletedEvents(unsigned int since, std::vector<event_id_t> &deleted, bool &full);
+		/* at most max events with a key above start, changed after 'since',
+		   of the channels (all, if empty). false after the last event */
+		bool getChangedEvents(unsigned int since, const std::set<t_channel_id> &channels, event_id_t &start, unsigned int max, CChannelEventList &eList);
 		void getCurrentNextServiceKey(t_channel_id uniqueServiceKey, CSectionsdClient::responseGetCurrentNextInfoChannelID& current_next );
 		bool getEPGidShort(event_id_t epgID, CShortEPGData * epgdata);
 		bool getEPGid(const event_id_t epgID, const time_t startzeit, CEPGData * epgdata);
@@ -69,6 +84,12 @@ class CEitManager : public OpenThreads::Thread, public OpenThreads::Mutex
 		void addChannelFilter(t_original_network_id onid, t_transport_stream_id tsid, t_service_id sid);
 		void clearChannelFilters(void);
 		unsigned getEventsCount();
+		/* modification counter of the store, changes with every new event */
+		unsigned int getEventsVersion();
+		/* end time of the last event of the channel, 0 if it has none */
+		time_t getEpgEnd(const t_channel_id epg_id);
+		/* guide files for channels without DVB EPG */
+		void setXMLTV(const std::list<std::string> &files, const xmltv_channel_map_t &channels);
 };
 
 #endif
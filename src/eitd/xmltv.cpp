@@ -0,0 +1,384 @@
+/*
+ * XMLTV import for channels without DVB EPG (webtv/webradio)
+ *
+ * License: GPLv2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <unistd.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+
+#include <xmltree/xmlinterface.h>
+#include <driver/abstime.h>
+#include <system/set_threadname.h>
+
+#include "xmltv.h"
+#include "eitd.h"
+#include "debug.h"
+
+void addEvents(const std::vector<SIevent> &evts, const time_t zeit);
+
+/* events added to the store at once */
+#define XMLTV_BLOCK	500
+/* longer texts are cut, so a broken file cannot eat up the memory */
+#define XMLTV_MAX_TEXT	16384U
+/* duration of the last programme of a channel without stop time, s */
+#define XMLTV_OPEN_DURATION	3600
+
+static OpenThreads::Mutex xmltv_mutex;
+static std::list<std::string> xmltv_files;
+static xmltv_channel_map_t xmltv_channels;
+/* modification time of the files at their last import */
+static std::map<std::string, time_t> xmltv_imported;
+static bool xmltv_running = false;
+
+/* XMLTV uses ISO 639-1 codes, the EPG the three letter codes of ISO 639-2 */
+static std::string xmltv_lang(const char *lang)
+{
+	static const char *codes[][2] = {
+		{ "de", "deu" }, { "en", "eng" }, { "fr", "fra" }, { "it", "ita" },
+		{ "es", "spa" }, { "nl", "nld" }, { "pl", "pol" }, { "ru", "rus" },
+		{ "tr", "tur" }, { "pt", "por" }, { "cs", "ces" }, { "hu", "hun" },
+		{ "sv", "swe" }, { "da", "dan" }, { "fi", "fin" }, { "no", "nor" },
+		{ "el", "ell" }, { "uk", "ukr" }, { "ar", "ara" }, { "sk", "slk" }
+	};
+	if (!lang || !*lang)
+		return "OFF";
+	for (unsigned i = 0; i < sizeof(codes) / sizeof(codes[0]); i++)
+		if (!strcasecmp(lang, codes[i][0]))
+			return codes[i][1];
+	return lang;
+}
+
+/* "YYYYMMDDhhmmss +zzzz", seconds and zone are optional */
+static time_t xmltv_time(const char *s)
+{
+	if (!s)
+		return -1;
+
+	struct tm t;
+	memset(&t, 0, sizeof(t));
+	int n = 0;
+	if (sscanf(s, "%4d%2d%2d%2d%2d%n", &t.tm_year, &t.tm_mon, &t.tm_mday, &t.tm_hour, &t.tm_min, &n) < 5)
+		return -1;
+	s += n;
+	if (isdigit(s[0]) && isdigit(s[1])) {
+		t.tm_sec = (s[0] - '0') * 10 + s[1] - '0';
+		s += 2;
+	}
+	t.tm_year -= 1900;
+	t.tm_mon -= 1;
+	time_t ret = timegm(&t);
+
+	while (*s == ' ')
+		s++;
+	if ((*s == '+' || *s == '-') && isdigit(s[1]) && isdigit(s[2]) && isdigit(s[3]) && isdigit(s[4])) {
+		int off = ((s[1] - '0') * 10 + s[2] - '0') * 3600 + ((s[3] - '0') * 10 + s[4] - '0') * 60;
+		ret -= (*s == '+') ? off : -off;
+	}
+	return ret;
+}
+
+/* <tv> <channel> <display-name/> </channel> <programme> <title/> <desc/>
+ * </programme> </tv>, read as a stream. entities, CDATA and the encoding
+ * of the file are handled by the xml parser */
+class CXMLTVParser : public CXMLSaxHandler
+{
+	private:
+		const xmltv_channel_map_t &channels;
+		/* ids of the guide mapped to our channels, from the channel elements */
+		xmltv_channel_map_t guide_channels;
+		std::vector<SIevent> events;
+		int count;
+		time_t now;
+
+		std::string text;
+		bool collect;
+		std::string lang;
+		std::string channel;
+		bool in_channel;
+		bool in_programme;
+		SIevent event;
+		t_channel_id programme_channel;
+		/* programmes without stop time, per channel. they end with the next
+		   one of their channel, or after XMLTV_OPEN_DURATION */
+		std::map<t_channel_id, SIevent> open_events;
+
+		/* interned element names, compared by pointer */
+		const char *n_channel, *n_display_name, *n_programme, *n_title, *n_sub_title, *n_desc;
+
+		void startProgramme(const char **atts);
+		void addEvent(const SIevent &e);
+		void closeEvent(SIevent &e, time_t stop);
+		void flush(void);
+	public:
+		CXMLTVParser(const xmltv_channel_map_t &chan);
+		int finish(void);
+
+		void StartElement(const char *name, const char **atts);
+		void EndElement(const char *name);
+		void CharacterData(const char *s, int len);
+};
+
+CXMLTVParser::CXMLTVParser(const xmltv_channel_map_t &chan) : channels(chan)
+{
+	count = 0;
+	now = time(NULL);
+	collect = false;
+	in_channel = false;
+	in_programme = false;
+	programme_channel = 0;
+	n_channel = xmlIntern("channel");
+	n_display_name = xmlIntern("display-name");
+	n_programme = xmlIntern("programme");
+	n_title = xmlIntern("title");
+	n_sub_title = xmlIntern("sub-title");
+	n_desc = xmlIntern("desc");
+}
+
+void CXMLTVParser::StartElement(const char *name, const char **atts)
+{
+	if (in_programme) {
+		if (name == n_title || name == n_sub_title || name == n_desc) {
+			text.clear();
+			collect = true;
+			lang = xmltv_lang(xmlGetAttribute(atts, "lang"));
+		}
+	}
+	else if (name == n_programme)
+		startProgramme(atts);
+	else if (name == n_channel) {
+		const char *id = xmlGetAttribute(atts, "id");
+		channel = id ? id : "";
+		in_channel = !channel.empty();
+		if (in_channel) {
+			xmltv_channel_map_t::const_iterator it = channels.find(channel);
+			if (it != channels.end())
+				guide_channels[channel] = it->second;
+		}
+	}
+	else if (in_channel && name == n_display_name) {
+		text.clear();
+		collect = true;
+	}
+}
+
+void CXMLTVParser::startProgramme(const char **atts)
+{
+	const char *id = xmlGetAttribute(atts, "channel");
+	if (!id)
+		return;
+	xmltv_channel_map_t::iterator it = guide_channels.find(id);
+	if (it == guide_channels.end())
+		return;
+	time_t start = xmltv_time(xmlGetAttribute(atts, "start"));
+	time_t stop = xmltv_time(xmlGetAttribute(atts, "stop"));
+	if (start <= 0)
+		return;
+
+	std::map<t_channel_id, SIevent>::iterator oit = open_events.find(it->second);
+	if (oit != open_events.end()) {
+		time_t s = oit->second.times.begin()->startzeit;
+		closeEvent(oit->second, start > s ? start : s + XMLTV_OPEN_DURATION);
+		open_events.erase(oit);
+	}
+	/* already over */
+	if (stop > 0 && stop < now)
+		return;
+
+	/* web channel ids hold a hash, the event only the lower 48 bits
+	   of it. the start minute serves as event id */
+	t_channel_id chid = it->second;
+	event = SIevent(GET_ORIGINAL_NETWORK_ID_FROM_CHANNEL_ID(chid), GET_TRANSPORT_STREAM_ID_FROM_CHANNEL_ID(chid),
+			GET_SERVICE_ID_FROM_CHANNEL_ID(chid), (start / 60) & 0xFFFF);
+	event.times.insert(SItime(start, stop > start ? stop - start : 0));
+	programme_channel = chid;
+	in_programme = true;
+}
+
+void CXMLTVParser::EndElement(const char *name)
+{
+	if (in_programme) {
+		if (collect) {
+			collect = false;
+			if (text.empty())
+				return;
+			if (name == n_title)
+				event.setName(lang, text);
+			else if (name == n_sub_title)
+				event.setText(lang, text);
+			else if (name == n_desc)
+				event.appendExtendedText(lang, text);
+		}
+		else if (name == n_programme) {
+			in_programme = false;
+			if (event.times.begin()->dauer)
+				addEvent(event);
+			else
+				open_events[programme_channel] = event;
+		}
+	}
+	else if (in_channel) {
+		if (collect) {
+			collect = false;
+			if (guide_channels.find(channel) != guide_channels.end())
+				return;
+			std::transform(text.begin(), text.end(), text.begin(), ::tolower);
+			xmltv_channel_map_t::const_iterator it = channels.find(text);
+			if (it != channels.end())
+				guide_channels[channel] = it->second;
+		}
+		else if (name == n_channel)
+			in_channel = false;
+	}
+}
+
+void CXMLTVParser::CharacterData(const char *s, int len)
+{
+	if (!collect || text.size() >= XMLTV_MAX_TEXT)
+		return;
+	text.append(s, std::min((size_t) len, XMLTV_MAX_TEXT - text.size()));
+}
+
+void CXMLTVParser::addEvent(const SIevent &e)
+{
+	events.push_back(e);
+	count++;
+	if (events.size() >= XMLTV_BLOCK)
+		flush();
+}
+
+/* sets the end of a programme without stop time and adds it */
+void CXMLTVParser::closeEvent(SIevent &e, time_t stop)
+{
+	if (stop < now)
+		return;
+	time_t start = e.times.begin()->startzeit;
+	e.times.clear();
+	e.times.insert(SItime(start, stop - start));
+	addEvent(e);
+}
+
+void CXMLTVParser::flush(void)
+{
+	if (events.empty())
+		return;
+	addEvents(events, 0);
+	events.clear();
+}
+
+/* at the end of the file, also of a broken one */
+int CXMLTVParser::finish(void)
+{
+	/* the last programmes of their channels */
+	for (std::map<t_channel_id, SIevent>::iterator it = open_events.begin(); it != open_events.end(); ++it)
+		closeEvent(it->second, it->second.times.begin()->startzeit + XMLTV_OPEN_DURATION);
+	open_events.clear();
+	flush();
+	dprintf("[xmltv] %d channels matched\n", (int)guide_channels.size());
+	return count;
+}
+
+bool readEventsFromXMLTV(const std::string &filename, const xmltv_channel_map_t &channels, int &ev_count)
+{
+	CXMLTVParser parser(channels);
+	bool ret = parseXmlFileSax(filename.c_str(), parser);
+	/* events of the part read before an error are kept */
+	ev_count += parser.finish();
+	return ret;
+}
+
+static void *insertEventsfromXMLTV(void *)
+{
+	set_threadname("sd:xmltv");
+
+	for (;;) {
+		std::string file;
+		xmltv_channel_map_t channels;
+		{
+			OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(xmltv_mutex);
+			for (std::list<std::string>::iterator it = xmltv_files.begin(); it != xmltv_files.end(); ++it) {
+				struct stat st;
+				if (stat(it->c_str(), &st) || xmltv_imported[*it] == st.st_mtime)
+					continue;
+				xmltv_imported[*it] = st.st_mtime;
+				file = *it;
+				break;
+			}
+			if (file.empty()) {
+				xmltv_running = false;
+				break;
+			}
+			channels = xmltv_channels;
+		}
+
+		int ev_count = 0;
+		int64_t now = time_monotonic_ms();
+		readEventsFromXMLTV(file, channels, ev_count);
+		printf("[sectionsd] Reading XMLTV %s finished after %" PRId64 " milliseconds (%d events)\n",
+				file.c_str(), time_monotonic_ms() - now, ev_count);
+	}
+	pthread_exit(NULL);
+}
+
+/* mutex must be held */
+static void startXMLTVImport(void)
+{
+	if (xmltv_running || xmltv_files.empty() || xmltv_channels.empty())
+		return;
+
+	pthread_t thrInsert;
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	if (pthread_create(&thrInsert, &attr, insertEventsfromXMLTV, NULL))
+		perror("sectionsd: pthread_create()");
+	else
+		xmltv_running = true;
+	pthread_attr_destroy(&attr);
+}
+
+void setXMLTVSources(const std::list<std::string> &files, const xmltv_channel_map_t &channels)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(xmltv_mutex);
+	/* other channels, other events */
+	if (channels != xmltv_channels)
+		xmltv_imported.clear();
+	xmltv_files = files;
+	xmltv_channels = channels;
+	startXMLTVImport();
+}
+
+void checkXMLTVSources(void)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(xmltv_mutex);
+	startXMLTVImport();
+}
@@ -0,0 +1,43 @@
+/*
+ * XMLTV import for channels without DVB EPG (webtv/webradio)
+ *
+ * License: GPLv2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#ifndef __eitd_xmltv_h__
+#define __eitd_xmltv_h__
+
+#include <string>
+#include <list>
+#include <map>
+
+#include <zapit/types.h>
+
+/* XMLTV channel ids, and lower case names of channels to be matched by the
+ * display names of the guide, mapped to the channel they belong to */
+typedef std::map<std::string, t_channel_id> xmltv_channel_map_t;
+
+/* parses the guide file as a stream, memory use does not depend on the
+ * size of the file. events are added in blocks */
+bool readEventsFromXMLTV(const std::string &filename, const xmltv_channel_map_t &channels, int &ev_count);
+
+/* set the guide files and channels, starts an import in background */
+void setXMLTVSources(const std::list<std::string> &files, const xmltv_channel_map_t &channels);
+/* import again all guide files, which changed since the last import */
+void checkXMLTVSources(void);
+
+#endif
@@ -31,6 +31,7 @@
 #include <stdlib.h>
 #include <dirent.h>
 #include <string>
+#include <vector>
 #include <sys/stat.h>
 
 #include <xmltree/xmlinterface.h>
@@ -43,7 +44,7 @@
 #include "debug.h"
 #include <system/set_threadname.h>
 
-void addEvent(const SIevent &evt, const time_t zeit, bool cn = false);
+void addEvents(const std::vector<SIevent> &evts, const time_t zeit);
 extern MySIeventsOrderServiceUniqueKeyFirstStartTimeEventUniqueKey mySIeventsOrderServiceUniqueKeyFirstStartTimeEventUniqueKey;
 extern bool reader_ready;
 extern pthread_rwlock_t eventsLock;
@@ -286,163 +287,206 @@ void deleteOldfileEvents(const char *epgdir)
 	}
 }
 
-bool readEventsFromFile(std::string &epgname, int &ev_count)
-{
-	xmlDocPtr event_parser = NULL;
-	xmlNodePtr service;
-	xmlNodePtr event;
-	t_original_network_id onid = 0;
-	t_transport_stream_id tsid = 0;
-	t_service_id sid = 0;
+/* events added to the store at once */
+#define EPG_XML_BLOCK	500
 
-	if (!(event_parser = parseXmlFile(epgname.c_str()))) {
-		dprintf("unable to open %s for reading\n", epgname.c_str());
-		return false;
-	}
-	service = xmlDocGetRootElement(event_parser);
-	service = xmlChildrenNode(service);
-
-	while (service) {
-		onid = xmlGetNumericAttribute(service, "original_network_id", 16);
-		tsid = xmlGetNumericAttribute(service, "transport_stream_id", 16);
-		sid = xmlGetNumericAttribute(service, "service_id", 16);
-		if(!onid || !tsid || !sid){
-			service = xmlNextNode(service);
-			continue;
-		}
-		event = xmlChildrenNode(service);
-
-		while (event) {
-			SIevent e(onid,tsid,sid,xmlGetNumericAttribute(event, "id", 16));
-			uint8_t tid = xmlGetNumericAttribute(event, "tid", 16);
-			std::string contentClassification, userClassification;
-			if(tid)
-				e.table_id = tid;
-			e.table_id |= 0x80; /* make sure on-air data has a lower table_id */
-
-			xmlNodePtr node;
-
-			node = xmlChildrenNode(event);
-			while ((node = xmlGetNextOccurence(node, "name"))) {
-				const char *s = xmlGetAttribute(node, "string");
-				if (s)
-					e.setName(ZapitTools::UTF8_to_Latin1(xmlGetAttribute(node, "lang")), s);
-				node = xmlNextNode(node);
-			}
+/* <dvbepg> <service> <event> <name/> <text/> ... </event> </service> </dvbepg>,
+ * read as a stream, so only one block of events is held in memory */
+class CEpgXmlReader : public CXMLSaxHandler
+{
+	private:
+		int depth;
+		bool in_service;
+		bool in_event;
+		t_original_network_id onid;
+		t_transport_stream_id tsid;
+		t_service_id sid;
+		std::string contentClassification, userClassification;
+		std::vector<SIevent> events;
+		int &ev_count;
+
+		/* interned element names, compared by pointer */
+		const char *n_name, *n_text, *n_item, *n_item_description, *n_extended_text;
+		const char *n_time, *n_content, *n_component, *n_parental_rating, *n_linkage;
+
+		void startEvent(const char **atts);
+		void endEvent(void);
+		void eventChild(const char *name, const char **atts);
+	public:
+		CEpgXmlReader(int &count);
+		void flush(void);
+
+		void StartElement(const char *name, const char **atts);
+		void EndElement(const char *name);
+};
 
-			node = xmlChildrenNode(event);
-			while ((node = xmlGetNextOccurence(node, "text"))) {
-				const char *s = xmlGetAttribute(node, "string");
-				if (s)
-					e.setText(ZapitTools::UTF8_to_Latin1(xmlGetAttribute(node, "lang")), s);
-				node = xmlNextNode(node);
-			}
-			node = xmlChildrenNode(event);
-			while ((node = xmlGetNextOccurence(node, "item"))) {
-#ifdef USE_ITEM_DESCRIPTION
-				const char *s = xmlGetAttribute(node, "string");
-				if (s)
-					e.item = s;
-#endif
-				node = xmlNextNode(node);
-			}
+CEpgXmlReader::CEpgXmlReader(int &count) : ev_count(count)
+{
+	depth = 0;
+	in_service = in_event = false;
+	onid = tsid = sid = 0;
+	n_name = xmlIntern("name");
+	n_text = xmlIntern("text");
+	n_item = xmlIntern("item");
+	n_item_description = xmlIntern("item_description");
+	n_extended_text = xmlIntern("extended_text");
+	n_time = xmlIntern("time");
+	n_content = xmlIntern("content");
+	n_component = xmlIntern("component");
+	n_parental_rating = xmlIntern("parental_rating");
+	n_linkage = xmlIntern("linkage");
+}
 
-			node = xmlChildrenNode(event);
-			while ((node = xmlGetNextOccurence(node, "item_description"))) {
-#ifdef USE_ITEM_DESCRIPTION
-				const char *s = xmlGetAttribute(node, "string");
-				if (s)
-					e.itemDescription = s;
-#endif
-				node = xmlNextNode(node);
-			}
-			node = xmlChildrenNode(event);
-			while ((node = xmlGetNextOccurence(node, "extended_text"))) {
-				const char *l = xmlGetAttribute(node, "lang");
-				const char *s = xmlGetAttribute(node, "string");
-				if (l && s)
-					e.appendExtendedText(ZapitTools::UTF8_to_Latin1(l), s);
-				node = xmlNextNode(node);
-			}
+void CEpgXmlReader::StartElement(const char *name, const char **atts)
+{
+	depth++;
+	if (depth == 2) {
+		onid = xmlGetNumericAttribute(atts, "original_network_id", 16);
+		tsid = xmlGetNumericAttribute(atts, "transport_stream_id", 16);
+		sid = xmlGetNumericAttribute(atts, "service_id", 16);
+		in_service = onid && tsid && sid;
+	}
+	else if (depth == 3 && in_service)
+		startEvent(atts);
+	else if (depth == 4 && in_event)
+		eventChild(name, atts);
+}
 
-			node = xmlChildrenNode(event);
-			while ((node = xmlGetNextOccurence(node, "time"))) {
-				e.times.insert(SItime(xmlGetNumericAttribute(node, "start_time", 10),
-							xmlGetNumericAttribute(node, "duration", 10)));
-				node = xmlNextNode(node);
-			}
+void CEpgXmlReader::EndElement(const char * /*name*/)
+{
+	if (depth == 3 && in_event)
+		endEvent();
+	else if (depth == 2)
+		in_service = false;
+	depth--;
+}
 
-			node = xmlChildrenNode(event);
-			while ((node = xmlGetNextOccurence(node, "content"))) {
-				const char cl = xmlGetNumericAttribute(node, "class", 16);
-				contentClassification += cl;
-				const char cl2 = xmlGetNumericAttribute(node, "user", 16);
-				userClassification += cl2;
-				node = xmlNextNode(node);
-			}
+void CEpgXmlReader::startEvent(const char **atts)
+{
+	events.push_back(SIevent(onid, tsid, sid, xmlGetNumericAttribute(atts, "id", 16)));
+	SIevent &e = events.back();
+	uint8_t tid = xmlGetNumericAttribute(atts, "tid", 16);
+	if (tid)
+		e.table_id = tid;
+	e.table_id |= 0x80; /* make sure on-air data has a lower table_id */
+	contentClassification.clear();
+	userClassification.clear();
+	in_event = true;
+}
 
-			node = xmlChildrenNode(event);
-			while ((node = xmlGetNextOccurence(node, "component"))) {
-				SIcomponent c;
-				c.streamContent = xmlGetNumericAttribute(node, "stream_content", 16);
-				c.componentType = xmlGetNumericAttribute(node, "type", 16);
-				c.componentTag = xmlGetNumericAttribute(node, "tag", 16);
-				const char *s = xmlGetAttribute(node, "text");
-				if (s)
-					c.setComponent(s);
-				//e.components.insert(c);
-				e.components.push_back(c);
-				node = xmlNextNode(node);
-			}
+void CEpgXmlReader::eventChild(const char *name, const char **atts)
+{
+	SIevent &e = events.back();
 
-			node = xmlChildrenNode(event);
-			while ((node = xmlGetNextOccurence(node, "parental_rating"))) {
-				const char *s = xmlGetAttribute(node, "country");
-				if (s)
-#if 0
-					e.ratings.insert(SIparentalRating(ZapitTools::UTF8_to_Latin1(s),
-								(unsigned char) xmlGetNumericAttribute(node, "rating", 10)));
+	if (name == n_name) {
+		const char *s = xmlGetAttribute(atts, "string");
+		if (s)
+			e.setName(ZapitTools::UTF8_to_Latin1(xmlGetAttribute(atts, "lang")), s);
+	}
+	else if (name == n_text) {
+		const char *s = xmlGetAttribute(atts, "string");
+		if (s)
+			e.setText(ZapitTools::UTF8_to_Latin1(xmlGetAttribute(atts, "lang")), s);
+	}
+	else if (name == n_item) {
+#ifdef USE_ITEM_DESCRIPTION
+		const char *s = xmlGetAttribute(atts, "string");
+		if (s)
+			e.item = s;
 #endif
-				e.ratings.push_back(SIparentalRating(ZapitTools::UTF8_to_Latin1(s),
-							(unsigned char) xmlGetNumericAttribute(node, "rating", 10)));
-				node = xmlNextNode(node);
-			}
+	}
+	else if (name == n_item_description) {
+#ifdef USE_ITEM_DESCRIPTION
+		const char *s = xmlGetAttribute(atts, "string");
+		if (s)
+			e.itemDescription = s;
+#endif
+	}
+	else if (name == n_extended_text) {
+		const char *l = xmlGetAttribute(atts, "lang");
+		const char *s = xmlGetAttribute(atts, "string");
+		if (l && s)
+			e.appendExtendedText(ZapitTools::UTF8_to_Latin1(l), s);
+	}
+	else if (name == n_time) {
+		e.times.insert(SItime(xmlGetNumericAttribute(atts, "start_time", 10),
+					xmlGetNumericAttribute(atts, "duration", 10)));
+	}
+	else if (name == n_content) {
+		const char cl = xmlGetNumericAttribute(atts, "class", 16);
+		contentClassification += cl;
+		const char cl2 = xmlGetNumericAttribute(atts, "user", 16);
+		userClassification += cl2;
+	}
+	else if (name == n_component) {
+		SIcomponent c;
+		c.streamContent = xmlGetNumericAttribute(atts, "stream_content", 16);
+		c.componentType = xmlGetNumericAttribute(atts, "type", 16);
+		c.componentTag = xmlGetNumericAttribute(atts, "tag", 16);
+		const char *s = xmlGetAttribute(atts, "text");
+		if (s)
+			c.setComponent(s);
+		e.components.push_back(c);
+	}
+	else if (name == n_parental_rating) {
+		const char *s = xmlGetAttribute(atts, "country");
+		if (s)
+			e.ratings.push_back(SIparentalRating(ZapitTools::UTF8_to_Latin1(s),
+						(unsigned char) xmlGetNumericAttribute(atts, "rating", 10)));
+	}
+	else if (name == n_linkage) {
+		SIlinkage l;
+		l.linkageType = xmlGetNumericAttribute(atts, "type", 16);
+		l.transportStreamId = xmlGetNumericAttribute(atts, "transport_stream_id", 16);
+		l.originalNetworkId = xmlGetNumericAttribute(atts, "original_network_id", 16);
+		l.serviceId = xmlGetNumericAttribute(atts, "service_id", 16);
+		const char *s = xmlGetAttribute(atts, "linkage_descriptor");
+		if (s)
+			l.name = s;
+		e.linkage_descs.insert(e.linkage_descs.end(), l);
+	}
+}
 
-			node = xmlChildrenNode(event);
-			while ((node = xmlGetNextOccurence(node, "linkage"))) {
-				SIlinkage l;
-				l.linkageType = xmlGetNumericAttribute(node, "type", 16);
-				l.transportStreamId = xmlGetNumericAttribute(node, "transport_stream_id", 16);
-				l.originalNetworkId = xmlGetNumericAttribute(node, "original_network_id", 16);
-				l.serviceId = xmlGetNumericAttribute(node, "service_id", 16);
-				const char *s = xmlGetAttribute(node, "linkage_descriptor");
-				if (s)
-					l.name = s;
-				e.linkage_descs.insert(e.linkage_descs.end(), l);
-				node = xmlNextNode(node);
-			}
+void CEpgXmlReader::endEvent(void)
+{
+	SIevent &e = events.back();
 
-			if (!contentClassification.empty()) {
+	if (!contentClassification.empty()) {
 #ifdef FULL_CONTENT_CLASSIFICATION
-				ssize_t off = e.classifications.reserve(2 * contentClassification.size());
-				if (off > -1)
-					for (unsigned i = 0; i < contentClassification.size(); i++)
-						off = e.classifications.set(off, contentClassification.at(i), userClassification.at(i));
+		ssize_t off = e.classifications.reserve(2 * contentClassification.size());
+		if (off > -1)
+			for (unsigned i = 0; i < contentClassification.size(); i++)
+				off = e.classifications.set(off, contentClassification.at(i), userClassification.at(i));
 #else
-				e.classifications.content = contentClassification.at(0);
-				e.classifications.user = userClassification.at(0);
+		e.classifications.content = contentClassification.at(0);
+		e.classifications.user = userClassification.at(0);
 #endif
-			}
-			addEvent(e, 0);
-			ev_count++;
+	}
+	ev_count++;
+	in_event = false;
 
-			event = xmlNextNode(event);
-		}
+	if (events.size() >= EPG_XML_BLOCK)
+		flush();
+}
 
-		service = xmlNextNode(service);
-	}
-	xmlFreeDoc(event_parser);
-	return true;
+void CEpgXmlReader::flush(void)
+{
+	if (events.empty())
+		return;
+	addEvents(events, 0);
+	events.clear();
+}
+
+bool readEventsFromFile(std::string &epgname, int &ev_count)
+{
+	CEpgXmlReader reader(ev_count);
+
+	bool ret = parseXmlFileSax(epgname.c_str(), reader);
+	/* events before a parse error, e.g. of a truncated file, are kept */
+	reader.flush();
+	if (!ret)
+		dprintf("unable to read %s\n", epgname.c_str());
+	return ret;
 }
 
 static int my_filter(const struct dirent *entry)
@@ -0,0 +1,505 @@
+/*
+	Neutrino-GUI  -   DBoxII-Project
+
+	framebuffer replay: paints screens from a script into the headless
+	framebuffer, with the fonts and icons of neutrino, and reports per
+	screen the painting time, the painted pixels and the allocations. no
+	display and no running neutrino needed.
+
+	usage: fb_replay [script|- [pngdir [repeats]]]
+	  script	screens to paint, - or nothing: built-in channel list,
+			EPG+, infobar, menu and movie browser
+	  pngdir	each screen is saved there as <screen>.png, to compare
+			them after changes
+	  repeats	paints of each screen, default 20
+
+	script lines, colors are ARGB in hex:
+	  screen <name>
+	  box <x> <y> <w> <h> <color> [radius]
+	  frame <x> <y> <w> <h> <thickness> <color> [radius]
+	  line <x1> <y1> <x2> <y2> <color>
+	  text <x> <y> <w> <size> <color> <text ...>
+	  icon <name> <x> <y>
+
+	License: GPL
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <new>
+#include <string>
+#include <vector>
+#include <map>
+#include <png.h>
+#include <zlib.h>
+
+#define NEUTRINO_CPP
+#include <global.h>
+#include <driver/abstime.h>
+#include <driver/fb_generic.h>
+#include <driver/fb_accel.h>
+#include <driver/fontrenderer.h>
+#include <driver/pictureviewer/pictureviewer.h>
+#include <gui/audiomute.h>
+#include <video.h>
+#include <cs_api.h>
+#include "check.h"
+
+#ifndef REPLAY_DATADIR
+#define REPLAY_DATADIR	"../data"
+#endif
+#define SCREEN_WIDTH	1280
+#define SCREEN_HEIGHT	720
+
+/* what the framebuffer code needs from the rest of neutrino */
+int debug = 0;
+CPictureViewer * g_PicViewer = NULL;
+cVideo * videoDecoder = NULL;
+
+/* allocations with new and of pixel buffers */
+static volatile unsigned int alloc_count = 0;
+static volatile uint64_t alloc_bytes = 0;
+
+static inline void *counted_malloc(size_t size)
+{
+	__sync_fetch_and_add(&alloc_count, 1);
+	__sync_fetch_and_add(&alloc_bytes, size);
+	return malloc(size ? size : 1);
+}
+
+static void __attribute__((noinline)) counted_free(void *p)
+{
+	free(p);
+}
+
+void *operator new(size_t size) throw (std::bad_alloc)
+{
+	void *p = counted_malloc(size);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void *operator new[](size_t size) throw (std::bad_alloc)
+{
+	void *p = counted_malloc(size);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void *p) throw ()
+{
+	counted_free(p);
+}
+
+void operator delete[](void *p) throw ()
+{
+	counted_free(p);
+}
+
+/* libcoolstream is not linked. on the other box types libstb-hal is,
+ * its pixel buffers are not counted */
+#if HAVE_COOL_HARDWARE
+void *cs_malloc_uncached(size_t size)
+{
+	return counted_malloc(size);
+}
+
+void cs_free_uncached(void *p)
+{
+	counted_free(p);
+}
+
+void cVideo::ShowPicture(const char *)
+{
+}
+
+void cVideo::StopPicture()
+{
+}
+#endif
+
+CAudioMute *CAudioMute::getInstance()
+{
+	return NULL;
+}
+
+/* icons are installed into one directory, in the tree they are sorted */
+static const char *icon_dirs[] = {
+	"", "buttons/", "headers/", "status/channel/", "status/markers/",
+	"status/various/", "filetypes/", "movieplayer/"
+};
+
+fb_pixel_t *CPictureViewer::getIcon(const std::string &name, int *width, int *height)
+{
+	std::string base = name.substr(name.rfind('/') + 1);
+	FILE *fp = NULL;
+	for (unsigned int i = 0; !fp && i < sizeof(icon_dirs) / sizeof(icon_dirs[0]); i++)
+		fp = fopen((std::string(REPLAY_DATADIR "/icons/") + icon_dirs[i] + base).c_str(), "rb");
+	if (!fp)
+		return NULL;
+
+	png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	png_infop info = png ? png_create_info_struct(png) : NULL;
+	fb_pixel_t *data = NULL;
+	if (!info || setjmp(png_jmpbuf(png))) {
+		png_destroy_read_struct(&png, info ? &info : NULL, NULL);
+		fclose(fp);
+		if (data)
+			cs_free_uncached(data);
+		return NULL;
+	}
+	png_init_io(png, fp);
+	png_read_info(png, info);
+	/* everything to 8 bit BGRA, that is ARGB in memory */
+	png_set_expand(png);
+	png_set_strip_16(png);
+	png_set_gray_to_rgb(png);
+	png_set_bgr(png);
+	png_set_filler(png, 0xff, PNG_FILLER_AFTER);
+	png_set_interlace_handling(png);
+	png_read_update_info(png, info);
+	*width = png_get_image_width(png, info);
+	*height = png_get_image_height(png, info);
+	data = (fb_pixel_t *) cs_malloc_uncached(*width * *height * sizeof(fb_pixel_t));
+	std::vector<png_bytep> rows(*height);
+	for (int y = 0; y < *height; y++)
+		rows[y] = (png_bytep)(data + y * *width);
+	png_read_image(png, &rows[0]);
+	png_destroy_read_struct(&png, &info, NULL);
+	fclose(fp);
+	return data;
+}
+
+/* screens like the GUI paints them, in 1280x720 */
+static std::string builtin_script(void)
+{
+	std::string s;
+	char line[256];
+	/* channel list: header, rows with number, name and progress, buttons */
+	s += "screen channellist\n"
+	     "box 100 60 1080 50 ff1e3c5a 10\n"
+	     "icon settings 114 69\n"
+	     "text 160 100 700 28 ffffffff Favoriten - Sport\n"
+	     "text 980 100 180 22 ffc0c0c0 20:15\n";
+	for (int i = 0; i < 14; i++) {
+		int y = 110 + i * 38;
+		snprintf(line, sizeof(line), "box 100 %d 1080 38 %s\n", y, i == 3 ? "ff3c6e96" : "ff14283c");
+		s += line;
+		snprintf(line, sizeof(line), "text 110 %d 60 22 ffe0e0e0 %d\n", y + 30, i + 1);
+		s += line;
+		snprintf(line, sizeof(line), "text 180 %d 500 24 ffffffff Channel %d HD\n", y + 30, i + 1);
+		s += line;
+		snprintf(line, sizeof(line), "icon marker_scrambled 700 %d\n", y + 9);
+		s += line;
+		snprintf(line, sizeof(line), "frame 900 %d 200 14 1 ff808080\n", y + 12);
+		s += line;
+		snprintf(line, sizeof(line), "box 901 %d %d 12 ff50a050\n", y + 13, (i * 37) % 198);
+		s += line;
+	}
+	s += "box 100 642 1080 40 ff1e3c5a 10\n"
+	     "icon rot 120 650\ntext 150 672 200 20 ffffffff Delete\n"
+	     "icon gruen 360 650\ntext 390 672 200 20 ffffffff Move\n"
+	     "icon gelb 600 650\ntext 630 672 200 20 ffffffff Bouquets\n"
+	     "icon blau 840 650\ntext 870 672 200 20 ffffffff Favorites\n";
+
+	/* EPG+: channel column, time line and the event grid */
+	s += "screen epgplus\n"
+	     "box 60 40 1160 44 ff1e3c5a 10\n"
+	     "text 80 74 600 26 ffffffff EPG+ Monday, 20:00 - 22:00\n";
+	for (int i = 0; i < 4; i++) {
+		snprintf(line, sizeof(line), "box %d 84 270 30 ff28465f\ntext %d 108 260 20 ffffffff %d:%s\n",
+				260 + i * 240, 266 + i * 240, 20 + i / 2, i % 2 ? "30" : "00");
+		s += line;
+	}
+	for (int r = 0; r < 13; r++) {
+		int y = 114 + r * 42;
+		snprintf(line, sizeof(line), "box 60 %d 200 42 ff14283c\ntext 66 %d 190 20 ffe0e0e0 Channel %d\n", y, y + 28, r + 1);
+		s += line;
+		int x = 260;
+		for (int e = 0; x < 1220; e++) {
+			int w = 90 + ((r * 7 + e * 13) % 5) * 60;
+			if (x + w > 1220)
+				w = 1220 - x;
+			snprintf(line, sizeof(line), "box %d %d %d 41 %s\nframe %d %d %d 42 1 ff0a141e\n"
+					"text %d %d %d 18 ffffffff Event %d.%d with a long title\n",
+					x, y, w, (r == 2 && e == 1) ? "ff3c6e96" : "ff1e3246", x, y, w, x + 4, y + 27, w - 8, r + 1, e + 1);
+			s += line;
+			x += w;
+		}
+	}
+	s += "line 700 84 700 660 ffff4040\n";
+
+	/* infobar: round box at the bottom, logo area, progress and icons */
+	s += "screen infobar\n"
+	     "box 80 480 1120 200 e0102030 20\n"
+	     "box 80 440 140 50 e0102030 10\n"
+	     "text 96 476 120 30 ffffffff 112\n"
+	     "text 240 530 700 40 ffffffff Channel with a long name HD\n"
+	     "text 1040 530 140 26 ffffffff 20:15\n"
+	     "frame 240 550 940 12 1 ffc0c0c0 4\n"
+	     "box 241 551 420 10 ff50a050 4\n"
+	     "text 240 600 100 24 ffc0c0c0 20:00\n"
+	     "text 340 600 700 24 ffffffff Now: the running event\n"
+	     "text 240 634 100 24 ffc0c0c0 21:45\n"
+	     "text 340 634 700 24 ffc0c0c0 Next: the following event\n";
+	static const char *status[] = { "16_9", "dd", "vtxt", "subt", "res_1080", "ca2", "tuner_1" };
+	for (int i = 0; i < 7; i++) {
+		snprintf(line, sizeof(line), "icon %s %d 650\n", status[i], 760 + i * 60);
+		s += line;
+	}
+	s += "icon rot 100 650\nicon gruen 130 650\nicon gelb 160 650\nicon blau 190 650\n";
+
+	/* main menu: header, items with icons, the selected one highlighted */
+	s += "screen menu\n"
+	     "box 390 90 500 50 ff1e3c5a 10\n"
+	     "icon mainmenue 400 99\n"
+	     "text 450 128 400 28 ffffffff Main menu\n"
+	     "box 390 140 500 460 ff14283c\n";
+	static const char *items[] = { "TV mode", "Radio mode", "Timer list", "Media", "Games",
+		"Scripts", "Settings", "Service", "Information", "Sleep timer", "Reboot", "Shutdown" };
+	for (int i = 0; i < 12; i++) {
+		int y = 150 + i * 36;
+		if (i == 6) {
+			snprintf(line, sizeof(line), "box 398 %d 484 36 ff3c6e96 6\n", y);
+			s += line;
+		}
+		snprintf(line, sizeof(line), "icon %d 410 %d\ntext 450 %d 380 24 ffffffff %s\n", (i + 1) % 10, y + 8, y + 27, items[i]);
+		s += line;
+	}
+	s += "box 390 600 500 40 ff1e3c5a 10\n"
+	     "icon help 410 608\ntext 450 630 400 20 ffc0c0c0 Help\n";
+
+	/* movie browser: list, the info panel with text, footer buttons */
+	s += "screen moviebrowser\n"
+	     "box 40 30 1200 50 ff1e3c5a 10\n"
+	     "icon icon_movieplayer 54 39\n"
+	     "text 100 66 800 28 ffffffff Movie browser - /media/hdd/movie\n";
+	for (int i = 0; i < 16; i++) {
+		int y = 80 + i * 26;
+		snprintf(line, sizeof(line), "box 40 %d 1200 26 %s\nicon movie 48 %d\n"
+				"text 80 %d 700 20 ffffffff Recording %d - with a title\n"
+				"text 800 %d 200 20 ffc0c0c0 2%02d.01.2026\ntext 1040 %d 180 20 ffc0c0c0 %d min\n",
+				y, i == 5 ? "ff3c6e96" : "ff14283c", y + 5, y + 20, i + 1, y + 20, i, y + 20, 30 + i * 7);
+		s += line;
+	}
+	s += "box 40 496 1200 150 ff0f1e2d\n"
+	     "frame 40 496 1200 150 2 ff1e3c5a\n";
+	for (int i = 0; i < 5; i++) {
+		snprintf(line, sizeof(line), "text 56 %d 1170 20 ffe0e0e0 Line %d of the description of the selected recording, "
+				"long enough to be cut at the end of the box\n", 524 + i * 26, i + 1);
+		s += line;
+	}
+	s += "box 40 646 1200 40 ff1e3c5a 10\n"
+	     "icon rot 60 654\ntext 90 676 200 20 ffffffff Sort\n"
+	     "icon gruen 300 654\ntext 330 676 200 20 ffffffff Filter\n"
+	     "icon gelb 540 654\ntext 570 676 200 20 ffffffff Focus\n"
+	     "icon blau 780 654\ntext 810 676 200 20 ffffffff Reload\n";
+	return s;
+}
+
+struct screen_t
+{
+	std::string name;
+	std::vector<std::string> ops;
+};
+
+static bool parse_script(const std::string &script, std::vector<screen_t> &screens)
+{
+	size_t pos = 0;
+	int nr = 0;
+	while (pos < script.size()) {
+		size_t end = script.find('\n', pos);
+		if (end == std::string::npos)
+			end = script.size();
+		std::string line = script.substr(pos, end - pos);
+		pos = end + 1;
+		nr++;
+		if (!line.empty() && line[line.size() - 1] == '\r')
+			line.erase(line.size() - 1);
+		if (line.empty() || line[0] == '#')
+			continue;
+		if (line.compare(0, 7, "screen ") == 0) {
+			screens.push_back(screen_t());
+			screens.back().name = line.substr(7);
+		} else if (screens.empty()) {
+			printf("line %d: paint before the first screen\n", nr);
+			return false;
+		} else
+			screens.back().ops.push_back(line);
+	}
+	return !screens.empty();
+}
+
+static std::string fontfile;
+static FBFontRenderClass *renderer;
+static std::map<int, Font *> fonts;
+
+static Font *get_font(int size)
+{
+	std::map<int, Font *>::iterator it = fonts.find(size);
+	if (it != fonts.end())
+		return it->second;
+	static const char *style = renderer->AddFont(fontfile.c_str());
+	Font *f = renderer->getFont(renderer->getFamily(fontfile.c_str()).c_str(), style, size);
+	fonts[size] = f;
+	return f;
+}
+
+/* one paint command, false if it cannot be painted */
+static bool paint(CFrameBuffer *fb, const std::string &op)
+{
+	char cmd[16], name[64];
+	int x, y, w, h, n, r = 0, len = 0;
+	unsigned int col;
+	if (sscanf(op.c_str(), "%15s", cmd) != 1)
+		return false;
+	std::string c = cmd;
+	if (c == "box" && sscanf(op.c_str(), "%*s %d %d %d %d %x %d", &x, &y, &w, &h, &col, &r) >= 5) {
+		fb->paintBoxRel(x, y, w, h, col, r);
+	} else if (c == "frame" && sscanf(op.c_str(), "%*s %d %d %d %d %d %x %d", &x, &y, &w, &h, &n, &col, &r) >= 6) {
+		fb->paintBoxFrame(x, y, w, h, n, col, r);
+	} else if (c == "line" && sscanf(op.c_str(), "%*s %d %d %d %d %x", &x, &y, &w, &h, &col) == 5) {
+		fb->paintLine(x, y, w, h, col);
+	} else if (c == "text" && sscanf(op.c_str(), "%*s %d %d %d %d %x %n", &x, &y, &w, &n, &col, &len) == 5 && len > 0) {
+		Font *f = get_font(n);
+		if (!f)
+			return false;
+		f->RenderString(x, y, w, op.substr(len), col);
+	} else if (c == "icon" && sscanf(op.c_str(), "%*s %63s %d %d", name, &x, &y) == 3) {
+		return fb->paintIcon(name, x, y);
+	} else
+		return false;
+	return true;
+}
+
+static uint32_t screen_crc(CFrameBuffer *fb)
+{
+	return crc32(0L, (const Bytef *) fb->getFrameBufferPointer(), SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(fb_pixel_t));
+}
+
+int main(int argc, char **argv)
+{
+	std::string script;
+	if (argc > 1 && strcmp(argv[1], "-")) {
+		FILE *f = fopen(argv[1], "r");
+		if (!f) {
+			perror(argv[1]);
+			return CHECK_ERROR;
+		}
+		char buf[4096];
+		size_t n;
+		while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+			script.append(buf, n);
+		fclose(f);
+	} else
+		script = builtin_script();
+	std::string pngdir = argc > 2 ? argv[2] : "";
+	int repeats = argc > 3 ? atoi(argv[3]) : 20;
+	if (repeats < 2)
+		repeats = 2;
+
+	std::vector<screen_t> screens;
+	if (!parse_script(script, screens)) {
+		fprintf(stderr, "%s: no screens\n", argc > 1 ? argv[1] : "built-in script");
+		return CHECK_ERROR;
+	}
+
+	char size[32];
+	snprintf(size, sizeof(size), "%dx%d", SCREEN_WIDTH, SCREEN_HEIGHT);
+	setenv("NEUTRINO_HEADLESS", size, 1);
+	unsetenv("NEUTRINO_HEADLESS_DUMP");
+	CFrameBuffer *fb = CFrameBuffer::getInstance();
+	fb->init();
+	CFbAccelHeadless *headless = dynamic_cast<CFbAccelHeadless *>(fb);
+	if (!headless) {
+		fprintf(stderr, "no headless framebuffer\n");
+		return CHECK_ERROR;
+	}
+	fontfile = REPLAY_DATADIR "/fonts/LiberationSans-Regular.ttf";
+	if (access(fontfile.c_str(), R_OK)) {
+		perror(fontfile.c_str());
+		return CHECK_ERROR;
+	}
+	renderer = new FBFontRenderClass(72 * SCREEN_WIDTH / 1280, 72 * SCREEN_HEIGHT / 720);
+
+	int64_t all_start = time_monotonic_us();
+	for (std::vector<screen_t>::iterator s = screens.begin(); s != screens.end(); ++s) {
+		uint32_t crc = 0;
+		int64_t first_us = 0, us = 0;
+		uint64_t pixels = 0;
+		unsigned int paints = 0, first_allocs = 0, allocs = 0;
+		uint64_t alloc_kb = 0;
+		bool painted = true, same = true;
+		for (int i = 0; i < repeats; i++) {
+			memset(fb->getFrameBufferPointer(), 0, SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(fb_pixel_t));
+			uint64_t p0;
+			unsigned int o0;
+			headless->getPainted(p0, o0);
+			unsigned int a0 = alloc_count;
+			uint64_t b0 = alloc_bytes;
+			int64_t start = time_monotonic_us();
+			for (std::vector<std::string>::iterator op = s->ops.begin(); op != s->ops.end(); ++op) {
+				if (!paint(fb, *op)) {
+					if (i == 0)
+						printf("%s: cannot paint '%s'\n", s->name.c_str(), op->c_str());
+					painted = false;
+				}
+			}
+			fb->blit();
+			int64_t t = time_monotonic_us() - start;
+			unsigned int a = alloc_count - a0;
+			uint64_t p1;
+			unsigned int o1;
+			headless->getPainted(p1, o1);
+			uint32_t c = screen_crc(fb);
+			if (i == 0) {
+				/* with loading fonts and icons */
+				first_us = t;
+				first_allocs = a;
+				crc = c;
+				pixels = p1 - p0;
+				paints = o1 - o0;
+			} else {
+				us += t;
+				allocs += a;
+				alloc_kb += (alloc_bytes - b0) / 1024;
+				same = same && (c == crc);
+			}
+		}
+		int rest = repeats - 1;
+		printf("%-14s first %6d us, %d allocations | then %6d us (%.1f fps), %" PRIu64 " pixels, %u paints, %.1f allocations (%d kB), crc %08x\n",
+				s->name.c_str(), (int) first_us, first_allocs, (int)(us / rest),
+				us ? rest * 1000000.0 / us : 0.0, pixels, paints,
+				(double) allocs / rest, (int)(alloc_kb / rest), crc);
+
+		std::string what = s->name + ": ";
+		check(painted, (what + "paint failed").c_str());
+		check(pixels > 0, (what + "nothing painted").c_str());
+		check(same, (what + "repeated paint differs").c_str());
+		if (!pngdir.empty())
+			check(headless->saveScreen(pngdir + "/" + s->name + ".png"), (what + "png not saved").c_str());
+	}
+	printf("%d screens, %d paints each, %d ms\n", (int) screens.size(), repeats,
+			(int)((time_monotonic_us() - all_start) / 1000));
+
+	return check_result();
+}
@@ -37,6 +37,7 @@
 #include <driver/rcinput.h>
 #include <driver/audioplay.h>
 #include <driver/audiometadata.h>
+#include <driver/audiodec/audiometadb.h>
 #include <driver/display.h>
 
 #include <daemonc/remotecontrol.h>
@@ -169,6 +170,8 @@ void CAudioPlayerGui::Init(void)
 	pictureviewer = false;
 
 	m_select_title_by_name = g_settings.audioplayer_select_title_by_name==1;
+	m_metadb_generation = 0;
+	m_metadb_time = 0;
 
 	if (!g_settings.network_nfs_audioplayerdir.empty())
 		m_Path = g_settings.network_nfs_audioplayerdir.c_str();
@@ -354,6 +357,8 @@ int CAudioPlayerGui::exec(CMenuTarget* parent, const std::string &actionKey)
 
 	CNeutrinoApp::getInstance()->StartSubtitles();
 
+	CAudioMetaDB::getInstance()->Save();
+
 	return res;
 }
 
@@ -386,6 +391,10 @@ int CAudioPlayerGui::show()
 		if (CNeutrinoApp::getInstance()->getMode() != NeutrinoModes::mode_audio)
 			loop = false;
 
+		checkTrackChange();
+		if (updateFromMetaDB())
+			update = true;
+
 		if (
 			(m_state != CAudioPlayerGui::STOP) &&
 			(CAudioPlayer::getInstance()->getState() == CBaseDec::STOP) &&
@@ -956,6 +965,8 @@ bool CAudioPlayerGui::playNext(bool allow_rotate)
 
 void CAudioPlayerGui::wantNextPlay()
 {
+	checkTrackChange();
+
 	if (
 		(m_state != CAudioPlayerGui::STOP) &&
 		(CAudioPlayer::getInstance()->getState() == CBaseDec::STOP) &&
@@ -2034,7 +2045,8 @@ void CAudioPlayerGui::rev(unsigned int seconds)
 	paintLCD();
 }
 
-void CAudioPlayerGui::play(unsigned int pos)
+/* start == false: the player already went on to this entry by itself */
+void CAudioPlayerGui::play(unsigned int pos, bool start)
 {
 	//printf("AudioPlaylist: play %d/%d\n",pos,playlist.size());
 	unsigned int old_current = m_current;
@@ -2084,7 +2096,9 @@ void CAudioPlayerGui::play(unsigned int pos)
 	m_state = CAudioPlayerGui::PLAY;
 	m_curr_audiofile = m_playlist[m_current];
 	// Play
-	CAudioPlayer::getInstance()->play(&m_curr_audiofile, g_settings.audioplayer_highprio == 1);
+	if (start)
+		CAudioPlayer::getInstance()->play(&m_curr_audiofile, g_settings.audioplayer_highprio == 1);
+	queueNext();
 
 	if (!pictureviewer)
 	{
@@ -2112,6 +2126,46 @@ int CAudioPlayerGui::getNext()
 	return ret;
 }
 
+/* hand the following entry to the player, so it can decode it right after
+   the current one while the read-ahead buffer still plays */
+void CAudioPlayerGui::queueNext()
+{
+	int next = -1;
+	if (g_settings.audioplayer_buffer > 0 && m_curr_audiofile.FileType != CFile::STREAM_AUDIO)
+		next = getNext();
+	if (next >= 0 && m_playlist[next].FileType != CFile::STREAM_AUDIO)
+	{
+		GetMetaData(m_playlist[next]);
+		CAudioPlayer::getInstance()->setNext(&m_playlist[next]);
+	}
+	else
+		CAudioPlayer::getInstance()->setNext(NULL);
+}
+
+void CAudioPlayerGui::checkTrackChange()
+{
+	if (m_state == CAudioPlayerGui::STOP || !CAudioPlayer::getInstance()->hasTrackChanged())
+		return;
+
+	std::string filename = CAudioPlayer::getInstance()->getFilename();
+	int next = getNext();
+	if (next >= 0 && m_playlist[next].Filename != filename)
+	{
+		// playlist was changed meanwhile
+		next = -1;
+		for (unsigned int i = 0; i < m_playlist.size(); i++)
+		{
+			if (m_playlist[i].Filename == filename)
+			{
+				next = i;
+				break;
+			}
+		}
+	}
+	if (next >= 0)
+		play(next, false);
+}
+
 void CAudioPlayerGui::updateMetaData()
 {
 	bool updateMeta = false;
@@ -2307,12 +2361,19 @@ void CAudioPlayerGui::screensaver(bool on)
 	}
 }
 
-void CAudioPlayerGui::GetMetaData(CAudiofileExt &File)
+/* wait == false: use the tag database only, unknown files are read in
+   background and shown by file name meanwhile */
+void CAudioPlayerGui::GetMetaData(CAudiofileExt &File, bool wait)
 {
 	bool ret = 1;
 
 	if (File.FileType != CFile::STREAM_AUDIO && !File.MetaData.bitrate)
-		ret = CAudioPlayer::getInstance()->readMetaData(&File, m_state != CAudioPlayerGui::STOP && !g_settings.audioplayer_highprio);
+	{
+		if (wait)
+			ret = CAudioPlayer::getInstance()->readMetaData(&File, m_state != CAudioPlayerGui::STOP && !g_settings.audioplayer_highprio);
+		else if (!(ret = CAudioMetaDB::getInstance()->Lookup(&File)))
+			CAudioMetaDB::getInstance()->Queue(&File);
+	}
 
 	if (!ret || (File.MetaData.artist.empty() && File.MetaData.title.empty()))
 	{
@@ -2341,6 +2402,41 @@ void CAudioPlayerGui::GetMetaData(CAudiofileExt &File)
 	}
 }
 
+/* pick up tags the background threads of the database have read meanwhile,
+   returns true if the playlist needs a repaint */
+bool CAudioPlayerGui::updateFromMetaDB()
+{
+	unsigned int generation = CAudioMetaDB::getInstance()->getGeneration();
+	if (generation == m_metadb_generation)
+		return false;
+	// while scanning, not more than every few seconds
+	time_t now = time(NULL);
+	if (CAudioMetaDB::getInstance()->isScanning() && now - m_metadb_time < 5)
+		return false;
+	m_metadb_generation = generation;
+	m_metadb_time = now;
+
+	bool changed = false;
+	for (CAudioPlayList::iterator it = m_playlist.begin(); it != m_playlist.end(); ++it)
+	{
+		if (it->FileType == CFile::STREAM_AUDIO || it->MetaData.bitrate)
+			continue;
+		if (CAudioMetaDB::getInstance()->Lookup(&(*it)))
+		{
+			it->firstChar = '\0';
+			changed = true;
+		}
+	}
+	if (!changed)
+		return false;
+
+	if (m_select_title_by_name)
+		buildSearchTree(false);
+	else
+		m_playlistHasChanged = true;
+	return m_show_playlist && !m_screensaver && !pictureviewer;
+}
+
 bool CAudioPlayerGui::getNumericInput(neutrino_msg_t& msg, int& val)
 {
 	//FIXME - remove fixed values
@@ -2388,7 +2484,7 @@ void CAudioPlayerGui::getFileInfoToDisplay(std::string &fileInfo, CAudiofileExt
 		title = "Title?";
 	}
 
-	GetMetaData(file);
+	GetMetaData(file, false);
 
 	if (!file.MetaData.artist.empty())
 		artist = file.MetaData.artist;
@@ -2432,7 +2528,7 @@ void CAudioPlayerGui::addToPlaylist(CAudiofileExt &file)
 		getFileInfoToDisplay(t,file);
 	}
 	else
-		GetMetaData(file);
+		GetMetaData(file, false);
 
 	m_playlist.push_back(file);
 	m_playlistHasChanged = true;
@@ -2565,7 +2661,7 @@ void CAudioPlayerGui::printSearchTree()
 	}
 }
 
-void CAudioPlayerGui::buildSearchTree()
+void CAudioPlayerGui::buildSearchTree(bool progress_window)
 {
 	//printf("before\n");
 	//printSearchTree();
@@ -2576,8 +2672,11 @@ void CAudioPlayerGui::buildSearchTree()
 #endif
 
 	CProgressWindow progress;
-	progress.setTitle(LOCALE_AUDIOPLAYER_BUILDING_SEARCH_INDEX);
-	progress.exec(this, "");
+	if (progress_window)
+	{
+		progress.setTitle(LOCALE_AUDIOPLAYER_BUILDING_SEARCH_INDEX);
+		progress.exec(this, "");
+	}
 
 	long maxProgress = (m_playlist.size() > 1) ? m_playlist.size() - 1 : 1;
 
@@ -2587,13 +2686,17 @@ void CAudioPlayerGui::buildSearchTree()
 	for (CAudioPlayList::iterator it=m_playlist.begin(); it!=m_playlist.end(); ++it)
 	{
 		listPos++;
-		progress.showStatus(100*listPos / maxProgress);
-		progress.showStatusMessageUTF(it->Filename);
+		if (progress_window && listPos % 50 == 0)
+		{
+			progress.showStatus(100*listPos / maxProgress);
+			progress.showStatusMessageUTF(it->Filename);
+		}
 		unsigned char firstChar = getFirstChar(*it);
 		const std::pair<CTitle2Pos::iterator,bool> item = m_title2Pos.insert(CTitle2PosItem(firstChar,CPosList()));
 		item.first->second.insert(listPos);
 	}
-	progress.hide();
+	if (progress_window)
+		progress.hide();
 	m_playlistHasChanged = false;
 
 #ifdef AUDIOPLAYER_TIME_DEBUG
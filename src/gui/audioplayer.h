@@ -109,6 +109,8 @@ class CAudioPlayerGui : public CMenuTarget
 		bool		m_select_title_by_name;
 		bool		m_show_playlist;
 		bool		m_playlistHasChanged;
+		unsigned int	m_metadb_generation;
+		time_t		m_metadb_time;
 
 		CAudioPlayList	m_playlist;
 		CAudioPlayList	m_radiolist;
@@ -150,7 +152,10 @@ class CAudioPlayerGui : public CMenuTarget
 		void ff(unsigned int seconds=0);
 		void rev(unsigned int seconds=0);
 		int getNext();
-		void GetMetaData(CAudiofileExt &File);
+		void queueNext();
+		void checkTrackChange();
+		void GetMetaData(CAudiofileExt &File, bool wait = true);
+		bool updateFromMetaDB();
 		void updateMetaData();
 		void updateTimes(const bool force = false);
 		void showMetaData();
@@ -196,7 +201,7 @@ class CAudioPlayerGui : public CMenuTarget
 
 		void printSearchTree();
 
-		void buildSearchTree();
+		void buildSearchTree(bool progress = true);
 
 		unsigned char getFirstChar(CAudiofileExt &file);
 
@@ -245,7 +250,7 @@ class CAudioPlayerGui : public CMenuTarget
 
 		void wantNextPlay();
 		void pause();
-		void play(unsigned int pos);
+		void play(unsigned int pos, bool start = true);
 		void stop();
 		bool playNext(bool allow_rotate = false);
 		bool playPrev(bool allow_rotate = false);
@@ -128,6 +128,11 @@ int CAudioPlayerSetup::showAudioPlayerSetup()
 	mc = new CMenuOptionChooser(LOCALE_AUDIOPLAYER_HIGHPRIO, &g_settings.audioplayer_highprio, MESSAGEBOX_NO_YES_OPTIONS, MESSAGEBOX_NO_YES_OPTION_COUNT, true );
 	mc->setHint("", LOCALE_MENU_HINT_AUDIOPLAYER_HIGHPRIO);
 	audioplayerSetup->addItem(mc);
+
+	CMenuOptionNumberChooser *nc = new CMenuOptionNumberChooser(LOCALE_AUDIOPLAYER_BUFFER, &g_settings.audioplayer_buffer, true, 0, 10, NULL, CRCInput::RC_nokey, NULL, 0, 0, LOCALE_OPTIONS_OFF);
+	nc->setNumberFormat(std::string("%d ") + g_Locale->getText(LOCALE_UNIT_SHORT_SECOND));
+	nc->setHint("", LOCALE_MENU_HINT_AUDIOPLAYER_BUFFER);
+	audioplayerSetup->addItem(nc);
 #if 0
 	if (CVFD::getInstance()->has_lcd) //FIXME
 		audioplayerSetup->addItem(new CMenuOptionChooser(LOCALE_AUDIOPLAYER_SPECTRUM     , &g_settings.spectrum    , MESSAGEBOX_NO_YES_OPTIONS      , MESSAGEBOX_NO_YES_OPTION_COUNT      , true ));
@@ -449,6 +449,7 @@ void CBEChannelWidget::renameChannel()
 			(*Channels)[selected]->setUserName("");
 		else
 			(*Channels)[selected]->setUserName(newName);
+		CServiceManager::getInstance()->InvalidateNameIndex();
 
 		channelsChanged = true;
 	}
@@ -48,6 +48,7 @@
 #include <driver/display.h>
 #include <driver/radiotext.h>
 #include <driver/fontrenderer.h>
+#include <driver/pictureviewer/pictureviewer.h>
 
 #include <gui/color.h>
 #include <gui/color_custom.h>
@@ -90,6 +91,7 @@
 
 extern CBouquetList * bouquetList;       /* neutrino.cpp */
 extern CRemoteControl * g_RemoteControl; /* neutrino.cpp */
+extern CPictureViewer * g_PicViewer;
 extern CBouquetList   * AllFavBouquetList;
 extern CBouquetList   * TVfavList;
 extern CBouquetList   * RADIOfavList;
@@ -2266,6 +2268,14 @@ void CChannelList::paintBody()
 	liststart = (selected/listmaxshow)*listmaxshow;
 	updateEvents(this->historyMode ? 0:liststart, this->historyMode ? 0:(liststart + listmaxshow));
 
+	if (g_settings.channellist_show_channellogo) {
+		/* this page and the next one */
+		std::vector<std::pair<uint64_t, std::string> > logos;
+		for (unsigned int i = liststart; i < liststart + 2 * listmaxshow && i < (*chanlist).size(); i++)
+			logos.push_back(std::make_pair((*chanlist)[i]->getChannelID(), (*chanlist)[i]->getName()));
+		g_PicViewer->PrefetchLogos(logos);
+	}
+
 	if (minitv_is_active)
 		paintPig(x+width, y+theight, pig_width, pig_height);
 
@@ -2766,6 +2776,7 @@ void CChannelList::renameChannel()
 			(*chanlist)[selected]->setUserName("");
 		else
 			(*chanlist)[selected]->setUserName(newName);
+		CServiceManager::getInstance()->InvalidateNameIndex();
 
 		channelsChanged = true;
 	}
@@ -29,6 +29,7 @@
 #include <cs_api.h>
 #include <driver/pictureviewer/pictureviewer.h>
 #include <system/debug.h>
+#include <system/metrics.h>
 extern CPictureViewer * g_PicViewer;
 
 /* export CCDRAW_DEBUG to paint red lines around all elements */
@@ -489,6 +490,8 @@ void CCDraw::enablePaintCache(bool enable)
 //paint framebuffer layers
 void CCDraw::paintFbItems(bool do_save_bg)
 {
+	CMetricTimer metric_timer(METRIC_PAINT_TIME);
+
 	//Pick up signal if filled and execute slots.
 	OnBeforePaintLayers();
 
@@ -32,6 +32,7 @@
 #include "cc_frm_signalbars.h"
 #include <driver/fontrenderer.h>
 #include <zapit/include/zapit/frontend_c.h>
+#include <zapit/include/zapit/fesampler.h>
 #include <sstream>
 
 #define SB_MIN_HEIGHT OFFSET_INNER_MID
@@ -49,6 +50,24 @@ CSignalBar::CSignalBar(const int& xpos, const int& ypos, const int& w, const int
 	initVarSigBar(xpos, ypos, w, h, frontend_ref, sbname, parent);
 }
 
+CSignalBar::~CSignalBar()
+{
+	if (sb_frontend)
+		sb_frontend->getSampler()->Unsubscribe();
+}
+
+void CSignalBar::setFrontEnd(CFrontend *frontend_ref)
+{
+	if (sb_frontend == frontend_ref)
+		return;
+	if (sb_frontend)
+		sb_frontend->getSampler()->Unsubscribe();
+	sb_lastsig = 0;
+	sb_frontend = frontend_ref;
+	if (sb_frontend)
+		sb_frontend->getSampler()->Subscribe();
+}
+
 void CSignalBar::initVarSigBar(const int& xpos, const int& ypos, const int& w, const int& h, CFrontend *frontend_ref, const std::string& sbname, CComponentsForm *parent)
 {
 	cc_item_type.id 	= CC_ITEMTYPE_FRM_SIGNALBAR;
@@ -75,6 +94,8 @@ void CSignalBar::initVarSigBar(const int& xpos, const int& ypos, const int& w, c
 	sb_lbl		= NULL;
 
 	sb_frontend 	= frontend_ref;
+	if (sb_frontend)
+		sb_frontend->getSampler()->Subscribe();
 	x 		= xpos;
 	y 		= ypos;
 	width 		= w;
@@ -200,7 +221,7 @@ void CSignalBar::Refresh()
 	//get current value from frontend
 	sb_signal = 0;
 	if (sb_frontend)
-		sb_signal = sb_frontend->getSignalStrength();
+		sb_signal = sb_frontend->getSampler()->getLast().sig;
 
 	//reinit items with current values
 	initSBItems();
@@ -252,7 +273,7 @@ void CSignalNoiseRatioBar::Refresh()
 	//get current value from frontend
 	sb_signal = 0;
 	if (sb_frontend)
-		sb_signal = sb_frontend->getSignalNoiseRatio();
+		sb_signal = sb_frontend->getSampler()->getLast().snr;
 
 	//reinit items with current values
 	initSBItems();
@@ -307,6 +328,15 @@ void CSignalBox::initVarSigBox()
 	vertical = true;
 }
 
+void CSignalBox::setFrontEnd(CFrontend *frontend_ref)
+{
+	sbx_frontend = frontend_ref;
+	if (sbar)
+		sbar->setFrontEnd(sbx_frontend);
+	if (snrbar)
+		snrbar->setFrontEnd(sbx_frontend);
+}
+
 void CSignalBox::initSignalItems()
 {
 	//set current properties for items
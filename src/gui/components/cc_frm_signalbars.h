@@ -119,8 +119,10 @@ class CSignalBar : public CComponentsForm, public CCTextScreen
 		///basic component class constructor for signal.
 		CSignalBar(const int& xpos, const int& ypos, const int& w, const int& h, CFrontend *frontend_ref, const std::string& sb_name = "SIG", CComponentsForm *parent = NULL);
 
-		///assigns the current used frontend, simplified a tuner object, see frontend_c.h
-		virtual void setFrontEnd(CFrontend *frontend_ref){if (sb_frontend != frontend_ref) {sb_lastsig = 0; sb_frontend = frontend_ref;}}
+		virtual ~CSignalBar();
+
+		///assigns the current used frontend, simplified a tuner object, see frontend_c.h. The values are taken from its sampler, while the bar exists.
+		virtual void setFrontEnd(CFrontend *frontend_ref);
 		///assigns font for caption
 		virtual void setTextFont(Font* font_text){sb_font = font_text;};
 		///sets the caption color, see also property 'sb_caption_color'
@@ -311,7 +313,7 @@ class CSignalBox : public CComponentsForm, public CCTextScreen
 		CSignalNoiseRatioBar* getLabelObject(){return snrbar;};
 
 		///assigns the current used frontend, simplified a tuner object, see frontend_c.h
-		void setFrontEnd(CFrontend *frontend_ref){sbx_frontend = frontend_ref;}
+		void setFrontEnd(CFrontend *frontend_ref);
 
 		///sets the caption color of signalbars, see also property 'sbx_caption_color'
 		void setTextColor(const fb_pixel_t& caption_color){ sbx_caption_color = caption_color;};
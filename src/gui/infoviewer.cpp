@@ -2082,6 +2082,9 @@ void CInfoViewer::killTitle()
 		if (sigbox)
 			sigbox->kill();
 #endif
+		//no signal values needed while hidden, stops the frontend sampler
+		if (sigbox)
+			sigbox->setFrontEnd(NULL);
 
 		header->kill();
 
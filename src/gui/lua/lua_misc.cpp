@@ -26,6 +26,7 @@
 
 #include <global.h>
 #include <system/debug.h>
+#include <system/metrics.h>
 #include <gui/widget/menue.h>
 #include <gui/widget/msgbox.h>
 #include <driver/volume.h>
@@ -73,6 +74,8 @@ void CLuaInstMisc::LuaMiscRegister(lua_State *L)
 		{ "checkVersion",    CLuaInstMisc::checkVersion },
 		{ "postMsg",         CLuaInstMisc::postMsg },
 		{ "getTimeOfDay",    CLuaInstMisc::getTimeOfDay },
+		{ "getMetrics",      CLuaInstMisc::getMetrics },
+		{ "enableMetrics",   CLuaInstMisc::enableMetrics },
 		{ "__gc",            CLuaInstMisc::MiscDelete },
 		{ NULL, NULL }
 	};
@@ -355,6 +358,60 @@ int CLuaInstMisc::getTimeOfDay(lua_State *L)
 	return 1;
 }
 
+/* { enabled = bool, uptime = s, counters = { name = n, ... },
+     latency = { name = { count, avg, max, p50, p90, p99 }, ... } }, times in us */
+int CLuaInstMisc::getMetrics(lua_State *L)
+{
+	CLuaMisc *D = MiscCheckData(L, 1);
+	if (!D) return 0;
+
+	lua_newtable(L);
+	lua_pushboolean(L, metrics_enabled);
+	lua_setfield(L, -2, "enabled");
+	lua_pushnumber(L, (lua_Number) Metrics::uptime());
+	lua_setfield(L, -2, "uptime");
+
+	lua_newtable(L);
+	for (int i = 0; i < METRIC_COUNTER_MAX; i++) {
+		metric_counter_t id = (metric_counter_t) i;
+		lua_pushnumber(L, (lua_Number) Metrics::getCounter(id));
+		lua_setfield(L, -2, Metrics::counterName(id));
+	}
+	lua_setfield(L, -2, "counters");
+
+	lua_newtable(L);
+	for (int i = 0; i < METRIC_LATENCY_MAX; i++) {
+		metric_latency_t id = (metric_latency_t) i;
+		metric_latency_stats_t st;
+		Metrics::getLatency(id, st);
+		lua_newtable(L);
+		lua_pushnumber(L, (lua_Number) st.count);
+		lua_setfield(L, -2, "count");
+		lua_pushnumber(L, (lua_Number) (st.count ? st.sum / st.count : 0));
+		lua_setfield(L, -2, "avg");
+		lua_pushnumber(L, (lua_Number) st.max);
+		lua_setfield(L, -2, "max");
+		lua_pushnumber(L, (lua_Number) st.p50);
+		lua_setfield(L, -2, "p50");
+		lua_pushnumber(L, (lua_Number) st.p90);
+		lua_setfield(L, -2, "p90");
+		lua_pushnumber(L, (lua_Number) st.p99);
+		lua_setfield(L, -2, "p99");
+		lua_setfield(L, -2, Metrics::latencyName(id));
+	}
+	lua_setfield(L, -2, "latency");
+	return 1;
+}
+
+int CLuaInstMisc::enableMetrics(lua_State *L)
+{
+	CLuaMisc *D = MiscCheckData(L, 1);
+	if (!D) return 0;
+
+	Metrics::enable(_luaL_checkbool(L, 2));
+	return 0;
+}
+
 int CLuaInstMisc::MiscDelete(lua_State *L)
 {
 	CLuaMisc *D = MiscCheckData(L, 1);
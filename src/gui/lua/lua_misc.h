@@ -64,6 +64,8 @@ class CLuaInstMisc
 		static int checkVersion(lua_State *L);
 		static int postMsg(lua_State *L);
 		static int getTimeOfDay(lua_State *L);
+		static int getMetrics(lua_State *L);
+		static int enableMetrics(lua_State *L);
 		static int MiscDelete(lua_State *L);
 
 		static void miscFunctionDeprecated(lua_State *L, std::string oldFunc);
@@ -76,6 +76,7 @@
 #endif
 #include <zapit/debug.h>
 #include <driver/moviecut.h>
+#include <driver/tsindex.h>
 #include <driver/fontrenderer.h>
 
 #include <timerdclient/timerdclient.h>
@@ -2519,6 +2520,7 @@ bool CMovieBrowser::onDeleteFile(MI_MOVIE_INFO *movieinfo, bool skipAsk)
 		CFile file_xml = movieinfo->file;
 		if (m_movieInfo.convertTs2XmlName(file_xml.Name))
 			unlink(file_xml.Name.c_str());
+		unlink(CTsIndex::GetSidecarName(movieinfo->file.Name).c_str());
 
 		hintBox.hide();
 		g_RCInput->clearRCMsg();
@@ -68,6 +68,7 @@
 #include <stdlib.h>
 #include <sys/timeb.h>
 #include <sys/mount.h>
+#include <sys/stat.h>
 #include <json/json.h>
 
 #include <video.h>
@@ -181,6 +182,7 @@ void CMoviePlayerGui::Init(void)
 	currentVideoSystem = -1;
 	currentOsdResolution = 0;
 	is_audio_playing = false;
+	has_tsindex = false;
 
 	frameBuffer = CFrameBuffer::getInstance();
 
@@ -1382,6 +1384,7 @@ bool CMoviePlayerGui::PlayFileStart(void)
 
 	printf("IS FILE PLAYER: %s\n", is_file_player ?  "true": "false" );
 	playback->Open(is_file_player ? PLAYMODE_FILE : PLAYMODE_TS);
+	has_tsindex = !is_file_player && timeshift == TSHIFT_MODE_OFF && tsindex.Load(CTsIndex::GetSidecarName(file_name));
 
 	if (p_movie_info) {
 		if (timeshift != TSHIFT_MODE_OFF) {
@@ -1548,6 +1551,18 @@ bool CMoviePlayerGui::PlayFileStart(void)
 bool CMoviePlayerGui::SetPosition(int pos, bool absolute)
 {
 	StopSubtitles(true);
+	int newpos;
+	struct stat64 st;
+	/* the index maps from the current offset, not the one of the last osd update */
+	if (timeshift != TSHIFT_MODE_OFF || has_tsindex)
+		playback->GetPosition(position, duration);
+	if (timeshift != TSHIFT_MODE_OFF && CRecordManager::getInstance()->GetTimeshiftSeekPosition(position, duration, pos, absolute, newpos)) {
+		pos = newpos;
+		absolute = true;
+	} else if (has_tsindex && !stat64(file_name.c_str(), &st) && tsindex.GetSeekPosition(st.st_size, 0, position, duration, pos, absolute, newpos)) {
+		pos = newpos;
+		absolute = true;
+	}
 	bool res = playback->SetPosition(pos, absolute);
 	if(is_file_player && res && speed == 0 && playstate == CMoviePlayerGui::PAUSE){
 		playstate = CMoviePlayerGui::PLAY;
@@ -42,6 +42,7 @@
 #include <gui/widget/hintbox.h>
 #include <gui/timeosd.h>
 #include <driver/record.h>
+#include <driver/tsindex.h>
 #include <zapit/channel.h>
 #include <playback.h>
 
@@ -117,6 +118,9 @@ class CMoviePlayerGui : public CMenuTarget
 	int startposition;
 	int position;
 	int duration;
+	/* recording index for exact seeks, if the recording has one */
+	CTsIndex tsindex;
+	bool has_tsindex;
 	int currentVideoSystem;
 	uint32_t currentOsdResolution;
 
@@ -412,6 +412,12 @@ void CRecordSetup::showRecordTimeShiftSetup(CMenuWidget *menu_ts)
 		mn->setNumberFormat(std::string("%d ") + g_Locale->getText(LOCALE_UNIT_SHORT_HOUR));
 		mn->setHint("", LOCALE_MENU_HINT_RECORD_TIME_TS);
 		menu_ts->addItem(mn);
+
+		//ring size
+		mn = new CMenuOptionNumberChooser(LOCALE_EXTRA_TIMESHIFT_RING, &g_settings.timeshift_ring, true, 0, 64, NULL);
+		mn->setNumberFormat("%d GB");
+		mn->setHint("", LOCALE_MENU_HINT_RECORD_TIMESHIFT_RING);
+		menu_ts->addItem(mn);
 	}
 }
 
@@ -52,6 +52,7 @@
 #include <audio.h>
 #include <dmx.h>
 #include <zapit/satconfig.h>
+#include <zapit/fesampler.h>
 #include <string>
 #include <system/helpers.h>
 
@@ -126,11 +127,15 @@ int CStreamInfo2::exec (CMenuTarget * parent, const std::string &)
 
 	frontend = CFEManager::getInstance()->getLiveFE();
 
+	if (!mp)
+		frontend->getSampler()->Subscribe();
 	fader.StartFadeIn();
 	paint (paint_mode);
 	int res = doSignalStrengthLoop ();
 	hide ();
 	fader.StopFade();
+	if (!mp)
+		frontend->getSampler()->Unsubscribe();
 	return res;
 }
 
@@ -158,9 +163,10 @@ int CStreamInfo2::doSignalStrengthLoop ()
 	ts_setup ();
 	while (1) {
 		if (!mp) {
-			signal.sig = frontend->getSignalStrength() & 0xFFFF;
-			signal.snr = frontend->getSignalNoiseRatio() & 0xFFFF;
-			signal.ber = frontend->getBitErrorRate();
+			fe_sample_t s = frontend->getSampler()->getLast();
+			signal.sig = s.sig & 0xFFFF;
+			signal.snr = s.snr & 0xFFFF;
+			signal.ber = s.ber;
 		}
 
 		int ret = update_rate ();
@@ -54,6 +54,7 @@ extern "C" {
 #include <audio.h>
 #include <dmx.h>
 #include <zapit/satconfig.h>
+#include <zapit/fesampler.h>
 #include <string>
 #include <system/helpers.h>
 #include <system/set_threadname.h>
@@ -359,9 +360,13 @@ int CStreamInfo2::exec (CMenuTarget * parent, const std::string &)
 
 	frontend = mp ? NULL : CFEManager::getInstance()->getLiveFE();
 
+	if (frontend)
+		frontend->getSampler()->Subscribe();
 	paint (paint_mode);
 	int res = doSignalStrengthLoop ();
 	hide ();
+	if (frontend)
+		frontend->getSampler()->Unsubscribe();
 	return res;
 }
 
@@ -392,9 +397,10 @@ int CStreamInfo2::doSignalStrengthLoop ()
 
 		if (!mp)
 		{
-			signal.sig = 100 * (frontend->getSignalStrength() & 0xFFFF) >> 16;
-			signal.snr = 100 * (frontend->getSignalNoiseRatio() & 0xFFFF) >> 16;
-			signal.ber = 100 * (frontend->getBitErrorRate() & 0xFFFF) >> 16; // FIXME?
+			fe_sample_t s = frontend->getSampler()->getLast();
+			signal.sig = 100 * (s.sig & 0xFFFF) >> 16;
+			signal.snr = 100 * (s.snr & 0xFFFF) >> 16;
+			signal.ber = 100 * (s.ber & 0xFFFF) >> 16; // FIXME?
 		}
 
 		bool got_rate = update_rate();
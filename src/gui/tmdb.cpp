@@ -37,6 +37,7 @@
 #include "system/helpers.h"
 #include <system/helpers-json.h>
 #include "system/set_threadname.h"
+#include <system/httpclient.h>
 #include "gui/widget/hintbox.h"
 
 #include <driver/screen_max.h>
@@ -80,15 +81,6 @@ cTmdb::~cTmdb()
 	curl_easy_cleanup(curl_handle);
 }
 
-size_t cTmdb::CurlWriteToString(void *ptr, size_t size, size_t nmemb, void *data)
-{
-	if (size * nmemb > 0) {
-		std::string* pStr = (std::string*) data;
-		pStr->append((char*) ptr, nmemb);
-	}
-	return size*nmemb;
-}
-
 std::string cTmdb::decodeUrl(std::string url)
 {
 	char * str = curl_easy_unescape(curl_handle, url.c_str(), 0, NULL);
@@ -107,83 +99,19 @@ std::string cTmdb::encodeUrl(std::string txt)
 	return txt;
 }
 
-bool cTmdb::getUrl(std::string &url, std::string &answer, CURL *_curl_handle)
+bool cTmdb::getUrl(std::string &url, std::string &answer)
 {
 	printf("[TMDB]: %s\n",__func__);
-	if (!_curl_handle)
-		_curl_handle = curl_handle;
-
-	curl_easy_setopt(_curl_handle, CURLOPT_URL, url.c_str());
-	curl_easy_setopt(_curl_handle, CURLOPT_WRITEFUNCTION, &cTmdb::CurlWriteToString);
-	curl_easy_setopt(_curl_handle, CURLOPT_FILE, (void *)&answer);
-	curl_easy_setopt(_curl_handle, CURLOPT_FAILONERROR, 1);
-	curl_easy_setopt(_curl_handle, CURLOPT_TIMEOUT, URL_TIMEOUT);
-	curl_easy_setopt(_curl_handle, CURLOPT_NOSIGNAL, (long)1);
-	curl_easy_setopt(_curl_handle, CURLOPT_SSL_VERIFYPEER, false);
-
-	if (!g_settings.softupdate_proxyserver.empty()) {
-		curl_easy_setopt(_curl_handle, CURLOPT_PROXY, g_settings.softupdate_proxyserver.c_str());
-		if (!g_settings.softupdate_proxyusername.empty()) {
-			std::string tmp = g_settings.softupdate_proxyusername + ":" + g_settings.softupdate_proxypassword;
-			curl_easy_setopt(_curl_handle, CURLOPT_PROXYUSERPWD, tmp.c_str());
-		}
-	}
-
-	char cerror[CURL_ERROR_SIZE] = {0};
-	curl_easy_setopt(_curl_handle, CURLOPT_ERRORBUFFER, cerror);
-
 	printf("try to get [%s] ...\n", url.c_str());
-	CURLcode httpres = curl_easy_perform(_curl_handle);
-
-	printf("http: res %d size %d\n", httpres, (int)answer.size());
-
-	if (httpres != 0 || answer.empty()) {
-		printf("error: %s\n", cerror);
-		return false;
-	}
-	return true;
+	bool ok = CHTTPClient::getInstance()->getUrl(url, answer, CHTTPRequest::PRIO_HIGH, URL_TIMEOUT, false);
+	printf("http: ok %d size %d\n", ok, (int)answer.size());
+	return ok && !answer.empty();
 }
 
-bool cTmdb::DownloadUrl(std::string url, std::string file, CURL *_curl_handle)
+bool cTmdb::DownloadUrl(std::string url, std::string file)
 {
-	if (!_curl_handle)
-		_curl_handle = curl_handle;
-
-	FILE * fp = fopen(file.c_str(), "wb");
-	if (fp == NULL) {
-		perror(file.c_str());
-		return false;
-	}
-	curl_easy_setopt(_curl_handle, CURLOPT_URL, url.c_str());
-	curl_easy_setopt(_curl_handle, CURLOPT_WRITEFUNCTION, NULL);
-	curl_easy_setopt(_curl_handle, CURLOPT_FILE, fp);
-	curl_easy_setopt(_curl_handle, CURLOPT_FAILONERROR, 1);
-	curl_easy_setopt(_curl_handle, CURLOPT_TIMEOUT, URL_TIMEOUT);
-	curl_easy_setopt(_curl_handle, CURLOPT_NOSIGNAL, (long)1);
-	curl_easy_setopt(_curl_handle, CURLOPT_SSL_VERIFYPEER, false);
-
-	if (!g_settings.softupdate_proxyserver.empty()) {
-		curl_easy_setopt(_curl_handle, CURLOPT_PROXY, g_settings.softupdate_proxyserver.c_str());
-		if (!g_settings.softupdate_proxyusername.empty()) {
-			std::string tmp = g_settings.softupdate_proxyusername + ":" + g_settings.softupdate_proxypassword;
-			curl_easy_setopt(_curl_handle, CURLOPT_PROXYUSERPWD, tmp.c_str());
-		}
-	}
-
-	char cerror[CURL_ERROR_SIZE] = {0};
-	curl_easy_setopt(_curl_handle, CURLOPT_ERRORBUFFER, cerror);
-
 	printf("try to get [%s] ...\n", url.c_str());
-	CURLcode httpres = curl_easy_perform(_curl_handle);
-
-	double dsize;
-	curl_easy_getinfo(_curl_handle, CURLINFO_SIZE_DOWNLOAD, &dsize);
-	fclose(fp);
-
-	printf("http: res %d size %g.\n", httpres, dsize);
-
-	if (httpres != 0) {
-		printf("curl error: %s\n", cerror);
+	if (!CHTTPClient::getInstance()->downloadUrl(url, file, CHTTPRequest::PRIO_HIGH, URL_TIMEOUT, false)) {
 		unlink(file.c_str());
 		return false;
 	}
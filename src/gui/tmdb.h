@@ -50,12 +50,11 @@ class cTmdb
 		CURL *curl_handle;
 		tmdbinfo minfo;
 
-		static size_t CurlWriteToString(void *ptr, size_t size, size_t nmemb, void *data);
 		std::string encodeUrl(std::string txt);
 		std::string decodeUrl(std::string url);
 		std::string key; // tmdb api key
-		bool getUrl(std::string &url, std::string &answer, CURL *_curl_handle = NULL);
-		bool DownloadUrl(std::string url, std::string file, CURL *_curl_handle = NULL);
+		bool getUrl(std::string &url, std::string &answer);
+		bool DownloadUrl(std::string url, std::string file);
 		bool GetMovieDetails(std::string lang);
 
 	public:
@@ -68,6 +68,7 @@
 #include <gui/color_custom.h>
 #endif
 #include <sstream>
+#include <climits>
 
 #define	SCROLL_FRAME_WIDTH	SCROLLBAR_WIDTH
 #define	SCROLL_MARKER_BORDER	OFFSET_INNER_MIN
@@ -193,6 +194,16 @@ void CTextBox::initVar(void)
 	m_nBgRadiusType 	= m_old_nBgRadiusType = CORNER_NONE;
 
 	m_cLineArray.clear();
+	m_cLineWidth.clear();
+	m_layout_font		= NULL;
+	m_layout_font_size	= 0;
+	m_layout_width		= 0;
+	m_layout_mode		= 0;
+	m_layout_utf8		= true;
+	m_layout_done		= true;
+	m_layout_pos		= 0;
+	m_layout_line_width	= 0;
+	m_layout_max_width	= 0;
 
 	m_renderMode		= 0;
 	m_utf8_encoded		= true;
@@ -340,25 +351,11 @@ void CTextBox::initFramesRel(void)
 #endif
 }
 
-void CTextBox::refreshTextLineArray(void)
+void CTextBox::refreshTextLineArray(bool complete)
 {
 	//TRACE("[CTextBox]->RefreshLineArray \r\n");
-	int loop 		= true;
-	int pos_prev 		= 0;
-	int pos 		= 0;
-	int aktWidth 		= 0;
-	int aktWordWidth 	= 0;
 	int lineBreakWidth 	= 0;
 
-	m_nNrOfNewLine 		= 0;
-
-	std::string	aktLine = "";
-	std::string	aktWord = "";
-
-	/* clear current line vector */
-	m_cLineArray.clear();
-	m_nNrOfLines = 0;
-
 	int MaxWidth = m_nMaxWidth - m_cFrameScrollRel.iWidth - 2*text_Hborder_width;
 	if( m_nMode & AUTO_WIDTH){
 		/* In case of autowidth, we calculate the max allowed width of the textbox */
@@ -377,88 +374,47 @@ void CTextBox::refreshTextLineArray(void)
 	// do not parse, if text is empty
 	if(TextChars == 0)
 	{
+		m_cLineArray.clear();
+		m_cLineWidth.clear();
+		m_layout_text.clear();
+		m_nNrOfNewLine = 0;
 		m_nNrOfPages = 0;
 		m_nNrOfLines = 0;
 		m_nCurrentPage = 0;
 		m_nCurrentLine = 0;
 		m_nLinesPerPage = 1;
+		return;
 	}
-	else
-	{
-		while(loop)
-		{
-			//manage auto linebreak,
-			if(m_nMode & NO_AUTO_LINEBREAK)
-				pos = m_cText.find_first_of("\n", pos_prev);
-			else if(m_nMode & AUTO_LINEBREAK_NO_BREAKCHARS)
-				pos = m_cText.find_first_of("\n/ ", pos_prev);
-			else
-				pos = m_cText.find_first_of("\n/-. ", pos_prev);
-
-			//TRACE_1("     pos: %d pos_prev: %d\r\n",pos,pos_prev);
-
-			if(pos == -1)
-			{
-				pos = TextChars+1;
-				loop = false; // note, this is not 100% correct. if the last characters does not fit in one line, the characters after are cut
-				//TRACE_1(" Textend found\r\n");
-			}
 
-			//find current word between start pos and next pos (next possible \n)
-			aktWord = m_cText.substr(pos_prev, pos - pos_prev + 1);
-
-			//calculate length of current found word
-			aktWordWidth = m_pcFontText->getRenderWidth(aktWord, m_utf8_encoded);
-
-			//set next start pos
-			pos_prev = pos + 1;
-			//if(aktWord.find("&quot;") == )
-			if(1)
-			{
-				//TRACE_1("     aktWord: >%s< pos:%d\r\n",aktWord.c_str(),pos);
-
-				if( (aktWidth + aktWordWidth) > lineBreakWidth && !(m_nMode & NO_AUTO_LINEBREAK))
-				{
-					/* we need a new line before we can continue */
-					m_cLineArray.push_back(aktLine);
-					//TRACE_1("  end line: %s\r\n", aktLine.c_str());
-					m_nNrOfLines++;
-					aktLine = "";
-					aktWidth = 0;
-
-					if(pos_prev >= TextChars)
-						loop = false;
-				}
-
-				//add current word to current line
-				aktLine  += aktWord;
-				//set current line width 
-				aktWidth += aktWordWidth;
-
-				//set max text width, if required
-				if (aktWidth > m_nMaxTextWidth)
-					m_nMaxTextWidth = aktWidth;
-
-				//TRACE_1("     aktLine : %s\r\n",aktLine.c_str());
-				//TRACE_1("     aktWidth: %d aktWordWidth:%d\r\n",aktWidth,aktWordWidth);
-
-				if( ((pos < TextChars) && (m_cText[pos] == '\n')) || loop == false)
-				{
-					// current line ends with an carriage return, make new line
-					if ((pos < TextChars) && (m_cText[pos] == '\n'))
-						aktLine.erase(aktLine.size() - 1,1);
-					m_cLineArray.push_back(aktLine);
-					m_nNrOfLines++;
-					aktLine = "";
-					aktWidth = 0;
-					m_nNrOfNewLine++;
-					
-					if(pos_prev >= TextChars)
-						loop = false;
-				}
-			}
-		}
+	/* keep the line breaks, if nothing they depend on has changed */
+	int mode = m_nMode & (NO_AUTO_LINEBREAK | AUTO_LINEBREAK_NO_BREAKCHARS);
+	if (m_layout_text != m_cText || m_layout_font != m_pcFontText || m_layout_font_size != m_pcFontText->getSize() ||
+	    m_layout_width != lineBreakWidth || m_layout_mode != mode || m_layout_utf8 != m_utf8_encoded || m_nNrOfLines != (int)m_cLineArray.size())
+	{
+		m_cLineArray.clear();
+		m_cLineWidth.clear();
+		m_nNrOfLines		= 0;
+		m_nNrOfNewLine		= 0;
+		m_layout_text		= m_cText;
+		m_layout_font		= m_pcFontText;
+		m_layout_font_size	= m_pcFontText->getSize();
+		m_layout_width		= lineBreakWidth;
+		m_layout_mode		= mode;
+		m_layout_utf8		= m_utf8_encoded;
+		m_layout_done		= false;
+		m_layout_pos		= 0;
+		m_layout_line.clear();
+		m_layout_line_width	= 0;
+		m_layout_max_width	= 0;
+	}
+	else if (m_layout_done && m_layout_max_width > m_nMaxTextWidth)
+		m_nMaxTextWidth = m_layout_max_width;
 
+	/* auto sized boxes need all lines, scrolled boxes only the shown ones */
+	bool lazy = !complete && (m_nMode & SCROLL) && !(m_nMode & (AUTO_WIDTH | AUTO_HIGH));
+	if (!lazy)
+	{
+		layoutLines(INT_MAX);
 
 		/* check if we have to recalculate the window frame size, due to auto width and auto height */
 		if( m_nMode & AUTO_WIDTH)
@@ -470,15 +426,17 @@ void CTextBox::refreshTextLineArray(void)
 		{
 			reSizeMainFrameHeight(m_nNrOfLines * m_nFontTextHeight);
 		}
+	}
 
-		m_nLinesPerPage = std::max(1, (m_cFrameTextRel.iHeight - (2*text_Vborder_width)) / m_nFontTextHeight);
-		m_nNrOfPages =	((m_nNrOfLines-1) / m_nLinesPerPage) + 1;
+	m_nLinesPerPage = std::max(1, (m_cFrameTextRel.iHeight - (2*text_Vborder_width)) / m_nFontTextHeight);
+	if (lazy)
+		layoutLines((m_nCurrentPage + 2) * m_nLinesPerPage);
+	refreshPages();
 
-		if(m_nCurrentPage >= m_nNrOfPages)
-		{
-			m_nCurrentPage = m_nNrOfPages - 1;
-			m_nCurrentLine = m_nCurrentPage * m_nLinesPerPage;
-		}
+	if(m_nCurrentPage >= m_nNrOfPages)
+	{
+		m_nCurrentPage = m_nNrOfPages - 1;
+		m_nCurrentLine = m_nCurrentPage * m_nLinesPerPage;
 	}
 
 #if 0
@@ -493,6 +451,110 @@ void CTextBox::refreshTextLineArray(void)
 #endif
 }
 
+/* break the text into lines, until there are at least the given number
+ * of lines or the text is done. continues where the last call stopped */
+void CTextBox::layoutLines(int lines)
+{
+	int pos 		= 0;
+	int aktWordWidth 	= 0;
+	int TextChars 		= m_cText.size();
+	bool loop 		= !m_layout_done;
+
+	std::string	aktWord;
+
+	while(loop && m_nNrOfLines < lines)
+	{
+		//manage auto linebreak,
+		if(m_nMode & NO_AUTO_LINEBREAK)
+			pos = m_cText.find_first_of("\n", m_layout_pos);
+		else if(m_nMode & AUTO_LINEBREAK_NO_BREAKCHARS)
+			pos = m_cText.find_first_of("\n/ ", m_layout_pos);
+		else
+			pos = m_cText.find_first_of("\n/-. ", m_layout_pos);
+
+		//TRACE_1("     pos: %d pos_prev: %d\r\n",pos,m_layout_pos);
+
+		if(pos == -1)
+		{
+			pos = TextChars+1;
+			loop = false; // note, this is not 100% correct. if the last characters does not fit in one line, the characters after are cut
+			//TRACE_1(" Textend found\r\n");
+		}
+
+		//find current word between start pos and next pos (next possible \n)
+		aktWord = m_cText.substr(m_layout_pos, pos - m_layout_pos + 1);
+
+		//calculate length of current found word
+		aktWordWidth = m_pcFontText->getRenderWidth(aktWord, m_utf8_encoded);
+
+		//set next start pos
+		m_layout_pos = pos + 1;
+
+		//TRACE_1("     aktWord: >%s< pos:%d\r\n",aktWord.c_str(),pos);
+
+		if( (m_layout_line_width + aktWordWidth) > m_layout_width && !(m_nMode & NO_AUTO_LINEBREAK))
+		{
+			/* we need a new line before we can continue */
+			m_cLineArray.push_back(m_layout_line);
+			m_cLineWidth.push_back(-1);
+			//TRACE_1("  end line: %s\r\n", m_layout_line.c_str());
+			m_nNrOfLines++;
+			m_layout_line.clear();
+			m_layout_line_width = 0;
+
+			if(m_layout_pos >= TextChars)
+				loop = false;
+		}
+
+		//add current word to current line
+		m_layout_line += aktWord;
+		//set current line width
+		m_layout_line_width += aktWordWidth;
+
+		//set max text width, if required
+		if (m_layout_line_width > m_layout_max_width)
+			m_layout_max_width = m_layout_line_width;
+
+		//TRACE_1("     aktLine : %s\r\n",m_layout_line.c_str());
+		//TRACE_1("     aktWidth: %d aktWordWidth:%d\r\n",m_layout_line_width,aktWordWidth);
+
+		if( ((pos < TextChars) && (m_cText[pos] == '\n')) || loop == false)
+		{
+			// current line ends with an carriage return, make new line
+			if ((pos < TextChars) && (m_cText[pos] == '\n'))
+				m_layout_line.erase(m_layout_line.size() - 1,1);
+			m_cLineArray.push_back(m_layout_line);
+			m_cLineWidth.push_back(-1);
+			m_nNrOfLines++;
+			m_layout_line.clear();
+			m_layout_line_width = 0;
+			m_nNrOfNewLine++;
+
+			if(m_layout_pos >= TextChars)
+				loop = false;
+		}
+	}
+	/* the width of a partial text would change the break width of the next refresh */
+	if (!loop)
+	{
+		m_layout_done = true;
+		if (m_layout_max_width > m_nMaxTextWidth)
+			m_nMaxTextWidth = m_layout_max_width;
+	}
+}
+
+/* as long as the text is not completely broken into lines, the count of
+ * pages is estimated from the part done so far */
+void CTextBox::refreshPages(void)
+{
+	m_nNrOfPages =	((m_nNrOfLines-1) / m_nLinesPerPage) + 1;
+	if (!m_layout_done && m_layout_pos > 0)
+	{
+		long long lines = (long long)m_nNrOfLines * m_cText.size() / m_layout_pos;
+		m_nNrOfPages = std::max(m_nNrOfPages + 1, (int)((lines - 1) / m_nLinesPerPage) + 1);
+	}
+}
+
 void CTextBox::refreshScroll(void)
 {
 	if(!(m_nMode & SCROLL))
@@ -705,7 +767,9 @@ void CTextBox::refreshText(void)
 		//calculate xpos
 		if ((m_nMode & CENTER) || (m_nMode & RIGHT))
 		{
-			x_center = m_cFrameTextRel.iWidth - m_cFrameTextRel.iX - 2*text_Hborder_width - m_pcFontText->getRenderWidth(m_cLineArray[i], m_utf8_encoded);
+			if (m_cLineWidth[i] < 0)
+				m_cLineWidth[i] = m_pcFontText->getRenderWidth(m_cLineArray[i], m_utf8_encoded);
+			x_center = m_cFrameTextRel.iWidth - m_cFrameTextRel.iX - 2*text_Hborder_width - m_cLineWidth[i];
 			if (m_nMode & CENTER)
 				x_center /= 2;
 			if (m_nMode & SCROLL)
@@ -738,6 +802,12 @@ void CTextBox::scrollPageDown(const int pages)
 	if( m_nNrOfLines <= 0)
 		return;
 
+	if (!m_layout_done)
+	{
+		layoutLines((m_nCurrentPage + pages + 2) * m_nLinesPerPage);
+		refreshPages();
+	}
+
 	if(m_nCurrentPage + pages < m_nNrOfPages)
 	{
 		m_nCurrentPage += pages;
@@ -911,11 +981,22 @@ int CTextBox::getLines()
 	if (m_cText.empty())
 		return 0;
 
-	refreshTextLineArray();
+	refreshTextLineArray(true);
 
 	return m_nNrOfLines;
 }
 
+int CTextBox::getPages()
+{
+	if (!m_layout_done && m_nNrOfLines > 0)
+	{
+		layoutLines(INT_MAX);
+		refreshPages();
+	}
+
+	return m_nNrOfPages;
+}
+
 int CTextBox::getMaxLineWidth(const std::string& text, Font* font)
 {
 	std::string txt = text;
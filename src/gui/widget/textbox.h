@@ -99,7 +99,9 @@ class CTextBox : public sigc::trackable
 		
 	private:
 		/* Functions */
-		void refreshTextLineArray(void);
+		void refreshTextLineArray(bool complete = false);
+		void layoutLines(int lines);
+		void refreshPages(void);
 		void initVar(void);
 		void initFramesRel(void);
 		void initFramesAndTextArray();
@@ -116,6 +118,22 @@ class CTextBox : public sigc::trackable
 		/* Variables */
 		std::string m_cText, m_old_cText;
 		std::vector<std::string> m_cLineArray;
+		std::vector<int> m_cLineWidth;		//render width of the lines, -1 = not measured yet
+
+		/* line breaks are kept as long as text, font, break width and
+		   break mode are the same. long texts are broken only as far
+		   as they are shown, the rest follows when scrolling */
+		std::string m_layout_text;
+		Font* m_layout_font;
+		int m_layout_font_size;
+		int m_layout_width;
+		int m_layout_mode;
+		bool m_layout_utf8;
+		bool m_layout_done;
+		int m_layout_pos;			//text position to continue
+		std::string m_layout_line;		//unfinished line at m_layout_pos
+		int m_layout_line_width;
+		int m_layout_max_width;
 
 		int m_old_x, m_old_y, m_old_dx, m_old_dy, m_old_nBgRadius, m_old_nBgRadiusType, m_old_nMode;
 		bool m_has_scrolled;
@@ -204,7 +222,7 @@ class CTextBox : public sigc::trackable
 		CBox	getWindowsPos(void)		{return(m_cFrame);};
 
 		int     getLinesPerPage(void)		{return m_nLinesPerPage;};
-		int     getPages(void)			{return(m_nNrOfPages);};
+		int     getPages(void);
 		int	getBackGroundRadius(void)	{return(m_nBgRadius);};
 
 		/**
@@ -0,0 +1,321 @@
+/*
+	Neutrino-GUI  -   DBoxII-Project
+
+	HTTP client check: runs requests of CHTTPClient against a small HTTP
+	server in this program, and checks caching, revalidation, connection
+	reuse, concurrent downloads, errors and progress. no network needed.
+
+	usage: httpclient_check
+
+	License: GPL
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <string>
+#include <map>
+
+#define NEUTRINO_CPP
+#include <global.h>
+#include <driver/abstime.h>
+#include <system/httpclient.h>
+#include "check.h"
+
+int debug = 0;
+
+#define BIG_SIZE	(3 * 1024 * 1024)
+#define SLOW_SIZE	(512 * 1024)
+#define DOWNLOADS	8
+
+static int port;
+static pthread_mutex_t server_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* requests per path, 304 answers, accepted connections */
+static std::map<std::string, int> requests;
+static int not_modified = 0;
+static int connections = 0;
+
+static int hits(const char *path)
+{
+	pthread_mutex_lock(&server_mutex);
+	int n = requests[path];
+	pthread_mutex_unlock(&server_mutex);
+	return n;
+}
+
+static bool send_all(int fd, const char *data, size_t len)
+{
+	while (len) {
+		ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+		if (n <= 0)
+			return false;
+		data += n;
+		len -= n;
+	}
+	return true;
+}
+
+/* one connection, keep-alive */
+static void *serve(void *arg)
+{
+	int fd = (int)(long) arg;
+	std::string in;
+	char buf[4096];
+	for (;;) {
+		size_t end;
+		while ((end = in.find("\r\n\r\n")) == std::string::npos) {
+			ssize_t n = recv(fd, buf, sizeof(buf), 0);
+			if (n <= 0) {
+				close(fd);
+				return NULL;
+			}
+			in.append(buf, n);
+		}
+		std::string head = in.substr(0, end);
+		in.erase(0, end + 4);
+		size_t sp = head.find(' ');
+		std::string path = head.substr(sp + 1, head.find(' ', sp + 1) - sp - 1);
+		bool etag_match = head.find("If-None-Match: \"v1\"") != std::string::npos;
+
+		pthread_mutex_lock(&server_mutex);
+		requests[path]++;
+		pthread_mutex_unlock(&server_mutex);
+
+		std::string status = "200 OK", headers, body;
+		size_t size = 0;
+		bool slow = false;
+		if (path == "/fresh" || path == "/prefetch") {
+			headers = "Cache-Control: max-age=3600\r\n";
+			body = "fresh " + path;
+		} else if (path == "/etag") {
+			headers = "ETag: \"v1\"\r\nCache-Control: max-age=0\r\n";
+			if (etag_match) {
+				status = "304 Not Modified";
+				pthread_mutex_lock(&server_mutex);
+				not_modified++;
+				pthread_mutex_unlock(&server_mutex);
+			} else
+				body = "etag v1";
+		} else if (path == "/big")
+			size = BIG_SIZE;
+		else if (path == "/slow") {
+			size = SLOW_SIZE;
+			slow = true;
+		} else {
+			status = "404 Not Found";
+			body = "not found";
+		}
+		if (size == 0)
+			size = body.size();
+
+		char line[256];
+		snprintf(line, sizeof(line), "HTTP/1.1 %s\r\nContent-Length: %d\r\n", status.c_str(),
+				status[0] == '3' ? 0 : (int) size);
+		std::string out = line + headers + "\r\n";
+		if (!send_all(fd, out.data(), out.size()))
+			break;
+		if (status[0] == '3')
+			continue;
+		if (!body.empty()) {
+			if (!send_all(fd, body.data(), body.size()))
+				break;
+			continue;
+		}
+		memset(buf, 'x', sizeof(buf));
+		for (size_t done = 0; done < size; done += sizeof(buf)) {
+			size_t n = size - done > sizeof(buf) ? sizeof(buf) : size - done;
+			if (!send_all(fd, buf, n))
+				break;
+			if (slow && (done / sizeof(buf)) % 2 == 0)
+				usleep(10000);
+		}
+	}
+	close(fd);
+	return NULL;
+}
+
+static void *listener(void *arg)
+{
+	int s = (int)(long) arg;
+	for (;;) {
+		int fd = accept(s, NULL, NULL);
+		if (fd < 0)
+			continue;
+		pthread_mutex_lock(&server_mutex);
+		connections++;
+		pthread_mutex_unlock(&server_mutex);
+		pthread_t t;
+		if (pthread_create(&t, NULL, serve, (void *)(long) fd) == 0)
+			pthread_detach(t);
+		else
+			close(fd);
+	}
+	return NULL;
+}
+
+static bool start_server(void)
+{
+	int s = socket(AF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t len = sizeof(addr);
+	if (s < 0 || bind(s, (struct sockaddr *) &addr, sizeof(addr)) || listen(s, 16) ||
+			getsockname(s, (struct sockaddr *) &addr, &len)) {
+		perror("httpclient_check: server");
+		return false;
+	}
+	port = ntohs(addr.sin_port);
+	pthread_t t;
+	if (pthread_create(&t, NULL, listener, (void *)(long) s))
+		return false;
+	pthread_detach(t);
+	return true;
+}
+
+static std::string url(const char *path)
+{
+	char buf[64];
+	snprintf(buf, sizeof(buf), "http://127.0.0.1:%d%s", port, path);
+	return buf;
+}
+
+static bool get(const char *path, CHTTPRequest &req)
+{
+	req = CHTTPRequest(url(path));
+	return CHTTPClient::getInstance()->perform(req);
+}
+
+struct download
+{
+	std::string file;
+	bool ok;
+	off_t size;
+};
+
+static void *download_thread(void *arg)
+{
+	download *d = (download *) arg;
+	CHTTPRequest req(url("/big"));
+	req.file = d->file;
+	req.cache = false;
+	req.prio = CHTTPRequest::PRIO_LOW;
+	d->ok = CHTTPClient::getInstance()->perform(req);
+	struct stat st;
+	d->size = stat(d->file.c_str(), &st) ? 0 : st.st_size;
+	unlink(d->file.c_str());
+	return NULL;
+}
+
+struct progress
+{
+	int calls;
+	bool sane;
+	double last;
+};
+
+static int progress_cb(void *data, double dltotal, double dlnow)
+{
+	progress *p = (progress *) data;
+	p->calls++;
+	if (dlnow < p->last || (dltotal > 0 && dlnow > dltotal))
+		p->sane = false;
+	p->last = dlnow;
+	return 0;
+}
+
+int main(void)
+{
+	if (!start_server())
+		return CHECK_ERROR;
+	char dir[] = "/tmp/httpclient_check.XXXXXX";
+	if (!mkdtemp(dir)) {
+		perror(dir);
+		return CHECK_ERROR;
+	}
+	CHTTPClient *client = CHTTPClient::getInstance();
+	client->setCache(dir, 4 * 1024 * 1024);
+	int64_t start = time_monotonic_ms();
+	CHTTPRequest req;
+
+	/* fresh entries come from the cache */
+	check(get("/fresh", req) && !req.cached && req.answer == "fresh /fresh", "first get");
+	check(get("/fresh", req) && req.cached && req.answer == "fresh /fresh", "second get not from the cache");
+	check(hits("/fresh") == 1, "fresh entry fetched again");
+
+	/* stale entries are revalidated */
+	check(get("/etag", req) && req.answer == "etag v1", "etag get");
+	check(get("/etag", req) && req.cached && req.answer == "etag v1", "revalidated entry not from the cache");
+	check(hits("/etag") == 2 && not_modified == 1, "no revalidation with 304");
+
+	/* errors */
+	check(!get("/missing", req) && req.code == 404, "404 not reported");
+
+	/* prefetch fills the cache in background */
+	client->prefetch(url("/prefetch"));
+	for (int i = 0; i < 100 && hits("/prefetch") == 0; i++)
+		usleep(20000);
+	usleep(100000);
+	check(get("/prefetch", req) && req.cached, "prefetched entry not in the cache");
+	check(hits("/prefetch") == 1, "prefetched entry fetched again");
+
+	/* progress in the waiting thread */
+	progress p = { 0, true, 0 };
+	req = CHTTPRequest(url("/slow"));
+	req.cache = false;
+	req.progress = progress_cb;
+	req.progress_data = &p;
+	check(client->perform(req) && req.answer.size() == SLOW_SIZE, "slow download");
+	printf("progress: %d calls, last %d bytes\n", p.calls, (int) p.last);
+	check(p.calls > 0 && p.sane, "progress");
+
+	/* concurrent downloads */
+	download d[DOWNLOADS];
+	pthread_t t[DOWNLOADS];
+	int64_t dl_start = time_monotonic_ms();
+	for (int i = 0; i < DOWNLOADS; i++) {
+		char name[64];
+		snprintf(name, sizeof(name), "%s/big%d", dir, i);
+		d[i].file = name;
+		pthread_create(&t[i], NULL, download_thread, &d[i]);
+	}
+	for (int i = 0; i < DOWNLOADS; i++) {
+		pthread_join(t[i], NULL);
+		check(d[i].ok && d[i].size == BIG_SIZE, "concurrent download");
+	}
+	printf("%d downloads of %d KB in %d ms\n", DOWNLOADS, BIG_SIZE / 1024, (int) (time_monotonic_ms() - dl_start));
+
+	int total = 0;
+	pthread_mutex_lock(&server_mutex);
+	for (std::map<std::string, int>::iterator it = requests.begin(); it != requests.end(); ++it)
+		total += it->second;
+	int conns = connections;
+	pthread_mutex_unlock(&server_mutex);
+	printf("%d requests on %d connections, %d ms\n", total, conns, (int) (time_monotonic_ms() - start));
+	check(conns < total, "no connection reused");
+
+	client->clearCache();
+	rmdir(dir);
+	return check_result();
+}
@@ -0,0 +1,191 @@
+/*
+	Neutrino-GUI  -   DBoxII-Project
+
+	movie cut benchmark: writes a recording sized file and copies the span
+	a cut keeps with CCutWorker, with each copy method, like the movie
+	cutter does. reports the rate, checks the copied data and the cancel.
+	no hardware needed, run it on the local disk and on an NFS mount.
+
+	usage: moviecut_bench [dir [size_mb]]
+	  dir		directory for the test files, default /tmp
+	  size_mb	size of the recording, default 64. use a few GB to
+			measure, the page cache is dropped for the source
+
+	License: GPL
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <string>
+
+#include <driver/abstime.h>
+#include <driver/cutworker.h>
+#include "check.h"
+
+#define PACKET	188
+/* packets per write of the source */
+#define WRITE_PACKETS	5577
+
+/* every packet carries its number, so copied data can be checked anywhere */
+static void fill_packet(unsigned char *p, uint64_t num)
+{
+	memset(p, 0xff, PACKET);
+	p[0] = 0x47;
+	memcpy(p + 4, &num, sizeof(num));
+}
+
+static bool write_source(const std::string &name, off64_t size)
+{
+	int fd = open(name.c_str(), O_CREAT | O_TRUNC | O_WRONLY | O_LARGEFILE, 0644);
+	if (fd < 0) {
+		perror(name.c_str());
+		return false;
+	}
+	unsigned char * buf = new unsigned char[WRITE_PACKETS * PACKET];
+	uint64_t num = 0;
+	bool ok = true;
+	int64_t start = time_monotonic_ms();
+	for (off64_t done = 0; ok && done < size; ) {
+		int n = 0;
+		for (; n < WRITE_PACKETS && done + (n + 1) * PACKET <= size; n++)
+			fill_packet(buf + n * PACKET, num++);
+		if (!n)
+			break;
+		ok = write(fd, buf, n * PACKET) == n * PACKET;
+		done += n * PACKET;
+	}
+	ok = ok && !fsync(fd);
+	/* like a recording from yesterday, not in the page cache */
+	posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	close(fd);
+	delete[] buf;
+	int64_t ms = time_monotonic_ms() - start;
+	printf("source: %" PRId64 " MB written in %d ms (%" PRId64 " MB/s)\n", size >> 20, (int) ms,
+			ms ? (size >> 20) * 1000 / ms : 0);
+	return ok;
+}
+
+static bool packet_ok(int fd, off64_t num, uint64_t want_num)
+{
+	unsigned char p[PACKET], want[PACKET];
+	fill_packet(want, want_num);
+	return pread64(fd, p, PACKET, num * PACKET) == PACKET && !memcmp(p, want, PACKET);
+}
+
+/* packets of the copy at about 1000 places and at its end */
+static bool check_copy(const std::string &name, off64_t offset, off64_t len)
+{
+	int fd = open(name.c_str(), O_RDONLY | O_LARGEFILE);
+	if (fd < 0)
+		return false;
+	struct stat64 st;
+	bool ok = !fstat64(fd, &st) && st.st_size == len;
+	off64_t first = offset / PACKET;
+	off64_t packets = len / PACKET;
+	off64_t step = packets / 1000 + 1;
+	for (off64_t i = 0; ok && i < packets; i += step)
+		ok = packet_ok(fd, i, first + i);
+	if (ok && packets)
+		ok = packet_ok(fd, packets - 1, first + packets - 1);
+	close(fd);
+	return ok;
+}
+
+static void copy(const std::string &src, const std::string &dst, off64_t size, CCutWorker::copy_method_t method)
+{
+	const char * mname[] = { "copy_file_range", "splice", "read/write" };
+	int srcfd = open(src.c_str(), O_RDONLY | O_LARGEFILE);
+	int dstfd = open(dst.c_str(), O_CREAT | O_TRUNC | O_WRONLY | O_LARGEFILE, 0644);
+	if (srcfd < 0 || dstfd < 0) {
+		perror("moviecut_bench: open");
+		exit(CHECK_ERROR);
+	}
+	posix_fadvise(srcfd, 0, 0, POSIX_FADV_DONTNEED);
+	/* the span a cut keeps of the middle of the recording */
+	off64_t offset = size / 10 / PACKET * PACKET;
+	off64_t len = size * 8 / 10 / PACKET * PACKET;
+
+	CCutWorker worker;
+	worker.SetMethod(method);
+	int64_t start = time_monotonic_ms();
+	check(worker.Start(srcfd, dstfd, offset, len), "worker not started");
+	/* progress polling of the cutter */
+	while (worker.Running())
+		usleep(20000);
+	bool ok = worker.Wait();
+	int64_t copied_ms = time_monotonic_ms() - start;
+	ok = ok && !fsync(dstfd);
+	int64_t ms = time_monotonic_ms() - start;
+	printf("%-16s %" PRId64 " MB in %d ms, %d ms with fsync (%" PRId64 " MB/s)%s%s\n", mname[method], len >> 20,
+			(int) copied_ms, (int) ms, ms ? (len >> 20) * 1000 / ms : 0,
+			worker.Method() != method ? ", fell back to " : "",
+			worker.Method() != method ? mname[worker.Method()] : "");
+	check(ok, "copy failed");
+	check(worker.Copied() == len, "copied length");
+	close(srcfd);
+	close(dstfd);
+	check(check_copy(dst, offset, len), "copied data differs");
+	unlink(dst.c_str());
+}
+
+static void cancel(const std::string &src, const std::string &dst, off64_t size)
+{
+	int srcfd = open(src.c_str(), O_RDONLY | O_LARGEFILE);
+	int dstfd = open(dst.c_str(), O_CREAT | O_TRUNC | O_WRONLY | O_LARGEFILE, 0644);
+	if (srcfd < 0 || dstfd < 0)
+		exit(CHECK_ERROR);
+	posix_fadvise(srcfd, 0, 0, POSIX_FADV_DONTNEED);
+	CCutWorker worker;
+	/* small steps, the other methods may be done before the cancel */
+	worker.SetMethod(CCutWorker::COPY_RW);
+	int64_t start = time_monotonic_us();
+	worker.Start(srcfd, dstfd, 0, size);
+	worker.Cancel();
+	bool ok = worker.Wait();
+	printf("cancel: stopped after %" PRId64 " KB, %d us\n", worker.Copied() >> 10, (int) (time_monotonic_us() - start));
+	check(!ok, "cancel not reported");
+	check(worker.Copied() < size, "cancel did not stop the copy");
+	close(srcfd);
+	close(dstfd);
+	unlink(dst.c_str());
+}
+
+int main(int argc, char **argv)
+{
+	std::string dir = argc > 1 ? argv[1] : "/tmp";
+	off64_t size = (off64_t) (argc > 2 ? atoi(argv[2]) : 64) << 20;
+	char pid[32];
+	snprintf(pid, sizeof(pid), "%d", (int) getpid());
+	std::string src = dir + "/moviecut_bench_" + pid + ".ts";
+	std::string dst = dir + "/moviecut_bench_" + pid + "_cut.ts";
+
+	if (size < (1 << 20) || !write_source(src, size)) {
+		unlink(src.c_str());
+		return CHECK_ERROR;
+	}
+	copy(src, dst, size, CCutWorker::COPY_RANGE);
+	copy(src, dst, size, CCutWorker::COPY_SPLICE);
+	copy(src, dst, size, CCutWorker::COPY_RW);
+	cancel(src, dst, size);
+	unlink(src.c_str());
+	return check_result();
+}
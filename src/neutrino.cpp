@@ -43,6 +43,7 @@
 #include <dirent.h>
 
 #include <fstream>
+#include <algorithm>
 
 #include "global.h"
 #include "neutrino.h"
@@ -722,6 +723,7 @@ int CNeutrinoApp::loadSetup(const char * fname)
 		g_settings.network_nfs[i].mac = configfile.getString("network_nfs_mac_" + i_str, "11:22:33:44:55:66");
 	}
 	g_settings.network_nfs_audioplayerdir = configfile.getString( "network_nfs_audioplayerdir", "/media/hdd/music" );
+	g_settings.audioplayer_buffer = configfile.getInt32( "audioplayer_buffer", 2 );
 	g_settings.network_nfs_picturedir = configfile.getString( "network_nfs_picturedir", "/media/hdd/pictures" );
 	g_settings.network_nfs_moviedir = configfile.getString( "network_nfs_moviedir", "/media/hdd/movie" );
 	g_settings.network_nfs_recordingdir = configfile.getString( "network_nfs_recordingdir", "/media/hdd/movie" );
@@ -769,6 +771,7 @@ int CNeutrinoApp::loadSetup(const char * fname)
 	}
 	g_settings.record_hours = configfile.getInt32( "record_hours", 4 );
 	g_settings.timeshift_hours = configfile.getInt32( "timeshift_hours", 4 );
+	g_settings.timeshift_ring = configfile.getInt32( "timeshift_ring", 0 );
 	g_settings.filesystem_is_utf8              = configfile.getBool("filesystem_is_utf8"                 , true );
 
 	//recording (server + vcr)
@@ -846,6 +849,16 @@ int CNeutrinoApp::loadSetup(const char * fname)
 	}
 #endif
 
+	g_settings.xmltv_xml.clear();
+	int xmltv_count = configfile.getInt32("xmltv_xml_count", 0);
+	for (int i = 0; i < xmltv_count; i++) {
+		std::string k = "xmltv_xml_" + to_string(i);
+		std::string xmltv_xml = configfile.getString(k, "");
+		if (xmltv_xml.empty())
+			continue;
+		g_settings.xmltv_xml.push_back(xmltv_xml);
+	}
+
 	loadKeys();
 
 	g_settings.key_playbutton = configfile.getInt32("key_playbutton", 0);
@@ -1532,6 +1545,7 @@ void CNeutrinoApp::saveSetup(const char * fname)
 		configfile.setString(cfg_key, g_settings.network_nfs[i].mac);
 	}
 	configfile.setString( "network_nfs_audioplayerdir", g_settings.network_nfs_audioplayerdir);
+	configfile.setInt32( "audioplayer_buffer", g_settings.audioplayer_buffer );
 	configfile.setString( "network_nfs_picturedir", g_settings.network_nfs_picturedir);
 	configfile.setString( "network_nfs_moviedir", g_settings.network_nfs_moviedir);
 	configfile.setString( "network_nfs_recordingdir", g_settings.network_nfs_recordingdir);
@@ -1593,6 +1607,14 @@ void CNeutrinoApp::saveSetup(const char * fname)
 	}
 	configfile.setInt32 ( "webradio_xml_count", g_settings.webradio_xml.size());
 
+	int xmltv_count = 0;
+	for (std::list<std::string>::iterator it = g_settings.xmltv_xml.begin(); it != g_settings.xmltv_xml.end(); ++it) {
+		std::string k = "xmltv_xml_" + to_string(xmltv_count);
+		configfile.setString(k, *it);
+		xmltv_count++;
+	}
+	configfile.setInt32 ( "xmltv_xml_count", g_settings.xmltv_xml.size());
+
 	saveKeys();
 
 	configfile.setInt32 ("key_playbutton", g_settings.key_playbutton );
@@ -1602,6 +1624,7 @@ void CNeutrinoApp::saveSetup(const char * fname)
 	configfile.setInt32( "auto_delete", g_settings.auto_delete );
 	configfile.setInt32( "record_hours", g_settings.record_hours );
 	configfile.setInt32( "timeshift_hours", g_settings.timeshift_hours );
+	configfile.setInt32( "timeshift_ring", g_settings.timeshift_ring );
 	//printf("set: key_unlock =============== %d\n", g_settings.key_unlock);
 	configfile.setInt32( "screenshot_count", g_settings.screenshot_count );
 	configfile.setInt32( "screenshot_cover", g_settings.screenshot_cover );
@@ -2030,6 +2053,7 @@ void CNeutrinoApp::channelsInit(bool bOnly)
 
 	SetChannelMode(lastChannelMode);
 	CEpgScan::getInstance()->ConfigureEIT();
+	xmltvInit();
 
 	dprintf(DEBUG_DEBUG, "\nAll bouquets-channels received\n");
 }
@@ -2264,6 +2288,28 @@ void CNeutrinoApp::SendSectionsdConfig(void)
 	g_Sectionsd->setConfig(config);
 }
 
+/* web channels with an XMLTV id get their EPG from the guide files */
+void CNeutrinoApp::xmltvInit()
+{
+	xmltv_channel_map_t channels;
+	ZapitChannelList list, radiolist;
+	CServiceManager::getInstance()->GetAllWebTVChannels(list);
+	CServiceManager::getInstance()->GetAllWebRadioChannels(radiolist);
+	list.insert(list.end(), radiolist.begin(), radiolist.end());
+
+	for (zapit_list_it_t it = list.begin(); it != list.end(); ++it) {
+		std::string id = (*it)->getXMLTVid();
+		if (id.empty())
+			continue;
+		if (id == "auto") {
+			id = (*it)->getName();
+			std::transform(id.begin(), id.end(), id.begin(), ::tolower);
+		}
+		channels[id] = (*it)->getEpgID();
+	}
+	CEitManager::getInstance()->setXMLTV(g_settings.xmltv_xml, channels);
+}
+
 void CNeutrinoApp::InitZapper()
 {
 	struct stat my_stat;
@@ -2463,7 +2509,9 @@ TIMER_START();
 
 	g_Locale        = new CLocaleManager;
 
+	int64_t load_start = time_monotonic_ms();
 	int loadSettingsErg = loadSetup(NEUTRINO_SETTINGS_FILE);
+	dprintf(DEBUG_NORMAL, "loading settings took %" PRId64 " ms\n", time_monotonic_ms() - load_start);
 #if HAVE_SH4_HARDWARE
 	cpuFreq = new cCpuFreqManager();
 	cpuFreq->SetCpuFreq(g_settings.cpufreq * 1000 * 1000);
@@ -2476,12 +2524,14 @@ TIMER_START();
 
 	initialize_iso639_map();
 
+	load_start = time_monotonic_ms();
 	CLocaleManager::loadLocale_ret_t loadLocale_ret = g_Locale->loadLocale(g_settings.language.c_str());
 	if (loadLocale_ret == CLocaleManager::NO_SUCH_LOCALE)
 	{
 		g_settings.language = "deutsch";
 		g_Locale->loadLocale(g_settings.language.c_str());
 	}
+	dprintf(DEBUG_NORMAL, "loading locale %s took %" PRId64 " ms\n", g_settings.language.c_str(), time_monotonic_ms() - load_start);
 
 	// default usermenu titles correspond to gui/user_menue_setup.h:struct usermenu_props_t usermenu
 	if (g_settings.usermenu[0]->title.empty() && !g_settings.usermenu[0]->items.empty())
@@ -2497,6 +2547,7 @@ TIMER_START();
 	neutrinoFonts = CNeutrinoFonts::getInstance();
 	SetupFonts();
 	g_PicViewer = new CPictureViewer();
+	g_PicViewer->StartLogoThread();
 	CColorSetupNotifier::setPalette();
 
 	char start_text [100];
@@ -197,6 +197,7 @@ public:
 	int recordingstatus;
 	void MakeSectionsdConfig(CSectionsdClient::epg_config& config);
 	void SendSectionsdConfig(void);
+	void xmltvInit(void);
 	int GetChannelMode(void) {
 		return lastChannelMode;
 	};
@@ -12,6 +12,7 @@
 #include <string>
 #include <fstream>
 #include <map>
+#include <set>
 // system
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -29,9 +30,11 @@
 #include <neutrinoMessages.h>
 #include <zapit/client/zapittools.h>
 #include <zapit/zapit.h>
+#include <zapit/fesampler.h>
 #include <eitd/sectionsd.h>
 #include <configfile.h>
 #include <system/configure_network.h>
+#include <system/metrics.h>
 #include <cs_api.h>
 #include <global.h>
 #include <neutrino.h>
@@ -52,6 +55,7 @@ extern CPictureViewer *g_PicViewer;
 #include "controlapi.h"
 #include <video.h>
 #include <zapit/femanager.h>
+#include <driver/scanepg.h>
 
 extern cVideo * videoDecoder;
 
@@ -177,6 +181,7 @@ const CControlAPI::TyCgiCall CControlAPI::yCgiCallList[]=
 	{"epg",			&CControlAPI::EpgCGI,			""},
 	{"zapto",		&CControlAPI::ZaptoCGI,			"text/plain"},
 	{"signal",		&CControlAPI::SignalInfoCGI,		"text/plain"},
+	{"metrics",		&CControlAPI::MetricsCGI,		""},
 	{"getonidsid",		&CControlAPI::GetChannelIDCGI,		"text/plain"},
 	{"getchannelid",	&CControlAPI::GetChannelIDCGI,		""},
 	{"getepgid",		&CControlAPI::GetEpgIDCGI,		""},
@@ -229,6 +234,8 @@ const CControlAPI::TyCgiCall CControlAPI::yCgiCallList[]=
 	// xmltv
 	{"xmltv.data",		&CControlAPI::xmltvepgCGI,		"+xml"},
 	{"xmltv.m3u",		&CControlAPI::xmltvm3uCGI,		""},
+	{"epgdump",		&CControlAPI::EpgDumpCGI,		""},
+	{"epgscan",		&CControlAPI::EpgScanCGI,		""},
 	// utils
 	{"build_live_url",	&CControlAPI::build_live_url,		""},
 	{"build_playlist",	&CControlAPI::build_playlist,		""},
@@ -1584,7 +1591,6 @@ void CControlAPI::GetBouquetsCGI(CyhookHandler *hh)
 {
 	bool show_hidden = true;
 	bool encode = false;
-	std::string result = "";
 
 	TOutType outType = hh->outStart();
 
@@ -1605,9 +1611,12 @@ void CControlAPI::GetBouquetsCGI(CyhookHandler *hh)
 		mode = CZapitClient::MODE_TV;
 	else if (hh->ParamList["mode"].compare("RADIO") == 0)
 		mode = CZapitClient::MODE_RADIO;
- 
+
+	hh->StreamResultStart();
+	hh->StreamWrite(hh->outArrayOpen("bouquets"));
 	std::string bouquet;
-	for (int i = 0, size = (int) g_bouquetManager->Bouquets.size(); i < size; i++) {
+	bool first = true;
+	for (int i = 0, size = (int) g_bouquetManager->Bouquets.size(); i < size && !hh->StreamCanceled(); i++) {
 		std::string item = "";
 		unsigned int channel_count = 0;
 		switch (mode) {
@@ -1631,12 +1640,14 @@ void CControlAPI::GetBouquetsCGI(CyhookHandler *hh)
 				item = hh->outPair("number", string_printf("%u", i + 1), true);
 				item += hh->outPair("name", bouquet, false);
 			}
-			result += hh->outArrayItem("bouquet", item, (i < size-1));
+			if (!first)
+				hh->StreamWrite(hh->outNext());
+			first = false;
+			hh->StreamWrite(hh->outArrayItem("bouquet", item, false));
 		}
 	}
-	result = hh->outArray("bouquets", result);
-
-	hh->SendResult(result);
+	hh->StreamWrite(hh->outArrayClose("bouquets"));
+	hh->StreamResultEnd();
 }
 //-----------------------------------------------------------------------------
 //	details EPG Information for channelid
@@ -1760,7 +1771,8 @@ void CControlAPI::epgDetailList(CyhookHandler *hh)
 
 	// ------ generate output ------
 	hh->outStart(true /*old mode*/);
-	std::string result = "";
+	hh->StreamResultStart();
+	hh->StreamWrite(hh->outObjectOpen("epglist"));
 
 	if (bouquetnr >= 0 || all_bouquets) {
 		int bouquet_size = (int) g_bouquetManager->Bouquets.size();
@@ -1774,33 +1786,30 @@ void CControlAPI::epgDetailList(CyhookHandler *hh)
 		ZapitChannelList channels;
 		int mode = NeutrinoAPI->Zapit->getMode();
 
-		for (int i = start_bouquet; i < bouquet_size; i++) {
+		for (int i = start_bouquet; i < bouquet_size && !hh->StreamCanceled(); i++) {
 			channels = mode == CZapitClient::MODE_RADIO ? g_bouquetManager->Bouquets[i]->radioChannels : g_bouquetManager->Bouquets[i]->tvChannels;
 			std::string bouquet = std::string(g_bouquetManager->Bouquets[i]->bFav ? g_Locale->getText(LOCALE_FAVORITES_BOUQUETNAME) : g_bouquetManager->Bouquets[i]->Name.c_str());
 			bouquet = encodeString(bouquet); // encode (URLencode) the bouquetname
-			std::string res_channels = "";
 
-			for (int j = 0, csize = (int) channels.size(); j < csize; j++) {
-				CZapitChannel * channel = channels[j];
-				res_channels += hh->outArrayItem("channel", channelEPGformated(hh, j + 1, channel->getChannelID(), max, stoptime), j<csize-1);
-			}
 			if(all_bouquets) {
-				res_channels = hh->outPair("number", string_printf("%d", i + 1), true) +
-						hh->outPair("name", hh->outValue(bouquet), true) +
-						res_channels;
-				result += hh->outArrayItem("bouquet", res_channels, i < bouquet_size-1);
+				hh->StreamWrite(hh->outArrayItemOpen("bouquet"));
+				hh->StreamWrite(hh->outPair("number", string_printf("%d", i + 1), true));
+				hh->StreamWrite(hh->outPair("name", hh->outValue(bouquet), true));
 			}
-			else
-				result += res_channels;
+			for (int j = 0, csize = (int) channels.size(); j < csize && !hh->StreamCanceled(); j++) {
+				CZapitChannel * channel = channels[j];
+				hh->StreamWrite(hh->outArrayItem("channel", channelEPGformated(hh, j + 1, channel->getChannelID(), max, stoptime), j<csize-1));
+			}
+			if(all_bouquets)
+				hh->StreamWrite(hh->outArrayItemClose("bouquet", i < bouquet_size-1));
 		}
 	}
 	else
 		// list one channel, no bouquetnr given
-		result = channelEPGformated(hh, 0, channel_id, max, stoptime);
-
-	result = hh->outObject("epglist", result);
+		hh->StreamWrite(channelEPGformated(hh, 0, channel_id, max, stoptime));
 
-	hh->SendResult(result);
+	hh->StreamWrite(hh->outObjectClose("epglist"));
+	hh->StreamResultEnd();
 }
 //-------------------------------------------------------------------------------------------------
 inline static bool sortByDateTime (const CChannelEvent& a, const CChannelEvent& b)
@@ -1908,7 +1917,9 @@ void CControlAPI::SendFoundEvents(CyhookHandler *hh, bool xml_format)
 	std::string genre;
 	CChannelEventList::iterator eventIterator;
 	unsigned int u_azeit = ( azeit > -1)? azeit:0;
-	for (eventIterator = evtlist.begin(); eventIterator != evtlist.end(); ++eventIterator)
+	hh->StreamResultStart();
+	hh->StreamWrite(hh->outArrayOpen("epgsearch"));
+	for (eventIterator = evtlist.begin(); eventIterator != evtlist.end() && !hh->StreamCanceled(); ++eventIterator)
 	{
 		bool got_next = (eventIterator != (evtlist.end() - 1));
 		if (CEitManager::getInstance()->getEPGidShort(eventIterator->eventID, &epg))
@@ -1954,7 +1965,7 @@ void CControlAPI::SendFoundEvents(CyhookHandler *hh, bool xml_format)
 				item += hh->outPair("epg_id", string_printf(PRINTF_CHANNEL_ID_TYPE_NO_LEADING_ZEROS, epg_id), true);
 				item += hh->outPair("eventid", string_printf("%llu", eventIterator->eventID), false);
 
-				result += hh->outArrayItem("item", item, got_next);
+				hh->StreamWrite(hh->outArrayItem("item", item, got_next));
 			}
 			else // outType == plain
 			{
@@ -1991,12 +2002,13 @@ void CControlAPI::SendFoundEvents(CyhookHandler *hh, bool xml_format)
 						result += hh->outSingle(ZapitTools::UTF8_to_UTF8XML(genre.c_str()));
 				}
 				result += hh->outSingle("----------------------------------------------------------");
+				hh->StreamWrite(result);
+				result.clear();
 			}
 		}
 	}
-	result = hh->outArray("epgsearch", result);
-
-	hh->SendResult(result);
+	hh->StreamWrite(hh->outArrayClose("epgsearch"));
+	hh->StreamResultEnd();
 }
 
 //-------------------------------------------------------------------------
@@ -2034,21 +2046,23 @@ void CControlAPI::EpgCGI(CyhookHandler *hh)
 		NeutrinoAPI->GetChannelEvents();
 
 		int mode = NeutrinoAPI->Zapit->getMode();
+		hh->StreamStart();
 		CBouquetManager::ChannelIterator cit = mode == CZapitClient::MODE_RADIO ? g_bouquetManager->radioChannelsBegin() : g_bouquetManager->tvChannelsBegin();
-		for (; !(cit.EndOfChannels()); cit++) {
+		for (; !(cit.EndOfChannels()) && !hh->StreamCanceled(); cit++) {
 			CZapitChannel * channel = *cit;
 			NeutrinoAPI->GetChannelEvent(channel->getChannelID(), event);
 			if (event.eventID) {
 				if (!isExt) {
-					hh->printf(PRINTF_CHANNEL_ID_TYPE_NO_LEADING_ZEROS
-					" %llu %s\n", channel->getChannelID(), event.eventID, event.description.c_str());
+					hh->StreamWrite(string_printf(PRINTF_CHANNEL_ID_TYPE_NO_LEADING_ZEROS
+					" %llu %s\n", channel->getChannelID(), event.eventID, event.description.c_str()));
 				}
 				else { // ext output
-					hh->printf(PRINTF_CHANNEL_ID_TYPE_NO_LEADING_ZEROS
-					" %ld %u %llu %s\n", channel->getChannelID(), event.startTime, event.duration, event.eventID, event.description.c_str());
+					hh->StreamWrite(string_printf(PRINTF_CHANNEL_ID_TYPE_NO_LEADING_ZEROS
+					" %ld %u %llu %s\n", channel->getChannelID(), event.startTime, event.duration, event.eventID, event.description.c_str()));
 				}
 			}
 		}
+		hh->StreamEnd();
 	}
 	else if (!hh->ParamList["search"].empty())
 	{
@@ -2337,39 +2351,141 @@ void CControlAPI::SendChannelList(CyhookHandler *hh, bool currentTP)
 }
 
 //-----------------------------------------------------------------------------
+/** Display the signal values of the live frontend
+ * @param hh CyhookHandler
+ *
+ * @par nhttpd-usage
+ * @code
+ * /control/signal[?sig|snr|ber][&window=<seconds>]
+ * @endcode
+ *
+ * @par output (window=60)
+ * @code
+ * SIG:  71  73  74
+ * SNR:  55  58  60
+ * BER:   0   2  40
+ * UNC: 0
+ * UNLOCKED: 0/120
+ * @endcode
+ * with window, min, avg and max of the samples of the last seconds are shown,
+ * as far as the frontend sampler has them (e.g. while the infobar shows the
+ * signal). sig and snr are in percent.
+ */
 void CControlAPI::SignalInfoCGI(CyhookHandler *hh)
 {
 	CFrontend *frontend = CFEManager::getInstance()->getLiveFE();
 	if(frontend){
 		bool parame_empty = false;
 
-		if (hh->ParamList["1"].empty())
+		if (hh->ParamList["1"].empty() || hh->ParamList["1"] == "window")
 			parame_empty = true;
 
+		CFESampler *sampler = frontend->getSampler();
+		fe_sample_t s = sampler->getLast();
+		fe_sample_stats_t st;
+		int window = atoi(hh->ParamList["window"].c_str());
+		bool stats = (window > 0) && sampler->getStats(window * 1000, st);
+
 		if ( parame_empty || (hh->ParamList["1"] == "sig") ){
-			unsigned int sig = frontend->getSignalStrength() & 0xFFFF;
-			sig = (sig & 0xFFFF) * 100 / 65535;
 			if (parame_empty)
 				hh->printf("SIG: ");
-			hh->printf("%3u\n", sig);
+			if (stats)
+				hh->printf("%3u %3u %3u\n", st.sig_min * 100 / 65535, st.sig_avg * 100 / 65535, st.sig_max * 100 / 65535);
+			else
+				hh->printf("%3u\n", (s.sig & 0xFFFF) * 100 / 65535);
 		}
 		if ( parame_empty || (hh->ParamList["1"] == "snr") ){
-			unsigned int snr = frontend->getSignalNoiseRatio() & 0xFFFF;
-			snr = (snr & 0xFFFF) * 100 / 65535;
 			if (parame_empty)
 				hh->printf("SNR: ");
-			hh->printf("%3u\n", snr);
+			if (stats)
+				hh->printf("%3u %3u %3u\n", st.snr_min * 100 / 65535, st.snr_avg * 100 / 65535, st.snr_max * 100 / 65535);
+			else
+				hh->printf("%3u\n", (s.snr & 0xFFFF) * 100 / 65535);
 		}
 		if ( parame_empty || (hh->ParamList["1"] == "ber") ){
-			unsigned int ber = frontend->getBitErrorRate();
 			if (parame_empty)
 				hh->printf("BER: ");
-			hh->printf("%3u\n", ber);
+			if (stats)
+				hh->printf("%3u %3u %3u\n", st.ber_min, st.ber_avg, st.ber_max);
+			else
+				hh->printf("%3u\n", s.ber);
+		}
+		if (parame_empty && stats) {
+			hh->printf("UNC: %u\n", st.unc);
+			hh->printf("UNLOCKED: %d/%d\n", st.unlocked, st.count);
 		}
 	}else
 		hh->SendError();
 }
 
+//-----------------------------------------------------------------------------
+/** Runtime counters and latencies
+ * @param hh CyhookHandler
+ *
+ * @par nhttpd-usage
+ * @code
+ * /control/metrics[?enable=1|0][&reset=1][&format=|xml|json]
+ * @endcode
+ *
+ * @par output (format=json)
+ * @code
+ * {"success": "true", "data":{"metrics": {
+ * 	"enabled": "true",
+ * 	"uptime": "3605",
+ * 	"counters": {"eit_sections": "48211", "eit_events": "9120", ...},
+ * 	"latency": {
+ * 		"zap_time": {"count": "12", "avg": "842000", "max": "1630000",
+ * 			"p50": "1048575", "p90": "1630000", "p99": "1630000"},
+ * 		...
+ * 	}
+ * }}}
+ * @endcode
+ * uptime is in seconds since metrics were enabled or reset, latencies are in
+ * microseconds. the percentiles are the upper bound of a power of two bucket.
+ * metrics are off by default, enable=1 or NEUTRINO_METRICS in the environment
+ * switches them on.
+ */
+void CControlAPI::MetricsCGI(CyhookHandler *hh)
+{
+	if (!hh->ParamList["enable"].empty())
+		Metrics::enable(hh->ParamList["enable"] == "1" || hh->ParamList["enable"] == "true");
+	if (hh->ParamList["reset"] == "1" || hh->ParamList["reset"] == "true")
+		Metrics::reset();
+
+	hh->outStart();
+
+	std::string item = "";
+	item += hh->outPair("enabled", metrics_enabled ? "true" : "false", true);
+	item += hh->outPair("uptime", string_printf("%lld", (long long) Metrics::uptime()), true);
+
+	std::string counters = "";
+	for (int i = 0; i < METRIC_COUNTER_MAX; i++) {
+		metric_counter_t id = (metric_counter_t) i;
+		counters += hh->outPair(Metrics::counterName(id),
+				string_printf("%llu", (unsigned long long) Metrics::getCounter(id)),
+				i < METRIC_COUNTER_MAX - 1);
+	}
+	item += hh->outObject("counters", counters, true);
+
+	std::string latency = "";
+	for (int i = 0; i < METRIC_LATENCY_MAX; i++) {
+		metric_latency_t id = (metric_latency_t) i;
+		metric_latency_stats_t st;
+		Metrics::getLatency(id, st);
+		std::string l = "";
+		l += hh->outPair("count", string_printf("%llu", (unsigned long long) st.count), true);
+		l += hh->outPair("avg", string_printf("%llu", (unsigned long long) (st.count ? st.sum / st.count : 0)), true);
+		l += hh->outPair("max", string_printf("%llu", (unsigned long long) st.max), true);
+		l += hh->outPair("p50", string_printf("%llu", (unsigned long long) st.p50), true);
+		l += hh->outPair("p90", string_printf("%llu", (unsigned long long) st.p90), true);
+		l += hh->outPair("p99", string_printf("%llu", (unsigned long long) st.p99), false);
+		latency += hh->outObject(Metrics::latencyName(id), l, i < METRIC_LATENCY_MAX - 1);
+	}
+	item += hh->outObject("latency", latency);
+
+	hh->SendResult(hh->outObject("metrics", item));
+}
+
 //-----------------------------------------------------------------------------
 void CControlAPI::SendStreamInfo(CyhookHandler *hh)
 {
@@ -3216,15 +3332,19 @@ void CControlAPI::xmltvepgCGI(CyhookHandler *hh)
 	hh->outStart();
 
 	t_channel_id channel_id;
-	std::string result = "";
 	std::string channelTag = "", channelData = "";
 	std::string programmeTag = "", programmeData = "";
+	const std::string tvTag = "tv generator-info-name=\"Neutrino XMLTV Generator v1.0\"";
 
 	ZapitChannelList chanlist;
 	CChannelEventList eList;
 	CChannelEventList::iterator eventIterator;
 
-	for (int i = 0; i < (int) g_bouquetManager->Bouquets.size(); i++)
+	hh->StreamResultStart();
+	hh->StreamWrite("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<!DOCTYPE tv SYSTEM \"xmltv.dtd\">\n");
+	hh->StreamWrite(hh->outObjectOpen(tvTag));
+
+	for (int i = 0; i < (int) g_bouquetManager->Bouquets.size() && !hh->StreamCanceled(); i++)
 	{
 		if (mode == CZapitClient::MODE_RADIO)
 			g_bouquetManager->Bouquets[i]->getRadioChannels(chanlist);
@@ -3238,7 +3358,7 @@ void CControlAPI::xmltvepgCGI(CyhookHandler *hh)
 				channel_id = channel->getChannelID() & 0xFFFFFFFFFFFFULL;
 				channelTag = "channel id=\""+string_printf(PRINTF_CHANNEL_ID_TYPE_NO_LEADING_ZEROS, channel_id)+"\"";
 				channelData = hh->outPair("display-name", hh->outValue(channel->getName()), true);
-				result += hh->outObject(channelTag, channelData);
+				hh->StreamWrite(hh->outObject(channelTag, channelData));
 
 				eList.clear();
 
@@ -3268,21 +3388,119 @@ void CControlAPI::xmltvepgCGI(CyhookHandler *hh)
 						programmeData  = hh->outPair("title lang=\"de\"", hh->outValue(eventIterator->description), false);
 						programmeData += hh->outPair("desc lang=\"de\"", hh->outValue(eventIterator->text), true);
 
-						result += hh->outArrayItem(programmeTag, programmeData, false);
+						hh->StreamWrite(hh->outArrayItem(programmeTag, programmeData, false));
 					}
 				}
 			}
 		}
 	}
 
+	hh->StreamWrite(hh->outObjectClose(tvTag));
+	hh->StreamResultEnd();
+}
 
-	result = hh->outObject("tv generator-info-name=\"Neutrino XMLTV Generator v1.0\"", result);
-
-	result = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<!DOCTYPE tv SYSTEM \"xmltv.dtd\">\n" + result;
+//-------------------------------------------------------------------------
+/** Display the state of the background EPG scan
+ * @param hh CyhookHandler
+ *
+ * @par nhttpd-usage
+ * @code
+ * /control/epgscan[?format=plain|json|xml]
+ * @endcode
+ *
+ * @par output (json)
+ * @code
+ * {"epgscan": {"pending": 3, "scanned": 12, "early": 9, "skipped": 20,
+ *   "failed": 0, "channels": 310, "covered": 280, "empty": 14,
+ *   "scans": 2, "current": "3ee0001 4440001", "next_rescan": 1700000000}}
+ * @endcode
+ * covered are the channels with EPG until the next rescan plus 12 hours.
+ * current are the transponders scanned now, one per free tuner.
+ */
+//-----------------------------------------------------------------------------
+void CControlAPI::EpgScanCGI(CyhookHandler *hh)
+{
+	epgscan_stats_t stats;
+	CEpgScan::getInstance()->GetStats(stats);
 
+	hh->outStart();
+	std::string result;
+	result  = hh->outPair("pending", string_printf("%u", stats.pending), true);
+	result += hh->outPair("scanned", string_printf("%u", stats.scanned), true);
+	result += hh->outPair("early", string_printf("%u", stats.early), true);
+	result += hh->outPair("skipped", string_printf("%u", stats.skipped), true);
+	result += hh->outPair("failed", string_printf("%u", stats.failed), true);
+	result += hh->outPair("channels", string_printf("%u", stats.channels), true);
+	result += hh->outPair("covered", string_printf("%u", stats.covered), true);
+	result += hh->outPair("empty", string_printf("%u", stats.empty), true);
+	std::string current;
+	for (unsigned int i = 0; i < stats.current.size(); i++)
+		current += string_printf(i ? " %" PRIx64 : "%" PRIx64, stats.current[i]);
+	result += hh->outPair("scans", string_printf("%u", (unsigned int) stats.current.size()), true);
+	result += hh->outPair("current", current, true);
+	result += hh->outPair("next_rescan", string_printf("%ld", (long)stats.next_rescan), false);
+	result = hh->outObject("epgscan", result);
 	hh->SendResult(result);
 }
 
+//-----------------------------------------------------------------------------
+// EPG of all channels, or of a bouquet, for clients which mirror it.
+// Param: since=<version of the last dump>, bouquet=<nr>
+// Output: JSON lines, first {"version": .., "full": ..}, then the deleted
+// events, then the added or changed ones. With full=true the client drops
+// its copy before, ended events are not reported as deleted.
+//-----------------------------------------------------------------------------
+#define EPGDUMP_BLOCK 500
+void CControlAPI::EpgDumpCGI(CyhookHandler *hh)
+{
+	unsigned int since = 0;
+	if (!hh->ParamList["since"].empty())
+		since = strtoul(hh->ParamList["since"].c_str(), NULL, 10);
+
+	std::set<t_channel_id> channels;
+	if (!hh->ParamList["bouquet"].empty()) {
+		int BouquetNr = atoi(hh->ParamList["bouquet"].c_str()) - 1;
+		if (BouquetNr < 0 || BouquetNr >= (int) g_bouquetManager->Bouquets.size()) {
+			hh->SetError(HTTP_NOT_FOUND);
+			return;
+		}
+		ZapitChannelList chanlist;
+		if (NeutrinoAPI->Zapit->getMode() == CZapitClient::MODE_RADIO)
+			g_bouquetManager->Bouquets[BouquetNr]->getRadioChannels(chanlist);
+		else
+			g_bouquetManager->Bouquets[BouquetNr]->getTvChannels(chanlist);
+		for (ZapitChannelList::iterator it = chanlist.begin(); it != chanlist.end(); ++it)
+			channels.insert((*it)->getEpgID() & 0xFFFFFFFFFFFFULL);
+		/* an empty set would mean all channels */
+		if (channels.empty())
+			channels.insert(0);
+	}
+
+	hh->SetHeader(HTTP_OK, "application/x-ndjson; charset=UTF-8");
+	hh->StreamStart();
+
+	bool full;
+	std::vector<event_id_t> deleted;
+	unsigned int version = CEitManager::getInstance()->getDeletedEvents(since, deleted, full);
+	hh->StreamWrite(string_printf("{\"version\": %u, \"full\": %s}\n", version, full ? "true" : "false"));
+	for (std::vector<event_id_t>::iterator it = deleted.begin(); it != deleted.end(); ++it)
+		hh->StreamWrite(string_printf("{\"deleted\": \"%llu\"}\n", (unsigned long long) *it));
+
+	event_id_t start = 0;
+	bool more = true;
+	CChannelEventList eList;
+	while (more && !hh->StreamCanceled()) {
+		eList.clear();
+		more = CEitManager::getInstance()->getChangedEvents(full ? 0 : since, channels, start, EPGDUMP_BLOCK, eList);
+		for (CChannelEventList::iterator e = eList.begin(); e != eList.end(); ++e)
+			hh->StreamWrite(string_printf("{\"id\": \"%llu\", \"channel\": \"" PRINTF_CHANNEL_ID_TYPE_NO_LEADING_ZEROS "\", "
+				"\"start\": %ld, \"duration\": %u, \"title\": \"%s\", \"text\": \"%s\"}\n",
+				(unsigned long long) e->eventID, e->channelID, (long) e->startTime, e->duration,
+				json_convert_string(e->description).c_str(), json_convert_string(e->text).c_str()));
+	}
+	hh->StreamEnd();
+}
+
 void CControlAPI::xmltvm3uCGI(CyhookHandler *hh)
 {
     hh->outStart();
@@ -127,6 +127,8 @@ private:
 	void changeBouquetCGI(CyhookHandler *hh);
 	void updateBouquetCGI(CyhookHandler *hh);
 	void xmltvepgCGI(CyhookHandler *hh);
+	void EpgDumpCGI(CyhookHandler *hh);
+	void EpgScanCGI(CyhookHandler *hh);
 	void xmltvm3uCGI(CyhookHandler *hh);
 	void build_live_url(CyhookHandler *hh);
 	void build_playlist(CyhookHandler *hh);
@@ -135,6 +137,7 @@ private:
 	void FileCGI(CyhookHandler *hh);
 	void StatfsCGI(CyhookHandler *hh);
 	void SignalInfoCGI(CyhookHandler *hh);
+	void MetricsCGI(CyhookHandler *hh);
 	void getDirCGI(CyhookHandler *hh);
 	void getMoviesCGI(CyhookHandler *hh);
 	std::string readMovies(CyhookHandler *hh, std::string path, std::string result, bool subdirs);
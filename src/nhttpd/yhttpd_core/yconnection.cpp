@@ -11,6 +11,7 @@
 #include <yconfig.h>
 #include "yconnection.h"
 #include "helper.h"
+#include <system/metrics.h>
 //=============================================================================
 // Initialization of static variables
 //=============================================================================
@@ -114,6 +115,9 @@ void CWebserverConnection::HandleConnection() {
 		log_level_printf(1, "enlapsed time request:%ld response:%ld url:%s\n",
 				enlapsed_request, enlapsed_response,
 				(Request.UrlData["fullurl"]).c_str());
+		METRIC_ADD(METRIC_HTTP_REQUESTS, 1);
+		if (enlapsed_request + enlapsed_response > 0)
+			METRIC_TIME(METRIC_HTTP_TIME, enlapsed_request + enlapsed_response);
 
 	} else {
 		RequestCanceled = true;
@@ -31,6 +31,10 @@ CyhookHandler::CyhookHandler()
 	outType = plain;
 	nonPair = false;
 	LastModified=0;
+	streamSink = NULL;
+	streamChunked = false;
+	streaming = false;
+	streamFailed = false;
 }
 
 CyhookHandler::~CyhookHandler()
@@ -201,6 +205,8 @@ void CyhookHandler::session_init(CStringList _ParamList, CStringList _UrlData,
 	ContentLength = 0;
 	LastModified = (time_t) - 1;
 	keep_alive = _keep_alive;
+	streaming = false;
+	streamFailed = false;
 	HookVarList.clear();
 }
 
@@ -318,6 +324,11 @@ std::string CyhookHandler::BuildHeader(bool cache) {
 		// content-len, last-modified
 		if (httpStatus == HTTP_NOT_MODIFIED || httpStatus == HTTP_NOT_FOUND || httpStatus == HTTP_REQUEST_RANGE_NOT_SATISFIABLE)
 			result += "Content-Length: 0\r\n";
+		else if (status == HANDLED_STREAMED) {
+			// length unknown: chunked or until connection close
+			if (streamChunked)
+				result += "Transfer-Encoding: chunked\r\n";
+		}
 		else if (GetContentLength() > 0) {
 			time_t mod_time = time(NULL);
 			if (LastModified != (time_t) - 1)
@@ -468,73 +479,96 @@ std::string CyhookHandler::outPair(std::string _key, std::string _content, bool
 
 //-----------------------------------------------------------------------------
 std::string CyhookHandler::outArray(std::string _key, std::string _content, bool _next) {
-	std::string result = "", _key_close = "", tmp;
-	ySplitString(_key, " ", _key_close, tmp);
+	return outArrayOpen(_key) + _content + outArrayClose(_key, _next);
+}
+
+//-----------------------------------------------------------------------------
+std::string CyhookHandler::outArrayItem(std::string _key, std::string _content, bool _next) {
+	return outArrayItemOpen(_key) + _content + outArrayItemClose(_key, _next);
+}
+//-----------------------------------------------------------------------------
+std::string CyhookHandler::outObject(std::string _key, std::string _content, bool _next) {
+	return outObjectOpen(_key) + _content + outObjectClose(_key, _next);
+}
+
+//-----------------------------------------------------------------------------
+std::string CyhookHandler::outArrayOpen(std::string _key) {
 	switch (outType) {
 	case xml:
 		//TODO: xml check and DESC check
-		result = outIndent() + "<" + _key + ">\n" + _content + "</" + _key_close + ">";
-		result += "\n";
-		break;
+		return outIndent() + "<" + _key + ">\n";
 	case json:
 		//TODO: json check
-		result = outIndent() + "\"" + _key + "\": [" + _content + "]";
-		if(_next)
-			result += ",";
-		result += "\n";
-		break;
+		return outIndent() + "\"" + _key + "\": [";
 	default:
-		result = _content;
-		break;
+		return "";
 	}
-	return result;
 }
 
 //-----------------------------------------------------------------------------
-std::string CyhookHandler::outArrayItem(std::string _key, std::string _content, bool _next) {
-	std::string result = "", _key_close = "", tmp;
+std::string CyhookHandler::outArrayClose(std::string _key, bool _next) {
+	std::string _key_close = "", tmp;
 	ySplitString(_key, " ", _key_close, tmp);
 	switch (outType) {
 	case xml:
-		//TODO: xml check and DESC check
-		result = outIndent() + "<" + _key + ">\n" + _content + "</" + _key_close + ">";
-		result += "\n";
-		break;
+		return "</" + _key_close + ">\n";
 	case json:
-		//TODO: json check
-		result = outIndent() + "{" + _content + "}";
-		if(_next)
-			result += ",";
-		result += "\n";
-		break;
+		return _next ? "],\n" : "]\n";
 	default:
-		result = _content;
-		break;
+		return "";
 	}
-	return result;
 }
+
 //-----------------------------------------------------------------------------
-std::string CyhookHandler::outObject(std::string _key, std::string _content, bool _next) {
-	std::string result = "", _key_close = "", tmp;
+std::string CyhookHandler::outArrayItemOpen(std::string _key) {
+	switch (outType) {
+	case xml:
+		return outIndent() + "<" + _key + ">\n";
+	case json:
+		return outIndent() + "{";
+	default:
+		return "";
+	}
+}
+
+//-----------------------------------------------------------------------------
+std::string CyhookHandler::outArrayItemClose(std::string _key, bool _next) {
+	std::string _key_close = "", tmp;
 	ySplitString(_key, " ", _key_close, tmp);
 	switch (outType) {
 	case xml:
-		//TODO: xml check and DESC check
-		result = outIndent() + "<" + _key + ">\n" + _content + "</" + _key_close + ">";
-		result += "\n";
-		break;
+		return "</" + _key_close + ">\n";
 	case json:
-		//TODO: json check
-		result = outIndent() + "\"" + _key + "\": {" + _content + "}";
-		if(_next)
-			result += ",";
-		result += "\n";
-		break;
+		return _next ? "},\n" : "}\n";
 	default:
-		result = _content;
-		break;
+		return "";
+	}
+}
+
+//-----------------------------------------------------------------------------
+std::string CyhookHandler::outObjectOpen(std::string _key) {
+	switch (outType) {
+	case xml:
+		return outIndent() + "<" + _key + ">\n";
+	case json:
+		return outIndent() + "\"" + _key + "\": {";
+	default:
+		return "";
+	}
+}
+
+//-----------------------------------------------------------------------------
+std::string CyhookHandler::outObjectClose(std::string _key, bool _next) {
+	std::string _key_close = "", tmp;
+	ySplitString(_key, " ", _key_close, tmp);
+	switch (outType) {
+	case xml:
+		return "</" + _key_close + ">\n";
+	case json:
+		return _next ? "},\n" : "}\n";
+	default:
+		return "";
 	}
-	return result;
 }
 
 //-----------------------------------------------------------------------------
@@ -619,3 +653,76 @@ void CyhookHandler::SendResult(std::string _content) {
 	}
 	WriteLn(result);
 }
+
+//=============================================================================
+// Streamed output
+//-----------------------------------------------------------------------------
+// The header is sent at StreamStart(), output of StreamWrite() is collected in
+// yresult and sent whenever STREAM_CHUNK_SIZE is reached, so memory stays
+// bounded and the client gets the first bytes at once.
+//=============================================================================
+#define STREAM_CHUNK_SIZE (16*1024)
+//-----------------------------------------------------------------------------
+bool CyhookHandler::StreamStart() {
+	if (streaming)
+		return true;
+	if (!streamSink || Method == M_HEAD)
+		return false;
+	status = HANDLED_STREAMED;
+	// HTTP/1.0: body ends with the connection
+	if (!streamChunked)
+		keep_alive = false;
+	std::string header = BuildHeader();
+	if (!streamSink->StreamData(header.c_str(), header.length())) {
+		streamFailed = true;
+		return false;
+	}
+	streaming = true;
+	return StreamFlush();
+}
+//-----------------------------------------------------------------------------
+void CyhookHandler::StreamWrite(const std::string& text) {
+	yresult += text;
+	if (streaming && yresult.length() >= STREAM_CHUNK_SIZE)
+		StreamFlush();
+}
+//-----------------------------------------------------------------------------
+bool CyhookHandler::StreamFlush() {
+	if (!streaming || streamFailed)
+		return false;
+	if (yresult.empty())
+		return true;
+	bool ok = true;
+	if (streamChunked) {
+		std::string size = string_printf("%lx\r\n", (unsigned long) yresult.length());
+		yresult += "\r\n";
+		ok = streamSink->StreamData(size.c_str(), size.length());
+	}
+	if (ok)
+		ok = streamSink->StreamData(yresult.c_str(), yresult.length());
+	yresult.clear();
+	if (!ok)
+		streamFailed = true;
+	return ok;
+}
+//-----------------------------------------------------------------------------
+void CyhookHandler::StreamEnd() {
+	if (!streaming)
+		return;
+	if (StreamFlush() && streamChunked && !streamSink->StreamData("0\r\n\r\n", 5))
+		streamFailed = true;
+	streaming = false;
+}
+//-----------------------------------------------------------------------------
+void CyhookHandler::StreamResultStart() {
+	StreamStart();
+	if (outType == json)
+		StreamWrite("{\"success\": \"true\", \"data\":{");
+}
+//-----------------------------------------------------------------------------
+void CyhookHandler::StreamResultEnd() {
+	if (outType == json)
+		StreamWrite("}}");
+	StreamWrite("\r\n");
+	StreamEnd();
+}
@@ -35,6 +35,11 @@
 // helper-function for Output and Status-Handling.
 // The Input is encapsulated too: ParamList, HeaderList, UrlData, ...
 // Look at Response.SendResponse()
+// Large responses can be streamed instead: StreamStart() sends the header,
+// StreamWrite() collects output and sends it in chunks (HTTP/1.1 chunked
+// transfer, else until connection close), StreamEnd() finishes the body.
+// The status is HANDLED_STREAMED then. Without a stream sink (e.g. HEAD) the
+// output is collected in yresult as usual.
 //-----------------------------------------------------------------------------
 // Other Hooks
 //-----------------------------------------------------------------------------
@@ -78,6 +83,7 @@ typedef enum
 	HANDLED_SENDFILE,		// Set new URL and Send File
 	HANDLED_REWRITE,		// Set new URL and call Hooks again
 	HANDLED_CONTINUE,		// handled but go on
+	HANDLED_STREAMED,		// handled, header and body already sent
 
 } THandleStatus;
 typedef std::list<Cyhook *> THookList;
@@ -115,6 +121,16 @@ public:
 	virtual THandleStatus 	Hook_ReadConfig(CConfigFile *, CStringList &){return HANDLED_NONE;};
 };
 
+//-----------------------------------------------------------------------------
+// Socket output for streamed responses (implemented by CWebserverResponse)
+//-----------------------------------------------------------------------------
+class CyhookStreamSink
+{
+public:
+	virtual ~CyhookStreamSink(){};
+	virtual bool StreamData(char const *data, long length) = 0;
+};
+
 //-----------------------------------------------------------------------------
 // Hook Handling and Input & Output abstraction
 //-----------------------------------------------------------------------------
@@ -122,6 +138,10 @@ class CyhookHandler
 {
 protected:
 	static THookList HookList;
+	CyhookStreamSink *streamSink;		// socket output for streaming
+	bool		streamChunked;		// client understands chunked transfer
+	bool		streaming;		// header sent, body follows in chunks
+	bool		streamFailed;		// client gone
 public:
 	CyhookHandler();
 	~CyhookHandler();
@@ -199,6 +219,17 @@ public:
 	void SendRedirect(const std::string& url)	{httpStatus=HTTP_MOVED_TEMPORARILY; NewURL = url; status = HANDLED_REDIRECTION;}
 	void SendRewrite(const std::string& url)	{NewURL = url; status = HANDLED_REWRITE;}
 
+	// streamed output
+	void SetStreamSink(CyhookStreamSink *sink, bool chunked)
+						{streamSink = sink; streamChunked = chunked;}
+	bool StreamStart();
+	void StreamWrite(const std::string& text);
+	bool StreamFlush();
+	void StreamEnd();
+	bool StreamCanceled()			{return streamFailed;}
+	void StreamResultStart();		// StreamStart() + head of SendResult()
+	void StreamResultEnd();			// tail of SendResult() + StreamEnd()
+
 	bool ParamList_exist(std::string keyword);
 
 	int _outIndent;
@@ -211,6 +242,13 @@ public:
 	std::string outArray(std::string _key, std::string _content, bool _next = false);
 	std::string outArrayItem(std::string _key, std::string _content, bool _next);
 	std::string outObject(std::string _key,std::string  _content, bool _next = false);
+	// opening and closing parts of the above, for streamed output
+	std::string outArrayOpen(std::string _key);
+	std::string outArrayClose(std::string _key, bool _next = false);
+	std::string outArrayItemOpen(std::string _key);
+	std::string outArrayItemClose(std::string _key, bool _next);
+	std::string outObjectOpen(std::string _key);
+	std::string outObjectClose(std::string _key, bool _next = false);
 	std::string outValue(std::string _content);
 	std::string outNext();
 	friend class CyParser;
@@ -9,6 +9,7 @@
 #include <pthread.h>
 // yhttpd
 #include <yconfig.h>
+#include <system/asynclog.h>
 
 // forward declaration
 class CWebserverConnection;
@@ -55,29 +56,33 @@ class CLogging
 // definitions for easy use
 //-----------------------------------------------------------------------------
 
+// with the async log, lines go to its ring instead of through the mutex
+#define ylog_printf(fmt, args...) \
+	do { if (asynclog_enabled) ASYNCLOG_PRINTF(0, fmt, ## args); else CLogging::getInstance()->printf(fmt, ## args); } while (0)
+
 // print always
 #define aprintf(fmt, args...) \
-	do { CLogging::getInstance()->printf("[yhttpd] " fmt, ## args); } while (0)
+	do { ylog_printf("[yhttpd] " fmt, ## args); } while (0)
 	
 // print show file and linenumber
 #define log_printfX(fmt, args...) \
-	do { CLogging::getInstance()->printf("[yhttpd(%s:%d)] " fmt, __file__, __LINE__, ## args); } while (0)
+	do { ylog_printf("[yhttpd(%s:%d)] " fmt, __file__, __LINE__, ## args); } while (0)
 
 //Set Watch Point (show file and linenumber and function)
 #define WP() \
-	do { CLogging::getInstance()->printf("[yhttpd(%s:%d)%s]\n", __file__, __LINE__, __FUNCTION__); } while (0)
+	do { ylog_printf("[yhttpd(%s:%d)%s]\n", __file__, __LINE__, __FUNCTION__); } while (0)
 
 // print if level matches
 #define log_level_printf(level, fmt, args...) \
-	do { if(CLogging::getInstance()->LogLevel>=level) CLogging::getInstance()->printf("[yhttpd#%d] " fmt, level, ## args); } while (0)
+	do { if(CLogging::getInstance()->LogLevel>=level) ylog_printf("[yhttpd#%d] " fmt, level, ## args); } while (0)
 
 // print if level matches / show file and linenumber
 #define log_level_printfX(level, fmt, args...) \
-	do { if(CLogging::getInstance()->LogLevel>=level) CLogging::getInstance()->printf("[yhttpd#%d(%s:%d)] " fmt, level, __file__, __LINE__, ## args); } while (0)
+	do { if(CLogging::getInstance()->LogLevel>=level) ylog_printf("[yhttpd#%d(%s:%d)] " fmt, level, __file__, __LINE__, ## args); } while (0)
 
 // print only if debug is on
 #define dprintf(fmt, args...) \
-	do { if(CLogging::getInstance()->getDebug())CLogging::getInstance()->printf("[yhttpd] " fmt, ## args); } while (0)
+	do { if(CLogging::getInstance()->getDebug())ylog_printf("[yhttpd] " fmt, ## args); } while (0)
 
 // print string to stdandard error
 #define dperror(str) \
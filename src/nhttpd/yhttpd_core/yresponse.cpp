@@ -60,6 +60,7 @@ bool CWebserverResponse::SendResponse() {
 	Connection->HookHandler.session_init(Connection->Request.ParameterList,
 			Connection->Request.UrlData, (Connection->Request.HeaderList),
 			(Cyhttpd::ConfigList), Connection->Method, Connection->keep_alive);
+	Connection->HookHandler.SetStreamSink(this, Connection->httprotocol == "HTTP/1.1");
 	//--------------------------------------------------------------
 	// HOOK Handling Loop [ PREPARE response hook ]
 	// Checking and Preperation: Auth, static, cache, ...
@@ -119,6 +120,12 @@ bool CWebserverResponse::SendResponse() {
 				if (Connection->Method != M_HEAD)
 					Write(Connection->HookHandler.yresult);
 				return false;
+			} else if (Connection->HookHandler.status == HANDLED_STREAMED) {
+				// header and body already sent by the hook
+				log_level_printf(2, "Response Hook Output streamed\n");
+				if (!Connection->HookHandler.keep_alive)
+					Connection->keep_alive = false;
+				return !Connection->RequestCanceled;
 			} else if (Connection->HookHandler.status == HANDLED_ABORT)
 				return false;
 			// URL has new value. Analyze new URL for SendFile
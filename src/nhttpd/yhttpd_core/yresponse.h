@@ -18,7 +18,7 @@ class CWebserver;
 class CWebserverConnection;
 
 //-----------------------------------------------------------------------------
-class CWebserverResponse
+class CWebserverResponse : public CyhookStreamSink
 {
 private:
 
@@ -38,6 +38,9 @@ public:
 	// response control
 	bool SendResponse(void);
 
+	// streamed hook output (CyhookStreamSink)
+	bool StreamData(char const *data, long length) { return WriteData(data, length); }
+
 	// output methods
 	void printf(const char *fmt, ...);
 	bool Write(char const *text);
@@ -5,6 +5,7 @@
 // Send a File (main) with given path and filename.
 // It procuced a Response-Header (SendHeader).
 // It supports Client caching mechanism "If-Modified-Since".
+// Recordings with index sidecar can be started at a time with ?start=<seconds>.
 //-----------------------------------------------------------------------------
 // RFC 2616 / 14.25 If-Modified-Since
 //
@@ -42,12 +43,14 @@
 
 // system
 #include <cstdio>
+#include <cstdlib>
 #include <fcntl.h>
 #include <pthread.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <inttypes.h>
 #include <system/helpers.h>
+#include <driver/tsindex.h>
 // yhttpd
 #include <yconfig.h>
 #include <ytypes_globals.h>
@@ -126,6 +129,12 @@ THandleStatus CmodSendfile::Hook_PrepareResponse(CyhookHandler *hh) {
 					hh->SetError(HTTP_REQUEST_RANGE_NOT_SATISFIABLE);
 					aprintf("mod_sendfile: Client requested range '%s' which is outside of [0,%lld]\n", range, hh->ContentLength - 1);
 				} else {
+					// recordings: ?start=<seconds> starts at the I-frame from the index sidecar
+					if (!range && hh->UrlData["fileext"] == "ts" && !hh->ParamList["start"].empty()) {
+						off_t offset = CTsIndex::FindOffset(CTsIndex::GetSidecarName(fullfilename), atoll(hh->ParamList["start"].c_str()) * 1000);
+						if (offset > 0 && offset < hh->ContentLength)
+							hh->RangeStart = offset;
+					}
 					hh->SendFile(fullfilename);
 					hh->ResponseMimeType = mime;
 					if (hh->RangeStart && (hh->RangeEnd != hh->ContentLength - 1))
@@ -37,16 +37,17 @@ pthread_mutex_t CyParser::yParser_mutex = PTHREAD_MUTEX_INITIALIZER;
 std::string CyParser::HTML_DIRS[HTML_DIR_COUNT];
 std::string CyParser::PLUGIN_DIRS[PLUGIN_DIR_COUNT];
 std::map<std::string, std::string> CyParser::ycgi_global_vars;
-struct stat CyParser::yCached_blocks_attrib;
-std::string CyParser::yCached_blocks_filename;
-std::string CyParser::yCached_blocks_content;
+std::map<std::string, CyParser::TyCachedTemplate> CyParser::yCached_templates;
+std::map<std::string, CyParser::TyCachedBlocks> CyParser::yCached_blocks;
+
+// max. number of cached templates and block files
+#define YPARSER_CACHE_MAX 128
 
 //=============================================================================
 // Constructor & Destructor
 //=============================================================================
 CyParser::CyParser() {
 	yConfig = new CConfigFile(',');
-	yCached_blocks_attrib.st_mtime = 0;
 }
 //-----------------------------------------------------------------------------
 CyParser::~CyParser(void) {
@@ -265,13 +266,127 @@ void CyParser::ParseAndSendFile(CyhookHandler *hh) {
 //=============================================================================
 // y Parsing helpers
 //=============================================================================
+//-----------------------------------------------------------------------------
+// read a text file line by line, each line terminated with eol
+//-----------------------------------------------------------------------------
+static bool yparser_read_file(const std::string &filename, const char *eol, std::string &content) {
+	std::fstream fin(filename.c_str(), std::fstream::in);
+	if (!fin.good())
+		return false;
+	std::string ytmp;
+	while (!fin.eof()) {
+		getline(fin, ytmp);
+		content += ytmp;
+		content += eol;
+	}
+	fin.close();
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// split a template into literal text and top level {=..=} regions.
+// Commands are executed innermost first, left to right, so evaluating each
+// region on its own gives the same output as parsing the whole template.
+// Unbalanced escapes keep the whole template in one region.
+//-----------------------------------------------------------------------------
+void CyParser::split_template(const std::string &html_template, TySegments &segments) {
+	std::string::size_type pos = 0, lit_start = 0, cmd_start = 0, open, close;
+	unsigned int esc_len = strlen(YPARSER_ESCAPE_START);
+	int depth = 0;
+	TySegment segment;
+
+	segments.clear();
+	while (true) {
+		open = html_template.find(YPARSER_ESCAPE_START, pos);
+		close = html_template.find(YPARSER_ESCAPE_END, pos);
+		if (close == std::string::npos) {
+			if (depth == 0 && open == std::string::npos)
+				break;
+			depth = -1; // unclosed
+			break;
+		}
+		if (open != std::string::npos && open < close) {
+			if (close < open + esc_len) {
+				depth = -1; // overlapping "{=}"
+				break;
+			}
+			if (depth++ == 0) {
+				if (open > lit_start) {
+					segment.is_cmd = false;
+					segment.text = html_template.substr(lit_start, open - lit_start);
+					segments.push_back(segment);
+				}
+				cmd_start = open;
+			}
+			pos = open + esc_len;
+		} else {
+			if (depth == 0) {
+				depth = -1; // end without start
+				break;
+			}
+			pos = close + esc_len;
+			if (--depth == 0) {
+				segment.is_cmd = true;
+				segment.text = html_template.substr(cmd_start, pos - cmd_start);
+				segments.push_back(segment);
+				lit_start = pos;
+			}
+		}
+	}
+	if (depth < 0) {
+		segments.clear();
+		segment.is_cmd = true;
+		segment.text = html_template;
+		segments.push_back(segment);
+	} else if (lit_start < html_template.length()) {
+		segment.is_cmd = false;
+		segment.text = html_template.substr(lit_start);
+		segments.push_back(segment);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// get the pre-split template from cache, (re)load it if changed
+//-----------------------------------------------------------------------------
+bool CyParser::get_template(std::string filename, TySegments &segments) {
+	struct stat attrib;
+	if (stat(filename.c_str(), &attrib) != 0 || !S_ISREG(attrib.st_mode))
+		return false;
+
+	pthread_mutex_lock(&yParser_mutex);
+	std::map<std::string, TyCachedTemplate>::iterator it = yCached_templates.find(filename);
+	if (it != yCached_templates.end() && it->second.mtime == attrib.st_mtime && it->second.size == attrib.st_size) {
+		segments = it->second.segments;
+		pthread_mutex_unlock(&yParser_mutex);
+		log_level_printf(6, "template: (%s) from cache\n", filename.c_str());
+		return true;
+	}
+	pthread_mutex_unlock(&yParser_mutex);
+
+	std::string html_template;
+	if (!yparser_read_file(filename, "\r\n", html_template))
+		return false;
+	split_template(html_template, segments);
+	log_level_printf(6, "template: (%s) from file, %d segments\n", filename.c_str(), (int) segments.size());
+
+	pthread_mutex_lock(&yParser_mutex);
+	if (yCached_templates.size() >= YPARSER_CACHE_MAX)
+		yCached_templates.clear();
+	TyCachedTemplate &cached = yCached_templates[filename];
+	cached.mtime = attrib.st_mtime;
+	cached.size = attrib.st_size;
+	cached.segments = segments;
+	pthread_mutex_unlock(&yParser_mutex);
+	return true;
+}
+
 //-----------------------------------------------------------------------------
 // mini cgi Engine (file parsing)
 //-----------------------------------------------------------------------------
 std::string CyParser::cgi_file_parsing(CyhookHandler *hh,
 		std::string htmlfilename, bool ydebug) {
 	bool found = false;
-	std::string htmlfullfilename, yresult, html_template;
+	std::string htmlfullfilename, yresult;
 
 	bool isHosted = false;
 #ifdef Y_CONFIG_USE_HOSTEDWEB
@@ -285,19 +400,19 @@ std::string CyParser::cgi_file_parsing(CyhookHandler *hh,
 	getcwd(cwd, 254);
 	for (unsigned int i = 0; i < (isHosted ? 1 : HTML_DIR_COUNT) && !found; i++) {
 		htmlfullfilename = (isHosted ? "" : HTML_DIRS[i]) + "/" + htmlfilename;
-		std::fstream fin(htmlfullfilename.c_str(), std::fstream::in);
-		if (fin.good()) {
+		TySegments segments;
+		if (get_template(htmlfullfilename, segments)) {
 			found = true;
 			chdir(HTML_DIRS[i].c_str()); // set working dir
 
-			// read whole file into html_template
-			std::string ytmp;
-			while (!fin.eof()) {
-				getline(fin, ytmp);
-				html_template = html_template + ytmp + "\r\n";
-			}
-			yresult += cgi_cmd_parsing(hh, html_template, ydebug); // parsing engine
-			fin.close();
+			if (ydebug) { // show all parsing steps on the whole template
+				std::string html_template;
+				for (TySegments::iterator it = segments.begin(); it != segments.end(); ++it)
+					html_template += it->text;
+				yresult += cgi_cmd_parsing(hh, html_template, ydebug); // parsing engine
+			} else
+				for (TySegments::iterator it = segments.begin(); it != segments.end(); ++it)
+					yresult += it->is_cmd ? cgi_cmd_parsing(hh, it->text, ydebug) : it->text;
 		}
 	}
 	chdir(cwd);
@@ -316,7 +431,7 @@ std::string CyParser::cgi_file_parsing(CyhookHandler *hh,
 //-----------------------------------------------------------------------------
 std::string CyParser::cgi_cmd_parsing(CyhookHandler *hh,
 		std::string html_template, bool ydebug) {
-	std::string::size_type start, end;
+	std::string::size_type start, end, pos = 0;
 	unsigned int esc_len = strlen(YPARSER_ESCAPE_START);
 	bool is_cmd;
 	std::string ycmd, yresult;
@@ -324,7 +439,7 @@ std::string CyParser::cgi_cmd_parsing(CyhookHandler *hh,
 	do // replace all {=<cmd>=} nested and recursive
 	{
 		is_cmd = false;
-		if ((end = html_template.find(YPARSER_ESCAPE_END)) != std::string::npos) // 1. find first y-end
+		if ((end = html_template.find(YPARSER_ESCAPE_END, pos)) != std::string::npos) // 1. find first y-end
 		{
 			if (ydebug)
 				hh->printf("[ycgi debug]: END at:%d following:%s<br/>\n", end,
@@ -349,6 +464,8 @@ std::string CyParser::cgi_cmd_parsing(CyhookHandler *hh,
 							yresult.c_str());
 				html_template.replace(start, end - start + esc_len, yresult); // 5. replace cmd with output
 				is_cmd = true; // one command found
+				// no y-end before start, go on there (output may start with '}')
+				pos = (start > 0) ? start - 1 : 0;
 
 				if (ydebug)
 					hh->printf("[ycgi debug]: STEP<br/>\n%s<br/>\n",
@@ -584,63 +701,73 @@ void CyParser::YWeb_cgi_set_ini(CyhookHandler *, std::string filename,
 // Get text block named <blockname> from file <filename>
 // The textblock starts with "start-block~<blockname>" and ends with
 // "end-block~<blockname>"
+// Block files are read once and indexed by block name.
 //-------------------------------------------------------------------------
 std::string CyParser::YWeb_cgi_include_block(std::string filename,
 		std::string blockname, std::string ydefault) {
-	std::string ytmp, yfile, yresult;
+	std::string ifilename, yfile, yresult;
 	struct stat attrib;
+	bool found = false;
 	yresult = ydefault;
 
-	stat(filename.c_str(), &attrib);
+	for (unsigned int i = 0; i < HTML_DIR_COUNT && !found; i++) {
+		ifilename = HTML_DIRS[i] + "/" + filename;
+		if (stat(ifilename.c_str(), &attrib) == 0 && S_ISREG(attrib.st_mode))
+			found = true;
+	}
+	if (!found) {
+		aprintf("include-blocks: file not found:%s Blockname:%s\n",
+				filename.c_str(), blockname.c_str());
+		return yresult;
+	}
 
 	pthread_mutex_lock(&yParser_mutex);
-	if ((attrib.st_mtime == yCached_blocks_attrib.st_mtime) && (filename
-			== yCached_blocks_filename)) {
-		log_level_printf(6, "include-block: (%s) from cache\n",
-				blockname.c_str());
-		yfile = yCached_blocks_content;
-	} else {
-		bool found = false;
-		for (unsigned int i = 0; i < HTML_DIR_COUNT && !found; i++) {
-			std::string ifilename = HTML_DIRS[i] + "/" + filename;
-			std::fstream fin(ifilename.c_str(), std::fstream::in);
-			if (fin.good()) {
-				found = true;
-				while (!fin.eof()) // read whole file into yfile
-				{
-					getline(fin, ytmp);
-					yfile += ytmp + "\n";
-				}
-				fin.close();
-			}
+	std::map<std::string, TyCachedBlocks>::iterator it = yCached_blocks.find(ifilename);
+	if (it == yCached_blocks.end() || it->second.mtime != attrib.st_mtime
+			|| it->second.size != attrib.st_size) {
+		// build index: name -> text between "start-block~<name>" and "end-block~<name>"
+		pthread_mutex_unlock(&yParser_mutex);
+		if (!yparser_read_file(ifilename, "\n", yfile)) {
+			aprintf("include-blocks: file not found:%s Blockname:%s\n",
+					filename.c_str(), blockname.c_str());
+			return yresult;
 		}
-		yCached_blocks_content = yfile;
-		yCached_blocks_attrib = attrib;
-		yCached_blocks_filename = filename;
-		log_level_printf(6, "include-block: (%s) from file\n",
+		TyCachedBlocks cached;
+		cached.mtime = attrib.st_mtime;
+		cached.size = attrib.st_size;
+		std::string t = "start-block~";
+		std::string::size_type start = 0, name_end, end;
+		while ((start = yfile.find(t, start)) != std::string::npos) {
+			start += t.length();
+			if ((name_end = yfile.find_first_of(" \t\r\n", start)) == std::string::npos)
+				break;
+			std::string name = yfile.substr(start, name_end - start);
+			if (!name.empty() && cached.blocks.find(name) == cached.blocks.end()
+					&& (end = yfile.find("end-block~" + name, name_end)) != std::string::npos)
+				cached.blocks[name] = yfile.substr(name_end, end - name_end);
+			start = name_end;
+		}
+		log_level_printf(6, "include-block: (%s) from file, %d blocks\n",
+				blockname.c_str(), (int) cached.blocks.size());
+
+		pthread_mutex_lock(&yParser_mutex);
+		if (yCached_blocks.size() >= YPARSER_CACHE_MAX)
+			yCached_blocks.clear();
+		it = yCached_blocks.insert(std::make_pair(ifilename, cached)).first;
+		it->second = cached;
+	} else
+		log_level_printf(6, "include-block: (%s) from cache\n",
 				blockname.c_str());
-	}
-	pthread_mutex_unlock(&yParser_mutex);
-	if (!yfile.empty()) {
-		std::string t = "start-block~" + blockname;
-		std::string::size_type start, end;
-		if ((start = yfile.find(t)) != std::string::npos) {
-			if ((end = yfile.find("end-block~" + blockname, start + t.length()))
-					!= std::string::npos) {
-				yresult = yfile.substr(start + t.length(), end - (start
-						+ t.length()));
-				log_level_printf(7, "include-block: (%s) yresult:(%s)\n",
-						blockname.c_str(), yresult.c_str());
-			} else
-				aprintf(
-						"include-blocks: Block END not found:%s Blockname:%s\n",
-						filename.c_str(), blockname.c_str());
-		} else
-			aprintf("include-blocks: Block START not found:%s Blockname:%s\n",
-					filename.c_str(), blockname.c_str());
+
+	std::map<std::string, std::string>::iterator block = it->second.blocks.find(blockname);
+	if (block != it->second.blocks.end()) {
+		yresult = block->second;
+		log_level_printf(7, "include-block: (%s) yresult:(%s)\n",
+				blockname.c_str(), yresult.c_str());
 	} else
-		aprintf("include-blocks: file not found:%s Blockname:%s\n",
+		aprintf("include-blocks: Block not found:%s Blockname:%s\n",
 				filename.c_str(), blockname.c_str());
+	pthread_mutex_unlock(&yParser_mutex);
 
 	return yresult;
 }
@@ -9,6 +9,7 @@
 // c++
 #include <map>
 #include <string>
+#include <vector>
 // system
 #include <fcntl.h>
 #include <sys/stat.h>
@@ -68,16 +69,38 @@ private:
 	CStringList ycgi_vars;	//ycgi session vars
 	CConfigFile *yConfig;
 
+	// pre-split template: literal text and {=..=} regions (with nested commands)
+	typedef struct
+	{
+		bool		is_cmd;		// text must go through cgi_cmd_parsing
+		std::string	text;
+	} TySegment;
+	typedef std::vector<TySegment> TySegments;
+	typedef struct
+	{
+		time_t		mtime;
+		off_t		size;
+		TySegments	segments;
+	} TyCachedTemplate;
+	// block file indexed by block name
+	typedef struct
+	{
+		time_t		mtime;
+		off_t		size;
+		std::map<std::string, std::string> blocks;
+	} TyCachedBlocks;
+
 	// mutex for vars and caching (yCached_*)
 	static pthread_mutex_t yParser_mutex;
 	// ycgi globals
 	static std::map<std::string, std::string> ycgi_global_vars;
-	// caching globals
-	static struct stat yCached_blocks_attrib;
-	static std::string yCached_blocks_filename;
-	static std::string yCached_blocks_content;
+	// caching globals, keyed by full filename
+	static std::map<std::string, TyCachedTemplate> yCached_templates;
+	static std::map<std::string, TyCachedBlocks> yCached_blocks;
 
 	// parsing engine
+	static void split_template(const std::string &html_template, TySegments &segments);
+	bool get_template(std::string filename, TySegments &segments);
 	std::string cgi_file_parsing(CyhookHandler *hh, std::string htmlfilename, bool ydebug);
 	std::string cgi_cmd_parsing(CyhookHandler *hh, std::string html_template, bool ydebug);
 	std::string YWeb_cgi_cmd(CyhookHandler *hh, std::string ycmd);
@@ -0,0 +1,262 @@
+/*
+	Neutrino-GUI  -   DBoxII-Project
+
+	channel lookup benchmark: fills CServiceManager and CBouquetManager
+	with generated services and webtv channels, and times the indexed
+	lookups by name, by channel id and by channel number against a linear
+	walk like the old code did. no hardware and no services.xml needed, the
+	zapit parts the lookups do not use are stubbed below.
+
+	usage: services_bench [services [webtv]]
+	  services	number of dvb services, default 20000
+	  webtv		number of webtv channels, default 5000
+
+	License: GPL
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <inttypes.h>
+#include <string>
+#include <vector>
+
+#include <driver/abstime.h>
+#include <zapit/zapit.h>
+#include <zapit/femanager.h>
+#include <zapit/capmt.h>
+#include <zapit/getservices.h>
+#include <zapit/bouquets.h>
+#include "check.h"
+
+/* channels per generated bouquet */
+#define BOUQUET_SIZE	100
+
+/* globals of zapit.cpp */
+int zapit_debug = 0;
+Zapit_config zapitCfg;
+transponder_list_t transponders;
+CBouquetManager *g_bouquetManager = NULL;
+
+/* zapit parts not used by the lookups */
+CZapit *CZapit::getInstance() { return NULL; }
+audio_map_set_t *CZapit::GetSavedPids(const t_channel_id) { return NULL; }
+CFEManager *CFEManager::getInstance() { return NULL; }
+CCamManager *CCamManager::getInstance() { return NULL; }
+bool CFrontend::isSat(delivery_system_t delsys) { return delsys & ALL_SAT; }
+bool CFrontend::isCable(delivery_system_t delsys) { return delsys & ALL_CABLE; }
+bool CFrontend::isTerr(delivery_system_t delsys) { return delsys & ALL_TERR; }
+fe_code_rate_t CFrontend::getCodeRate(const uint8_t, delivery_system_t) { return FEC_AUTO; }
+delivery_system_t CFrontend::getZapitDeliverySystem(uint32_t) { return DVB_S; }
+uint32_t CFrontend::getXMLDeliverySystem(delivery_system_t) { return 0; }
+void CFrontend::getXMLDelsysFEC(fe_code_rate_t, delivery_system_t &, fe_modulation_t &, fe_code_rate_t &) {}
+void CFrontend::getDelSys(delivery_system_t, int, int, const char * &, const char * &, const char * &) {}
+uint32_t CFrontend::getFEBandwidth(fe_bandwidth_t) { return 0; }
+
+/* the lookups as they were before the indexes */
+static CZapitChannel *linear_name(const std::string &name)
+{
+	tallchans *all = CServiceManager::getInstance()->GetAllChannels();
+	CZapitChannel *found = NULL;
+	for (tallchans_iterator it = all->begin(); it != all->end(); ++it)
+		if (it->second.getName().length() == name.length() && !strcasecmp(it->second.getName().c_str(), name.c_str()))
+			if (!found || it->first < found->getChannelID())
+				found = &it->second;
+	return found;
+}
+
+static CZapitChannel *linear_id(CZapitBouquet *bouquet, t_channel_id channel_id)
+{
+	for (unsigned int i = 0; i < bouquet->tvChannels.size(); i++)
+		if (bouquet->tvChannels[i]->getChannelID() == channel_id)
+			return bouquet->tvChannels[i];
+	return NULL;
+}
+
+static CZapitChannel *linear_nr(unsigned int nr)
+{
+	BouquetList &bouquets = g_bouquetManager->Bouquets;
+	for (unsigned int b = 0; b < bouquets.size(); b++) {
+		if (nr < bouquets[b]->tvChannels.size())
+			return bouquets[b]->tvChannels[nr];
+		nr -= bouquets[b]->tvChannels.size();
+	}
+	return NULL;
+}
+
+static int linear_lowest(t_channel_id channel_id)
+{
+	BouquetList &bouquets = g_bouquetManager->Bouquets;
+	for (unsigned int b = 0; b < bouquets.size(); b++)
+		for (unsigned int i = 0; i < bouquets[b]->tvChannels.size(); i++)
+			if (bouquets[b]->tvChannels[i]->getChannelID() == channel_id)
+				return bouquets[b]->tvChannels[i]->number - 1;
+	return -1;
+}
+
+/* the indexed lookups run twice, the first run builds the index */
+static void report(const char *what, int n, int64_t linear, int64_t cold, int64_t warm)
+{
+	printf("%-24s %5d lookups: linear %8d us, indexed %6d us with build, %6d us built\n",
+			what, n, (int) linear, (int) cold, (int) warm);
+}
+
+int main(int argc, char **argv)
+{
+	int services = argc > 1 ? atoi(argv[1]) : 20000;
+	int webtv = argc > 2 ? atoi(argv[2]) : 5000;
+	CServiceManager *sm = CServiceManager::getInstance();
+	g_bouquetManager = new CBouquetManager();
+
+	int64_t start = time_monotonic_us();
+	std::vector<t_channel_id> ids;
+	CZapitBouquet *bouquet = NULL;
+	for (int i = 0; i < services; i++) {
+		char name[64];
+		snprintf(name, sizeof(name), "Service %05d %s", i, (i % 3) ? "HD" : "SD");
+		CZapitChannel *channel = new CZapitChannel(name, 0x1000 + i, 0x10 + i / 50, 0x1, ST_DIGITAL_TELEVISION_SERVICE, 192, 11000 + i / 50);
+		if (!sm->AddChannel(channel))
+			continue;
+		if (i % BOUQUET_SIZE == 0) {
+			snprintf(name, sizeof(name), "Bouquet %03d", i / BOUQUET_SIZE);
+			bouquet = g_bouquetManager->addBouquet(name);
+		}
+		bouquet->addService(channel);
+		ids.push_back(channel->getChannelID());
+	}
+	/* webtv channels, named after a service like the xmltv/webtv matching looks them up */
+	CZapitBouquet *webtv_bouquet = g_bouquetManager->addBouquet("WebTV");
+	std::vector<std::string> names;
+	for (int i = 0; i < webtv; i++) {
+		char name[64], url[64];
+		snprintf(name, sizeof(name), "service %05d %s", (i * 7) % (services ? services : 1), ((i * 7) % 3) ? "hd" : "sd");
+		snprintf(url, sizeof(url), "http://127.0.0.1/live/%d.ts", i);
+		names.push_back(name);
+		std::string webname = std::string("Web ") + name;
+		CZapitChannel *channel = new CZapitChannel(webname.c_str(), create_channel_id(0, 0, 0, url), url, NULL);
+		if (sm->AddChannel(channel))
+			webtv_bouquet->addService(channel);
+	}
+	g_bouquetManager->renumServices();
+	printf("%d services, %d webtv channels in %d bouquets, set up in %d ms\n", services, webtv,
+			(int) g_bouquetManager->Bouquets.size(), (int) ((time_monotonic_us() - start) / 1000));
+
+	/* by name */
+	int64_t linear = time_monotonic_us();
+	std::vector<CZapitChannel *> expect;
+	for (unsigned int i = 0; i < names.size(); i++)
+		expect.push_back(linear_name(names[i]));
+	linear = time_monotonic_us() - linear;
+	int64_t indexed[2];
+	std::vector<CZapitChannel *> got;
+	for (int pass = 0; pass < 2; pass++) {
+		got.clear();
+		indexed[pass] = time_monotonic_us();
+		for (unsigned int i = 0; i < names.size(); i++)
+			got.push_back(sm->FindChannelByName(names[i]));
+		indexed[pass] = time_monotonic_us() - indexed[pass];
+	}
+	report("FindChannelByName", names.size(), linear, indexed[0], indexed[1]);
+	check(got == expect, "FindChannelByName differs from the linear walk");
+	check(names.empty() || got[0] != NULL, "FindChannelByName found nothing");
+
+	/* renamed channel, the index is dropped and built again */
+	if (!ids.empty()) {
+		CZapitChannel *channel = sm->FindChannel(ids[0]);
+		channel->setName("Renamed");
+		sm->InvalidateNameIndex();
+		check(sm->FindChannelByName("renamed") == channel, "renamed channel not found");
+	}
+
+	/* by channel id in a bouquet */
+	int n = 0;
+	linear = time_monotonic_us();
+	expect.clear();
+	for (unsigned int i = 0; i < ids.size(); i += 7, n++)
+		expect.push_back(linear_id(g_bouquetManager->Bouquets[i / BOUQUET_SIZE], ids[i]));
+	linear = time_monotonic_us() - linear;
+	for (int pass = 0; pass < 2; pass++) {
+		got.clear();
+		indexed[pass] = time_monotonic_us();
+		for (unsigned int i = 0; i < ids.size(); i += 7)
+			got.push_back(g_bouquetManager->Bouquets[i / BOUQUET_SIZE]->getChannelByChannelID(ids[i]));
+		indexed[pass] = time_monotonic_us() - indexed[pass];
+	}
+	report("getChannelByChannelID", n, linear, indexed[0], indexed[1]);
+	check(got == expect, "getChannelByChannelID differs from the linear walk");
+
+	/* by number over all bouquets */
+	unsigned int total = 0;
+	for (unsigned int b = 0; b < g_bouquetManager->Bouquets.size(); b++)
+		total += g_bouquetManager->Bouquets[b]->tvChannels.size();
+	n = 0;
+	linear = time_monotonic_us();
+	expect.clear();
+	for (unsigned int nr = 0; nr <= total; nr += 3, n++)
+		expect.push_back(linear_nr(nr));
+	linear = time_monotonic_us() - linear;
+	for (int pass = 0; pass < 2; pass++) {
+		got.clear();
+		indexed[pass] = time_monotonic_us();
+		for (unsigned int nr = 0; nr <= total; nr += 3) {
+			CBouquetManager::ChannelIterator cit = g_bouquetManager->tvChannelsBegin().FindChannelNr(nr);
+			got.push_back(cit.EndOfChannels() ? NULL : *cit);
+		}
+		indexed[pass] = time_monotonic_us() - indexed[pass];
+	}
+	report("FindChannelNr", n, linear, indexed[0], indexed[1]);
+	check(got == expect, "FindChannelNr differs from the linear walk");
+
+	n = 0;
+	std::vector<int> expect_nr, got_nr;
+	linear = time_monotonic_us();
+	for (unsigned int i = 0; i < ids.size(); i += 11, n++)
+		expect_nr.push_back(linear_lowest(ids[i]));
+	linear = time_monotonic_us() - linear;
+	g_bouquetManager->invalidatePositions();
+	for (int pass = 0; pass < 2; pass++) {
+		got_nr.clear();
+		indexed[pass] = time_monotonic_us();
+		for (unsigned int i = 0; i < ids.size(); i += 11)
+			got_nr.push_back(g_bouquetManager->tvChannelsBegin().getLowestChannelNumberWithChannelID(ids[i]));
+		indexed[pass] = time_monotonic_us() - indexed[pass];
+	}
+	report("getLowestChannelNumber", n, linear, indexed[0], indexed[1]);
+	check(got_nr == expect_nr, "getLowestChannelNumberWithChannelID differs from the linear walk");
+
+	/* a moved bouquet, the positions are built again */
+	if (g_bouquetManager->Bouquets.size() > 1) {
+		g_bouquetManager->moveBouquet(0, g_bouquetManager->Bouquets.size() - 1);
+		CBouquetManager::ChannelIterator cit = g_bouquetManager->tvChannelsBegin().FindChannelNr(0);
+		check(!cit.EndOfChannels() && *cit == linear_nr(0), "FindChannelNr after moveBouquet");
+	}
+	/* a channel added to a bouquet without renumbering */
+	if (!g_bouquetManager->Bouquets.empty()) {
+		CZapitChannel *channel = new CZapitChannel("Added", 0xfff0, 0x1, 0x1, ST_DIGITAL_TELEVISION_SERVICE, 192, 12000);
+		if (sm->AddChannel(channel)) {
+			g_bouquetManager->Bouquets.back()->addService(channel);
+			CBouquetManager::ChannelIterator cit = g_bouquetManager->tvChannelsBegin().FindChannelNr(total);
+			check(!cit.EndOfChannels() && *cit == channel, "FindChannelNr after addService");
+			check(g_bouquetManager->tvChannelsBegin().getLowestChannelNumberWithChannelID(channel->getChannelID()) ==
+					linear_lowest(channel->getChannelID()), "getLowestChannelNumberWithChannelID after addService");
+		}
+	}
+
+	delete g_bouquetManager;
+	return check_result();
+}
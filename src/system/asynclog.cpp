@@ -0,0 +1,305 @@
+/*
+	Neutrino-GUI  -   DBoxII-Project
+
+	asynchronous backend of the debug macros
+
+	License: GPL
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/syscall.h>
+
+#include <system/asynclog.h>
+#include <system/set_threadname.h>
+
+volatile bool asynclog_enabled = getenv("NEUTRINO_LOG_ASYNC") || getenv("NEUTRINO_LOG_COMPACT");
+
+/* single producer (the owning thread), single consumer (the flusher).
+   head and tail count bytes and wrap around */
+struct log_ring
+{
+	char buf[ASYNCLOG_RING_SIZE];
+	volatile uint32_t head;
+	volatile uint32_t tail;
+	volatile uint32_t dropped;	/* lines which did not fit */
+	uint32_t dropped_seen;		/* reported by the flusher */
+	uint32_t tid;
+	volatile bool used;
+	log_ring * volatile next;
+};
+
+static log_ring * volatile rings = NULL;
+static pthread_mutex_t rings_mutex = PTHREAD_MUTEX_INITIALIZER;	/* new rings */
+static pthread_mutex_t flush_mutex = PTHREAD_MUTEX_INITIALIZER;	/* reading side */
+static pthread_key_t ring_key;
+static pthread_once_t log_once = PTHREAD_ONCE_INIT;
+static int log_rate = 100;
+static int compact_fd = -1;
+
+static char compact_buf[16 * 1024];
+static size_t compact_len = 0;
+
+static void ring_release(void *p)
+{
+	/* the flusher still empties it, a new thread takes it after that */
+	((log_ring *) p)->used = false;
+}
+
+static void ring_write(log_ring *r, uint32_t pos, const void *src, uint32_t n)
+{
+	uint32_t off = pos & (ASYNCLOG_RING_SIZE - 1);
+	uint32_t first = ASYNCLOG_RING_SIZE - off;
+	if (first > n)
+		first = n;
+	memcpy(r->buf + off, src, first);
+	memcpy(r->buf, (const char *) src + first, n - first);
+}
+
+static void ring_read(log_ring *r, uint32_t pos, void *dst, uint32_t n)
+{
+	uint32_t off = pos & (ASYNCLOG_RING_SIZE - 1);
+	uint32_t first = ASYNCLOG_RING_SIZE - off;
+	if (first > n)
+		first = n;
+	memcpy(dst, r->buf + off, first);
+	memcpy((char *) dst + first, r->buf, n - first);
+}
+
+static void compact_flush(void)
+{
+	size_t done = 0;
+	while (done < compact_len) {
+		ssize_t ret = write(compact_fd, compact_buf + done, compact_len - done);
+		if (ret <= 0)
+			break;
+		done += ret;
+	}
+	compact_len = 0;
+}
+
+static void compact_write(const void *data, size_t len)
+{
+	if (compact_len + len > sizeof(compact_buf))
+		compact_flush();
+	memcpy(compact_buf + compact_len, data, len);
+	compact_len += len;
+}
+
+static void output(const asynclog_record_t &rec, const char *text)
+{
+	if (compact_fd > -1) {
+		compact_write(&rec, sizeof(rec));
+		compact_write(text, rec.len);
+		return;
+	}
+	FILE *f = (rec.flags & ASYNCLOG_STDERR) ? stderr : stdout;
+	if (rec.flags & ASYNCLOG_DATE) {
+		time_t sec = rec.time / 1000000;
+		struct tm tm;
+		localtime_r(&sec, &tm);
+		fprintf(f, "%02d:%02d:%02d.%03d ", tm.tm_hour, tm.tm_min, tm.tm_sec, (int) (rec.time % 1000000) / 1000);
+	}
+	fwrite(text, 1, rec.len, f);
+}
+
+/* write out all rings, true if there was anything */
+static bool flush_rings(void)
+{
+	bool work = false;
+	asynclog_record_t rec;
+	char text[ASYNCLOG_LINE_MAX];
+
+	pthread_mutex_lock(&flush_mutex);
+	for (log_ring *r = rings; r; r = r->next) {
+		uint32_t head = r->head;
+		__sync_synchronize();
+		uint32_t tail = r->tail;
+		while (tail != head) {
+			ring_read(r, tail, &rec, sizeof(rec));
+			ring_read(r, tail + sizeof(rec), text, rec.len);
+			output(rec, text);
+			tail += sizeof(rec) + rec.len;
+			__sync_synchronize();
+			r->tail = tail;
+			work = true;
+		}
+		uint32_t dropped = r->dropped;
+		if (dropped != r->dropped_seen) {
+			fprintf(stderr, "[asynclog] thread %u: %u lines dropped, ring full\n", r->tid, dropped - r->dropped_seen);
+			r->dropped_seen = dropped;
+		}
+	}
+	if (work) {
+		if (compact_fd > -1)
+			compact_flush();
+		fflush(stdout);
+		fflush(stderr);
+	}
+	pthread_mutex_unlock(&flush_mutex);
+	return work;
+}
+
+static void *flush_thread(void *)
+{
+	set_threadname("asynclog");
+	while (true) {
+		if (!flush_rings())
+			usleep(ASYNCLOG_FLUSH_INTERVAL * 1000);
+	}
+	return NULL;
+}
+
+static void log_init(void)
+{
+	pthread_key_create(&ring_key, ring_release);
+
+	const char *rate = getenv("NEUTRINO_LOG_RATE");
+	if (rate)
+		log_rate = atoi(rate);
+
+	const char *file = getenv("NEUTRINO_LOG_COMPACT");
+	if (file && *file) {
+		compact_fd = open(file, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+		if (compact_fd < 0)
+			perror(file);
+	}
+
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, flush_thread, NULL)) {
+		perror("[asynclog] pthread_create");
+		asynclog_enabled = false;
+		return;
+	}
+	pthread_detach(thread);
+	atexit(asynclog_flush);
+}
+
+static log_ring *get_ring(void)
+{
+	log_ring *r = (log_ring *) pthread_getspecific(ring_key);
+	if (r)
+		return r;
+
+	pthread_mutex_lock(&rings_mutex);
+	for (r = rings; r; r = r->next)
+		if (!r->used && r->head == r->tail)
+			break;
+	if (!r) {
+		r = new log_ring;
+		r->head = r->tail = 0;
+		r->dropped = r->dropped_seen = 0;
+		r->next = rings;
+		__sync_synchronize();
+		rings = r;
+	}
+	r->tid = (uint32_t) syscall(SYS_gettid);
+	r->used = true;
+	pthread_mutex_unlock(&rings_mutex);
+	pthread_setspecific(ring_key, r);
+	return r;
+}
+
+static void push(int flags, const struct timeval &tv, const char *text, int len)
+{
+	log_ring *r = get_ring();
+	uint32_t need = sizeof(asynclog_record_t) + len;
+	uint32_t head = r->head;
+	if (ASYNCLOG_RING_SIZE - (head - r->tail) < need) {
+		r->dropped++;
+		return;
+	}
+
+	asynclog_record_t rec;
+	rec.time = (int64_t) tv.tv_sec * 1000000 + tv.tv_usec;
+	rec.tid = r->tid;
+	rec.len = len;
+	rec.flags = flags;
+	rec.reserved = 0;
+	ring_write(r, head, &rec, sizeof(rec));
+	ring_write(r, head + sizeof(rec), text, len);
+	__sync_synchronize();
+	r->head = head + need;
+}
+
+void asynclog_vprintf(asynclog_site_t *site, int flags, const char *fmt, va_list ap)
+{
+	/* no flush thread and no ring key, as long as it is not used. a
+	   failed init falls back to the direct output */
+	if (asynclog_enabled)
+		pthread_once(&log_once, log_init);
+	if (!asynclog_enabled) {
+		FILE *f = (flags & ASYNCLOG_STDERR) ? stderr : stdout;
+		vfprintf(f, fmt, ap);
+		return;
+	}
+
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+
+	/* several threads may pass the same site, the limit is not exact then */
+	if (site && log_rate > 0) {
+		if (site->second != (int32_t) tv.tv_sec) {
+			uint32_t suppressed = site->suppressed;
+			site->second = tv.tv_sec;
+			site->count = 0;
+			site->suppressed = 0;
+			if (suppressed) {
+				char line[128];
+				int len = snprintf(line, sizeof(line), "[asynclog] %u lines suppressed: %.60s", suppressed, fmt);
+				if (len >= (int) sizeof(line))
+					len = sizeof(line) - 1;
+				char *nl = strchr(line, '\n');
+				if (nl)
+					len = nl - line;
+				line[len++] = '\n';
+				push(flags, tv, line, len);
+			}
+		}
+		if (++site->count > (uint32_t) log_rate) {
+			site->suppressed++;
+			return;
+		}
+	}
+
+	char line[ASYNCLOG_LINE_MAX];
+	int len = vsnprintf(line, sizeof(line), fmt, ap);
+	if (len < 0)
+		return;
+	if (len >= (int) sizeof(line))
+		len = sizeof(line) - 1;
+	push(flags, tv, line, len);
+}
+
+void asynclog_printf(asynclog_site_t *site, int flags, const char *fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	asynclog_vprintf(site, flags, fmt, ap);
+	va_end(ap);
+}
+
+void asynclog_flush(void)
+{
+	if (rings)
+		flush_rings();
+}
@@ -0,0 +1,79 @@
+/*
+	Neutrino-GUI  -   DBoxII-Project
+
+	asynchronous backend of the debug macros. every thread formats its
+	lines into its own ring, one thread writes them out, so a debug line
+	costs no lock and no i/o in the caller.
+
+	License: GPL
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#ifndef __asynclog_h__
+#define __asynclog_h__
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <inttypes.h>
+
+/* environment:
+ *   NEUTRINO_LOG_ASYNC		enables the backend
+ *   NEUTRINO_LOG_RATE=n	lines per second of one call site, default 100
+ *   NEUTRINO_LOG_COMPACT=file	write binary records to file instead of
+ *				text to stdout/stderr, implies NEUTRINO_LOG_ASYNC
+ */
+extern volatile bool asynclog_enabled;
+
+#define ASYNCLOG_LINE_MAX	1024
+#define ASYNCLOG_RING_SIZE	(64 * 1024)	/* per thread, power of two */
+#define ASYNCLOG_FLUSH_INTERVAL	50		/* ms */
+
+/* flags of a line */
+#define ASYNCLOG_STDERR		0x01
+#define ASYNCLOG_DATE		0x02		/* prefix hh:mm:ss.ms */
+
+/* a record in the ring, and in the compact file. len bytes of text follow,
+   without terminating 0 */
+typedef struct asynclog_record
+{
+	int64_t		time;		/* gettimeofday, us */
+	uint32_t	tid;
+	uint16_t	len;
+	uint8_t		flags;
+	uint8_t		reserved;
+} asynclog_record_t;
+
+/* one per call site, for the rate limit */
+typedef struct asynclog_site
+{
+	volatile int32_t	second;
+	volatile uint32_t	count;
+	volatile uint32_t	suppressed;
+} asynclog_site_t;
+
+void asynclog_printf(asynclog_site_t *site, int flags, const char *fmt, ...) __attribute__ ((format (printf, 3, 4)));
+void asynclog_vprintf(asynclog_site_t *site, int flags, const char *fmt, va_list ap);
+/* write out what is buffered, e.g. before a crash dump or exit */
+void asynclog_flush(void);
+
+/* front end for the debug macros: the rate limit is kept per expansion */
+#define ASYNCLOG_PRINTF(flags, fmt, args...) \
+	do { \
+		static asynclog_site_t __asynclog_site; \
+		asynclog_printf(&__asynclog_site, flags, fmt, ## args); \
+	} while (0)
+
+#endif
@@ -25,6 +25,7 @@
 #ifndef __neutrino_debug__
 #define __neutrino_debug__
 #include <zapit/debug.h>
+#include <system/asynclog.h>
 extern int debug;
 
 enum
@@ -41,8 +42,12 @@ void setDebugLevel( int level );
 
 #define dprintf(debuglevel, fmt, args...) \
 	do { \
-		if (debug >= debuglevel) \
-			printf( "[neutrino] " fmt, ## args); \
+		if (debug >= debuglevel) { \
+			if (asynclog_enabled) \
+				ASYNCLOG_PRINTF(0, "[neutrino] " fmt, ## args); \
+			else \
+				printf( "[neutrino] " fmt, ## args); \
+		} \
 	} while(0)
 #define dperror(str) {perror("[neutrino] " str);}
 
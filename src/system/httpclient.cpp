@@ -0,0 +1,767 @@
+/*
+	Neutrino-GUI  -   DBoxII-Project
+
+	shared HTTP client: one curl multi handle for all downloads, with
+	connection reuse, priorities and a bounded disk cache
+
+	License: GPL
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <curl/curl.h>
+#include <algorithm>
+
+#include <global.h>
+#include <system/set_threadname.h>
+#include <system/debug.h>
+#include "httpclient.h"
+
+/* transfers running at the same time */
+#define HTTP_MAX_TRANSFERS	6
+/* connections to the same server */
+#define HTTP_MAX_HOST_CONN	2
+#define HTTP_TIMEOUT		60
+#define HTTP_CACHE_DIR		"/tmp/httpcache"
+#define HTTP_CACHE_SIZE		(4 * 1024 * 1024)
+/* without max-age, a response with Last-Modified stays fresh for a tenth
+   of its age, but not longer than this */
+#define HTTP_CACHE_HEURISTIC	(24 * 60 * 60)
+
+struct CHTTPClient::transfer
+{
+	CHTTPRequest *req;
+	CHTTPRequest own;		/* the request of a prefetch */
+	bool detached;			/* nobody waits, delete when done */
+	bool started;
+	bool done;
+	bool cancel;
+	CURL *curl;
+	struct curl_slist *headers;
+	FILE *fp;
+	char error[CURL_ERROR_SIZE];
+	double dltotal;			/* progress, under the client mutex */
+	double dlnow;
+
+	std::string key;		/* of the cache */
+	bool revalidate;		/* the cache has a stale copy */
+	std::string if_etag;
+	std::string if_lastmod;
+
+	/* response headers */
+	std::string etag;
+	std::string lastmod;
+	long maxage;
+	bool nostore;
+
+	transfer(CHTTPRequest *r)
+	{
+		req = r ? r : &own;
+		detached = (r == NULL);
+		started = done = cancel = false;
+		curl = NULL;
+		headers = NULL;
+		fp = NULL;
+		error[0] = 0;
+		dltotal = dlnow = 0;
+		revalidate = false;
+		maxage = -1;
+		nostore = false;
+	}
+};
+
+CHTTPRequest::CHTTPRequest(const std::string &_url)
+{
+	url = _url;
+	prio = PRIO_NORMAL;
+	cache = true;
+	follow = true;
+	verifypeer = true;
+	timeout = 0;
+	connecttimeout = 0;
+	progress = NULL;
+	progress_data = NULL;
+	ok = false;
+	code = 0;
+	cached = false;
+}
+
+static bool readFile(const std::string &name, std::string &data)
+{
+	FILE *f = fopen(name.c_str(), "r");
+	if (!f)
+		return false;
+	data.clear();
+	char buf[4096];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+		data.append(buf, n);
+	bool ok = !ferror(f);
+	fclose(f);
+	return ok;
+}
+
+static bool writeFile(const std::string &name, const std::string &data)
+{
+	FILE *f = fopen(name.c_str(), "w");
+	if (!f)
+		return false;
+	bool ok = (fwrite(data.data(), 1, data.size(), f) == data.size());
+	if (fclose(f))
+		ok = false;
+	if (!ok)
+		unlink(name.c_str());
+	return ok;
+}
+
+static size_t writeData(void *ptr, size_t size, size_t nmemb, void *data)
+{
+	std::string *answer = (std::string *) data;
+	answer->append((char *) ptr, size * nmemb);
+	return size * nmemb;
+}
+
+static std::string trim(const std::string &s)
+{
+	size_t start = s.find_first_not_of(" \t\r\n");
+	if (start == std::string::npos)
+		return "";
+	return s.substr(start, s.find_last_not_of(" \t\r\n") - start + 1);
+}
+
+CHTTPClient::CHTTPClient()
+{
+	curl_global_init(CURL_GLOBAL_ALL);
+	CURLM *m = curl_multi_init();
+	curl_multi_setopt(m, CURLMOPT_MAXCONNECTS, (long) HTTP_MAX_TRANSFERS * 2);
+#if LIBCURL_VERSION_NUM >= 0x071e00
+	curl_multi_setopt(m, CURLMOPT_MAX_HOST_CONNECTIONS, (long) HTTP_MAX_HOST_CONN);
+#endif
+	multi = m;
+
+	pthread_mutex_init(&mutex, NULL);
+	pthread_cond_init(&cond, NULL);
+	active = 0;
+
+	cache_dir = HTTP_CACHE_DIR;
+	cache_max = HTTP_CACHE_SIZE;
+	cache_size = 0;
+	cache_loaded = false;
+
+	running = true;
+	if (pipe(wakeup)) {
+		perror("[CHTTPClient] pipe");
+		wakeup[0] = wakeup[1] = -1;
+	} else {
+		fcntl(wakeup[0], F_SETFL, O_NONBLOCK);
+		fcntl(wakeup[1], F_SETFL, O_NONBLOCK);
+	}
+	if (pthread_create(&thread, NULL, Run, (void *) this)) {
+		perror("[CHTTPClient] pthread_create");
+		thread = 0;
+	}
+}
+
+CHTTPClient::~CHTTPClient()
+{
+	pthread_mutex_lock(&mutex);
+	running = false;
+	pthread_mutex_unlock(&mutex);
+	signalThread();
+	if (thread)
+		pthread_join(thread, NULL);
+	curl_multi_cleanup((CURLM *) multi);
+	if (wakeup[0] >= 0) {
+		close(wakeup[0]);
+		close(wakeup[1]);
+	}
+	pthread_cond_destroy(&cond);
+	pthread_mutex_destroy(&mutex);
+}
+
+CHTTPClient *CHTTPClient::getInstance()
+{
+	static CHTTPClient *instance = NULL;
+	static pthread_mutex_t instance_mutex = PTHREAD_MUTEX_INITIALIZER;
+	pthread_mutex_lock(&instance_mutex);
+	if (!instance)
+		instance = new CHTTPClient();
+	pthread_mutex_unlock(&instance_mutex);
+	return instance;
+}
+
+void CHTTPClient::signalThread(void)
+{
+	if (wakeup[1] >= 0) {
+		char c = 0;
+		if (write(wakeup[1], &c, 1) < 0 && errno != EAGAIN)
+			perror("[CHTTPClient] write");
+	}
+}
+
+void *CHTTPClient::Run(void *arg)
+{
+	set_threadname("n:httpclient");
+	((CHTTPClient *) arg)->run();
+	return NULL;
+}
+
+void CHTTPClient::run(void)
+{
+	CURLM *m = (CURLM *) multi;
+	while (true) {
+		std::list<transfer *> start;
+		pthread_mutex_lock(&mutex);
+		if (!running) {
+			pthread_mutex_unlock(&mutex);
+			break;
+		}
+		while (active < HTTP_MAX_TRANSFERS && !pending.empty()) {
+			transfer *t = pending.front();
+			pending.pop_front();
+			t->started = true;
+			start.push_back(t);
+			active++;
+		}
+		pthread_mutex_unlock(&mutex);
+
+		for (std::list<transfer *>::iterator it = start.begin(); it != start.end(); ++it)
+			startTransfer(*it);
+
+		int still;
+		curl_multi_perform(m, &still);
+
+		CURLMsg *msg;
+		int left;
+		while ((msg = curl_multi_info_read(m, &left)) != NULL) {
+			if (msg->msg != CURLMSG_DONE)
+				continue;
+			transfer *t = NULL;
+			CURLcode res = msg->data.result;
+			curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **) &t);
+			finishTransfer(t, res);
+		}
+
+		struct curl_waitfd wfd;
+		wfd.fd = wakeup[0];
+		wfd.events = CURL_WAIT_POLLIN;
+		wfd.revents = 0;
+		int numfds;
+		curl_multi_wait(m, &wfd, wakeup[0] >= 0 ? 1 : 0, active ? 1000 : 10000, &numfds);
+		char buf[64];
+		while (wakeup[0] >= 0 && read(wakeup[0], buf, sizeof(buf)) > 0)
+			;
+	}
+}
+
+void CHTTPClient::startTransfer(transfer *t)
+{
+	CHTTPRequest *req = t->req;
+	CURL *c = curl_easy_init();
+	t->curl = c;
+	if (!c) {
+		finishTransfer(t, CURLE_FAILED_INIT);
+		return;
+	}
+
+	curl_easy_setopt(c, CURLOPT_URL, req->url.c_str());
+	curl_easy_setopt(c, CURLOPT_PRIVATE, (char *) t);
+	if (req->file.empty()) {
+		curl_easy_setopt(c, CURLOPT_WRITEFUNCTION, writeData);
+		curl_easy_setopt(c, CURLOPT_WRITEDATA, (void *) &req->answer);
+	}
+	curl_easy_setopt(c, CURLOPT_HEADERFUNCTION, headerData);
+	curl_easy_setopt(c, CURLOPT_HEADERDATA, (void *) t);
+#if LIBCURL_VERSION_NUM >= 0x072000
+	curl_easy_setopt(c, CURLOPT_XFERINFOFUNCTION, progressData);
+	curl_easy_setopt(c, CURLOPT_XFERINFODATA, (void *) t);
+#else
+	curl_easy_setopt(c, CURLOPT_PROGRESSFUNCTION, progressData);
+	curl_easy_setopt(c, CURLOPT_PROGRESSDATA, (void *) t);
+#endif
+	curl_easy_setopt(c, CURLOPT_NOPROGRESS, (long) 0);
+	curl_easy_setopt(c, CURLOPT_FAILONERROR, (long) 1);
+	curl_easy_setopt(c, CURLOPT_NOSIGNAL, (long) 1);
+	curl_easy_setopt(c, CURLOPT_SSL_VERIFYPEER, (long) req->verifypeer);
+	curl_easy_setopt(c, CURLOPT_ENCODING, "");
+	curl_easy_setopt(c, CURLOPT_TIMEOUT, req->timeout ? req->timeout : (long) HTTP_TIMEOUT);
+	if (req->connecttimeout)
+		curl_easy_setopt(c, CURLOPT_CONNECTTIMEOUT_MS, req->connecttimeout);
+	if (req->follow)
+		curl_easy_setopt(c, CURLOPT_FOLLOWLOCATION, (long) 1);
+	if (!req->useragent.empty())
+		curl_easy_setopt(c, CURLOPT_USERAGENT, req->useragent.c_str());
+	curl_easy_setopt(c, CURLOPT_ERRORBUFFER, t->error);
+
+	if (!g_settings.softupdate_proxyserver.empty()) {
+		curl_easy_setopt(c, CURLOPT_PROXY, g_settings.softupdate_proxyserver.c_str());
+		if (!g_settings.softupdate_proxyusername.empty()) {
+			std::string tmp = g_settings.softupdate_proxyusername + ":" + g_settings.softupdate_proxypassword;
+			curl_easy_setopt(c, CURLOPT_PROXYUSERPWD, tmp.c_str());
+		}
+	}
+
+	if (t->revalidate) {
+		if (!t->if_etag.empty())
+			t->headers = curl_slist_append(t->headers, ("If-None-Match: " + t->if_etag).c_str());
+		if (!t->if_lastmod.empty())
+			t->headers = curl_slist_append(t->headers, ("If-Modified-Since: " + t->if_lastmod).c_str());
+		curl_easy_setopt(c, CURLOPT_HTTPHEADER, t->headers);
+	}
+
+	if (!req->file.empty()) {
+		/* after a 304, the file is written from the cache */
+		t->fp = fopen(req->file.c_str(), "w");
+		if (!t->fp) {
+			snprintf(t->error, sizeof(t->error), "%s: %s", req->file.c_str(), strerror(errno));
+			finishTransfer(t, CURLE_WRITE_ERROR);
+			return;
+		}
+		curl_easy_setopt(c, CURLOPT_WRITEFUNCTION, NULL);
+		curl_easy_setopt(c, CURLOPT_WRITEDATA, t->fp);
+	}
+
+	curl_multi_add_handle((CURLM *) multi, c);
+}
+
+size_t CHTTPClient::headerData(char *ptr, size_t size, size_t nmemb, void *data)
+{
+	transfer *t = (transfer *) data;
+	size_t len = size * nmemb;
+	std::string line = trim(std::string(ptr, len));
+	/* a new response, after a redirect */
+	if (line.compare(0, 5, "HTTP/") == 0) {
+		t->etag.clear();
+		t->lastmod.clear();
+		t->maxage = -1;
+		t->nostore = false;
+		return len;
+	}
+	size_t colon = line.find(':');
+	if (colon == std::string::npos)
+		return len;
+	std::string name = line.substr(0, colon);
+	std::string value = trim(line.substr(colon + 1));
+	if (!strcasecmp(name.c_str(), "ETag"))
+		t->etag = value;
+	else if (!strcasecmp(name.c_str(), "Last-Modified"))
+		t->lastmod = value;
+	else if (!strcasecmp(name.c_str(), "Cache-Control")) {
+		if (strcasestr(value.c_str(), "no-store"))
+			t->nostore = true;
+		if (strcasestr(value.c_str(), "no-cache"))
+			t->maxage = 0;
+		const char *p = strcasestr(value.c_str(), "max-age=");
+		if (p && t->maxage != 0)
+			t->maxage = atol(p + 8);
+	}
+	return len;
+}
+
+#if LIBCURL_VERSION_NUM >= 0x072000
+int CHTTPClient::progressData(void *data, curl_off_t dltotal, curl_off_t dlnow, curl_off_t /*ultotal*/, curl_off_t /*ulnow*/)
+#else
+int CHTTPClient::progressData(void *data, double dltotal, double dlnow, double /*ultotal*/, double /*ulnow*/)
+#endif
+{
+	transfer *t = (transfer *) data;
+	/* read by the thread waiting for the transfer */
+	CHTTPClient *client = getInstance();
+	pthread_mutex_lock(&client->mutex);
+	t->dltotal = dltotal;
+	t->dlnow = dlnow;
+	bool cancel = t->cancel;
+	pthread_mutex_unlock(&client->mutex);
+	return cancel ? 1 : 0;
+}
+
+void CHTTPClient::finishTransfer(transfer *t, int res)
+{
+	CHTTPRequest *req = t->req;
+	long code = 0;
+	if (t->curl) {
+		curl_easy_getinfo(t->curl, CURLINFO_RESPONSE_CODE, &code);
+		curl_multi_remove_handle((CURLM *) multi, t->curl);
+		curl_easy_cleanup(t->curl);
+		t->curl = NULL;
+	}
+	if (t->headers) {
+		curl_slist_free_all(t->headers);
+		t->headers = NULL;
+	}
+	if (t->fp) {
+		if (fclose(t->fp) && res == CURLE_OK)
+			res = CURLE_WRITE_ERROR;
+		t->fp = NULL;
+	}
+
+	pthread_mutex_lock(&mutex);
+	req->code = code;
+	if (res == CURLE_OK && code == 304 && t->revalidate) {
+		req->ok = cacheRead(t->key, *req);
+		req->cached = req->ok;
+		if (req->ok) {
+			cacheStore(t);
+		} else {
+			cacheRemove(t->key);
+			req->error = "cached copy lost";
+		}
+	} else if (res == CURLE_OK) {
+		req->ok = true;
+		cacheStore(t);
+	} else {
+		req->error = t->error[0] ? t->error : curl_easy_strerror((CURLcode) res);
+		dprintf(DEBUG_NORMAL, "[CHTTPClient] %s: %s\n", req->url.c_str(), req->error.c_str());
+	}
+	active--;
+	t->done = true;
+	pthread_cond_broadcast(&cond);
+	if (t->detached)
+		delete t;
+	pthread_mutex_unlock(&mutex);
+}
+
+bool CHTTPClient::perform(CHTTPRequest &req)
+{
+	req.ok = false;
+	req.cached = false;
+	req.code = 0;
+	req.error.clear();
+	if (req.file.empty())
+		req.answer.clear();
+
+	transfer t(&req);
+	pthread_mutex_lock(&mutex);
+	if (cacheLookup(&t)) {
+		pthread_mutex_unlock(&mutex);
+		return true;
+	}
+	std::list<transfer *>::iterator it = pending.begin();
+	while (it != pending.end() && (*it)->req->prio <= req.prio)
+		++it;
+	pending.insert(it, &t);
+	pthread_mutex_unlock(&mutex);
+	signalThread();
+
+	pthread_mutex_lock(&mutex);
+	while (!t.done) {
+		if (!req.progress) {
+			pthread_cond_wait(&cond, &mutex);
+			continue;
+		}
+		struct timespec abs_wait;
+		clock_gettime(CLOCK_REALTIME, &abs_wait);
+		abs_wait.tv_nsec += 200 * 1000 * 1000;
+		if (abs_wait.tv_nsec >= 1000 * 1000 * 1000) {
+			abs_wait.tv_sec++;
+			abs_wait.tv_nsec -= 1000 * 1000 * 1000;
+		}
+		pthread_cond_timedwait(&cond, &mutex, &abs_wait);
+		if (t.done)
+			break;
+		double dltotal = t.dltotal, dlnow = t.dlnow;
+		pthread_mutex_unlock(&mutex);
+		int cancel = req.progress(req.progress_data, dltotal, dlnow);
+		pthread_mutex_lock(&mutex);
+		if (cancel && !t.done) {
+			t.cancel = true;
+			if (!t.started) {
+				pending.remove(&t);
+				req.error = "cancelled";
+				t.done = true;
+			}
+		}
+	}
+	pthread_mutex_unlock(&mutex);
+	return req.ok;
+}
+
+bool CHTTPClient::getUrl(const std::string &url, std::string &answer, int prio, long timeout, bool verifypeer)
+{
+	CHTTPRequest req(url);
+	req.prio = prio;
+	req.timeout = timeout;
+	req.verifypeer = verifypeer;
+	bool ok = perform(req);
+	answer.swap(req.answer);
+	return ok;
+}
+
+bool CHTTPClient::downloadUrl(const std::string &url, const std::string &file, int prio, long timeout, bool verifypeer)
+{
+	CHTTPRequest req(url);
+	req.file = file;
+	req.prio = prio;
+	req.timeout = timeout;
+	req.verifypeer = verifypeer;
+	return perform(req);
+}
+
+void CHTTPClient::prefetch(const std::string &url)
+{
+	transfer *t = new transfer(NULL);
+	t->req->url = url;
+	t->req->prio = CHTTPRequest::PRIO_LOW;
+	pthread_mutex_lock(&mutex);
+	bool queued = (cache_max == 0) || cacheLookup(t, false);
+	for (std::list<transfer *>::iterator it = pending.begin(); !queued && it != pending.end(); ++it)
+		queued = ((*it)->req->url == url);
+	if (queued) {
+		pthread_mutex_unlock(&mutex);
+		delete t;
+		return;
+	}
+	pending.push_back(t);
+	pthread_mutex_unlock(&mutex);
+	signalThread();
+}
+
+/* cache, everything below needs the mutex */
+
+std::string CHTTPClient::cacheKey(const std::string &url)
+{
+	/* FNV-1a */
+	uint64_t h = 0xcbf29ce484222325ULL;
+	for (size_t i = 0; i < url.size(); i++) {
+		h ^= (unsigned char) url[i];
+		h *= 0x100000001b3ULL;
+	}
+	char key[17];
+	snprintf(key, sizeof(key), "%016llx", (unsigned long long) h);
+	return key;
+}
+
+void CHTTPClient::cacheLoad(void)
+{
+	if (cache_loaded)
+		return;
+	cache_loaded = true;
+	cache.clear();
+	cache_size = 0;
+	if (mkdir(cache_dir.c_str(), 0755) && errno != EEXIST) {
+		perror(cache_dir.c_str());
+		cache_max = 0;
+		return;
+	}
+	DIR *d = opendir(cache_dir.c_str());
+	if (!d)
+		return;
+	struct dirent *e;
+	while ((e = readdir(d)) != NULL) {
+		std::string name = e->d_name;
+		if (name.size() != 20 || name.compare(16, 4, ".hdr"))
+			continue;
+		std::string key = name.substr(0, 16);
+		std::string hdr;
+		struct stat st;
+		if (!readFile(cache_dir + "/" + name, hdr) || stat((cache_dir + "/" + key).c_str(), &st)) {
+			cacheRemove(key);
+			continue;
+		}
+		/* url, etag, last-modified, expires */
+		std::string line[4];
+		size_t pos = 0;
+		for (int i = 0; i < 4 && pos < hdr.size(); i++) {
+			size_t end = hdr.find('\n', pos);
+			if (end == std::string::npos)
+				end = hdr.size();
+			line[i] = hdr.substr(pos, end - pos);
+			pos = end + 1;
+		}
+		cache_entry &c = cache[key];
+		c.url = line[0];
+		c.etag = line[1];
+		c.lastmod = line[2];
+		c.expires = atol(line[3].c_str());
+		c.used = st.st_mtime;
+		c.size = st.st_size;
+		cache_size += c.size;
+	}
+	closedir(d);
+	cacheTrim(cache_max);
+}
+
+/* serves a fresh copy, or prepares revalidation of a stale one */
+bool CHTTPClient::cacheLookup(transfer *t, bool read)
+{
+	CHTTPRequest *req = t->req;
+	if (!req->cache || cache_max == 0)
+		return false;
+	cacheLoad();
+	t->key = cacheKey(req->url);
+	std::map<std::string, cache_entry>::iterator it = cache.find(t->key);
+	if (it == cache.end() || it->second.url != req->url)
+		return false;
+	time_t now = time(NULL);
+	if (it->second.expires > now) {
+		if (!read)
+			return true;
+		if (cacheRead(t->key, *req)) {
+			req->ok = true;
+			req->cached = true;
+			req->code = 200;
+			return true;
+		}
+		cacheRemove(t->key);
+		return false;
+	}
+	if (!it->second.etag.empty() || !it->second.lastmod.empty()) {
+		t->revalidate = true;
+		t->if_etag = it->second.etag;
+		t->if_lastmod = it->second.lastmod;
+	}
+	return false;
+}
+
+bool CHTTPClient::cacheRead(const std::string &key, CHTTPRequest &req)
+{
+	std::map<std::string, cache_entry>::iterator it = cache.find(key);
+	if (it == cache.end())
+		return false;
+	std::string data;
+	if (!readFile(cache_dir + "/" + key, data))
+		return false;
+	if (req.file.empty())
+		req.answer.swap(data);
+	else if (!writeFile(req.file, data))
+		return false;
+	it->second.used = time(NULL);
+	return true;
+}
+
+void CHTTPClient::cacheStore(transfer *t)
+{
+	CHTTPRequest *req = t->req;
+	if (!req->cache || cache_max == 0 || t->nostore || t->key.empty())
+		return;
+
+	std::map<std::string, cache_entry>::iterator it = cache.find(t->key);
+	if (req->code == 304) {
+		/* only the header changes */
+		if (it == cache.end())
+			return;
+		if (t->etag.empty())
+			t->etag = it->second.etag;
+		if (t->lastmod.empty())
+			t->lastmod = it->second.lastmod;
+	}
+	if (t->etag.empty() && t->lastmod.empty() && t->maxage <= 0)
+		return;
+
+	time_t now = time(NULL);
+	cache_entry c;
+	c.url = req->url;
+	c.etag = t->etag;
+	c.lastmod = t->lastmod;
+	c.used = now;
+	if (t->maxage >= 0)
+		c.expires = now + t->maxage;
+	else {
+		time_t modified = c.lastmod.empty() ? -1 : curl_getdate(c.lastmod.c_str(), NULL);
+		time_t fresh = (modified > 0 && modified < now) ? (now - modified) / 10 : 0;
+		c.expires = now + std::min(fresh, (time_t) HTTP_CACHE_HEURISTIC);
+	}
+
+	std::string data;
+	std::string name = cache_dir + "/" + t->key;
+	if (req->code == 304) {
+		c.size = it->second.size;
+		it->second = c;
+	} else {
+		if (req->file.empty())
+			data = req->answer;
+		else {
+			struct stat st;
+			if (stat(req->file.c_str(), &st) || (size_t) st.st_size > cache_max / 4)
+				return;
+			if (!readFile(req->file, data))
+				return;
+		}
+		if (data.size() > cache_max / 4)
+			return;
+		cacheRemove(t->key);
+		if (!writeFile(name, data))
+			return;
+		c.size = data.size();
+		cache[t->key] = c;
+		cache_size += c.size;
+	}
+	char expires[32];
+	snprintf(expires, sizeof(expires), "%ld", (long) c.expires);
+	std::string hdr = c.url + "\n" + c.etag + "\n" + c.lastmod + "\n" + expires + "\n";
+	if (!writeFile(name + ".hdr", hdr)) {
+		cacheRemove(t->key);
+		return;
+	}
+	cacheTrim(cache_max);
+}
+
+void CHTTPClient::cacheRemove(const std::string &key)
+{
+	std::map<std::string, cache_entry>::iterator it = cache.find(key);
+	if (it != cache.end()) {
+		cache_size -= it->second.size;
+		cache.erase(it);
+	}
+	std::string name = cache_dir + "/" + key;
+	unlink(name.c_str());
+	name += ".hdr";
+	unlink(name.c_str());
+}
+
+/* removes the least recently used entries */
+void CHTTPClient::cacheTrim(size_t limit)
+{
+	while (cache_size > limit && !cache.empty()) {
+		std::map<std::string, cache_entry>::iterator oldest = cache.begin();
+		for (std::map<std::string, cache_entry>::iterator it = cache.begin(); it != cache.end(); ++it)
+			if (it->second.used < oldest->second.used)
+				oldest = it;
+		cacheRemove(oldest->first);
+	}
+}
+
+void CHTTPClient::setCache(const std::string &dir, size_t max_size)
+{
+	pthread_mutex_lock(&mutex);
+	cache_dir = dir;
+	cache_max = max_size;
+	cache_loaded = false;
+	cache.clear();
+	cache_size = 0;
+	pthread_mutex_unlock(&mutex);
+}
+
+void CHTTPClient::clearCache(void)
+{
+	pthread_mutex_lock(&mutex);
+	cacheLoad();
+	cacheTrim(0);
+	pthread_mutex_unlock(&mutex);
+}
@@ -0,0 +1,134 @@
+/*
+	Neutrino-GUI  -   DBoxII-Project
+
+	shared HTTP client: one curl multi handle for all downloads, with
+	connection reuse, priorities and a bounded disk cache
+
+	License: GPL
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#ifndef __httpclient__
+#define __httpclient__
+
+#include <string>
+#include <list>
+#include <map>
+#include <pthread.h>
+#include <time.h>
+#include <curl/curl.h>
+
+/* progress of a transfer, called in the thread waiting for it. a return
+   value other than 0 cancels the transfer */
+typedef int (*http_progress_t)(void *data, double dltotal, double dlnow);
+
+struct CHTTPRequest
+{
+	enum {
+		PRIO_HIGH,		/* the user is waiting for it */
+		PRIO_NORMAL,
+		PRIO_LOW		/* background downloads */
+	};
+
+	std::string url;
+	std::string file;		/* download to this file, if set */
+	std::string answer;		/* else the response is stored here */
+	int prio;
+	bool cache;			/* use the disk cache */
+	bool follow;			/* follow redirects */
+	bool verifypeer;		/* check the certificate of the server */
+	long timeout;			/* seconds */
+	long connecttimeout;		/* milliseconds */
+	std::string useragent;
+	http_progress_t progress;
+	void *progress_data;
+
+	/* result */
+	bool ok;
+	long code;			/* HTTP response code */
+	bool cached;			/* served from the cache */
+	std::string error;
+
+	CHTTPRequest(const std::string &_url = "");
+};
+
+class CHTTPClient
+{
+	private:
+		struct transfer;
+		struct cache_entry {
+			std::string url;
+			std::string etag;
+			std::string lastmod;
+			time_t expires;
+			time_t used;
+			size_t size;
+		};
+
+		void *multi;
+		pthread_t thread;
+		pthread_mutex_t mutex;
+		pthread_cond_t cond;
+		int wakeup[2];
+		bool running;
+		std::list<transfer *> pending;
+		int active;
+
+		std::string cache_dir;
+		size_t cache_max;
+		size_t cache_size;
+		bool cache_loaded;
+		std::map<std::string, cache_entry> cache;
+
+		CHTTPClient();
+		static void *Run(void *arg);
+		void run(void);
+		void startTransfer(transfer *t);
+		void finishTransfer(transfer *t, int res);
+		void signalThread(void);
+		static size_t headerData(char *ptr, size_t size, size_t nmemb, void *data);
+#if LIBCURL_VERSION_NUM >= 0x072000
+		static int progressData(void *data, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow);
+#else
+		static int progressData(void *data, double dltotal, double dlnow, double ultotal, double ulnow);
+#endif
+
+		static std::string cacheKey(const std::string &url);
+		void cacheLoad(void);
+		bool cacheLookup(transfer *t, bool read = true);
+		bool cacheRead(const std::string &key, CHTTPRequest &req);
+		void cacheStore(transfer *t);
+		void cacheTrim(size_t limit);
+		void cacheRemove(const std::string &key);
+	public:
+		~CHTTPClient();
+		static CHTTPClient *getInstance();
+
+		/* runs the request with the others, returns when it is done */
+		bool perform(CHTTPRequest &req);
+
+		bool getUrl(const std::string &url, std::string &answer, int prio = CHTTPRequest::PRIO_NORMAL, long timeout = 0, bool verifypeer = true);
+		bool downloadUrl(const std::string &url, const std::string &file, int prio = CHTTPRequest::PRIO_NORMAL, long timeout = 0, bool verifypeer = true);
+		/* download into the cache in background, for what is probably
+		   needed soon */
+		void prefetch(const std::string &url);
+
+		/* move the cache, e.g. to a local test directory. size 0 disables it */
+		void setCache(const std::string &dir, size_t max_size);
+		void clearCache(void);
+};
+
+#endif
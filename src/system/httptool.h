@@ -34,6 +34,7 @@
 #define __httptool__
 
 #include <gui/widget/progresswindow.h>
+#include <system/httpclient.h>
 
 #include <string>
 
@@ -45,8 +46,8 @@ class CHTTPTool
 		int	iGlobalProgressBegin;
 
 		CProgressWindow*	statusViewer;
-		static int show_progress( void *clientp, double dltotal, double dlnow, double ultotal, double ulnow);
-		static size_t CurlWriteToString(void *ptr, size_t size, size_t nmemb, void *data);
+		static int show_progress( void *clientp, double dltotal, double dlnow);
+		bool download(CHTTPRequest &req, int globalProgressEnd, int connecttimeout, int timeout);
 
 	public:
 		CHTTPTool();
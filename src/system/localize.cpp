@@ -38,14 +38,22 @@
 #include <system/localize.h>
 #include <system/locals_intern.h>
 
+#include <driver/abstime.h>
+
 #include <cstring>
 #include <fstream>
 #include <string>
 #include <iostream>
 #include <map>
+#include <vector>
+#include <algorithm>
+#include <errno.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <unistd.h>
 
 static const char * iso639filename = "/share/iso-codes/iso-639.tab";
@@ -93,6 +101,7 @@ CLocaleManager::CLocaleManager()
 	memcpy(localeData, locale_real_names, sizeof(locale_real_names));
 	memcpy(defaultData, locale_real_names, sizeof(locale_real_names));
 	defaultDataMem = localeDataMem = NULL;
+	defaultDataMapped = localeDataMapped = 0;
 
 	loadLocale(DEFAULT_LOCALE, true);
 }
@@ -102,30 +111,316 @@ CLocaleManager::~CLocaleManager()
 	delete[] localeData;
 	delete[] defaultData;
 
-	if (localeDataMem)
-		::free(localeDataMem);
-	if (defaultDataMem)
-		::free(defaultDataMem);
+	freeData(false);
+	freeData(true);
+}
+
+void CLocaleManager::freeData(bool asdefault)
+{
+	char **mem = asdefault ? &defaultDataMem : &localeDataMem;
+	size_t *mapped = asdefault ? &defaultDataMapped : &localeDataMapped;
+	if (*mem) {
+		if (*mapped)
+			munmap(*mem, *mapped);
+		else
+			::free(*mem);
+	}
+	*mem = NULL;
+	*mapped = 0;
 }
 
 const char * path[2] = { LOCALEDIR_VAR, LOCALEDIR };
 
+#define LOCALE_COUNT (sizeof(locale_real_names)/sizeof(const char *))
+
+/* hash index of locale_real_names, entry 0 is empty. a locale file has
+   thousands of keys, comparing each with all names took most of the time */
+static unsigned int *locale_index = NULL;
+static unsigned int locale_index_mask;
+
+static uint32_t locale_hash(const char *s, size_t len)
+{
+	uint32_t h = 2166136261U;	/* FNV-1a */
+	for (size_t i = 0; i < len; i++)
+		h = (h ^ (unsigned char) s[i]) * 16777619U;
+	return h;
+}
+
+static void build_locale_index(void)
+{
+	unsigned int size = 1;
+	while (size < 2 * LOCALE_COUNT)
+		size <<= 1;
+	locale_index = new unsigned int[size];
+	memset(locale_index, 0, size * sizeof(unsigned int));
+	locale_index_mask = size - 1;
+
+	for (unsigned int i = 1; i < LOCALE_COUNT; i++) {
+		unsigned int h = locale_hash(locale_real_names[i], strlen(locale_real_names[i])) & locale_index_mask;
+		while (locale_index[h])
+			h = (h + 1) & locale_index_mask;
+		locale_index[h] = i;
+	}
+}
+
+/* index into locale_real_names, 0 if the key is unknown */
+static unsigned int find_locale(const char *key, size_t len)
+{
+	unsigned int h = locale_hash(key, len) & locale_index_mask;
+	while (locale_index[h]) {
+		const char *name = locale_real_names[locale_index[h]];
+		if (!strncmp(name, key, len) && name[len] == 0)
+			return locale_index[h];
+		h = (h + 1) & locale_index_mask;
+	}
+	return 0;
+}
+
+/* compiled locales: written after a locale file was read, and mapped
+   instead of reading it again as long as the file does not change. the
+   texts are looked up by key with a perfect hash: a key hashes to a
+   bucket, the seed of the bucket to a slot no other key has */
+#define LOCALE_CACHEDIR		CONFIGDIR "/locale"
+#define LOCALE_BIN_MAGIC	0x42434c4e	/* NLCB */
+#define LOCALE_BIN_VERSION	1
+/* tries for the seed of a bucket */
+#define LOCALE_BIN_MAX_SEED	(1 << 20)
+
+struct locale_bin_header
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t names;		/* hash of locale_real_names of the writer */
+	uint32_t count;		/* texts */
+	uint32_t buckets;
+	uint32_t slots;
+	uint32_t size;		/* of the whole file */
+	uint32_t reserved;
+	int64_t src_size;	/* of the locale file */
+	int64_t src_mtime;
+};
+/* followed by uint32_t seed[buckets], locale_bin_slot[slots], the strings */
+
+struct locale_bin_slot
+{
+	uint32_t key;		/* offsets into the file, key 0: empty slot */
+	uint32_t text;
+};
+
+static uint64_t locale_hash64(const char *s, size_t len)
+{
+	uint64_t h = 14695981039346656037ULL;	/* FNV-1a */
+	for (size_t i = 0; i < len; i++)
+		h = (h ^ (unsigned char) s[i]) * 1099511628211ULL;
+	return h;
+}
+
+/* seed 0 gives the bucket, seed n + 1 the slot for bucket seed n */
+static uint32_t locale_mix(uint64_t h, uint32_t seed)
+{
+	h ^= seed * 0x9e3779b97f4a7c15ULL;
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return (uint32_t) h;
+}
+
+/* a compiled locale of another build may have other keys */
+static uint32_t locale_names_hash(void)
+{
+	static uint32_t names = 0;
+	if (!names) {
+		uint32_t h = 2166136261U;
+		for (unsigned int i = 1; i < LOCALE_COUNT; i++)
+			for (const char *p = locale_real_names[i]; ; p++) {
+				h = (h ^ (unsigned char) *p) * 16777619U;
+				if (!*p)
+					break;
+			}
+		names = h ? h : 1;
+	}
+	return names;
+}
+
+static std::string locale_bin_name(const char * const locale)
+{
+	return std::string(LOCALE_CACHEDIR "/") + locale + ".lcb";
+}
+
+bool CLocaleManager::loadCompiled(const char * const locale, const struct stat &src, bool asdefault)
+{
+	std::string filename = locale_bin_name(locale);
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) < 0 || st.st_size < (off_t) sizeof(locale_bin_header)) {
+		close(fd);
+		return false;
+	}
+	char *file = (char *) mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (file == MAP_FAILED)
+		return false;
+
+	const locale_bin_header *hdr = (const locale_bin_header *) file;
+	uint64_t tables = sizeof(*hdr) + (uint64_t) hdr->buckets * sizeof(uint32_t) + (uint64_t) hdr->slots * sizeof(locale_bin_slot);
+	if (hdr->magic != LOCALE_BIN_MAGIC || hdr->version != LOCALE_BIN_VERSION
+			|| hdr->names != locale_names_hash() || hdr->size != (uint64_t) st.st_size
+			|| hdr->src_size != (int64_t) src.st_size || hdr->src_mtime != (int64_t) src.st_mtime
+			|| !hdr->buckets || !hdr->slots || tables >= hdr->size || file[hdr->size - 1] != 0) {
+		munmap(file, st.st_size);
+		return false;
+	}
+
+	const uint32_t *seed = (const uint32_t *)(file + sizeof(*hdr));
+	const locale_bin_slot *slot = (const locale_bin_slot *)(seed + hdr->buckets);
+	char ** loadData = asdefault ? defaultData : localeData;
+
+	freeData(asdefault);
+	memcpy(loadData, locale_real_names, sizeof(locale_real_names));
+	for (unsigned int i = 1; i < LOCALE_COUNT; i++) {
+		const char *name = locale_real_names[i];
+		uint64_t h = locale_hash64(name, strlen(name));
+		const locale_bin_slot &e = slot[locale_mix(h, seed[locale_mix(h, 0) % hdr->buckets] + 1) % hdr->slots];
+		if (e.key >= tables && e.key < hdr->size && e.text >= tables && e.text < hdr->size && !strcmp(file + e.key, name))
+			loadData[i] = file + e.text;
+	}
+	if (asdefault) {
+		defaultDataMem = file;
+		defaultDataMapped = st.st_size;
+	} else {
+		localeDataMem = file;
+		localeDataMapped = st.st_size;
+	}
+	return true;
+}
+
+/* orders the buckets, the largest ones get their slots first */
+struct locale_bucket_cmp
+{
+	const std::vector<std::vector<unsigned int> > &members;
+	locale_bucket_cmp(const std::vector<std::vector<unsigned int> > &m) : members(m) {}
+	bool operator()(unsigned int a, unsigned int b) const { return members[a].size() > members[b].size(); }
+};
+
+/* the texts read from the locale file, before the missing ones are taken
+   from the default locale */
+void CLocaleManager::saveCompiled(const char * const locale, const struct stat &src, bool asdefault)
+{
+	char ** loadData = asdefault ? defaultData : localeData;
+	std::vector<unsigned int> keys;
+	for (unsigned int i = 1; i < LOCALE_COUNT; i++)
+		if (loadData[i] != locale_real_names[i])
+			keys.push_back(i);
+	if (keys.empty())
+		return;
+
+	locale_bin_header hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = LOCALE_BIN_MAGIC;
+	hdr.version = LOCALE_BIN_VERSION;
+	hdr.names = locale_names_hash();
+	hdr.count = keys.size();
+	hdr.buckets = hdr.count / 4 + 1;
+	hdr.slots = hdr.count + hdr.count / 8 + 1;
+	hdr.src_size = src.st_size;
+	hdr.src_mtime = src.st_mtime;
+
+	std::vector<uint64_t> hash(keys.size());
+	std::vector<std::vector<unsigned int> > members(hdr.buckets);
+	for (unsigned int k = 0; k < keys.size(); k++) {
+		const char *name = locale_real_names[keys[k]];
+		hash[k] = locale_hash64(name, strlen(name));
+		members[locale_mix(hash[k], 0) % hdr.buckets].push_back(k);
+	}
+	std::vector<unsigned int> order(hdr.buckets);
+	for (unsigned int b = 0; b < hdr.buckets; b++)
+		order[b] = b;
+	std::sort(order.begin(), order.end(), locale_bucket_cmp(members));
+
+	std::vector<uint32_t> seed(hdr.buckets, 0);
+	std::vector<int> slot_key(hdr.slots, -1);
+	std::vector<uint32_t> tried;
+	for (unsigned int o = 0; o < hdr.buckets; o++) {
+		const std::vector<unsigned int> &m = members[order[o]];
+		if (m.empty())
+			break;
+		uint32_t s;
+		for (s = 0; s < LOCALE_BIN_MAX_SEED; s++) {
+			tried.clear();
+			unsigned int j;
+			for (j = 0; j < m.size(); j++) {
+				uint32_t pos = locale_mix(hash[m[j]], s + 1) % hdr.slots;
+				if (slot_key[pos] >= 0 || std::find(tried.begin(), tried.end(), pos) != tried.end())
+					break;
+				tried.push_back(pos);
+			}
+			if (j == m.size())
+				break;
+		}
+		if (s == LOCALE_BIN_MAX_SEED) {
+			printf("[%s.locale] no perfect hash, not compiled\n", locale);
+			return;
+		}
+		seed[order[o]] = s;
+		for (unsigned int j = 0; j < m.size(); j++)
+			slot_key[tried[j]] = m[j];
+	}
+
+	/* keys and texts after the tables */
+	std::vector<locale_bin_slot> slots(hdr.slots);
+	std::string strings;
+	uint32_t base = sizeof(hdr) + hdr.buckets * sizeof(uint32_t) + hdr.slots * sizeof(locale_bin_slot);
+	for (unsigned int i = 0; i < hdr.slots; i++) {
+		slots[i].key = slots[i].text = 0;
+		if (slot_key[i] < 0)
+			continue;
+		unsigned int idx = keys[slot_key[i]];
+		slots[i].key = base + strings.size();
+		strings.append(locale_real_names[idx]);
+		strings.push_back(0);
+		slots[i].text = base + strings.size();
+		strings.append(loadData[idx]);
+		strings.push_back(0);
+	}
+	hdr.size = base + strings.size();
+
+	mkdir(LOCALE_CACHEDIR, 0755);
+	std::string filename = locale_bin_name(locale);
+	std::string tmpname = filename + ".tmp";
+	FILE *f = fopen(tmpname.c_str(), "w");
+	if (!f) {
+		perror(tmpname.c_str());
+		return;
+	}
+	bool ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1
+		&& fwrite(&seed[0], sizeof(uint32_t), seed.size(), f) == seed.size()
+		&& fwrite(&slots[0], sizeof(locale_bin_slot), slots.size(), f) == slots.size()
+		&& fwrite(strings.data(), 1, strings.size(), f) == strings.size();
+	if (fclose(f) || !ok || rename(tmpname.c_str(), filename.c_str())) {
+		perror(filename.c_str());
+		unlink(tmpname.c_str());
+	}
+}
+
 CLocaleManager::loadLocale_ret_t CLocaleManager::loadLocale(const char * const locale, bool asdefault)
 {
-	FILE * fd = NULL;
+	int fd = -1;
 	char ** loadData = asdefault ? defaultData : localeData;
 
 	char **mem = asdefault ? &defaultDataMem : &localeDataMem;
 
 	if(!asdefault && !strcmp(locale, DEFAULT_LOCALE)) {
-		if (*mem) {
-			free(*mem);
-			*mem = NULL;
-		}
+		freeData(asdefault);
 		memcpy(loadData, defaultData, sizeof(locale_real_names));
 		return UNICODE_FONT;
 	}
 
+	int64_t start = time_monotonic_us();
+
 	struct stat st;
 	for (unsigned int i = 0; i < 2; i++)
 	{
@@ -133,116 +428,118 @@ CLocaleManager::loadLocale_ret_t CLocaleManager::loadLocale(const char * const l
 		filename += "/";
 		filename += locale;
 		filename += ".locale";
-		::stat(filename.c_str(), &st);
-		
-		fd = fopen(filename.c_str(), "r");
-		if (fd)
+
+		fd = open(filename.c_str(), O_RDONLY);
+		if (fd > -1)
 			break;
 	}
-	
-	if (!fd)
-	{		
+
+	if (fd < 0 || fstat(fd, &st) < 0 || st.st_size == 0)
+	{
 		perror("cannot read locale");
+		if (fd > -1)
+			close(fd);
 		return NO_SUCH_LOCALE;
 	}
 
-	if (*mem) {
-		free (*mem);
-		*mem = NULL;
+	if (loadCompiled(locale, st, asdefault)) {
+		close(fd);
+		loadDone(locale, asdefault, true, start);
+		return UNICODE_FONT;
+	}
+
+	/* the file is parsed where it is mapped, only the texts are copied */
+	char *file = (char *) mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (file == MAP_FAILED)
+	{
+		perror("loadLocale: mmap");
+		return NO_SUCH_LOCALE;
 	}
 
+	freeData(asdefault);
+
+	if (!locale_index)
+		build_locale_index();
+
 	memcpy(loadData, locale_real_names, sizeof(locale_real_names));
 
 	*mem = (char *) malloc(st.st_size);
 	if (!*mem)
 	{
 		perror("loadLocale");
+		munmap(file, st.st_size);
 		return NO_SUCH_LOCALE;
 	}
 	char *memp = *mem;
 
-	char *buf=NULL;
-	size_t len = 0;
-
-	while(!feof(fd))
+	const char *end = file + st.st_size;
+	for (const char *line = file; line < end; )
 	{
-		if(getline(&buf, &len, fd)!=-1)
+		const char *eol = line;
+		while (eol < end && *eol != '\n' && *eol != '\r')
+			eol++;
+		const char *next = eol < end ? eol + 1 : end;
+
+		const char *val = (const char *) memchr(line, ' ', eol - line);
+		if (val == NULL) {
+			line = next;
+			continue;
+		}
+
+		size_t keylen = val - line;
+		unsigned int i = find_locale(line, keylen);
+		val++;
+		if (i == 0)
+			printf("[%s.locale] superfluous entry: %.*s\n", locale, (int) keylen, line);
+		else if (loadData[i] != locale_real_names[i])
+			printf("[%s.locale] dup entry: %s\n", locale, locale_real_names[i]);
+		else
 		{
-			char * val    = NULL;
-			char * tmpptr = buf;
-
-			for(; (*tmpptr!=10) && (*tmpptr!=13);tmpptr++)
-			{
-				if ((*tmpptr == ' ') && (val == NULL))
-				{
-					*tmpptr  = 0;
-					val      = tmpptr + 1;
-				}
-			}
-			*tmpptr = 0;
-
-			if (val == NULL)
-				continue;
-
-			std::string text = val;
-
-			int pos;
-			do
-			{
-				pos = text.find("\\n");
-				if ( pos!=-1 )
-				{
-					text.replace(pos, 2, "\n", 1);
-				}
-			} while ( ( pos != -1 ) );
-
-			unsigned int i;
-			for(i = 1; i < sizeof(locale_real_names)/sizeof(const char *); i++)
-			{
-//printf("[%s] [%s]\n", buf,locale_real_names[i]);
-				if(!strcmp(buf,locale_real_names[i]))
-				{
-					if(loadData[i] == locale_real_names[i])
-					{
-						loadData[i] = memp;
-						size_t l = text.length() + 1;
-						memcpy(memp, text.c_str(), l);
-						memp += l;
-					}
-					else
-						printf("[%s.locale] dup entry: %s\n", locale, locale_real_names[i]);
-					break;
-				}
+			loadData[i] = memp;
+			for (const char *v = val; v < eol; v++) {
+				if (v[0] == '\\' && v + 1 < eol && v[1] == 'n') {
+					*memp++ = '\n';
+					v++;
+				} else
+					*memp++ = *v;
 			}
-//			printf("i=%d\n", i);
-			if(i == sizeof(locale_real_names)/sizeof(const char *))
-				printf("[%s.locale] superfluous entry: %s\n", locale, buf);
+			*memp++ = 0;
 		}
+		line = next;
 	}
-	fclose(fd);
-	if(buf)
-		free(buf);
+	munmap(file, st.st_size);
+
 	if(memp - *mem > 0){
 		char *_mem = (char *) realloc(*mem, memp - *mem);
 		if (_mem) {
 			if (_mem != *mem) {
 				// most likely doesn't happen
-				for(unsigned int i = 1; i < sizeof(locale_real_names)/sizeof(const char *); i++)
+				for(unsigned int i = 1; i < LOCALE_COUNT; i++)
 					if (loadData[i] != locale_real_names[i])
 						loadData[i] -= *mem - _mem;
 				*mem = _mem;
 			}
 		}
 	}
-	for (unsigned j = 1; j < (sizeof(locale_real_names)/sizeof(const char *)); j++)
+	saveCompiled(locale, st, asdefault);
+	loadDone(locale, asdefault, false, start);
+	return UNICODE_FONT;
+}
+
+/* the missing texts from the default locale */
+void CLocaleManager::loadDone(const char * const locale, bool asdefault, bool compiled, int64_t start)
+{
+	char ** loadData = asdefault ? defaultData : localeData;
+	for (unsigned j = 1; j < LOCALE_COUNT; j++)
 		if (loadData[j] == locale_real_names[j])
 		{
 			printf("[%s.locale] missing entry: %s\n", locale, locale_real_names[j]);
 			if(!asdefault)
 				loadData[j] = defaultData[j];
 		}
-
-	return UNICODE_FONT;
+	printf("[%s.locale] %s in %d us\n", locale, compiled ? "compiled locale mapped" : "read and compiled",
+			(int) (time_monotonic_us() - start));
 }
 
 const char * CLocaleManager::getText(const neutrino_locale_t keyName) const
@@ -36,6 +36,7 @@
 #include <system/locals.h>
 #include <locale.h>
 #include <time.h>
+#include <sys/stat.h>
 #include <string>
 #include <map>
 
@@ -54,6 +55,15 @@ class CLocaleManager
 
 		char * localeDataMem;
 		char * defaultDataMem;
+		/* size of the mapped compiled locale the texts point into, 0 if
+		   they are copied into the memory above */
+		size_t localeDataMapped;
+		size_t defaultDataMapped;
+
+		void freeData(bool asdefault);
+		bool loadCompiled(const char * const locale, const struct stat &st, bool asdefault);
+		void saveCompiled(const char * const locale, const struct stat &st, bool asdefault);
+		void loadDone(const char * const locale, bool asdefault, bool compiled, int64_t start);
 		
 	public:
 		enum loadLocale_ret_t
@@ -192,6 +192,7 @@ typedef enum
 	LOCALE_AUDIOPLAYER_ADD_LOC,
 	LOCALE_AUDIOPLAYER_ADD_SC,
 	LOCALE_AUDIOPLAYER_ARTIST_TITLE,
+	LOCALE_AUDIOPLAYER_BUFFER,
 	LOCALE_AUDIOPLAYER_BUILDING_SEARCH_INDEX,
 	LOCALE_AUDIOPLAYER_BUTTON_SELECT_TITLE_BY_ID,
 	LOCALE_AUDIOPLAYER_BUTTON_SELECT_TITLE_BY_NAME,
@@ -523,6 +524,7 @@ typedef enum
 	LOCALE_EXTRA_START_TOSTANDBY,
 	LOCALE_EXTRA_TEMP_TIMESHIFT,
 	LOCALE_EXTRA_TIMESHIFT_PAUSE,
+	LOCALE_EXTRA_TIMESHIFT_RING,
 	LOCALE_EXTRA_TP_BANDWIDTH,
 	LOCALE_EXTRA_TP_BANDWIDTH_10MHZ,
 	LOCALE_EXTRA_TP_BANDWIDTH_1_712MHZ,
@@ -1102,6 +1104,7 @@ typedef enum
 	LOCALE_MENU_HINT_AUDIO_SRS_VOLUME,
 	LOCALE_MENU_HINT_AUDIO_VOLSTART,
 	LOCALE_MENU_HINT_AUDIO_VOLSTEP,
+	LOCALE_MENU_HINT_AUDIOPLAYER_BUFFER,
 	LOCALE_MENU_HINT_AUDIOPLAYER_DEFDIR,
 	LOCALE_MENU_HINT_AUDIOPLAYER_FOLLOW,
 	LOCALE_MENU_HINT_AUDIOPLAYER_HIGHPRIO,
@@ -1432,6 +1435,7 @@ typedef enum
 	LOCALE_MENU_HINT_RECORD_TIMESHIFT_AUTO,
 	LOCALE_MENU_HINT_RECORD_TIMESHIFT_DELETE,
 	LOCALE_MENU_HINT_RECORD_TIMESHIFT_PAUSE,
+	LOCALE_MENU_HINT_RECORD_TIMESHIFT_RING,
 	LOCALE_MENU_HINT_RECORD_TIMESHIFT_TEMP,
 	LOCALE_MENU_HINT_RECORD_ZAP,
 	LOCALE_MENU_HINT_RECORD_ZAP_PRE_TIME,
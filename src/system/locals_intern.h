@@ -192,6 +192,7 @@ const char * locale_real_names[] =
 	"audioplayer.add_loc",
 	"audioplayer.add_sc",
 	"audioplayer.artist_title",
+	"audioplayer.buffer",
 	"audioplayer.building_search_index",
 	"audioplayer.button_select_title_by_id",
 	"audioplayer.button_select_title_by_name",
@@ -523,6 +524,7 @@ const char * locale_real_names[] =
 	"extra.start_tostandby",
 	"extra.temp_timeshift",
 	"extra.timeshift_pause",
+	"extra.timeshift_ring",
 	"extra.tp_bandwidth",
 	"extra.tp_bandwidth_10mhz",
 	"extra.tp_bandwidth_1_712mhz",
@@ -1102,6 +1104,7 @@ const char * locale_real_names[] =
 	"menu.hint_audio_srs_volume",
 	"menu.hint_audio_volstart",
 	"menu.hint_audio_volstep",
+	"menu.hint_audioplayer_buffer",
 	"menu.hint_audioplayer_defdir",
 	"menu.hint_audioplayer_follow",
 	"menu.hint_audioplayer_highprio",
@@ -1432,6 +1435,7 @@ const char * locale_real_names[] =
 	"menu.hint_record_timeshift_auto",
 	"menu.hint_record_timeshift_delete",
 	"menu.hint_record_timeshift_pause",
+	"menu.hint_record_timeshift_ring",
 	"menu.hint_record_timeshift_temp",
 	"menu.hint_record_zap",
 	"menu.hint_record_zap_pre_time",
@@ -0,0 +1,229 @@
+/*
+	Neutrino-GUI  -   DBoxII-Project
+
+	runtime counters and latency histograms
+
+	License: GPL
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <system/metrics.h>
+
+volatile bool metrics_enabled = getenv("NEUTRINO_METRICS") != NULL;
+
+/* one slot per thread, only this thread writes it. slots of finished
+   threads are taken by new ones, they are never freed */
+struct metric_slot
+{
+	volatile uint64_t counter[METRIC_COUNTER_MAX];
+	struct {
+		volatile uint64_t count;
+		volatile uint64_t sum;
+		volatile uint64_t max;
+		volatile uint64_t bucket[METRIC_BUCKETS];
+	} latency[METRIC_LATENCY_MAX];
+	volatile uint32_t gen;		/* reset generation the values belong to */
+	volatile bool used;
+	metric_slot * volatile next;
+};
+
+static metric_slot * volatile slots = NULL;
+static pthread_mutex_t slots_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t slot_key;
+static pthread_once_t slot_once = PTHREAD_ONCE_INIT;
+/* a reset starts a new generation, old values are cleared by their writer */
+static volatile uint32_t metrics_gen = 1;
+static volatile int64_t metrics_start = time_monotonic_ms();
+
+static const char *counter_names[METRIC_COUNTER_MAX] = {
+	"eit_sections",
+	"eit_events",
+	"stream_bytes",
+	"stream_drops",
+	"http_requests"
+};
+
+static const char *latency_names[METRIC_LATENCY_MAX] = {
+	"zap_time",
+	"tune_time",
+	"zap_pat",
+	"zap_pmt",
+	"zap_playback",
+	"zap_capmt",
+	"zap_total",
+	"http_time",
+	"paint_time"
+};
+
+static void slot_release(void *p)
+{
+	((metric_slot *) p)->used = false;
+}
+
+static void slot_key_create(void)
+{
+	pthread_key_create(&slot_key, slot_release);
+}
+
+static metric_slot *get_slot(void)
+{
+	pthread_once(&slot_once, slot_key_create);
+	metric_slot *s = (metric_slot *) pthread_getspecific(slot_key);
+	if (s)
+		return s;
+
+	pthread_mutex_lock(&slots_mutex);
+	for (s = slots; s; s = s->next)
+		if (!s->used)
+			break;
+	if (!s) {
+		s = new metric_slot;
+		memset((void *) s, 0, sizeof(*s));
+		s->next = slots;
+		__sync_synchronize();
+		slots = s;
+	}
+	s->used = true;
+	pthread_mutex_unlock(&slots_mutex);
+	pthread_setspecific(slot_key, s);
+	return s;
+}
+
+/* the values of an older generation are dropped by the writer itself */
+static inline metric_slot *get_current_slot(void)
+{
+	metric_slot *s = get_slot();
+	uint32_t gen = metrics_gen;
+	if (s->gen != gen) {
+		memset((void *) s->counter, 0, sizeof(s->counter));
+		memset((void *) s->latency, 0, sizeof(s->latency));
+		__sync_synchronize();
+		s->gen = gen;
+	}
+	return s;
+}
+
+/* 64 bit values are not written at once on 32 bit cpus */
+static inline uint64_t read64(const volatile uint64_t *p)
+{
+	uint64_t a, b;
+	do {
+		a = *p;
+		b = *p;
+	} while (a != b);
+	return a;
+}
+
+void Metrics::enable(bool on)
+{
+	if (on && !metrics_enabled)
+		reset();
+	metrics_enabled = on;
+}
+
+void Metrics::reset()
+{
+	metrics_start = time_monotonic_ms();
+	__sync_fetch_and_add(&metrics_gen, 1);
+}
+
+int64_t Metrics::uptime()
+{
+	return (time_monotonic_ms() - metrics_start) / 1000;
+}
+
+void Metrics::add(metric_counter_t id, uint64_t n)
+{
+	metric_slot *s = get_current_slot();
+	s->counter[id] += n;
+}
+
+void Metrics::addTime(metric_latency_t id, uint64_t us)
+{
+	metric_slot *s = get_current_slot();
+	int b = 0;
+	while (b < METRIC_BUCKETS - 1 && (us >> b))
+		b++;
+	s->latency[id].bucket[b]++;
+	s->latency[id].sum += us;
+	if (us > s->latency[id].max)
+		s->latency[id].max = us;
+	s->latency[id].count++;
+}
+
+uint64_t Metrics::getCounter(metric_counter_t id)
+{
+	uint64_t n = 0;
+	uint32_t gen = metrics_gen;
+	for (metric_slot *s = slots; s; s = s->next)
+		if (s->gen == gen)
+			n += read64(&s->counter[id]);
+	return n;
+}
+
+void Metrics::getLatency(metric_latency_t id, metric_latency_stats_t &stats)
+{
+	uint64_t bucket[METRIC_BUCKETS];
+	memset(bucket, 0, sizeof(bucket));
+	memset(&stats, 0, sizeof(stats));
+
+	uint32_t gen = metrics_gen;
+	for (metric_slot *s = slots; s; s = s->next) {
+		if (s->gen != gen)
+			continue;
+		stats.count += read64(&s->latency[id].count);
+		stats.sum += read64(&s->latency[id].sum);
+		uint64_t max = read64(&s->latency[id].max);
+		if (max > stats.max)
+			stats.max = max;
+		for (int b = 0; b < METRIC_BUCKETS; b++)
+			bucket[b] += read64(&s->latency[id].bucket[b]);
+	}
+
+	/* the buckets are summed up after count, use their own total */
+	uint64_t total = 0;
+	for (int b = 0; b < METRIC_BUCKETS; b++)
+		total += bucket[b];
+	if (total == 0)
+		return;
+
+	static const int pct[3] = { 50, 90, 99 };
+	uint64_t *res[3] = { &stats.p50, &stats.p90, &stats.p99 };
+	uint64_t sum = 0;
+	int p = 0;
+	for (int b = 0; b < METRIC_BUCKETS && p < 3; b++) {
+		sum += bucket[b];
+		uint64_t upper = (1ULL << b) - 1;
+		if (upper > stats.max)
+			upper = stats.max;
+		while (p < 3 && sum * 100 >= total * pct[p])
+			*res[p++] = upper;
+	}
+}
+
+const char *Metrics::counterName(metric_counter_t id)
+{
+	return (id < METRIC_COUNTER_MAX) ? counter_names[id] : "";
+}
+
+const char *Metrics::latencyName(metric_latency_t id)
+{
+	return (id < METRIC_LATENCY_MAX) ? latency_names[id] : "";
+}
@@ -0,0 +1,100 @@
+/*
+	Neutrino-GUI  -   DBoxII-Project
+
+	runtime counters and latency histograms. every thread writes its own
+	slot, readers sum up the slots, so nothing is locked on the hot paths.
+	with metrics disabled a call site costs one load and compare.
+
+	License: GPL
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#ifndef __metrics_h__
+#define __metrics_h__
+
+#include <inttypes.h>
+#include <driver/abstime.h>
+
+enum metric_counter_t
+{
+	METRIC_EIT_SECTIONS,		/* sections read by sectionsd */
+	METRIC_EIT_EVENTS,		/* new events inserted */
+	METRIC_STREAM_BYTES,		/* bytes sent by the stream server */
+	METRIC_STREAM_DROPS,		/* writes not done completely */
+	METRIC_HTTP_REQUESTS,		/* requests handled by nhttpd */
+	METRIC_COUNTER_MAX
+};
+
+enum metric_latency_t
+{
+	METRIC_ZAP_TIME,		/* zap start until first picture */
+	METRIC_TUNE_TIME,		/* frontend tune until lock */
+	/* stages of CZapit::ZapIt */
+	METRIC_ZAP_PAT,			/* pat read and parsed */
+	METRIC_ZAP_PMT,			/* pmt read and parsed */
+	METRIC_ZAP_PLAYBACK,		/* pids set, decoders started */
+	METRIC_ZAP_CAPMT,		/* ca pmt built and sent */
+	METRIC_ZAP_TOTAL,		/* ZapIt() until it returns */
+	METRIC_HTTP_TIME,		/* nhttpd request and response */
+	METRIC_PAINT_TIME,		/* paint of a gui component */
+	METRIC_LATENCY_MAX
+};
+
+/* latencies in us, bucket n counts values below 2^n */
+#define METRIC_BUCKETS	32
+
+typedef struct metric_latency_stats
+{
+	uint64_t	count;
+	uint64_t	sum;		/* us */
+	uint64_t	max;
+	uint64_t	p50, p90, p99;	/* upper bound of the bucket */
+} metric_latency_stats_t;
+
+extern volatile bool metrics_enabled;
+
+namespace Metrics
+{
+	void enable(bool on);
+	void reset();
+
+	/* slow paths of the macros below */
+	void add(metric_counter_t id, uint64_t n);
+	void addTime(metric_latency_t id, uint64_t us);
+
+	uint64_t getCounter(metric_counter_t id);
+	void getLatency(metric_latency_t id, metric_latency_stats_t &stats);
+	const char *counterName(metric_counter_t id);
+	const char *latencyName(metric_latency_t id);
+	/* seconds since the last reset */
+	int64_t uptime();
+}
+
+#define METRIC_ADD(id, n) do { if (metrics_enabled) Metrics::add(id, n); } while (0)
+#define METRIC_TIME(id, us) do { if (metrics_enabled) Metrics::addTime(id, us); } while (0)
+
+/* measures its scope */
+class CMetricTimer
+{
+	private:
+		metric_latency_t id;
+		uint64_t start;
+	public:
+		CMetricTimer(metric_latency_t _id) : id(_id), start(metrics_enabled ? time_monotonic_us() : 0) {}
+		~CMetricTimer() { if (start && metrics_enabled) Metrics::addTime(id, time_monotonic_us() - start); }
+};
+
+#endif
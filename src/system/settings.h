@@ -353,6 +353,7 @@ struct SNeutrinoSettings
 
 	std::list<std::string> webtv_xml;
 	std::list<std::string> webradio_xml;
+	std::list<std::string> xmltv_xml;
 
 #ifdef ENABLE_GRAPHLCD
 	int glcd_enable;
@@ -512,6 +513,7 @@ struct SNeutrinoSettings
 		std::string password;
 	} network_nfs[NETWORK_NFS_NR_OF_ENTRIES];
 	std::string network_nfs_audioplayerdir;
+	int audioplayer_buffer;
 	std::string network_nfs_picturedir;
 	std::string network_nfs_moviedir;
 	std::string network_nfs_recordingdir;
@@ -590,6 +592,7 @@ struct SNeutrinoSettings
 	int auto_delete;
 	int record_hours;
 	int timeshift_hours;
+	int timeshift_ring;
 	int key_record;
 	int key_help;
 	int key_next43mode;
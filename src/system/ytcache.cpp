@@ -29,16 +29,12 @@
 
 #include <stdio.h>
 #include <unistd.h>
-#include <curl/curl.h>
-#include <curl/easy.h>
-#if LIBCURL_VERSION_NUM < 0x071507
-#include <curl/types.h>
-#endif
 #define URL_TIMEOUT 3600
 
 #include "helpers.h"
 #include "settings.h"
 #include "set_threadname.h"
+#include "httpclient.h"
 #include <global.h>
 #include <driver/display.h>
 
@@ -107,7 +103,7 @@ bool cYTCache::useCachedCopy(MI_MOVIE_INFO *mi)
 	return false;
 }
 
-int cYTCache::curlProgress(void *clientp, double dltotal, double dlnow, double /*ultotal*/, double /*ulnow*/)
+int cYTCache::curlProgress(void *clientp, double dltotal, double dlnow)
 {
 	cYTCache *caller = (cYTCache *) clientp;
 	caller->dltotal = dltotal;
@@ -126,51 +122,22 @@ bool cYTCache::download(MI_MOVIE_INFO *mi)
 		return true;
 	}
 
-	FILE * fp = fopen(file.c_str(), "wb");
-	if (!fp) {
-		perror(file.c_str());
-		return false;
-	}
-
-	CURL *curl = curl_easy_init();
-	if (!curl) {
-		fclose(fp);
-		return false;
-	}
-
-	curl_easy_setopt(curl, CURLOPT_URL, mi->file.Url.c_str());
-	curl_easy_setopt(curl, CURLOPT_FILE, fp);
-	curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1);
-	curl_easy_setopt(curl, CURLOPT_TIMEOUT, URL_TIMEOUT);
-	curl_easy_setopt(curl, CURLOPT_NOSIGNAL, (long)1);
-	curl_easy_setopt(curl, CURLOPT_PROGRESSFUNCTION, cYTCache::curlProgress); 
-	curl_easy_setopt(curl, CURLOPT_PROGRESSDATA, this); 
-	curl_easy_setopt(curl, CURLOPT_NOPROGRESS, (long)0); 
-	curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1);
-
-	char cerror[CURL_ERROR_SIZE] = {0};
-	curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, cerror);
-
-	if(!g_settings.softupdate_proxyserver.empty()) {
-		curl_easy_setopt(curl, CURLOPT_PROXY, g_settings.softupdate_proxyserver.c_str());
-		if(!g_settings.softupdate_proxyusername.empty()) {
-			std::string tmp = g_settings.softupdate_proxyusername + ":" + g_settings.softupdate_proxypassword;
-			curl_easy_setopt(curl, CURLOPT_PROXYUSERPWD, tmp.c_str());
-		}
-	}
+	/* movies are too big for the http cache */
+	CHTTPRequest req(mi->file.Url);
+	req.file = file;
+	req.prio = CHTTPRequest::PRIO_LOW;
+	req.cache = false;
+	req.timeout = URL_TIMEOUT;
+	req.progress = cYTCache::curlProgress;
+	req.progress_data = this;
 
 	dltotal = 0;
 	dlnow = 0;
 	dlstart = time(NULL);
 
 	fprintf (stderr, "downloading %s to %s\n", mi->file.Url.c_str(), file.c_str());
-	CURLcode res = curl_easy_perform(curl);
-	curl_easy_cleanup(curl);
-
-	fclose(fp);
-
-	if (res) {
-		fprintf (stderr, "downloading %s to %s failed: %s\n", mi->file.Url.c_str(), file.c_str(), cerror);
+	if (!CHTTPClient::getInstance()->perform(req)) {
+		fprintf (stderr, "downloading %s to %s failed: %s\n", mi->file.Url.c_str(), file.c_str(), req.error.c_str());
 		unlink(file.c_str());
 		return false;
 	}
@@ -44,7 +44,7 @@ class cYTCache
 		bool download(MI_MOVIE_INFO *mi);
 		std::string getName(MI_MOVIE_INFO *mi, std::string ext = "mp4");
 		static void *downloadThread(void *arg);
-		static int curlProgress(void *clientp, double dltotal, double dlnow, double ultotal, double ulnow);
+		static int curlProgress(void *clientp, double dltotal, double dlnow);
 		bool compareMovieInfo(MI_MOVIE_INFO *a, MI_MOVIE_INFO *b);
 	public:
 		double dltotal;
@@ -40,6 +40,7 @@
 #include "helpers.h"
 #include "helpers-json.h"
 #include "set_threadname.h"
+#include "httpclient.h"
 #include <global.h>
 #include <json/json.h>
 
@@ -122,91 +123,18 @@ cYTFeedParser::~cYTFeedParser()
 	curl_easy_cleanup(curl_handle);
 }
 
-size_t cYTFeedParser::CurlWriteToString(void *ptr, size_t size, size_t nmemb, void *data)
+bool cYTFeedParser::getUrl(std::string &url, std::string &answer)
 {
-	if (size * nmemb > 0) {
-		std::string* pStr = (std::string*) data;
-		pStr->append((char*) ptr, nmemb);
-	}
-        return size*nmemb;
-}
-
-bool cYTFeedParser::getUrl(std::string &url, std::string &answer, CURL *_curl_handle)
-{
-	if (!_curl_handle)
-		_curl_handle = curl_handle;
-
-	curl_easy_setopt(_curl_handle, CURLOPT_URL, url.c_str());
-	curl_easy_setopt(_curl_handle, CURLOPT_WRITEFUNCTION, &cYTFeedParser::CurlWriteToString);
-	curl_easy_setopt(_curl_handle, CURLOPT_FILE, (void *)&answer);
-	curl_easy_setopt(_curl_handle, CURLOPT_FAILONERROR, 1);
-	curl_easy_setopt(_curl_handle, CURLOPT_TIMEOUT, URL_TIMEOUT);
-	curl_easy_setopt(_curl_handle, CURLOPT_NOSIGNAL, (long)1);
-	curl_easy_setopt(_curl_handle, CURLOPT_SSL_VERIFYPEER, false);
-
-	if(!g_settings.softupdate_proxyserver.empty()) {
-		curl_easy_setopt(_curl_handle, CURLOPT_PROXY, g_settings.softupdate_proxyserver.c_str());
-		if(!g_settings.softupdate_proxyusername.empty()) {
-			std::string tmp = g_settings.softupdate_proxyusername + ":" + g_settings.softupdate_proxypassword;
-			curl_easy_setopt(_curl_handle, CURLOPT_PROXYUSERPWD, tmp.c_str());
-		}
-	}
-
-	char cerror[CURL_ERROR_SIZE] = {0};
-	curl_easy_setopt(_curl_handle, CURLOPT_ERRORBUFFER, cerror);
-
 	printf("try to get [%s] ...\n", url.c_str());
-	CURLcode httpres = curl_easy_perform(_curl_handle);
-
-	printf("http: res %d size %d\n", httpres, (int)answer.size());
-
-	if (httpres != 0 || answer.empty()) {
-		printf("error: %s\n", cerror);
-		return false;
-	}
-	return true;
+	bool ok = CHTTPClient::getInstance()->getUrl(url, answer, CHTTPRequest::PRIO_NORMAL, URL_TIMEOUT, false);
+	printf("http: ok %d size %d\n", ok, (int)answer.size());
+	return ok && !answer.empty();
 }
 
-bool cYTFeedParser::DownloadUrl(std::string &url, std::string &file, CURL *_curl_handle)
+bool cYTFeedParser::DownloadUrl(std::string &url, std::string &file)
 {
-	if (!_curl_handle)
-		_curl_handle = curl_handle;
-
-	FILE * fp = fopen(file.c_str(), "wb");
-	if (fp == NULL) {
-		perror(file.c_str());
-		return false;
-	}
-	curl_easy_setopt(_curl_handle, CURLOPT_URL, url.c_str());
-	curl_easy_setopt(_curl_handle, CURLOPT_WRITEFUNCTION, NULL);
-	curl_easy_setopt(_curl_handle, CURLOPT_FILE, fp);
-	curl_easy_setopt(_curl_handle, CURLOPT_FAILONERROR, 1);
-	curl_easy_setopt(_curl_handle, CURLOPT_TIMEOUT, URL_TIMEOUT);
-	curl_easy_setopt(_curl_handle, CURLOPT_NOSIGNAL, (long)1);
-	curl_easy_setopt(_curl_handle, CURLOPT_SSL_VERIFYPEER, false);
-
-	if(!g_settings.softupdate_proxyserver.empty()) {
-		curl_easy_setopt(_curl_handle, CURLOPT_PROXY, g_settings.softupdate_proxyserver.c_str());
-		if(!g_settings.softupdate_proxyusername.empty()) {
-			std::string tmp = g_settings.softupdate_proxyusername + ":" + g_settings.softupdate_proxypassword;
-			curl_easy_setopt(_curl_handle, CURLOPT_PROXYUSERPWD, tmp.c_str());
-		}
-	}
-
-	char cerror[CURL_ERROR_SIZE] = {0};
-	curl_easy_setopt(_curl_handle, CURLOPT_ERRORBUFFER, cerror);
-
 	printf("try to get [%s] ...\n", url.c_str());
-	CURLcode httpres = curl_easy_perform(_curl_handle);
-
-	double dsize;
-	curl_easy_getinfo(_curl_handle, CURLINFO_SIZE_DOWNLOAD, &dsize);
-	fclose(fp);
-
-	printf("http: res %d size %g.\n", httpres, dsize);
-
-	if (httpres != 0) {
-		printf("curl error: %s\n", cerror);
+	if (!CHTTPClient::getInstance()->downloadUrl(url, file, CHTTPRequest::PRIO_NORMAL, URL_TIMEOUT, false)) {
 		unlink(file.c_str());
 		return false;
 	}
@@ -578,7 +506,7 @@ bool cYTFeedParser::ParseFeed(yt_feed_mode_t mode, std::string search, std::stri
 	return ParseFeed(url);
 }
 
-bool cYTFeedParser::ParseVideoInfo(cYTVideoInfo &vinfo, CURL *_curl_handle)
+bool cYTFeedParser::ParseVideoInfo(cYTVideoInfo &vinfo)
 {
 	bool ret = false;
 	std::vector<std::string> estr;
@@ -593,7 +521,7 @@ bool cYTFeedParser::ParseVideoInfo(cYTVideoInfo &vinfo, CURL *_curl_handle)
 		vurl += "&ps=default&eurl=&gl=US&hl=en";
 		printf("cYTFeedParser::ParseVideoInfo: get [%s]\n", vurl.c_str());
 		std::string answer;
-		if (!getUrl(vurl, answer, _curl_handle))
+		if (!getUrl(vurl, answer))
 			continue;
 		ret = decodeVideoInfo(answer, vinfo);
 		if (ret)
@@ -608,20 +536,16 @@ void *cYTFeedParser::DownloadThumbnailsThread(void *arg)
 	set_threadname("YT::DownloadThumbnails");
 	bool ret = true;
 	cYTFeedParser *caller = (cYTFeedParser *)arg;
-	CURL *c = curl_easy_init();
 	unsigned int i;
 	do {
 		OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(caller->mutex);
 		i = caller->worker_index++;
-	} while (i < caller->videos.size() && ((ret &= caller->DownloadThumbnail(caller->videos[i], c)) || true));
-	curl_easy_cleanup(c);
+	} while (i < caller->videos.size() && ((ret &= caller->DownloadThumbnail(caller->videos[i])) || true));
 	pthread_exit(&ret);
 }
 
-bool cYTFeedParser::DownloadThumbnail(cYTVideoInfo &vinfo, CURL *_curl_handle)
+bool cYTFeedParser::DownloadThumbnail(cYTVideoInfo &vinfo)
 {
-	if (!_curl_handle)
-		_curl_handle = curl_handle;
 	bool found = false;
 	if (!vinfo.thumbnail.empty()) {
 		std::string fname = thumbnail_dir + "/" + vinfo.id + ".jpg";
@@ -631,7 +555,7 @@ bool cYTFeedParser::DownloadThumbnail(cYTVideoInfo &vinfo, CURL *_curl_handle)
 				found = cYTCache::getInstance()->getNameIfExists(fname, vinfo.id, *fmtp);
 		}
 		if (!found)
-			found = DownloadUrl(vinfo.thumbnail, fname, _curl_handle);
+			found = DownloadUrl(vinfo.thumbnail, fname);
 		if (found)
 			vinfo.tfile = fname;
 	}
@@ -665,13 +589,11 @@ void *cYTFeedParser::GetVideoUrlsThread(void *arg)
 	set_threadname("YT::GetVideoUrls");
 	int ret = 0;
 	cYTFeedParser *caller = (cYTFeedParser *)arg;
-	CURL *c = curl_easy_init();
 	unsigned int i;
 	do {
 		OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(caller->mutex);
 		i = caller->worker_index++;
-	} while (i < caller->videos.size() && ((ret |= caller->ParseVideoInfo(caller->videos[i], c)) || true));
-	curl_easy_cleanup(c);
+	} while (i < caller->videos.size() && ((ret |= caller->ParseVideoInfo(caller->videos[i])) || true));
 	pthread_exit(&ret);
 }
 
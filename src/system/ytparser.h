@@ -101,14 +101,13 @@ class cYTFeedParser : public CProgressSignals
 		static void* GetVideoUrlsThread(void*);
 		static void* DownloadThumbnailsThread(void*);
 
-		static size_t CurlWriteToString(void *ptr, size_t size, size_t nmemb, void *data);
 		void encodeUrl(std::string &txt);
 		void decodeUrl(std::string &url);
 		static void splitString(std::string &str, std::string delim, std::vector<std::string> &strlist, int start = 0);
 		static void splitString(std::string &str, std::string delim, std::map<std::string,std::string> &strmap, int start = 0);
 		static bool saveToFile(const char * name, std::string str);
-		bool getUrl(std::string &url, std::string &answer, CURL *_curl_handle = NULL);
-		bool DownloadUrl(std::string &url, std::string &file, CURL *_curl_handle = NULL);
+		bool getUrl(std::string &url, std::string &answer);
+		bool DownloadUrl(std::string &url, std::string &file);
 		bool parseFeedJSON(std::string &answer);
 		bool parseFeedDetailsJSON(cYTVideoInfo* vinfo);
 		bool decodeVideoInfo(std::string &answer, cYTVideoInfo &vinfo);
@@ -137,8 +136,8 @@ class cYTFeedParser : public CProgressSignals
 		~cYTFeedParser();
 
 		bool ParseFeed(yt_feed_mode_t mode = MOST_POPULAR, std::string search = "", std::string vid = "", yt_feed_orderby_t orderby = ORDERBY_PUBLISHED);
-		bool ParseVideoInfo(cYTVideoInfo &vinfo, CURL *_curl_handle = NULL);
-		bool DownloadThumbnail(cYTVideoInfo &vinfo, CURL *_curl_handle = NULL);
+		bool ParseVideoInfo(cYTVideoInfo &vinfo);
+		bool DownloadThumbnail(cYTVideoInfo &vinfo);
 		bool GetVideoUrls();
 		bool DownloadThumbnails();
 		void Dump();
@@ -0,0 +1,311 @@
+/*
+	Neutrino-GUI  -   DBoxII-Project
+
+	timeshift ring check: replays a recorded TS into CTimeshiftRing the
+	way the recorder writes it, and seeks through the index like the movie
+	player does. no hardware needed.
+
+	usage: tsring_replay [file.ts [ring_mb [kbit/s]]]
+	  file.ts	recording to replay. without it a generated stream is
+			replayed with a small ring and without ring
+	  ring_mb	ring size, default 64, 0 = no ring (recording written
+			directly, the index follows the file and writes the
+			sidecar, checked against the sidecar lookup too)
+	  kbit/s	replay rate, default 0 = as fast as the disk allows
+
+	License: GPL
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <string>
+
+#include <driver/abstime.h>
+#include <driver/tsring.h>
+#include "check.h"
+
+#define CHUNK	(188 * 348)
+/* distance of I-frames, ms */
+#define MAX_GOP	2000
+/* generated stream */
+#define SAMPLE_SECS	60
+#define SAMPLE_RING_MB	4
+
+/* player with a position linear to the file size, like the hardware one.
+ * it plays at stream time ms when the seek comes, to time target */
+static void seek(CTimeshiftRing &ring, off64_t size, int64_t ms, int64_t target)
+{
+	CTsIndex * index = ring.GetIndex();
+	int64_t first = index->GetFirstTime();
+	int64_t last = first + index->GetDuration();
+	int duration = last;
+	if (duration <= 0)
+		return;
+	bool absolute = (ms < 0);
+	/* play position at an index entry, the player knows no better */
+	if (!absolute)
+		ms = index->GetTime(index->GetOffset(ms, false));
+	int position = index->GetOffset(ms, false) * duration / size;
+	int pos = target - ms;
+	if (absolute)
+		pos = index->GetOffset(target, false) * duration / size;
+
+	int newpos;
+	int64_t start = time_monotonic_us();
+	bool ok = ring.GetSeekPosition(position, duration, pos, absolute, newpos);
+	int64_t us = time_monotonic_us() - start;
+	if (!ok) {
+		printf("seek to %" PRId64 " ms: no position\n", target);
+		check(false, "seek without result");
+		return;
+	}
+
+	/* what the player does with the new position: the first I-frame at or
+	 * after the offset, it rounded to ms */
+	off64_t offset = (off64_t) newpos * size / duration;
+	off64_t iframe = index->GetOffset(index->GetTime(offset + size / duration + 188));
+	int64_t landed = index->GetTime(iframe);
+	printf("seek %7" PRId64 " -> %7" PRId64 " ms%s: I-frame %7" PRId64 " ms offset %" PRId64 ", player offset %" PRId64 ", %d us\n",
+			absolute ? target : ms, target, absolute ? " (abs)" : "", landed, iframe, offset, (int) us);
+
+	if (target < first)
+		target = first;
+	if (target > last)
+		target = last;
+	check(iframe >= ring.GetStart(), "seek into dropped segment");
+	check(iframe >= offset, "player starts after the I-frame");
+	check(landed <= target && target - landed <= MAX_GOP, "I-frame not the one before target");
+}
+
+/* generated stream: PAT, PMT and MPEG-2 video with an I-frame every 12
+ * frames at 25 fps, PTS from 1 s on */
+static unsigned char cc[0x2000];
+
+static uint32_t crc32_mpeg(const unsigned char *data, int len)
+{
+	uint32_t crc = 0xffffffff;
+	for (int i = 0; i < len; i++) {
+		crc ^= (uint32_t) data[i] << 24;
+		for (int b = 0; b < 8; b++)
+			crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+	}
+	return crc;
+}
+
+/* one packet with up to 184 bytes of data, returns the bytes used */
+static int write_packet(FILE *f, int pid, const unsigned char *data, int len, bool pusi)
+{
+	unsigned char p[188];
+	p[0] = 0x47;
+	p[1] = (pusi ? 0x40 : 0) | (pid >> 8);
+	p[2] = pid & 0xff;
+	int used = len > 184 ? 184 : len;
+	int stuff = 184 - used;
+	p[3] = (stuff ? 0x30 : 0x10) | (cc[pid]++ & 15);
+	if (stuff) {
+		p[4] = stuff - 1;
+		if (stuff > 1) {
+			p[5] = 0;
+			memset(p + 6, 0xff, stuff - 2);
+		}
+	}
+	memcpy(p + 4 + stuff, data, used);
+	fwrite(p, 1, 188, f);
+	return used;
+}
+
+static void write_section(FILE *f, int pid, const unsigned char *sec, int len)
+{
+	unsigned char buf[188];
+	buf[0] = 0;	/* pointer field */
+	memcpy(buf + 1, sec, len);
+	uint32_t crc = crc32_mpeg(sec, len);
+	for (int i = 0; i < 4; i++)
+		buf[1 + len + i] = crc >> (24 - 8 * i);
+	write_packet(f, pid, buf, len + 5, true);
+}
+
+static std::string write_sample(void)
+{
+	char name[] = "/tmp/tsring_replay_sample.XXXXXX";
+	int fd = mkstemp(name);
+	if (fd < 0) {
+		perror(name);
+		exit(CHECK_ERROR);
+	}
+	FILE *f = fdopen(fd, "w");
+	static const unsigned char pat[] = { 0x00, 0xb0, 13, 0, 1, 0xc1, 0, 0, 0, 1, 0xe1, 0x01 };
+	static const unsigned char pmt[] = { 0x02, 0xb0, 18, 0, 1, 0xc1, 0, 0, 0xe1, 0x00, 0xf0, 0,
+		0x02, 0xe1, 0x00, 0xf0, 0 };
+	unsigned char * pes = new unsigned char[32 * 1024];
+	for (int frame = 0; frame < SAMPLE_SECS * 25; frame++) {
+		bool iframe = (frame % 12) == 0;
+		if (iframe) {
+			write_section(f, 0, pat, sizeof(pat));
+			write_section(f, 0x101, pmt, sizeof(pmt));
+		}
+		int64_t pts = (frame * 3600 + 90000) & 0x1ffffffffLL;
+		static const unsigned char pes_head[] = { 0, 0, 1, 0xe0, 0, 0, 0x80, 0x80, 5 };
+		int len = sizeof(pes_head);
+		memcpy(pes, pes_head, len);
+		pes[len++] = 0x21 | ((pts >> 29) & 0x0e);
+		pes[len++] = (pts >> 22) & 0xff;
+		pes[len++] = 0x01 | ((pts >> 14) & 0xfe);
+		pes[len++] = (pts >> 7) & 0xff;
+		pes[len++] = 0x01 | ((pts << 1) & 0xfe);
+		/* picture start code, picture coding type 1 = I, 2 = P */
+		static const unsigned char pic[] = { 0, 0, 1, 0, 0 };
+		memcpy(pes + len, pic, sizeof(pic));
+		len += sizeof(pic);
+		pes[len++] = (iframe ? 1 : 2) << 3;
+		pes[len++] = 0;
+		pes[len++] = 0;
+		int body = iframe ? 20000 : 12000;
+		memset(pes + len, 0x55, body);
+		len += body;
+		for (int pos = 0; pos < len; )
+			pos += write_packet(f, 0x100, pes + pos, len - pos, pos == 0);
+	}
+	delete[] pes;
+	fclose(f);
+	return name;
+}
+
+static void replay(const char *file, int ring_mb, int kbit)
+{
+	printf("replay %s, ring %d MB\n", file, ring_mb);
+	int in = open(file, O_RDONLY | O_LARGEFILE);
+	if (in < 0) {
+		perror(file);
+		exit(CHECK_ERROR);
+	}
+	char outname[] = "/tmp/tsring_replay.XXXXXX";
+	int out = mkstemp(outname);
+	if (out < 0) {
+		perror(outname);
+		exit(CHECK_ERROR);
+	}
+
+	std::string idxname = CTsIndex::GetSidecarName(outname);
+	CTimeshiftRing ring(outname, ring_mb);
+	int input = out;
+	if (ring_mb) {
+		if (!ring.Start(out))
+			exit(CHECK_ERROR);
+		input = ring.GetInput();
+	} else {
+		ring.GetIndex()->OpenSidecar(idxname);
+		if (!ring.Follow())
+			exit(CHECK_ERROR);
+	}
+
+	unsigned char * buf = new unsigned char[CHUNK];
+	off64_t size = 0;
+	ssize_t len;
+	int64_t start = time_monotonic_ms();
+	while ((len = read(in, buf, CHUNK)) > 0) {
+		if (write(input, buf, len) != len) {
+			perror(outname);
+			break;
+		}
+		size += len;
+		if (kbit > 0) {
+			int64_t due = start + size * 8 / kbit;
+			int64_t now = time_monotonic_ms();
+			if (due > now)
+				usleep((due - now) * 1000);
+		}
+	}
+	delete[] buf;
+	close(in);
+	/* like the recorder on stop, without ring this closes the file */
+	close(input);
+
+	/* let the ring thread catch up */
+	for (int i = 0; i < 100 && ring.GetEnd() < size; i++)
+		usleep(100000);
+	ring.GetIndex()->Finish();
+
+	CTsIndex * index = ring.GetIndex();
+	struct stat64 st;
+	stat64(outname, &st);
+	printf("replayed %" PRId64 " bytes in %d ms, indexed %" PRId64 ", ring start %" PRId64 ", on disk %" PRId64 "\n",
+			size, (int) (time_monotonic_ms() - start), ring.GetEnd(), ring.GetStart(), (int64_t) st.st_blocks * 512);
+	printf("index: %d entries, %" PRId64 " .. %" PRId64 " ms\n", index->Count(), index->GetFirstTime(),
+			index->GetFirstTime() + index->GetDuration());
+
+	check(ring.GetEnd() == size, "ring did not parse the whole file");
+	check(index->Count() > 0, "no index entries");
+	if (ring_mb)
+		check((int64_t) st.st_blocks * 512 <= (int64_t) ring_mb * 1024 * 1024 * 2, "disk usage not bounded by the ring");
+
+	if (index->Count() > 0) {
+		int64_t first = index->GetFirstTime();
+		int64_t last = first + index->GetDuration();
+		int64_t mid = (first + last) / 2;
+		seek(ring, size, mid, mid + 10000);
+		seek(ring, size, mid, mid - 10000);
+		seek(ring, size, mid, mid + 600000);
+		seek(ring, size, first, first - 60000);
+		seek(ring, size, last, last + 60000);
+		/* jumps in the player's scale */
+		seek(ring, size, -1, first);
+		seek(ring, size, -1, mid);
+		seek(ring, size, -1, last - 1000);
+	}
+
+	/* sidecar lookup of the stream server against the loaded index */
+	if (!ring_mb && index->Count() > 0) {
+		ring.GetIndex()->CloseSidecar();
+		int64_t first = index->GetFirstTime();
+		int64_t dur = index->GetDuration();
+		int64_t start = time_monotonic_us();
+		int n = 0;
+		for (int64_t ms = 0; ms <= dur; ms += 997, n++) {
+			off64_t o = CTsIndex::FindOffset(idxname, ms);
+			if (o != index->GetOffset(first + ms)) {
+				printf("sidecar %" PRId64 " ms: %" PRId64 " != %" PRId64 "\n", ms, o, index->GetOffset(first + ms));
+				check(false, "sidecar lookup differs from index");
+			}
+		}
+		printf("sidecar lookups: %d, %d us each\n", n, (int) ((time_monotonic_us() - start) / (n ? n : 1)));
+	}
+
+	ring.Stop();
+	unlink(outname);
+	unlink(idxname.c_str());
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 1) {
+		int ring_mb = argc > 2 ? atoi(argv[2]) : 64;
+		int kbit = argc > 3 ? atoi(argv[3]) : 0;
+		replay(argv[1], ring_mb, kbit);
+	} else {
+		std::string sample = write_sample();
+		replay(sample.c_str(), SAMPLE_RING_MB, 0);
+		replay(sample.c_str(), 0, 0);
+		unlink(sample.c_str());
+	}
+	return check_result();
+}
@@ -0,0 +1,212 @@
+/*
+	Neutrino-GUI  -   DBoxII-Project
+
+	XMLTV import check: reads a guide file with readEventsFromXMLTV() like
+	the sectionsd import does, and checks the events it hands over. no
+	hardware and no running sectionsd needed.
+
+	usage: xmltv_check [guide.xml [id ...]]
+	  guide.xml	guide to read. without it a small built-in guide is
+			checked against the events it must give
+	  id		XMLTV channel ids or lower case display names to
+			import, default all channels of the guide
+
+	License: GPL
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <string>
+#include <vector>
+#include <map>
+
+#include <xmltree/xmlinterface.h>
+#include <driver/abstime.h>
+#include <eitd/SIutils.hpp>
+#include <eitd/SIevents.hpp>
+#include <eitd/xmltv.h>
+#include "check.h"
+
+/* the block size of the import */
+#define XMLTV_BLOCK	500
+
+static time_t start_time;
+static int blocks = 0;
+static int unnamed = 0;
+/* events per channel, as seen by the event store */
+static std::map<t_channel_id, int> channel_events;
+/* start and duration of all events, for the built-in guide */
+static std::map<std::pair<t_channel_id, time_t>, unsigned> event_times;
+
+/* instead of the event store of sectionsd */
+void addEvents(const std::vector<SIevent> &evts, const time_t /*zeit*/)
+{
+	blocks++;
+	check(!evts.empty() && evts.size() <= XMLTV_BLOCK, "block size");
+	for (std::vector<SIevent>::const_iterator e = evts.begin(); e != evts.end(); ++e) {
+		check(e->times.size() == 1, "event without exactly one time");
+		if (e->times.empty())
+			continue;
+		const SItime &t = *e->times.begin();
+		check(t.dauer > 0, "event without duration");
+		check(t.startzeit + (time_t) t.dauer >= start_time, "event already over");
+		if (e->getName().empty())
+			unnamed++;
+		channel_events[e->get_channel_id()]++;
+		event_times[std::make_pair(e->get_channel_id(), t.startzeit)] = t.dauer;
+	}
+}
+
+static std::string xmltv_stamp(time_t t)
+{
+	char buf[32];
+	struct tm tm;
+	gmtime_r(&t, &tm);
+	strftime(buf, sizeof(buf), "%Y%m%d%H%M%S +0000", &tm);
+	return buf;
+}
+
+/* two channels, the last programme of each one without stop time. the
+ * second channel is matched by its display name */
+static std::string write_sample(time_t base)
+{
+	char name[] = "/tmp/xmltv_check.XXXXXX";
+	int fd = mkstemp(name);
+	if (fd < 0) {
+		perror(name);
+		exit(CHECK_ERROR);
+	}
+	FILE *f = fdopen(fd, "w");
+	fprintf(f, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<!DOCTYPE tv SYSTEM \"xmltv.dtd\">\n<tv>\n");
+	fprintf(f, "<channel id=\"one.example\"><display-name>One</display-name></channel>\n");
+	fprintf(f, "<channel id=\"two.example\"><display-name lang=\"de\">Zwei &amp; Drei</display-name></channel>\n");
+	/* over, then running, then open until the next one */
+	fprintf(f, "<programme start=\"%s\" stop=\"%s\" channel=\"one.example\"><title>Over</title></programme>\n",
+			xmltv_stamp(base - 7200).c_str(), xmltv_stamp(base - 3600).c_str());
+	fprintf(f, "<programme start=\"%s\" stop=\"%s\" channel=\"one.example\"><title lang=\"en\">Now</title>"
+			"<desc><![CDATA[a <b>text</b> & more]]></desc></programme>\n",
+			xmltv_stamp(base - 600).c_str(), xmltv_stamp(base + 1800).c_str());
+	fprintf(f, "<programme start=\"%s\" channel=\"one.example\"><title>Open</title></programme>\n",
+			xmltv_stamp(base + 1800).c_str());
+	fprintf(f, "<programme start=\"%s\" stop=\"%s\" channel=\"one.example\"><title>Next</title></programme>\n",
+			xmltv_stamp(base + 3600).c_str(), xmltv_stamp(base + 5400).c_str());
+	/* open at the change of the channel */
+	fprintf(f, "<programme start=\"%s\" channel=\"one.example\"><title>Last one</title></programme>\n",
+			xmltv_stamp(base + 5400).c_str());
+	fprintf(f, "<programme start=\"%s\" stop=\"%s\" channel=\"two.example\"><title>Two</title></programme>\n",
+			xmltv_stamp(base).c_str(), xmltv_stamp(base + 900).c_str());
+	/* open at the end of the file */
+	fprintf(f, "<programme start=\"%s\" channel=\"two.example\"><title>Last two</title></programme>\n",
+			xmltv_stamp(base + 900).c_str());
+	fprintf(f, "<programme start=\"%s\" stop=\"%s\" channel=\"unknown.example\"><title>Unknown</title></programme>\n",
+			xmltv_stamp(base).c_str(), xmltv_stamp(base + 900).c_str());
+	fprintf(f, "</tv>\n");
+	fclose(f);
+	return name;
+}
+
+/* the channel ids of a guide, without parsing it */
+static void guide_channels(const char *file, std::vector<std::string> &ids)
+{
+	FILE *f = fopen(file, "r");
+	if (!f)
+		return;
+	char line[4096];
+	while (fgets(line, sizeof(line), f)) {
+		for (char *p = line; (p = strstr(p, "<channel ")); p++) {
+			char *id = strstr(p, "id=\"");
+			if (!id)
+				continue;
+			id += 4;
+			char *end = strchr(id, '"');
+			if (end)
+				ids.push_back(std::string(id, end - id));
+		}
+	}
+	fclose(f);
+}
+
+static bool has_event(t_channel_id chid, time_t start, unsigned dauer)
+{
+	std::map<std::pair<t_channel_id, time_t>, unsigned>::iterator it = event_times.find(std::make_pair(chid, start));
+	if (it == event_times.end()) {
+		printf("no event at %ld\n", (long) start);
+		return false;
+	}
+	if (it->second != dauer) {
+		printf("event at %ld: duration %u, want %u\n", (long) start, it->second, dauer);
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	start_time = time(NULL);
+	/* events carry the lower 48 bits of the channel id */
+	xmltv_channel_map_t channels;
+	std::string file;
+	bool sample = (argc < 2);
+	time_t base = start_time / 60 * 60;
+
+	if (sample) {
+		file = write_sample(base);
+		channels["one.example"] = 0x1001;
+		channels["zwei & drei"] = 0x2002;
+	} else {
+		file = argv[1];
+		std::vector<std::string> ids;
+		for (int i = 2; i < argc; i++)
+			ids.push_back(argv[i]);
+		if (ids.empty())
+			guide_channels(argv[1], ids);
+		for (unsigned i = 0; i < ids.size(); i++)
+			channels[ids[i]] = i + 1;
+		printf("%d channels to import\n", (int) channels.size());
+	}
+
+	int count = 0;
+	int64_t ms = time_monotonic_ms();
+	bool ok = readEventsFromXMLTV(file, channels, count);
+	ms = time_monotonic_ms() - ms;
+	struct rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+
+	int stored = 0;
+	for (std::map<t_channel_id, int>::iterator it = channel_events.begin(); it != channel_events.end(); ++it)
+		stored += it->second;
+	printf("%d events in %d blocks, %d ms, %d without name, max rss %ld KB\n", count, blocks, (int) ms, unnamed, ru.ru_maxrss);
+
+	check(ok, "guide not read");
+	check(stored == count, "events counted and stored differ");
+	if (sample) {
+		unlink(file.c_str());
+		check(count == 6, "events of the sample guide");
+		check(channel_events[0x1001] == 4, "events of channel one");
+		check(channel_events[0x2002] == 2, "events of channel two");
+		check(has_event(0x1001, base - 600, 2400), "running programme");
+		check(has_event(0x1001, base + 1800, 1800), "open programme ended by the next one");
+		check(has_event(0x1001, base + 5400, 3600), "open programme at the change of the channel");
+		check(has_event(0x2002, base + 900, 3600), "open programme at the end of the file");
+	}
+	return check_result();
+}
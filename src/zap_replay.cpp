@@ -0,0 +1,683 @@
+/*
+	Neutrino-GUI  -   DBoxII-Project
+
+	zap check: zaps through the services of a TS file with CZapit::ZapIt.
+	the demux reads PAT and PMT sections from the file, frontend, decoders
+	and the CA device are stubbed below, pat, pmt and ca pmt code is the
+	real one. prints the time of the zap stages from the metrics, checks
+	the pids set on the demuxes, the ca pmt and the zap events. the stream
+	is not paced, the times are what zapit spends, without waiting for
+	the repetition of the sections on air.
+
+	usage: zap_replay [file.ts [rounds]]
+	  file.ts	stream with PAT and PMTs, all its services are zapped.
+			without it a generated stream with clear and scrambled
+			services is used and the pids are checked against it
+	  rounds	zaps through all services, default 3
+
+	License: GPL
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <string>
+#include <vector>
+
+#include <driver/abstime.h>
+#include <system/metrics.h>
+#include <zapit/zapit.h>
+#include <zapit/femanager.h>
+#include <zapit/capmt.h>
+#include <zapit/scan.h>
+#include <zapit/scansdt.h>
+#include <zapit/getservices.h>
+#include <zapit/fesampler.h>
+#include <dmx.h>
+#include <audio_cs.h>
+#include <video_cs.h>
+#include <ca_cs.h>
+#include <driver/rcinput.h>
+#include <gui/osd_helpers.h>
+#include <neutrino.h>
+#include <libdvbsub/dvbsub.h>
+#include <libtuxtxt/teletext.h>
+#include "check.h"
+
+#define PACKET		188
+/* generated stream */
+#define SAMPLE_SERVICES	16
+#define SAMPLE_TSID	0x0441
+#define SAMPLE_ONID	0x0001
+#define SAMPLE_CAID	0x1702
+
+/* the stream, read into memory */
+static std::vector<unsigned char> ts;
+/* packet the stream is at, moves on with every section read like on air */
+static size_t live_packet = 0;
+
+cDemux *videoDemux = NULL;
+cDemux *audioDemux = NULL;
+extern cDemux *pcrDemux;
+cVideo *videoDecoder = NULL;
+cAudio *audioDecoder = NULL;
+
+/* what zapit did with the stubs */
+static unsigned short started_vpid, started_apid, started_pcr;
+static std::vector<unsigned char> last_capmt;
+static t_channel_id last_capmt_channel;
+static std::vector<unsigned int> events;
+static t_channel_id tuned_channel;
+
+/* ---- demux: sections of the stream, filtered like the driver does ---- */
+
+struct cDemuxData
+{
+	unsigned short pid;
+	unsigned char filter[DMX_FILTER_SIZE];
+	unsigned char mask[DMX_FILTER_SIZE];
+	unsigned char mode[DMX_FILTER_SIZE];
+	int len;
+	bool section;
+	bool running;
+};
+
+static uint32_t crc32_mpeg(const unsigned char *data, int len)
+{
+	uint32_t crc = 0xffffffff;
+	for (int i = 0; i < len; i++) {
+		crc ^= (uint32_t) data[i] << 24;
+		for (int b = 0; b < 8; b++)
+			crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+	}
+	return crc;
+}
+
+static bool section_match(cDemuxData *dd, const unsigned char *sec)
+{
+	/* filter byte 0 is the table id, the others start after the length */
+	bool neg = false, neg_hit = false;
+	for (int i = 0; i < dd->len; i++) {
+		unsigned char b = sec[i ? i + 2 : 0];
+		unsigned char pos = dd->mask[i] & ~dd->mode[i];
+		if ((b & pos) != (dd->filter[i] & pos))
+			return false;
+		unsigned char m = dd->mask[i] & dd->mode[i];
+		if (m) {
+			neg = true;
+			if ((b & m) != (dd->filter[i] & m))
+				neg_hit = true;
+		}
+	}
+	return !neg || neg_hit;
+}
+
+cDemux::cDemux(int num)
+{
+	unit = num;
+	pid = 0;
+	dd = new cDemuxData;
+	memset(dd, 0, sizeof(*dd));
+}
+
+cDemux::~cDemux()
+{
+	delete dd;
+}
+
+bool cDemux::Open(DMX_CHANNEL_TYPE pes_type, void *, int)
+{
+	type = pes_type;
+	return true;
+}
+
+bool cDemux::sectionFilter(unsigned short Pid, const unsigned char * const Tid, const unsigned char * const Mask, int len, int, const unsigned char * const nMask)
+{
+	if (len > DMX_FILTER_SIZE)
+		return false;
+	pid = Pid;
+	memset(dd, 0, sizeof(*dd));
+	dd->pid = Pid;
+	memcpy(dd->filter, Tid, len);
+	memcpy(dd->mask, Mask, len);
+	if (nMask)
+		memcpy(dd->mode, nMask, len);
+	dd->len = len;
+	dd->section = true;
+	dd->running = true;
+	return true;
+}
+
+bool cDemux::pesFilter(const unsigned short Pid)
+{
+	pid = Pid;
+	dd->pid = Pid;
+	dd->section = false;
+	return true;
+}
+
+bool cDemux::Start(bool)
+{
+	dd->running = true;
+	if (this == videoDemux)
+		started_vpid = pid;
+	else if (this == audioDemux)
+		started_apid = pid;
+	else if (this == pcrDemux)
+		started_pcr = pid;
+	return true;
+}
+
+bool cDemux::Stop()
+{
+	dd->running = false;
+	return true;
+}
+
+/* the next matching section from the live position on, -1 if the stream has
+ * none, like a timeout */
+int cDemux::Read(unsigned char *buff, int len, int)
+{
+	size_t packets = ts.size() / PACKET;
+	if (!dd->section || !dd->running || !packets)
+		return -1;
+	std::vector<unsigned char> sec;
+	size_t want = 0;
+	/* twice around, a section may start before the end and end after it */
+	for (size_t n = 0; n < 2 * packets; n++) {
+		const unsigned char *p = &ts[(live_packet++ % packets) * PACKET];
+		if (p[0] != 0x47 || (((p[1] & 0x1f) << 8) | p[2]) != dd->pid || !(p[3] & 0x10))
+			continue;
+		int off = 4;
+		if (p[3] & 0x20)
+			off += 1 + p[4];
+		if (off >= PACKET)
+			continue;
+		if (p[1] & 0x40) {
+			/* a new section starts, after the pointer field */
+			off += 1 + p[off];
+			sec.clear();
+			want = 0;
+		} else if (sec.empty())
+			continue;
+		if (off >= PACKET)
+			continue;
+		sec.insert(sec.end(), p + off, p + PACKET);
+		if (!want && sec.size() >= 3)
+			want = (((sec[1] & 0x0f) << 8) | sec[2]) + 3;
+		if (!want || sec.size() < want)
+			continue;
+		/* stuffing after the section is dropped */
+		sec.resize(want);
+		bool crc_ok = !(sec[1] & 0x80) || !crc32_mpeg(&sec[0], want);
+		if (crc_ok && (int) want <= len && section_match(dd, &sec[0])) {
+			memcpy(buff, &sec[0], want);
+			return want;
+		}
+		sec.clear();
+		want = 0;
+	}
+	return -1;
+}
+
+u32 cDemux::GetCount(DMX_TYPE) { return 4; }
+void *cDemux::getBuffer() { return NULL; }
+void *cDemux::getChannel() { return NULL; }
+
+/* ---- decoders and CA device ---- */
+
+cVideo::cVideo(int, void *, void *) {}
+int cVideo::Start(void *, unsigned short, unsigned short, void *) { return 0; }
+int cVideo::Stop(bool) { return 0; }
+int cVideo::SetStreamType(VIDEO_FORMAT) { return 0; }
+int cVideo::getAspectRatio() { return 0; }
+int cVideo::setAspectRatio(int, int) { return 0; }
+void cVideo::getPictureInfo(int &width, int &height, int &rate) { width = 720; height = 576; rate = 25; }
+int cVideo::getPlayState() { return 0; }
+int cVideo::SetVideoSystem(int, bool) { return 0; }
+void cVideo::SetAudioHandle(void *) {}
+void *cVideo::GetTVEnc() { return NULL; }
+void cVideo::Standby(bool) {}
+
+cAudio::cAudio(void *, void *, void *) {}
+cAudio::~cAudio() {}
+int cAudio::Start() { return 0; }
+int cAudio::Stop() { return 0; }
+int cAudio::setChannel(int) { return 0; }
+int cAudio::mute() { return 0; }
+int cAudio::unmute() { return 0; }
+int cAudio::setVolume(unsigned int, unsigned int) { return 0; }
+void cAudio::SetSyncMode(AVSYNC_TYPE) {}
+void *cAudio::GetHandle() { return NULL; }
+
+cCA::cCA() {}
+cCA::~cCA() {}
+void cCA::run() {}
+cCA *cCA::GetInstance()
+{
+	static cCA *instance = NULL;
+	if (!instance)
+		instance = new cCA();
+	return instance;
+}
+bool cCA::Start() { return true; }
+void cCA::Stop() {}
+void cCA::SetInitMask(CA_INIT_MASK) {}
+void cCA::SetTSClock(u32) {}
+int cCA::GetCAIDS(CaIdVector &Caids, CA_SLOT_TYPE) { Caids.clear(); return 0; }
+bool cCA::SendCAPMT(u64 ChannelId, u8, u8, const unsigned char *CAPMT, u32 CAPMTLen, const unsigned char *, u32, CA_SLOT_TYPE)
+{
+	if (CAPMT && CAPMTLen) {
+		last_capmt.assign(CAPMT, CAPMT + CAPMTLen);
+		last_capmt_channel = ChannelId;
+	}
+	return true;
+}
+
+/* no camd, the ca pmt goes to the CA device only */
+CBasicClient::CBasicClient() { sock_fd = -1; }
+bool CBasicClient::open_connection() { return false; }
+bool CBasicClient::send_data(const char * const, const size_t) { return false; }
+void CBasicClient::close_connection() {}
+
+/* ---- frontend, tuned to the transponder of the file ---- */
+
+CFEManager *CFEManager::manager = NULL;
+
+CFrontend::CFrontend(int Number, int Adapter)
+{
+	fd = -1;
+	fenumber = Number;
+	adapter = Adapter;
+	memset(&config, 0, sizeof(config));
+	tuned = false;
+	pretuning = false;
+	channel_id = 0;
+	sampler = NULL;
+}
+
+bool CFrontend::setInput(CZapitChannel *channel, bool)
+{
+	bool change = !tuned || channel->getTransponderId() != (transponder_id_t) channel_id;
+	channel_id = channel->getTransponderId();
+	return change;
+}
+
+bool CFrontend::tuneChannel(CZapitChannel *channel, bool)
+{
+	tuned = true;
+	tuned_channel = channel->getChannelID();
+	return true;
+}
+
+int CFrontend::driveToSatellitePosition(t_satellite_position, bool) { return 0; }
+bool CFrontend::isSat(delivery_system_t delsys) { return delsys & ALL_SAT; }
+bool CFrontend::isCable(delivery_system_t delsys) { return delsys & ALL_CABLE; }
+bool CFrontend::isTerr(delivery_system_t delsys) { return delsys & ALL_TERR; }
+fe_code_rate_t CFrontend::getCodeRate(const uint8_t, delivery_system_t) { return FEC_AUTO; }
+delivery_system_t CFrontend::getZapitDeliverySystem(uint32_t) { return DVB_S; }
+uint32_t CFrontend::getXMLDeliverySystem(delivery_system_t) { return 0; }
+void CFrontend::getXMLDelsysFEC(fe_code_rate_t, delivery_system_t &, fe_modulation_t &, fe_code_rate_t &) {}
+void CFrontend::getDelSys(delivery_system_t, int, int, const char * &, const char * &, const char * &) {}
+uint32_t CFrontend::getFEBandwidth(fe_bandwidth_t) { return 0; }
+delivery_system_t CFrontend::getCurrentDeliverySystem() { return DVB_S; }
+fe_code_rate_t CFrontend::getCFEC() { return FEC_AUTO; }
+uint32_t CFrontend::getRate() const { return 0; }
+uint8_t CFrontend::getPolarization() const { return 0; }
+void CFrontend::setInput(t_satellite_position, uint32_t, uint8_t) {}
+int CFrontend::tuneFrequency(FrontendParameters *, bool) { return 0; }
+bool CFrontend::tuneTransponder(transponder_id_t, t_satellite_position, FrontendParameters *) { return true; }
+void CFrontend::setDiseqcType(const diseqc_t, bool) {}
+void CFrontend::sendMotorCommand(uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, int) {}
+
+CFEManager::CFEManager() : configfile(',', false)
+{
+	livefe = new CFrontend(0, 0);
+}
+CFEManager::~CFEManager() {}
+CFEManager *CFEManager::getInstance()
+{
+	if (!manager)
+		manager = new CFEManager();
+	return manager;
+}
+bool CFEManager::Init() { return true; }
+void CFEManager::Open() {}
+void CFEManager::Close() {}
+bool CFEManager::loadSettings() { return true; }
+void CFEManager::saveSettings(bool) {}
+CFrontend *CFEManager::getFE(int) { return livefe; }
+void CFEManager::setLiveFE(CFrontend *fe) { livefe = fe; }
+CFrontend *CFEManager::allocateFE(CZapitChannel *, bool) { return livefe; }
+CFrontend *CFEManager::getFrontend(CZapitChannel *) { return livefe; }
+CFrontend *CFEManager::getPreTuneFrontend(CZapitChannel *, CFrontend *) { return NULL; }
+bool CFEManager::lockFrontend(CFrontend *, CZapitChannel *) { return true; }
+bool CFEManager::unlockFrontend(CFrontend *, bool) { return true; }
+void CFESampler::setInterval(int) {}
+
+/* ---- zapit parts a zap does not use ---- */
+
+/* the event server is made by CZapit::Start(), which is not run here. the
+ * stub does not use the object */
+void CEventServer::sendEvent(const unsigned int eventID, const initiators, const void *, const unsigned int)
+{
+	events.push_back(eventID);
+}
+void CEventServer::registerEvent(int) {}
+void CEventServer::unRegisterEvent(int) {}
+bool CBasicServer::prepare(const char *) { return false; }
+bool CBasicServer::run(bool (*)(CBasicMessage::Header &, int), const CBasicMessage::t_version, bool) { return false; }
+void CBasicServer::stop() {}
+bool CBasicServer::receive_data(int, void *, const size_t) { return false; }
+bool CBasicServer::send_data(int, const void *, const size_t) { return false; }
+char *CBasicServer::receive_string(int) { return NULL; }
+void CBasicServer::delete_string(char *) {}
+
+CServiceScan::CServiceScan() { running = false; }
+CServiceScan::~CServiceScan() {}
+void CServiceScan::run() {}
+CServiceScan *CServiceScan::getInstance()
+{
+	static CServiceScan *scan = NULL;
+	if (!scan)
+		scan = new CServiceScan();
+	return scan;
+}
+bool CServiceScan::Start(scan_type_t, void *) { return false; }
+bool CServiceScan::Stop() { return true; }
+bool CServiceScan::SetFrontend(t_satellite_position) { return false; }
+
+CSdt::CSdt(t_satellite_position, freq_id_t, bool, int, CFrontend *) {}
+CSdt::~CSdt() {}
+bool CSdt::Parse(t_transport_stream_id &, t_original_network_id &) { return false; }
+
+Zapit_config zapitCfg;
+SNeutrinoSettings g_settings;
+CRCInput *g_RCInput = NULL;
+CNeutrinoApp *CNeutrinoApp::getInstance() { return NULL; }
+void CRCInput::stopInput(const bool) {}
+void CRCInput::restartInput(const bool) {}
+COsdHelpers *COsdHelpers::getInstance() { return NULL; }
+void COsdHelpers::changeOsdResolution(uint32_t, bool, bool) {}
+int COsdHelpers::setVideoSystem(int, bool) { return 0; }
+std::string convertDVBUTF8(const char *data, int len, int, int) { return std::string(data, len); }
+
+int dvbsub_getpid() { return -1; }
+void dvbsub_setpid(int) {}
+int dvbsub_stop() { return 0; }
+int dvbsub_pause() { return 0; }
+void tuxtx_stop_subtitle() {}
+int tuxtx_subtitle_running(int *, int *, int *) { return 0; }
+void tuxtx_set_pid(int, int, const char *) {}
+
+/* ---- generated stream ---- */
+
+static unsigned char cc[0x2000];
+
+static void put_packet(int pid, const unsigned char *data, int len, bool pusi)
+{
+	unsigned char p[PACKET];
+	p[0] = 0x47;
+	p[1] = (pusi ? 0x40 : 0) | (pid >> 8);
+	p[2] = pid & 0xff;
+	p[3] = 0x10 | (cc[pid]++ & 15);
+	memset(p + 4, 0xff, PACKET - 4);
+	memcpy(p + 4, data, len);
+	ts.insert(ts.end(), p, p + PACKET);
+}
+
+/* a section with pointer field and crc, over as many packets as needed */
+static void put_section(int pid, std::vector<unsigned char> sec)
+{
+	int len = sec.size() + 1;
+	sec[1] = 0xb0 | (len >> 8);
+	sec[2] = len & 0xff;
+	uint32_t crc = crc32_mpeg(&sec[0], sec.size());
+	for (int i = 0; i < 4; i++)
+		sec.push_back(crc >> (24 - 8 * i));
+	sec.insert(sec.begin(), 0);
+	for (size_t pos = 0; pos < sec.size(); pos += PACKET - 4)
+		put_packet(pid, &sec[pos], std::min((size_t) PACKET - 4, sec.size() - pos), pos == 0);
+}
+
+static void put_es(std::vector<unsigned char> &sec, int type, int pid, const unsigned char *desc, int desc_len)
+{
+	sec.push_back(type);
+	sec.push_back(0xe0 | (pid >> 8));
+	sec.push_back(pid & 0xff);
+	sec.push_back(0xf0);
+	sec.push_back(desc_len);
+	sec.insert(sec.end(), desc, desc + desc_len);
+}
+
+static int sample_vpid(int i) { return 0x200 + i; }
+static int sample_apid(int i) { return 0x300 + i; }
+static int sample_pmt_pid(int i) { return 0x100 + i; }
+static bool sample_scrambled(int i) { return i & 1; }
+
+static void make_sample(void)
+{
+	std::vector<unsigned char> pat;
+	static const unsigned char pat_head[] = { 0x00, 0, 0, SAMPLE_TSID >> 8, SAMPLE_TSID & 0xff, 0xc1, 0, 0 };
+	pat.assign(pat_head, pat_head + sizeof(pat_head));
+	for (int i = 0; i < SAMPLE_SERVICES; i++) {
+		pat.push_back((i + 1) >> 8);
+		pat.push_back((i + 1) & 0xff);
+		pat.push_back(0xe0 | (sample_pmt_pid(i) >> 8));
+		pat.push_back(sample_pmt_pid(i) & 0xff);
+	}
+	std::vector<std::vector<unsigned char> > pmts;
+	for (int i = 0; i < SAMPLE_SERVICES; i++) {
+		std::vector<unsigned char> pmt;
+		static const unsigned char head[] = { 0x02, 0, 0, 0, 0, 0xc1, 0, 0, 0, 0, 0xf0, 0 };
+		pmt.assign(head, head + sizeof(head));
+		pmt[3] = (i + 1) >> 8;
+		pmt[4] = (i + 1) & 0xff;
+		/* pcr on the video pid */
+		pmt[8] = 0xe0 | (sample_vpid(i) >> 8);
+		pmt[9] = sample_vpid(i) & 0xff;
+		if (sample_scrambled(i)) {
+			/* ca descriptor, ecm pid 0x1f00 + service */
+			unsigned char ca[] = { 0x09, 4, SAMPLE_CAID >> 8, SAMPLE_CAID & 0xff, 0xff, 0 };
+			ca[5] = i;
+			pmt.insert(pmt.end(), ca, ca + sizeof(ca));
+			pmt[11] = sizeof(ca);
+		}
+		static const unsigned char lang_deu[] = { 0x0a, 4, 'd', 'e', 'u', 0 };
+		static const unsigned char lang_eng[] = { 0x0a, 4, 'e', 'n', 'g', 0 };
+		static const unsigned char ac3[] = { 0x6a, 1, 0 };
+		static const unsigned char ttx[] = { 0x56, 5, 'd', 'e', 'u', 0x09, 0x00 };
+		put_es(pmt, 0x1b, sample_vpid(i), NULL, 0);
+		put_es(pmt, 0x03, sample_apid(i), lang_deu, sizeof(lang_deu));
+		put_es(pmt, 0x06, sample_apid(i) + 0x40, ac3, sizeof(ac3));
+		put_es(pmt, 0x03, sample_apid(i) + 0x80, lang_eng, sizeof(lang_eng));
+		put_es(pmt, 0x06, 0x1000 + i, ttx, sizeof(ttx));
+		pmts.push_back(pmt);
+	}
+	/* PAT and each PMT about ten times a second at 8 Mbit/s, video and
+	 * audio packets between them */
+	unsigned char payload[PACKET - 4];
+	memset(payload, 0x55, sizeof(payload));
+	for (int round = 0; round < 10; round++) {
+		put_section(0, pat);
+		for (int i = 0; i < SAMPLE_SERVICES; i++) {
+			put_section(sample_pmt_pid(i), pmts[i]);
+			for (int n = 0; n < 30; n++)
+				put_packet(n % 5 ? sample_vpid(n % SAMPLE_SERVICES) : sample_apid(n % SAMPLE_SERVICES), payload, sizeof(payload), false);
+		}
+	}
+}
+
+static bool read_file(const char *name)
+{
+	FILE *f = fopen(name, "r");
+	if (!f) {
+		perror(name);
+		return false;
+	}
+	unsigned char buf[PACKET * 256];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+		ts.insert(ts.end(), buf, buf + n);
+	fclose(f);
+	ts.resize(ts.size() / PACKET * PACKET);
+	return !ts.empty();
+}
+
+/* ---- the zaps ---- */
+
+/* zapit without its threads and command socket, in tv mode, out of standby */
+class CZapReplay : public CZapit
+{
+	public:
+		CZapReplay()
+		{
+			zapit = this;
+			standby = false;
+			current_is_nvod = false;
+			memset(&config, 0, sizeof(config));
+			SetTVMode();
+		}
+		/* members only set by Start() are zero */
+		static void *operator new(size_t size) { return calloc(1, size); }
+		static void operator delete(void *p) { free(p); }
+};
+
+/* a channel for each service in the PAT of the stream */
+static std::vector<t_channel_id> add_channels(void)
+{
+	std::vector<t_channel_id> ids;
+	cDemux dmx(0);
+	dmx.Open(DMX_PSI_CHANNEL);
+	unsigned char filter[DMX_FILTER_SIZE], mask[DMX_FILTER_SIZE];
+	memset(filter, 0, sizeof(filter));
+	memset(mask, 0, sizeof(mask));
+	mask[0] = 0xff;
+	unsigned char pat[1024];
+	int len;
+	if (!dmx.sectionFilter(0, filter, mask, 1) || (len = dmx.Read(pat, sizeof(pat))) < 12)
+		return ids;
+	t_transport_stream_id tsid = (pat[3] << 8) | pat[4];
+	for (int i = 8; i < len - 4; i += 4) {
+		t_service_id sid = (pat[i] << 8) | pat[i + 1];
+		if (!sid)
+			continue;
+		char name[32];
+		snprintf(name, sizeof(name), "Service %04x", sid);
+		CZapitChannel *channel = new CZapitChannel(name, sid, tsid, SAMPLE_ONID, ST_DIGITAL_TELEVISION_SERVICE, 192, 11000);
+		if (CServiceManager::getInstance()->AddChannel(channel))
+			ids.push_back(channel->getChannelID());
+	}
+	return ids;
+}
+
+static bool has_event(unsigned int id)
+{
+	for (unsigned int i = 0; i < events.size(); i++)
+		if (events[i] == id)
+			return true;
+	return false;
+}
+
+/* the ca descriptor of the pmt, with its system id, is in the ca pmt */
+static bool capmt_has_caid(void)
+{
+	for (size_t i = 0; i + 3 < last_capmt.size(); i++)
+		if (last_capmt[i] == 0x09 && last_capmt[i + 2] == (SAMPLE_CAID >> 8) && last_capmt[i + 3] == (SAMPLE_CAID & 0xff))
+			return true;
+	return false;
+}
+
+static void zap(CZapit *zapit, t_channel_id id, bool sample, int index)
+{
+	events.clear();
+	last_capmt.clear();
+	started_vpid = started_apid = started_pcr = 0;
+	bool ok = zapit->ZapIt(id, false, true);
+	check(ok, "zap failed");
+	if (!ok)
+		return;
+	CZapitChannel *channel = CServiceManager::getInstance()->FindChannel(id);
+	check(has_event(CZapitClient::EVT_TUNE_COMPLETE), "no tune complete event");
+	check(has_event(CZapitClient::EVT_ZAP_CA_ID), "no ca id event");
+	check(started_vpid == channel->getVideoPid(), "video pid not started");
+	check(started_apid == channel->getAudioPid(), "audio pid not started");
+	check(started_pcr == channel->getPcrPid(), "pcr pid not started");
+	check(!last_capmt.empty() && last_capmt_channel == id, "no ca pmt sent");
+	if (!sample)
+		return;
+	check(channel->getPmtPid() == sample_pmt_pid(index), "pmt pid");
+	check(channel->getVideoPid() == sample_vpid(index), "video pid");
+	check(channel->getAudioPid() == sample_apid(index), "audio pid");
+	check(channel->getAudioChannelCount() == 3, "audio channels");
+	check(channel->getTeletextPid() == 0x1000 + index, "teletext pid");
+	check(channel->scrambled == sample_scrambled(index), "scrambled flag");
+	check(capmt_has_caid() == sample_scrambled(index), "ca descriptor in ca pmt");
+}
+
+static void report(metric_latency_t id)
+{
+	metric_latency_stats_t stats;
+	Metrics::getLatency(id, stats);
+	printf("%-14s %4" PRIu64 " zaps, avg %6" PRIu64 " us, p90 < %6" PRIu64 " us, max %6" PRIu64 " us\n", Metrics::latencyName(id),
+			stats.count, stats.count ? stats.sum / stats.count : 0, stats.p90, stats.max);
+}
+
+int main(int argc, char **argv)
+{
+	bool sample = argc < 2;
+	int rounds = argc > 2 ? atoi(argv[2]) : 3;
+	if (sample)
+		make_sample();
+	else if (!read_file(argv[1]))
+		return CHECK_ERROR;
+
+	videoDemux = new cDemux(0);
+	audioDemux = new cDemux(0);
+	pcrDemux = new cDemux(0);
+	videoDecoder = new cVideo(0, NULL, NULL);
+	audioDecoder = new cAudio(NULL, NULL, NULL);
+	CZapit *zapit = new CZapReplay();
+
+	std::vector<t_channel_id> ids = add_channels();
+	if (ids.empty()) {
+		printf("zap_replay: no services in the PAT\n");
+		return CHECK_ERROR;
+	}
+	if (sample)
+		check(ids.size() == SAMPLE_SERVICES, "services in the PAT");
+	printf("%d services, %d packets\n", (int) ids.size(), (int) (ts.size() / PACKET));
+
+	Metrics::enable(true);
+	Metrics::reset();
+	int64_t start = time_monotonic_us();
+	for (int r = 0; r < rounds; r++)
+		for (unsigned int i = 0; i < ids.size(); i++)
+			zap(zapit, ids[i], sample, i);
+	int64_t us = time_monotonic_us() - start;
+	printf("%d zaps in %d ms\n", rounds * (int) ids.size(), (int) (us / 1000));
+	report(METRIC_ZAP_PAT);
+	report(METRIC_ZAP_PMT);
+	report(METRIC_ZAP_PLAYBACK);
+	report(METRIC_ZAP_CAPMT);
+	report(METRIC_ZAP_TOTAL);
+
+	check(tuned_channel != 0, "frontend not tuned");
+	check(!zapit->ZapIt(0x1234, false, true), "zap to an unknown channel");
+	return check_result();
+}
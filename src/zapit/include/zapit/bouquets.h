@@ -32,6 +32,22 @@ typedef ZapitChannelList::iterator zapit_list_it_t;
 
 class CZapitBouquet
 {
+	private:
+	/* position of the channels in the lists, for getChannelByChannelID.
+	   the lists are changed directly too, so the index is checked with
+	   the list size and each hit, and built again if it does not match */
+	typedef std::map<t_channel_id, unsigned int> channel_pos_map_t;
+	struct channel_index {
+		channel_pos_map_t pos;
+		size_t size;
+		bool valid;
+		channel_index() : size(0), valid(false) {}
+	};
+	channel_index tvIndex;
+	channel_index radioIndex;
+
+	CZapitChannel* findChannel(ZapitChannelList &list, channel_index &index, const t_channel_id channel_id);
+
 	public:
 
 	std::string Name;
@@ -102,6 +118,28 @@ class CBouquetManager
 		std::map<t_channel_id, t_channel_id> EpgIDMapping;
 		void readEPGMapping();
 		t_channel_id reMapEpgID(t_channel_id channelid);
+
+		/* the channels of all bouquets in iterator order, for FindChannelNr
+		   and getLowestChannelNumberWithChannelID. built on first use and
+		   dropped by renumServices and the changes of the bouquet list. a
+		   hit is checked against the bouquet, a stale one builds it again */
+		struct channel_pos {
+			unsigned int bouquet;
+			unsigned int pos;
+			CZapitChannel *channel;
+		};
+		struct position_index {
+			std::vector<channel_pos> channels;
+			std::map<t_channel_id, unsigned int> first;
+			bool valid;
+			position_index() : valid(false) {}
+		};
+		position_index tvPositions;
+		position_index radioPositions;
+		void buildPositionIndex(position_index &index, bool tv);
+		bool checkPosition(const channel_pos &p, bool tv);
+		const channel_pos *findPosition(const unsigned int nr, bool tv);
+		const channel_pos *findPosition(const t_channel_id channel_id, bool tv);
 	public:
 		CBouquetManager() { remainChannels = NULL; };
 		~CBouquetManager();
@@ -118,10 +156,11 @@ class CBouquetManager
 				ChannelIterator operator ++(int);
 				CZapitChannel* operator *();
 				ChannelIterator FindChannelNr(const unsigned int channel);
-				//int getLowestChannelNumberWithChannelID(const t_channel_id channel_id);
+				int getLowestChannelNumberWithChannelID(const t_channel_id channel_id);
 				int getNrofFirstChannelofBouquet(const unsigned int bouquet_nr);
 				bool EndOfChannels() { return (c == -2); };
 		};
+		friend class ChannelIterator;
 
 		ChannelIterator tvChannelsBegin() { return ChannelIterator(this, true); };
 		ChannelIterator radioChannelsBegin() { return ChannelIterator(this, false); };
@@ -144,6 +183,8 @@ class CBouquetManager
 		bool existsChannelInBouquet(unsigned int bq_id, const t_channel_id channel_id);
 
 		void clearAll(bool user = true);
+		/* after the bouquet list or the channels of a bouquet changed */
+		void invalidatePositions(void);
 		void deletePosition(t_satellite_position satellitePosition);
 
 		void sortBouquets(void);
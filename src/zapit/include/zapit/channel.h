@@ -130,6 +130,8 @@ class CZapitChannel
 		/* WebTV/WebRadio */
 		std::string url;
 		std::string desc;
+		/* channel id in XMLTV guides, "auto" to match by name */
+		std::string xmltv;
 
 		/* pids of this channel */
 		std::vector <CZapitAbsSub* > channelSubs;
@@ -231,6 +233,7 @@ class CZapitChannel
 		const std::string&	getRealname(void)		const { return name; }
 		const std::string&	getUrl(void)			const { return url; }
 		const std::string&	getDesc(void)			const { return desc; }
+		const std::string&	getXMLTVid(void)		const { return xmltv; }
 		t_satellite_position	getSatellitePosition(void)	const { return satellitePosition; }
 		unsigned char 		getAudioChannelCount(void)	{ return (unsigned char) audioChannels.size(); }
 		unsigned short		getPcrPid(void)			{ return pcrPid; }
@@ -254,6 +257,7 @@ class CZapitChannel
 		/* set methods */
 		void setServiceType(const unsigned char pserviceType)	{ serviceType = pserviceType; }
 		inline void setName(const std::string &pName)            { name = pName; }
+		void setXMLTVid(const std::string &id)                   { xmltv = id; }
 		inline void setUserName(const std::string &pName)            { uname = pName; }
 		void setAudioChannel(unsigned char pAudioChannel)	{ if (pAudioChannel < audioChannels.size()) currentAudioChannel = pAudioChannel; }
 		void setPcrPid(unsigned short pPcrPid)			{ pcrPid = pPcrPid; }
@@ -203,7 +203,8 @@ class CZapitMessages
 	{
 		t_channel_id channel_id;
 		bool standby;
-		commandZaptoEpg():channel_id(0),standby(false){}
+		uint32_t busy_fe;
+		commandZaptoEpg():channel_id(0),standby(false),busy_fe(0){}
 	};
 
 	struct commandSetAudioChannel
@@ -280,7 +280,8 @@ class CZapitClient:public CBasicClient
 	unsigned int zapTo_serviceID(const t_channel_id channel_id);
 	unsigned int zapTo_record(const t_channel_id channel_id);
 	unsigned int zapTo_pip(const t_channel_id channel_id);
-	unsigned int zapTo_epg(const t_channel_id channel_id, bool standby = false);
+	/* busy_fe: bit n set keeps frontend n free, it scans already */
+	unsigned int zapTo_epg(const t_channel_id channel_id, bool standby = false, uint32_t busy_fe = 0);
 
 	/* zaps to subservice, returns the "zap-status" */
 	unsigned int zapTo_subServiceID(const t_channel_id channel_id);
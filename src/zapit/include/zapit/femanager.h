@@ -28,6 +28,7 @@
 #include <zapit/getservices.h>
 #include <zapit/frontend_c.h>
 #include <map>
+#include <vector>
 
 #include <OpenThreads/ReentrantMutex>
 
@@ -125,6 +126,8 @@ class CFEManager
 		int		getEnabledCount();
 
 		CFrontend *	getScanFrontend(t_satellite_position satellitePosition);
+		CFrontend *	getPreTuneFrontend(CZapitChannel * channel, CFrontend * except = NULL);
+		int		getScanFrontends(t_satellite_position satellitePosition, CFrontend * primary, std::vector<CFrontend*> &felist);
 		bool		canTune(CZapitChannel * channel);
 
 		bool		configExist() { return config_exist; };
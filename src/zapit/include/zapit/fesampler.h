@@ -0,0 +1,103 @@
+/*
+ * signal values of a frontend, read by one thread for all users
+ *
+ * License: GPLv2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#ifndef __zapit_fesampler_h__
+#define __zapit_fesampler_h__
+
+#include <inttypes.h>
+#include <vector>
+#include <OpenThreads/Thread>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/Condition>
+
+/* number of samples kept, about 4 minutes with the default interval */
+#define FE_SAMPLE_HISTORY	512
+#define FE_SAMPLE_INTERVAL	500	/* ms */
+
+typedef struct fe_sample
+{
+	int64_t		time;		/* time_monotonic_ms() */
+	uint16_t	sig;
+	uint16_t	snr;
+	uint32_t	ber;
+	uint32_t	unc;		/* uncorrected blocks, as the driver counts them */
+	bool		lock;
+} fe_sample_t;
+
+typedef struct fe_sample_stats
+{
+	int		count;
+	int		unlocked;	/* samples without lock */
+	uint16_t	sig_min, sig_max, sig_avg;
+	uint16_t	snr_min, snr_max, snr_avg;
+	uint32_t	ber_min, ber_max, ber_avg;
+	uint32_t	unc;		/* uncorrected blocks in the window */
+} fe_sample_stats_t;
+
+class CFrontend;
+
+/* the signal values of a frontend cost driver ioctls, which block the caller.
+ * one sampler per frontend reads them while there are subscribers and keeps
+ * the history in a ring, which is read without locks. everything else asks
+ * the sampler instead of the frontend */
+class CFESampler : public OpenThreads::Thread
+{
+	private:
+		struct slot {
+			volatile uint32_t seq;	/* odd while written */
+			fe_sample_t sample;
+		};
+
+		CFrontend *frontend;
+		slot ring[FE_SAMPLE_HISTORY];
+		volatile uint32_t head;		/* samples written so far */
+		int interval;
+		int subscribers;
+		bool running;
+
+		OpenThreads::Mutex mutex;	/* subscribers, start and stop */
+		OpenThreads::Mutex write_mutex;
+		OpenThreads::Mutex cond_mutex;
+		OpenThreads::Condition cond;
+
+		void run();
+		void sample(bool force);
+		void push(const fe_sample_t &s);
+		bool read(uint32_t n, fe_sample_t &s) const;
+	public:
+		CFESampler(CFrontend *fe);
+		~CFESampler();
+
+		/* the thread runs while anybody is subscribed */
+		void Subscribe();
+		void Unsubscribe();
+		void setInterval(int ms);
+		int getInterval() { return interval; }
+
+		/* the latest sample, read from the frontend if it is older than
+		 * the interval. callers at the same time share one read */
+		fe_sample_t getLast();
+		/* up to count samples, oldest first */
+		int getHistory(std::vector<fe_sample_t> &samples, int count = FE_SAMPLE_HISTORY);
+		/* min/max/avg of the samples of the last window_ms, false if there are none */
+		bool getStats(int window_ms, fe_sample_stats_t &stats);
+};
+
+#endif /* __zapit_fesampler_h__ */
@@ -34,6 +34,8 @@
 #include <zapit/frontend_types.h>
 #include <map>
 
+class CFESampler;
+
 #define FEC_S2_QPSK_BASE (fe_code_rate_t)(FEC_AUTO+1)
 #define FEC_S2_QPSK_1_2 (fe_code_rate_t)(FEC_S2_QPSK_BASE+0)	//10
 #define FEC_S2_QPSK_2_3 (fe_code_rate_t)(FEC_S2_QPSK_BASE+1)	//11
@@ -158,6 +160,7 @@ class CFrontend
 		//fe_delivery_system_t deliverySystems[MAX_DELSYS];
 		//uint32_t numDeliverySystems;
 		t_channel_id		channel_id;
+		CFESampler			*sampler;
 
 		bool				buildProperties(const FrontendParameters*, struct dtv_properties &);
 
@@ -186,6 +189,8 @@ class CFrontend
 	public:
 		/* tuning finished flag */
 		bool tuned;
+		/* tuned by the pre-tune thread, not ready for zap */
+		bool pretuning;
 
 		~CFrontend(void);
 
@@ -212,6 +217,8 @@ class CFrontend
 		uint16_t			getSignalStrength(void) const;
 		fe_status_t			getStatus(void) const;
 		uint32_t			getUncorrectedBlocks(void) const;
+		/* use this for the values above, it is shared by all users */
+		CFESampler *			getSampler(void) { return sampler; }
 		void				getDelSys(int f, int m, const char * &fec, const char * &sys, const char * &mod);
 		void				forceDelSys(int i);
 		void				getFEInfo(void);
@@ -246,6 +253,7 @@ class CFrontend
 		void				sendMotorCommand(uint8_t cmdtype, uint8_t address, uint8_t command, uint8_t num_parameters, uint8_t parameter1, uint8_t parameter2, int repeat = 0);
 		void				gotoXX(t_satellite_position pos);
 		bool				tuneChannel(CZapitChannel *channel, bool nvod);
+		bool				tuneTransponder(transponder_id_t tpid, t_satellite_position satellitePosition, FrontendParameters *feparams);
 		bool				retuneChannel(void);
 
 		t_channel_id			getChannelID(void) { return channel_id; }
@@ -35,6 +35,8 @@
 
 #include <map>
 #include <list>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
 
 extern transponder_list_t transponders;
 
@@ -88,10 +90,25 @@ class CServiceManager
 		satellite_map_t satellitePositions;
 		sat_transponder_map_t satelliteTransponders;
 
+		/* lower case channel names, for FindChannelByName and
+		   FindChannelByPattern. AddChannel and RemoveChannel keep it up
+		   to date, other changes drop it until the next search */
+		typedef std::multimap<std::string, CZapitChannel *> channel_name_map_t;
+		channel_name_map_t name_index;
+		bool name_index_valid;
+		OpenThreads::Mutex name_index_mutex;
+		static std::string NameKey(const std::string &name);
+		void BuildNameIndex(void);
+		void NameIndexAdd(CZapitChannel *channel);
+		void NameIndexRemove(CZapitChannel *channel);
+		CZapitChannel* SearchNameIndex(const std::string &name, bool prefix);
+
 		bool ParseScanXml(delivery_system_t delsys);
-		void ParseTransponders(xmlNodePtr node, t_satellite_position satellitePosition, delivery_system_t delsys);
-		void ParseChannels(xmlNodePtr node, const t_transport_stream_id transport_stream_id, const t_original_network_id original_network_id, t_satellite_position satellitePosition, freq_id_t freq, uint8_t polarization, delivery_system_t delsys);
-		void FindTransponder(xmlNodePtr search);
+		bool ParseProvider(const char *type, const char **atts, bool init, t_satellite_position &satellitePosition, delivery_system_t &delsys);
+		void ParseTransponder(const char **atts, t_satellite_position satellitePosition, delivery_system_t delsys,
+				t_transport_stream_id &transport_stream_id, t_original_network_id &original_network_id, freq_id_t &freq, uint8_t &polarization);
+		void ParseChannel(const char **atts, const t_transport_stream_id transport_stream_id, const t_original_network_id original_network_id, t_satellite_position satellitePosition, freq_id_t freq, uint8_t polarization, delivery_system_t delsys);
+		bool ReadServicesXml(const char *filename, bool init_positions);
 		void ParseSatTransponders(delivery_system_t delsys, xmlNodePtr search, t_satellite_position satellitePosition);
 		int LoadMotorPositions(void);
 
@@ -104,6 +121,8 @@ class CServiceManager
 		static CServiceManager * manager;
 		CServiceManager();
 
+		friend class CServicesXmlReader;
+
 	public:
 		~CServiceManager();
 		static CServiceManager * getInstance();
@@ -127,6 +146,8 @@ class CServiceManager
 		void RemoveAllChannels();
 		void RemoveCurrentChannels();
 		void RemoveNVODChannels();
+		/* after a channel got a new name */
+		void InvalidateNameIndex(void);
 
 		CZapitChannel* FindChannel(const t_channel_id channel_id, bool * current_is_nvod = NULL);
 		CZapitChannel* FindChannelByName(std::string name);
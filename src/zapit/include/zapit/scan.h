@@ -27,6 +27,7 @@
 #include <inttypes.h>
 #include <map>
 #include <list>
+#include <vector>
 #include <string>
 
 #include <zapit/femanager.h>
@@ -34,9 +35,34 @@
 #include <zapit/fastscan.h>
 #include "bouquets.h"
 #include <OpenThreads/Thread>
+#include <OpenThreads/ReentrantMutex>
+#include <OpenThreads/ScopedLock>
 
 extern CBouquetManager* scanBouquetManager;
 
+class CServiceScan;
+
+/* helper thread to scan transponders on additional, idle frontend */
+class CScanWorker : public OpenThreads::Thread
+{
+	private:
+		CServiceScan * scan;
+		CFrontend * frontend;
+		int dmxnum;
+		/* source of the demux before the scan */
+		int dmxsource;
+		t_satellite_position satellitePosition;
+
+		void run();
+	public:
+		CScanWorker(CServiceScan * s, CFrontend * fe, int dnum, t_satellite_position spos);
+		bool Start();
+		bool Stop();
+		CFrontend * GetFrontend() { return frontend; }
+		int GetDemux() { return dmxnum; }
+		int GetDemuxSource() { return dmxsource; }
+};
+
 class CServiceScan : public OpenThreads::Thread
 {
 	public:
@@ -86,11 +112,25 @@ class CServiceScan : public OpenThreads::Thread
 		transponder_list_t nittransponders;    // transponders from NIT
 		std::map <t_channel_id, uint8_t> service_types;
 
+		/* protect transponder lists, counters and services, if more than one frontend scan */
+		OpenThreads::ReentrantMutex scan_mutex;
+		/* transponders not yet given to any frontend */
+		std::list<transponder_pair_t> pending_transponders;
+		std::map <t_channel_id, int> nit_logical_map;
+		std::map <t_channel_id, int> nit_hd_logical_map;
+		std::string networkName;
+		/* sum of transponder scan times of all frontends */
+		int64_t tuner_time;
+
 		bool ScanProvider(t_satellite_position satellitePosition);
 		void Cleanup(const bool success);
-		bool tuneFrequency(FrontendParameters *feparams, t_satellite_position satellitePosition);
+		bool tuneFrequency(FrontendParameters *feparams, t_satellite_position satellitePosition, CFrontend * fe = NULL);
 		void SendTransponderInfo(transponder &t);
 		bool ReadNitSdt(t_satellite_position satellitePosition);
+		bool ScanOneTransponder(transponder_pair_t &tp, t_satellite_position satellitePosition, CFrontend * fe, int dmxnum);
+		void ScanParallel(t_satellite_position satellitePosition, std::vector<CFrontend*> &felist);
+		bool GetNextTransponder(CFrontend * fe, transponder_pair_t &tp);
+		void AddTunerTime(int64_t ms);
 		bool AddFromNit();
 		void FixServiceTypes();
 
@@ -128,6 +168,8 @@ class CServiceScan : public OpenThreads::Thread
 		static CServiceScan * scan;
 		CServiceScan();
 
+		friend class CScanWorker;
+
 	public:
 		~CServiceScan();
 		static CServiceScan * getInstance();
@@ -139,6 +181,10 @@ class CServiceScan : public OpenThreads::Thread
 		void ChannelFound(uint8_t service_type, std::string providerName, std::string serviceName);
 		void AddServiceType(t_channel_id channel_id, uint8_t service_type);
 
+		void Lock() { scan_mutex.lock(); }
+		void Unlock() { scan_mutex.unlock(); }
+		OpenThreads::ReentrantMutex & GetMutex() { return scan_mutex; }
+
 		bool Scanning() { return running; };
 		void Abort() { abort_scan = 1; };
 		bool Aborted() { return abort_scan; };
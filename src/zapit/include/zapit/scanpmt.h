@@ -35,6 +35,7 @@ class CPmt
 		unsigned char buffer[PMT_SECTION_SIZE];
 
 		bool Read(unsigned short pid, unsigned short sid);
+		bool ParseBuffer(CZapitChannel * const channel);
 		void MakeCAMap(casys_map_t &camap);
 		bool ParseEsInfo(ElementaryStreamInfo *esinfo, CZapitChannel * const channel);
 	public:
@@ -42,6 +43,7 @@ class CPmt
 		~CPmt();
 
 		bool Parse(CZapitChannel * const channel);
+		bool ParseCached(CZapitChannel * const channel);
 		bool haveCaSys(int pmtpid, int service_id);
 };
 
@@ -27,14 +27,21 @@
 #include <dmx.h>
 #include <dvbsi++/service_description_section.h>
 #include <dvbsi++/service_descriptor.h>
+#include <vector>
 
 #define SDT_SECTION_SIZE 4096
 
+class CFrontend;
+
+typedef std::pair<CZapitChannel *, uint8_t> sdt_channel_pair_t;
+typedef std::vector<sdt_channel_pair_t> sdt_channel_list_t;
+
 class CSdt
 {
 	private:
 		int dmxnum;
 		bool cable;
+		CFrontend * frontend;
 
 		t_transport_stream_id transport_stream_id;
 		t_original_network_id original_network_id;
@@ -44,6 +51,8 @@ class CSdt
 
 		ServiceDescriptionSectionList sections;
 		CPat pat;
+		/* services found while scanning, with their service type */
+		sdt_channel_list_t pid_channels;
 
 		/* current sdt to check updates */
 		bool current;
@@ -57,9 +66,10 @@ class CSdt
 
 		bool Read();
 		bool ParseServiceDescriptor(ServiceDescription * service, ServiceDescriptor * sd);
+		void ParsePids();
 
 	public:
-		CSdt(t_satellite_position spos, freq_id_t frq, bool curr = false, int dnum = 0);
+		CSdt(t_satellite_position spos, freq_id_t frq, bool curr = false, int dnum = 0, CFrontend * fe = NULL);
 		~CSdt();
 		bool Parse(t_transport_stream_id &tsid, t_original_network_id &onid);
 };
@@ -7,6 +7,7 @@
 
 #include <OpenThreads/Thread>
 #include <OpenThreads/ReentrantMutex>
+#include <OpenThreads/Condition>
 #include <configfile.h>
 #include <eventserver.h>
 #include <connection/basicserver.h>
@@ -60,6 +61,7 @@ typedef struct Zapit_config {
         int saveLastChannel;
         int rezapTimeout;
         int fastZap;
+        int preTune;
         int sortNames;
         int scanPids;
         int scanSDT;
@@ -68,6 +70,7 @@ typedef struct Zapit_config {
         /* FE common */
         int feTimeout;
         int feRetries;
+        int feSampleInterval;
         int noSameFE;
         int gotoXXLaDirection;
         int gotoXXLoDirection;
@@ -98,6 +101,48 @@ class CZapitSdtMonitor : public OpenThreads::Thread
 		void Wakeup();
 };
 
+/* tune idle frontends to the neighbours of live channel, and check pat after
+   fast zap. the command thread hands over copies of the channels, this thread
+   does not touch bouquets or services */
+class CZapitPreTune : public OpenThreads::Thread
+{
+	private:
+		bool started;
+		OpenThreads::Mutex mutex;
+		OpenThreads::Condition cond;
+
+		/* neighbours to pretune, owned, with the tuning parameters of
+		   their transponders, the transponder list is not used here */
+		bool pretune_wakeup;
+		CZapitChannel * pretune_next;
+		CZapitChannel * pretune_prev;
+		FrontendParameters pretune_next_params;
+		FrontendParameters pretune_prev_params;
+		transponder_id_t live_tp;
+
+		/* pat check of fast zap channel */
+		bool verify_pending;
+		bool verify_done;
+		t_channel_id verify_channel_id;
+		t_service_id verify_sid;
+		int verify_demux;
+		unsigned short verify_pmt_pid;
+
+		void run();
+		void PreTune(CZapitChannel * channel, FrontendParameters * feparams, transponder_id_t live, CFrontend * &used);
+		bool Pending();
+		void ClearPreTune();
+
+	public:
+		CZapitPreTune();
+		~CZapitPreTune();
+		bool Start();
+		bool Stop();
+		void Wakeup(CZapitChannel * live, CZapitChannel * next, CZapitChannel * prev);
+		void Verify(CZapitChannel * channel);
+		bool VerifyResult(t_channel_id channel_id, unsigned short &pmt_pid);
+};
+
 class CZapit : public OpenThreads::Thread
 {
 	private:
@@ -162,6 +207,11 @@ class CZapit : public OpenThreads::Thread
 		t_channel_id  lastChannelTV;
 		int abort_zapit;
 		int pmt_update_fd;
+		/* fast zap, started from cached pmt */
+		bool fastzap_verify;
+		/* zap timing */
+		int64_t zap_start_ms;
+		bool zap_wait_video;
 
 		//void LoadAudioMap();
 		void SaveAudioMap();
@@ -173,6 +223,9 @@ class CZapit : public OpenThreads::Thread
 
 		bool TuneChannel(CFrontend *frontend, CZapitChannel * channel, bool &transponder_change, bool send_event = true);
 		bool ParsePatPmt(CZapitChannel * channel);
+		void VerifyFastZap();
+		bool GetNeighbours(CZapitChannel * live, CZapitChannel * &next, CZapitChannel * &prev);
+		void CheckZapTime();
 
 		bool send_data_count(int connfd, int data_count);
 		void sendAPIDs(int connfd);
@@ -206,6 +259,7 @@ class CZapit : public OpenThreads::Thread
 		bool standby;
 		Zapit_config config;
 		CZapitSdtMonitor SdtMonitor;
+		CZapitPreTune PreTuner;
 		void LoadAudioMap();
 		void LoadVolumeMap();
 		void SaveChannelPids(CZapitChannel* channel);
@@ -226,7 +280,7 @@ class CZapit : public OpenThreads::Thread
 		bool ParseCommand(CBasicMessage::Header &rmsg, int connfd);
 		bool ZapIt(const t_channel_id channel_id, bool for_update = false, bool startplayback = true);
 		bool ZapForRecord(const t_channel_id channel_id);
-		bool ZapForEpg(const t_channel_id channel_id, bool standby);
+		bool ZapForEpg(const t_channel_id channel_id, bool standby, uint32_t busy_fe = 0);
 		bool ChangeAudioPid(uint8_t index);
 		void SetRadioMode();
 		void SetTVMode();
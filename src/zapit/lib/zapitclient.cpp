@@ -226,12 +226,13 @@ unsigned int CZapitClient::zapTo_pip(const t_channel_id channel_id)
 	return response.zapStatus;
 }
 
-unsigned int CZapitClient::zapTo_epg(const t_channel_id channel_id, bool standby)
+unsigned int CZapitClient::zapTo_epg(const t_channel_id channel_id, bool standby, uint32_t busy_fe)
 {
 	CZapitMessages::commandZaptoEpg msg;
 
 	msg.channel_id = channel_id;
 	msg.standby = standby;
+	msg.busy_fe = busy_fe;
 
 	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
 	send(CZapitMessages::CMD_ZAPTO_EPG, (const char *) & msg, sizeof(msg));
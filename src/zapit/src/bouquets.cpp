@@ -51,6 +51,27 @@ extern CBouquetManager *g_bouquetManager;
 
 /**** class CBouquet ********************************************************/
 // -- servicetype 0 queries TV and Radio Channels
+CZapitChannel* CZapitBouquet::findChannel(ZapitChannelList &list, channel_index &index, const t_channel_id channel_id)
+{
+	for (int pass = 0; pass < 2; pass++) {
+		if (!index.valid || index.size != list.size()) {
+			index.pos.clear();
+			for (unsigned int i = 0; i < list.size(); i++)
+				index.pos.insert(channel_pos_map_t::value_type(list[i]->getChannelID(), i));
+			index.size = list.size();
+			index.valid = true;
+		}
+		channel_pos_map_t::iterator it = index.pos.find(channel_id);
+		if (it == index.pos.end())
+			return NULL;
+		if (it->second < list.size() && list[it->second]->getChannelID() == channel_id)
+			return list[it->second];
+		/* moved or sorted */
+		index.valid = false;
+	}
+	return NULL;
+}
+
 CZapitChannel* CZapitBouquet::getChannelByChannelID(const t_channel_id channel_id, const unsigned char serviceType)
 {
 	CZapitChannel* result = NULL;
@@ -70,12 +91,7 @@ CZapitChannel* CZapitBouquet::getChannelByChannelID(const t_channel_id channel_i
 			break;
 	}
 
-	unsigned int i;
-	for (i = 0; (i < channels->size()) && ((*channels)[i]->getChannelID() != channel_id); i++)
-	{};
-
-	if (i<channels->size())
-		result = (*channels)[i];
+	result = findChannel(*channels, channels == &tvChannels ? tvIndex : radioIndex, channel_id);
 
 	if ((serviceType == ST_RESERVED) && (result == NULL)) {
 		result = getChannelByChannelID(channel_id, ST_DIGITAL_RADIO_SOUND_SERVICE);
@@ -98,18 +114,32 @@ void CZapitBouquet::sortBouquetByNumber(void)
 
 void CZapitBouquet::addService(CZapitChannel* newChannel)
 {
+	ZapitChannelList* channels = NULL;
+	channel_index* index = NULL;
+
 	switch (newChannel->getServiceType())
 	{
 		case ST_DIGITAL_TELEVISION_SERVICE:
 		case ST_NVOD_REFERENCE_SERVICE:
 		case ST_NVOD_TIME_SHIFTED_SERVICE:
-			tvChannels.push_back(newChannel);
+			channels = &tvChannels;
+			index = &tvIndex;
 			break;
 
 		case ST_DIGITAL_RADIO_SOUND_SERVICE:
-			radioChannels.push_back(newChannel);
+			channels = &radioChannels;
+			index = &radioIndex;
 			break;
 	}
+	if (channels) {
+		/* keep the index, if it was up to date */
+		if (index->valid && index->size == channels->size()) {
+			index->pos.insert(channel_pos_map_t::value_type(newChannel->getChannelID(), channels->size()));
+			index->size++;
+		} else
+			index->valid = false;
+		channels->push_back(newChannel);
+	}
 	if (bLocked)
 		newChannel->bLockCount++;
 }
@@ -372,6 +402,7 @@ void CBouquetManager::saveBouquets(const CZapitClient::bouquetMode bouquetMode,
 void CBouquetManager::sortBouquets(void)
 {
 	sort(Bouquets.begin(), Bouquets.end(), CmpBouquetByChName());
+	invalidatePositions();
 }
 
 void CBouquetManager::parseBouquetsXml(const char *fname, bool bUser)
@@ -446,8 +477,10 @@ void CBouquetManager::parseBouquetsXml(const char *fname, bool bUser)
 					chan = CServiceManager::getInstance()->FindChannel(chid);
 				if (chan != NULL) {
 					DBG("%04x %04x %04x %s\n", transport_stream_id, original_network_id, service_id, xmlGetAttribute(channel_node, "n"));
-					if(bUser && !(uname.empty()))
+					if(bUser && !(uname.empty())) {
 						chan->setUserName(uname);
+						CServiceManager::getInstance()->InvalidateNameIndex();
+					}
 					if(!bUser)
 						chan->pname = (char *) newBouquet->Name.c_str();
 					chan->bLocked = clock;
@@ -470,8 +503,10 @@ void CBouquetManager::parseBouquetsXml(const char *fname, bool bUser)
 					CServiceManager::getInstance()->AddChannel(chan);
 					chan->flags = CZapitChannel::NOT_FOUND;
 					chan->bLocked = clock;
-					if(!(uname.empty()))
+					if(!(uname.empty())) {
 						chan->setUserName(uname);
+						CServiceManager::getInstance()->InvalidateNameIndex();
+					}
 					newBouquet->addService(chan);
 					CServiceManager::getInstance()->SetServicesChanged(false);
 				}
@@ -568,6 +603,7 @@ void CBouquetManager::makeRemainingChannelsBouquet(void)
 
 void CBouquetManager::renumServices()
 {
+	invalidatePositions();
 #if 0
 	if(remainChannels)
 		deleteBouquet(remainChannels);
@@ -602,6 +638,7 @@ CZapitBouquet* CBouquetManager::addBouquet(const std::string & name, bool ub, bo
 		Bouquets.insert(it, newBouquet);
 	} else
 		Bouquets.push_back(newBouquet);
+	invalidatePositions();
 	return newBouquet;
 }
 
@@ -629,6 +666,7 @@ void CBouquetManager::deleteBouquet(const CZapitBouquet* bouquet)
 
 			Bouquets.erase(it);
 			delete bouquet;
+			invalidatePositions();
 		}
 	}
 }
@@ -764,6 +802,7 @@ void CBouquetManager::moveBouquet(const unsigned int oldId, const unsigned int n
 		it = Bouquets.begin();
 		advance(it, newId);
 		Bouquets.insert(it, tmp);
+		invalidatePositions();
 	}
 }
 
@@ -781,6 +820,7 @@ void CBouquetManager::clearAll(bool user)
 	if (!user)
 		Bouquets = tmplist;
 	remainChannels = NULL;
+	invalidatePositions();
 }
 
 void CBouquetManager::deletePosition(t_satellite_position satellitePosition)
@@ -794,6 +834,7 @@ void CBouquetManager::deletePosition(t_satellite_position satellitePosition)
 			tmplist.push_back(Bouquets[i]);
 	}
 	Bouquets = tmplist;
+	invalidatePositions();
 }
 
 CZapitBouquet* CBouquetManager::addBouquetIfNotExist(const std::string &name)
@@ -852,6 +893,7 @@ void CBouquetManager::loadWebchannels(int mode)
 					const char *genre = xmlGetAttribute(l1, "genre");
 					const char *epgid = xmlGetAttribute(l1, "epgid");
 					const char *script = xmlGetAttribute(l1, "script");
+					const char *xmltv = xmlGetAttribute(l1, "xmltv");
 					t_channel_id epg_id = 0;
 					if (epgid)
 					{
@@ -880,7 +922,12 @@ void CBouquetManager::loadWebchannels(int mode)
 					}
 					if (title && url) {
 						t_channel_id chid = create_channel_id64(0, 0, 0, 0, 0, url);
+						/* events of the guide are stored for the channel itself */
+						if (xmltv && !epg_id)
+							epg_id = chid;
 						CZapitChannel * channel = new CZapitChannel(title, chid, url, desc, epg_id, script, mode);
+						if (xmltv)
+							channel->setXMLTVid(xmltv);
 						CServiceManager::getInstance()->AddChannel(channel);
 						channel->flags = CZapitChannel::UPDATED;
 						if (gbouquet)
@@ -933,30 +980,89 @@ CZapitChannel* CBouquetManager::ChannelIterator::operator *()
 
 CBouquetManager::ChannelIterator CBouquetManager::ChannelIterator::FindChannelNr(const unsigned int channel)
 {
-	c = channel;
-	for (b = 0; b < Owner->Bouquets.size(); b++)
-		if (getBouquet()->size() > (unsigned int)c)
-			goto end;
-		else
-			c -= getBouquet()->size();
-	c = -2;
- end:
+	const channel_pos *p = Owner->findPosition(channel, tv);
+	if (p) {
+		b = p->bouquet;
+		c = p->pos;
+	} else
+		c = -2;
 	return (*this);
 }
 
-#if 0
 int CBouquetManager::ChannelIterator::getLowestChannelNumberWithChannelID(const t_channel_id channel_id)
 {
-	int i = 0;
+	const channel_pos *p = Owner->findPosition(channel_id, tv);
+	if (!p)
+		return -1; // not found
+	b = p->bouquet;
+	c = p->pos;
+	return p->channel->number - 1;
+}
 
-	for (b = 0; b < Owner->Bouquets.size(); b++)
-		for (c = 0; (unsigned int) c < getBouquet()->size(); c++, i++)
-			if ((**this)->getChannelID() == channel_id)
-			    return (**this)->number -1;
-			    //return i;
-	return -1; // not found
+void CBouquetManager::invalidatePositions(void)
+{
+	tvPositions.valid = false;
+	radioPositions.valid = false;
+}
+
+void CBouquetManager::buildPositionIndex(position_index &index, bool tv)
+{
+	index.channels.clear();
+	index.first.clear();
+	for (unsigned int b = 0; b < Bouquets.size(); b++) {
+		ZapitChannelList &list = tv ? Bouquets[b]->tvChannels : Bouquets[b]->radioChannels;
+		for (unsigned int i = 0; i < list.size(); i++) {
+			channel_pos p = { b, i, list[i] };
+			/* insert keeps the first one */
+			index.first.insert(std::make_pair(list[i]->getChannelID(), (unsigned int) index.channels.size()));
+			index.channels.push_back(p);
+		}
+	}
+	index.valid = true;
+}
+
+bool CBouquetManager::checkPosition(const channel_pos &p, bool tv)
+{
+	if (p.bouquet >= Bouquets.size())
+		return false;
+	ZapitChannelList &list = tv ? Bouquets[p.bouquet]->tvChannels : Bouquets[p.bouquet]->radioChannels;
+	return p.pos < list.size() && list[p.pos] == p.channel;
+}
+
+const CBouquetManager::channel_pos *CBouquetManager::findPosition(const unsigned int nr, bool tv)
+{
+	position_index &index = tv ? tvPositions : radioPositions;
+	for (int pass = 0; pass < 2; pass++) {
+		bool built = !index.valid;
+		if (built)
+			buildPositionIndex(index, tv);
+		if (nr < index.channels.size() && checkPosition(index.channels[nr], tv))
+			return &index.channels[nr];
+		if (built && nr >= index.channels.size())
+			break;
+		index.valid = false;
+	}
+	return NULL;
+}
+
+const CBouquetManager::channel_pos *CBouquetManager::findPosition(const t_channel_id channel_id, bool tv)
+{
+	position_index &index = tv ? tvPositions : radioPositions;
+	for (int pass = 0; pass < 2; pass++) {
+		bool built = !index.valid;
+		if (built)
+			buildPositionIndex(index, tv);
+		std::map<t_channel_id, unsigned int>::iterator it = index.first.find(channel_id);
+		if (it != index.first.end() && checkPosition(index.channels[it->second], tv)
+				&& index.channels[it->second].channel->getChannelID() == channel_id)
+			return &index.channels[it->second];
+		/* added channels are found after a rebuild only */
+		if (built)
+			break;
+		index.valid = false;
+	}
+	return NULL;
 }
-#endif
 
 int CBouquetManager::ChannelIterator::getNrofFirstChannelofBouquet(const unsigned int bouquet_nr)
 {
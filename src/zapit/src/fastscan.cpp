@@ -490,6 +490,7 @@ bool CServiceScan::ParseFst(unsigned short pid, fast_scan_operator_t * op)
 							newchannel->flags = CZapitChannel::UPDATED | CZapitChannel::FASTSCAN;
 						}
 						newchannel->setName(serviceName);
+						CServiceManager::getInstance()->InvalidateNameIndex();
 						newchannel->setServiceType(service_type);
 						newchannel->setVideoPid(video_pid);
 						newchannel->setAudioPid(audio_pid);
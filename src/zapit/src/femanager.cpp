@@ -554,6 +554,7 @@ bool CFEManager::loopCanTune(CFrontend * fe, CZapitChannel * channel)
 CFrontend * CFEManager::getFrontend(CZapitChannel * channel)
 {
 	CFrontend * retfe = NULL;
+	CFrontend * pretuned = NULL;
 
 	if (livefe && livefe->tuned && livefe->sameTsidOnid(channel->getTransponderId())) {
 		if (!noSameFE) {
@@ -599,7 +600,8 @@ CFrontend * CFEManager::getFrontend(CZapitChannel * channel)
 						free_twin = NULL;
 						break;
 					}
-					if (fe->tuned && fe->sameTsidOnid(channel->getTransponderId())) {
+					/* a running pre-tune is not the same TP yet */
+					if (fe->tuned && !fe->pretuning && fe->sameTsidOnid(channel->getTransponderId())) {
 						if (!noSameFE) {
 							FEDEBUG("fe %d on the same TP", fe->fenumber);
 							return fe;
@@ -632,7 +634,7 @@ CFrontend * CFEManager::getFrontend(CZapitChannel * channel)
 			FEDEBUG("Check fe%d: mode %d locked %d freq %d TP %" PRIx64 " - channel freq %d TP %" PRIx64, mfe->fenumber, mfe->getMode(),
 					mfe->Locked(), mfe->getFrequency(), mfe->getTsidOnid(), channel->getFreqId(), channel->getTransponderId());
 			if(mfe->Locked()) {
-				if(mfe->tuned && mfe->sameTsidOnid(channel->getTransponderId())) {
+				if(mfe->tuned && !mfe->pretuning && mfe->sameTsidOnid(channel->getTransponderId())) {
 					if (!noSameFE) {
 						FEDEBUG("fe %d on the same TP", mfe->fenumber);
 						return mfe;
@@ -641,10 +643,16 @@ CFrontend * CFEManager::getFrontend(CZapitChannel * channel)
 						return mfe;
 					}
 				}
+			} else if (mfe->tuned && !mfe->pretuning && mfe->sameTsidOnid(channel->getTransponderId())) {
+				/* idle, but already (pre-)tuned to channel's TP */
+				FEDEBUG("fe %d pre-tuned to the same TP", mfe->fenumber);
+				pretuned = mfe;
 			} else if(!retfe)
 				retfe = mfe;
 		}
 	}
+	if (pretuned)
+		retfe = pretuned;
 	FEDEBUG("Selected fe: %d", retfe ? retfe->fenumber : -1);
 	if (noSameFE && retfe)
 		retfe->setChannelID(channel->getChannelID());
@@ -784,6 +792,70 @@ CFrontend * CFEManager::getScanFrontend(t_satellite_position satellitePosition)
 	return frontend;
 }
 
+/* find idle independent frontend to tune channel's TP in advance, without disturbing live or record */
+CFrontend * CFEManager::getPreTuneFrontend(CZapitChannel * channel, CFrontend * except)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(mutex);
+	CFrontend * retfe = NULL;
+	t_satellite_position satellitePosition = channel->getSatellitePosition();
+	for(fe_map_iterator_t it = femap.begin(); it != femap.end(); it++) {
+		CFrontend * mfe = it->second;
+		if (mfe == livefe || mfe == except || mfe->Locked())
+			continue;
+		if (mfe->getMode() != CFrontend::FE_MODE_INDEPENDENT)
+			continue;
+		if (!mfe->supportsDelivery(channel->delsys) || mfe->forcedDelivery(channel->delsys))
+			continue;
+		if (mfe->hasSat()) {
+			satellite_map_t & satmap = mfe->getSatellites();
+			sat_iterator_t sit = satmap.find(satellitePosition);
+			if ((sit == satmap.end()) || !sit->second.configured)
+				continue;
+			if (sit->second.motor_position || sit->second.use_usals)
+				continue;
+		}
+		if (mfe->tuned && mfe->sameTsidOnid(channel->getTransponderId()))
+			return mfe;
+		if (!retfe)
+			retfe = mfe;
+	}
+	return retfe;
+}
+
+/* collect additional idle frontends, which can scan satellitePosition in parallel to primary */
+int CFEManager::getScanFrontends(t_satellite_position satellitePosition, CFrontend * primary, std::vector<CFrontend*> &felist)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(mutex);
+	felist.clear();
+	for(fe_map_iterator_t it = femap.begin(); it != femap.end(); it++) {
+		CFrontend * mfe = it->second;
+		if (mfe == primary || mfe->Locked())
+			continue;
+		if (mfe->getMode() == CFrontend::FE_MODE_UNUSED || CFrontend::linked(mfe->getMode()))
+			continue;
+		if (SAT_POSITION_CABLE(satellitePosition)) {
+			if (!mfe->hasCable() || mfe->forcedDelivery(ALL_CABLE))
+				continue;
+		} else if (SAT_POSITION_TERR(satellitePosition)) {
+			if (!mfe->hasTerr() || mfe->forcedDelivery(ALL_TERR))
+				continue;
+		} else {
+			if (!mfe->hasSat())
+				continue;
+			satellite_map_t & satmap = mfe->getSatellites();
+			sat_iterator_t sit = satmap.find(satellitePosition);
+			if ((sit == satmap.end()) || !sit->second.configured)
+				continue;
+			/* dont fight with primary frontend over rotor */
+			if (sit->second.motor_position || sit->second.use_usals)
+				continue;
+		}
+		felist.push_back(mfe);
+	}
+	INFO("%d additional frontends for %d", (int) felist.size(), satellitePosition);
+	return felist.size();
+}
+
 bool CFEManager::lockFrontend(CFrontend * frontend, CZapitChannel * channel)
 {
 	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(mutex);
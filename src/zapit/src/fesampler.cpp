@@ -0,0 +1,222 @@
+/*
+ * signal values of a frontend, read by one thread for all users
+ *
+ * License: GPLv2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include <string.h>
+#include <OpenThreads/ScopedLock>
+
+#include <zapit/debug.h>
+#include <zapit/fesampler.h>
+#include <zapit/frontend_c.h>
+#include <driver/abstime.h>
+#include <system/set_threadname.h>
+
+CFESampler::CFESampler(CFrontend *fe)
+{
+	frontend = fe;
+	memset(ring, 0, sizeof(ring));
+	head = 0;
+	interval = FE_SAMPLE_INTERVAL;
+	subscribers = 0;
+	running = false;
+}
+
+CFESampler::~CFESampler()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(mutex);
+	if (running) {
+		cond_mutex.lock();
+		running = false;
+		cond.signal();
+		cond_mutex.unlock();
+		join();
+	}
+}
+
+void CFESampler::Subscribe()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(mutex);
+	if (subscribers++ == 0) {
+		running = true;
+		if (start() != 0) {
+			WARN("[fe%d] sampler start failed", frontend->getNumber());
+			running = false;
+		}
+	}
+}
+
+void CFESampler::Unsubscribe()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(mutex);
+	if (subscribers == 0 || --subscribers > 0)
+		return;
+	if (running) {
+		cond_mutex.lock();
+		running = false;
+		cond.signal();
+		cond_mutex.unlock();
+		/* under mutex, a new subscriber has to wait until it is gone */
+		join();
+	}
+}
+
+void CFESampler::setInterval(int ms)
+{
+	if (ms < 50)
+		ms = 50;
+	interval = ms;
+}
+
+void CFESampler::run()
+{
+	set_threadname("zap:fesampler");
+	DBG("[fe%d] sampler started, interval %d ms\n", frontend->getNumber(), interval);
+
+	cond_mutex.lock();
+	while (running) {
+		cond_mutex.unlock();
+		sample(true);
+		cond_mutex.lock();
+		if (running)
+			cond.wait(&cond_mutex, interval);
+	}
+	cond_mutex.unlock();
+	DBG("[fe%d] sampler stopped\n", frontend->getNumber());
+}
+
+void CFESampler::sample(bool force)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(write_mutex);
+	int64_t now = time_monotonic_ms();
+	if (!force && head) {
+		/* somebody else just read it */
+		fe_sample_t last;
+		if (read(head - 1, last) && now - last.time < interval)
+			return;
+	}
+
+	fe_sample_t s;
+	s.lock = frontend->getStatus() != 0;
+	s.sig  = frontend->getSignalStrength();
+	s.snr  = frontend->getSignalNoiseRatio();
+	s.ber  = frontend->getBitErrorRate();
+	s.unc  = frontend->getUncorrectedBlocks();
+	s.time = time_monotonic_ms();
+	push(s);
+}
+
+/* single writer, under write_mutex. readers check the sequence of the slot
+   before and after the copy, a slot being written has an odd number */
+void CFESampler::push(const fe_sample_t &s)
+{
+	uint32_t n = head;
+	slot &sl = ring[n % FE_SAMPLE_HISTORY];
+	sl.seq = 2 * n + 1;
+	__sync_synchronize();
+	sl.sample = s;
+	__sync_synchronize();
+	sl.seq = 2 * n + 2;
+	__sync_synchronize();
+	head = n + 1;
+}
+
+bool CFESampler::read(uint32_t n, fe_sample_t &s) const
+{
+	const slot &sl = ring[n % FE_SAMPLE_HISTORY];
+	uint32_t seq = sl.seq;
+	__sync_synchronize();
+	s = sl.sample;
+	__sync_synchronize();
+	return seq == 2 * n + 2 && sl.seq == seq;
+}
+
+fe_sample_t CFESampler::getLast()
+{
+	fe_sample_t s;
+	uint32_t n = head;
+	if (n && read(n - 1, s) && time_monotonic_ms() - s.time < interval)
+		return s;
+
+	sample(false);
+	n = head;
+	if (!n || !read(n - 1, s))
+		memset(&s, 0, sizeof(s));
+	return s;
+}
+
+int CFESampler::getHistory(std::vector<fe_sample_t> &samples, int count)
+{
+	samples.clear();
+	uint32_t n = head;
+	/* the oldest slot might be written right now */
+	if (count > FE_SAMPLE_HISTORY - 1)
+		count = FE_SAMPLE_HISTORY - 1;
+	if ((uint32_t) count > n)
+		count = n;
+	fe_sample_t s;
+	for (uint32_t i = n - count; i < n; i++)
+		if (read(i, s))
+			samples.push_back(s);
+	return samples.size();
+}
+
+bool CFESampler::getStats(int window_ms, fe_sample_stats_t &stats)
+{
+	memset(&stats, 0, sizeof(stats));
+	uint32_t n = head;
+	int64_t since = time_monotonic_ms() - window_ms;
+	uint64_t sig = 0, snr = 0, ber = 0;
+	uint32_t unc_first = 0, unc_last = 0;
+	fe_sample_t s;
+
+	for (uint32_t i = n; i > 0 && n - i < FE_SAMPLE_HISTORY - 1; i--) {
+		if (!read(i - 1, s))
+			continue;
+		if (s.time < since)
+			break;
+		if (stats.count == 0) {
+			stats.sig_min = stats.sig_max = s.sig;
+			stats.snr_min = stats.snr_max = s.snr;
+			stats.ber_min = stats.ber_max = s.ber;
+			unc_last = s.unc;
+		}
+		if (s.sig < stats.sig_min) stats.sig_min = s.sig;
+		if (s.sig > stats.sig_max) stats.sig_max = s.sig;
+		if (s.snr < stats.snr_min) stats.snr_min = s.snr;
+		if (s.snr > stats.snr_max) stats.snr_max = s.snr;
+		if (s.ber < stats.ber_min) stats.ber_min = s.ber;
+		if (s.ber > stats.ber_max) stats.ber_max = s.ber;
+		sig += s.sig;
+		snr += s.snr;
+		ber += s.ber;
+		if (!s.lock)
+			stats.unlocked++;
+		unc_first = s.unc;
+		stats.count++;
+	}
+	if (stats.count == 0)
+		return false;
+
+	stats.sig_avg = sig / stats.count;
+	stats.snr_avg = snr / stats.count;
+	stats.ber_avg = ber / stats.count;
+	/* most drivers count up, some reset the counter on read */
+	stats.unc = (unc_last >= unc_first) ? unc_last - unc_first : unc_last;
+	return true;
+}
@@ -38,8 +38,10 @@
 #include <connection/basicserver.h>
 #include <zapit/client/msgtypes.h>
 #include <zapit/frontend_c.h>
+#include <zapit/fesampler.h>
 #include <zapit/satconfig.h>
 #include <driver/abstime.h>
+#include <system/metrics.h>
 #include <linux/dvb/frontend.h>
 #include <linux/dvb/version.h>
 
@@ -221,11 +223,13 @@ CFrontend::CFrontend(int Number, int Adapter)
 	standby		= true;
 	locked		= false;
 	usecount	= 0;
+	sampler		= new CFESampler(this);
 
 	femode		= FE_MODE_INDEPENDENT;
 	masterkey	= 0;
 
 	tuned					= false;
+	pretuning				= false;
 	uncommitedInput				= 255;
 
 	currentDiseqc		= 255;
@@ -257,6 +261,7 @@ CFrontend::CFrontend(int Number, int Adapter)
 CFrontend::~CFrontend(void)
 {
 	DBG("[fe%d/%d] close frontend fd %d\n", adapter, fenumber, fd);
+	delete sampler;
 	if(fd >= 0)
 		Close();
 }
@@ -766,8 +771,6 @@ uint16_t CFrontend::getSignalNoiseRatio(void) const
 	return snr;
 }
 
-#if 0 
-//never used
 uint32_t CFrontend::getUncorrectedBlocks(void) const
 {
 	uint32_t blocks = 0;
@@ -775,7 +778,6 @@ uint32_t CFrontend::getUncorrectedBlocks(void) const
 
 	return blocks;
 }
-#endif
 
 struct dvb_frontend_event CFrontend::getEvent(void)
 {
@@ -1422,6 +1424,7 @@ int CFrontend::setFrontend(const FrontendParameters *feparams, bool nowait)
 
 		if(tuned) {
 			FE_TIMER_STOP("tuning took");
+			METRIC_TIME(METRIC_TUNE_TIME, (uint64_t) timer_msec * 1000);
 		}
 	}
 
@@ -1764,6 +1767,16 @@ bool CFrontend::tuneChannel(CZapitChannel * /*channel*/, bool /*nvod*/)
 	return tuneFrequency(&transponder->second.feparams, false);
 }
 
+/* setInput() and tuneChannel() with the given parameters instead of the
+   transponder list, for threads other than the zapit command thread */
+bool CFrontend::tuneTransponder(transponder_id_t tpid, t_satellite_position satellitePosition, FrontendParameters *feparams)
+{
+	currentTransponder.setTransponderId(tpid);
+	currentSatellitePosition = satellitePosition;
+	setInput(satellitePosition, feparams->frequency, feparams->polarization);
+	return tuneFrequency(feparams, false);
+}
+
 #if 0
 bool CFrontend::retuneChannel(void)
 {
@@ -47,6 +47,7 @@ CServiceManager::CServiceManager()
 	service_count = 0;
 	services_changed = false;
 	keep_numbers = false;
+	name_index_valid = false;
 }
 
 CServiceManager::~CServiceManager()
@@ -98,8 +99,10 @@ bool CServiceManager::AddChannel(CZapitChannel * &channel)
 		channel_pair_t (channel->getChannelID(), *channel));
 	delete channel;
 	channel = &ret.first->second;
-	if(ret.second)
+	if(ret.second) {
 		services_changed = true;
+		NameIndexAdd(channel);
+	}
 	return ret.second;
 }
 
@@ -156,13 +159,18 @@ void CServiceManager::ResetChannelNumbers(bool bouquets, bool numbers)
 
 void CServiceManager::RemoveChannel(const t_channel_id channel_id)
 {
-	allchans.erase(channel_id);
+	channel_map_iterator_t it = allchans.find(channel_id);
+	if (it != allchans.end()) {
+		NameIndexRemove(&it->second);
+		allchans.erase(it);
+	}
 	services_changed = true;
 }
 
 void CServiceManager::RemoveAllChannels()
 {
 	allchans.clear();
+	InvalidateNameIndex();
 }
 
 void CServiceManager::RemovePosition(t_satellite_position satellitePosition)
@@ -170,9 +178,10 @@ void CServiceManager::RemovePosition(t_satellite_position satellitePosition)
 	INFO("delete %d, size before: %zd", satellitePosition, allchans.size());
 	t_channel_id live_id = CZapit::getInstance()->GetCurrentChannelID();
 	for (channel_map_iterator_t it = allchans.begin(); it != allchans.end();) {
-		if (it->second.getSatellitePosition() == satellitePosition && live_id != it->first)
+		if (it->second.getSatellitePosition() == satellitePosition && live_id != it->first) {
+			NameIndexRemove(&it->second);
 			allchans.erase(it++);
-		else
+		} else
 			++it;
 	}
 	services_changed = true;
@@ -209,29 +218,97 @@ CZapitChannel * CServiceManager::FindChannel(const t_channel_id channel_id, bool
 	return &cit->second;
 }
 
-CZapitChannel * CServiceManager::FindChannelByName(std::string name)
+std::string CServiceManager::NameKey(const std::string &name)
 {
-	for (channel_map_iterator_t it = allchans.begin(); it != allchans.end(); ++it) {
-		if(it->second.getName().length() == name.length() &&
-			!strcasecmp(it->second.getName().c_str(), name.c_str())) {
-			return &it->second;
+	std::string key(name);
+	for (std::string::iterator it = key.begin(); it != key.end(); ++it)
+		*it = tolower((unsigned char) *it);
+	return key;
+}
+
+/* name_index_mutex must be locked */
+void CServiceManager::BuildNameIndex(void)
+{
+	name_index.clear();
+	for (channel_map_iterator_t it = allchans.begin(); it != allchans.end(); ++it)
+		name_index.insert(channel_name_map_t::value_type(NameKey(it->second.getName()), &it->second));
+	name_index_valid = true;
+}
+
+void CServiceManager::NameIndexAdd(CZapitChannel *channel)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(name_index_mutex);
+	if (name_index_valid)
+		name_index.insert(channel_name_map_t::value_type(NameKey(channel->getName()), channel));
+}
+
+void CServiceManager::NameIndexRemove(CZapitChannel *channel)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(name_index_mutex);
+	if (!name_index_valid)
+		return;
+	std::pair<channel_name_map_t::iterator, channel_name_map_t::iterator> range = name_index.equal_range(NameKey(channel->getName()));
+	for (channel_name_map_t::iterator it = range.first; it != range.second; ++it) {
+		if (it->second == channel) {
+			name_index.erase(it);
+			return;
 		}
 	}
-	return NULL;
+	/* renamed since it was indexed */
+	name_index_valid = false;
+	name_index.clear();
 }
 
-//NI
-CZapitChannel * CServiceManager::FindChannelByPattern(std::string pattern)
+void CServiceManager::InvalidateNameIndex(void)
 {
-	for (channel_map_iterator_t it = allchans.begin(); it != allchans.end(); ++it) {
-		//INFO("searching for %s in %s", pattern.c_str(), it->second.getName().c_str());
-		if (strncasecmp(it->second.getName().c_str(), pattern.c_str(), pattern.length()) == 0) {
-			return &it->second;
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(name_index_mutex);
+	name_index_valid = false;
+	name_index.clear();
+}
+
+/* the channel with the lowest id, which has this name, ignoring case.
+   with prefix, names starting with it match too */
+CZapitChannel * CServiceManager::SearchNameIndex(const std::string &name, bool prefix)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(name_index_mutex);
+	std::string key = NameKey(name);
+	for (int pass = 0; pass < 2; pass++) {
+		if (!name_index_valid)
+			BuildNameIndex();
+		CZapitChannel *found = NULL;
+		bool stale = false;
+		for (channel_name_map_t::iterator it = name_index.lower_bound(key); it != name_index.end(); ++it) {
+			if (prefix ? it->first.compare(0, key.size(), key) : it->first != key)
+				break;
+			CZapitChannel *channel = it->second;
+			const std::string &cname = channel->getName();
+			if ((!prefix && cname.length() != name.length()) ||
+			    strncasecmp(cname.c_str(), name.c_str(), name.length())) {
+				/* renamed since it was indexed */
+				stale = true;
+				break;
+			}
+			if (!found || channel->getChannelID() < found->getChannelID())
+				found = channel;
 		}
+		if (!stale)
+			return found;
+		name_index_valid = false;
 	}
 	return NULL;
 }
 
+CZapitChannel * CServiceManager::FindChannelByName(std::string name)
+{
+	return SearchNameIndex(name, false);
+}
+
+//NI
+CZapitChannel * CServiceManager::FindChannelByPattern(std::string pattern)
+{
+	return SearchNameIndex(pattern, true);
+}
+
 CZapitChannel * CServiceManager::FindCurrentChannel(const t_channel_id channel_id)
 {
 	channel_map_iterator_t cit = curchans.find(channel_id);
@@ -380,241 +457,289 @@ std::string CServiceManager::GetServiceName(t_channel_id channel_id)
                 return "";
 }
 
-void CServiceManager::ParseTransponders(xmlNodePtr node, t_satellite_position satellitePosition, delivery_system_t delsys)
+void CServiceManager::ParseTransponder(const char **atts, t_satellite_position satellitePosition, delivery_system_t delsys,
+		t_transport_stream_id &transport_stream_id, t_original_network_id &original_network_id, freq_id_t &freq, uint8_t &polarization)
 {
-	/* read all transponders */
-	while ((node = xmlGetNextOccurence(node, "TS")) != NULL) {
-		FrontendParameters feparams;
-
-		memset(&feparams, 0, sizeof(feparams));
-
-		t_transport_stream_id transport_stream_id = xmlGetNumericAttribute(node, "id", 16);
-		t_original_network_id original_network_id = xmlGetNumericAttribute(node, "on", 16);
-		feparams.frequency = xmlGetNumericAttribute(node, "frq", 0);
-		feparams.inversion = (fe_spectral_inversion) xmlGetNumericAttribute(node, "inv", 0);
-		feparams.plp_id = (uint8_t) xmlGetNumericAttribute(node, "pli", 0);
-
-		const char *system = xmlGetAttribute(node, "sys");
-		if (system) {
-			feparams.delsys = (delivery_system_t)CFrontend::getZapitDeliverySystem(xmlGetNumericAttribute(node, "sys", 0));
-			feparams.modulation  = (fe_modulation_t) xmlGetNumericAttribute(node, "mod", 0);
-			if (CFrontend::isSat(delsys))
-				feparams.fec_inner = (fe_code_rate_t)xmlGetNumericAttribute(node, "fec", 0);
-		} else {
-			if (CFrontend::isSat(delsys) || CFrontend::isCable(delsys)) {
-				fe_code_rate_t fec = (fe_code_rate_t)xmlGetNumericAttribute(node, "fec", 0);
+	FrontendParameters feparams;
 
-				if (CFrontend::isSat(delsys)) // translate old fec enum to new.
-					CFrontend::getXMLDelsysFEC(fec, feparams.delsys, feparams.modulation, feparams.fec_inner);
-				else if (CFrontend::isCable(delsys))
-					feparams.delsys = DVB_C;
-				
-			} else if (CFrontend::isTerr(delsys)) {
-				feparams.delsys = delsys;
-			}
-		}
+	memset(&feparams, 0, sizeof(feparams));
 
-		if (CFrontend::isSat(delsys)) {
-			feparams.symbol_rate = xmlGetNumericAttribute(node, "sr", 0);
-			feparams.polarization = xmlGetNumericAttribute(node, "pol", 0);
+	transport_stream_id = xmlGetNumericAttribute(atts, "id", 16);
+	original_network_id = xmlGetNumericAttribute(atts, "on", 16);
+	feparams.frequency = xmlGetNumericAttribute(atts, "frq", 0);
+	feparams.inversion = (fe_spectral_inversion) xmlGetNumericAttribute(atts, "inv", 0);
+	feparams.plp_id = (uint8_t) xmlGetNumericAttribute(atts, "pli", 0);
 
-			if(feparams.symbol_rate < 50000)
-				feparams.symbol_rate = feparams.symbol_rate * 1000;
+	const char *system = xmlGetAttribute(atts, "sys");
+	if (system) {
+		feparams.delsys = (delivery_system_t)CFrontend::getZapitDeliverySystem(xmlGetNumericAttribute(atts, "sys", 0));
+		feparams.modulation  = (fe_modulation_t) xmlGetNumericAttribute(atts, "mod", 0);
+		if (CFrontend::isSat(delsys))
+			feparams.fec_inner = (fe_code_rate_t)xmlGetNumericAttribute(atts, "fec", 0);
+	} else {
+		if (CFrontend::isSat(delsys) || CFrontend::isCable(delsys)) {
+			fe_code_rate_t fec = (fe_code_rate_t)xmlGetNumericAttribute(atts, "fec", 0);
 
-			if(feparams.frequency < 20000)
-				feparams.frequency = feparams.frequency*1000;
-			else
-				feparams.frequency = (int) 1000 * (int) round ((double) feparams.frequency / (double) 1000);
-			/* TODO: add xml tag ? */
-			feparams.pilot = ZPILOT_AUTO;
-			feparams.plp_id = xmlGetNumericAttribute(node, "pli", 0);
-			feparams.pls_mode = (fe_pls_mode_t) xmlGetNumericAttribute(node, "plm", 0);
-			feparams.pls_code = xmlGetNumericAttribute(node, "plc", 0);
-			if (feparams.pls_code == 0)
-				feparams.pls_code = 1;
+			if (CFrontend::isSat(delsys)) // translate old fec enum to new.
+				CFrontend::getXMLDelsysFEC(fec, feparams.delsys, feparams.modulation, feparams.fec_inner);
+			else if (CFrontend::isCable(delsys))
+				feparams.delsys = DVB_C;
+			
+		} else if (CFrontend::isTerr(delsys)) {
+			feparams.delsys = delsys;
 		}
-		else if (CFrontend::isTerr(delsys)) {
-			//<TS id="0001" on="7ffd" frq="650000" inv="2" bw="3" hp="9" lp="9" con="6" tm="2" gi="0" hi="4" sys="6">
+	}
 
-			feparams.bandwidth = (fe_bandwidth_t) xmlGetNumericAttribute(node, "bw", 0);
-			feparams.modulation = (fe_modulation_t) xmlGetNumericAttribute(node, "con", 0);
-			feparams.transmission_mode = (fe_transmit_mode_t) xmlGetNumericAttribute(node, "tm", 0);
-			feparams.code_rate_HP = (fe_code_rate_t) xmlGetNumericAttribute(node, "hp", 0);
-			feparams.code_rate_LP = (fe_code_rate_t) xmlGetNumericAttribute(node, "lp", 0);
-			feparams.guard_interval = (fe_guard_interval_t) xmlGetNumericAttribute(node, "gi", 0);
-			feparams.hierarchy = (fe_hierarchy_t) xmlGetNumericAttribute(node, "hi", 0);
+	if (CFrontend::isSat(delsys)) {
+		feparams.symbol_rate = xmlGetNumericAttribute(atts, "sr", 0);
+		feparams.polarization = xmlGetNumericAttribute(atts, "pol", 0);
 
-			if (feparams.frequency < 1000*1000)
-				feparams.frequency = feparams.frequency*1000;
-		}
-		else if (CFrontend::isCable(delsys)) {
-			feparams.fec_inner = (fe_code_rate_t) xmlGetNumericAttribute(node, "fec", 0);
-			feparams.symbol_rate = xmlGetNumericAttribute(node, "sr", 0);
-			feparams.modulation  = (fe_modulation_t) xmlGetNumericAttribute(node, "mod", 0);
+		if(feparams.symbol_rate < 50000)
+			feparams.symbol_rate = feparams.symbol_rate * 1000;
 
-			if (feparams.frequency > 1000*1000)
-				feparams.frequency = feparams.frequency/1000; //transponderlist was read from tuxbox
-		}
+		if(feparams.frequency < 20000)
+			feparams.frequency = feparams.frequency*1000;
+		else
+			feparams.frequency = (int) 1000 * (int) round ((double) feparams.frequency / (double) 1000);
+		/* TODO: add xml tag ? */
+		feparams.pilot = ZPILOT_AUTO;
+		feparams.plp_id = xmlGetNumericAttribute(atts, "pli", 0);
+		feparams.pls_mode = (fe_pls_mode_t) xmlGetNumericAttribute(atts, "plm", 0);
+		feparams.pls_code = xmlGetNumericAttribute(atts, "plc", 0);
+		if (feparams.pls_code == 0)
+			feparams.pls_code = 1;
+	}
+	else if (CFrontend::isTerr(delsys)) {
+		//<TS id="0001" on="7ffd" frq="650000" inv="2" bw="3" hp="9" lp="9" con="6" tm="2" gi="0" hi="4" sys="6">
+
+		feparams.bandwidth = (fe_bandwidth_t) xmlGetNumericAttribute(atts, "bw", 0);
+		feparams.modulation = (fe_modulation_t) xmlGetNumericAttribute(atts, "con", 0);
+		feparams.transmission_mode = (fe_transmit_mode_t) xmlGetNumericAttribute(atts, "tm", 0);
+		feparams.code_rate_HP = (fe_code_rate_t) xmlGetNumericAttribute(atts, "hp", 0);
+		feparams.code_rate_LP = (fe_code_rate_t) xmlGetNumericAttribute(atts, "lp", 0);
+		feparams.guard_interval = (fe_guard_interval_t) xmlGetNumericAttribute(atts, "gi", 0);
+		feparams.hierarchy = (fe_hierarchy_t) xmlGetNumericAttribute(atts, "hi", 0);
+
+		if (feparams.frequency < 1000*1000)
+			feparams.frequency = feparams.frequency*1000;
+	}
+	else if (CFrontend::isCable(delsys)) {
+		feparams.fec_inner = (fe_code_rate_t) xmlGetNumericAttribute(atts, "fec", 0);
+		feparams.symbol_rate = xmlGetNumericAttribute(atts, "sr", 0);
+		feparams.modulation  = (fe_modulation_t) xmlGetNumericAttribute(atts, "mod", 0);
 
-		freq_id_t freq = CREATE_FREQ_ID(feparams.frequency, CFrontend::isCable(delsys));
-		if (CFrontend::isTerr(delsys))
-			freq = (freq_id_t) (feparams.frequency/(1000*1000));
+		if (feparams.frequency > 1000*1000)
+			feparams.frequency = feparams.frequency/1000; //transponderlist was read from tuxbox
+	}
 
-		transponder_id_t tid = CREATE_TRANSPONDER_ID64(freq, satellitePosition,original_network_id,transport_stream_id);
-		transponder t(tid, feparams);
+	freq = CREATE_FREQ_ID(feparams.frequency, CFrontend::isCable(delsys));
+	if (CFrontend::isTerr(delsys))
+		freq = (freq_id_t) (feparams.frequency/(1000*1000));
 
-		std::pair<std::map<transponder_id_t, transponder>::iterator,bool> ret;
-		ret = transponders.insert(transponder_pair_t(tid, t));
-		if (ret.second == false)
-			t.dump("[zapit] duplicate in all transponders:");
+	transponder_id_t tid = CREATE_TRANSPONDER_ID64(freq, satellitePosition,original_network_id,transport_stream_id);
+	transponder t(tid, feparams);
 
-		/* read channels that belong to the current transponder */
-		ParseChannels(xmlChildrenNode(node), transport_stream_id, original_network_id, satellitePosition, freq, feparams.polarization, delsys);
+	std::pair<std::map<transponder_id_t, transponder>::iterator,bool> ret;
+	ret = transponders.insert(transponder_pair_t(tid, t));
+	if (ret.second == false)
+		t.dump("[zapit] duplicate in all transponders:");
 
-		/* hop to next transponder */
-		node = xmlNextNode(node);
-	}
-	UpdateSatTransponders(satellitePosition);
-	return;
+	polarization = feparams.polarization;
 }
 
-void CServiceManager::ParseChannels(xmlNodePtr node, const t_transport_stream_id transport_stream_id, const t_original_network_id original_network_id, t_satellite_position satellitePosition, freq_id_t freq, uint8_t polarization, delivery_system_t delsys)
+void CServiceManager::ParseChannel(const char **atts, const t_transport_stream_id transport_stream_id, const t_original_network_id original_network_id, t_satellite_position satellitePosition, freq_id_t freq, uint8_t polarization, delivery_system_t delsys)
 {
-	int dummy = 0;
-	int * have_ptr = &dummy;
-
 	sat_iterator_t sit = satellitePositions.find(satellitePosition);
 	if(sit != satellitePositions.end())
-		have_ptr = &sit->second.have_channels;
-
-	while ((node = xmlGetNextOccurence(node, "S")) != NULL) {
-		*have_ptr = 1;
-		t_service_id service_id = xmlGetNumericAttribute(node, "i", 16);
-		std::string name;
-		const char *nptr = xmlGetAttribute(node, "n");
-		if(nptr)
-			name = nptr;
-		uint8_t service_type = xmlGetNumericAttribute(node, "t", 16);
-		uint16_t vpid = xmlGetNumericAttribute(node, "v", 16);
-		uint16_t apid = xmlGetNumericAttribute(node, "a", 16);
-		uint16_t pcrpid = xmlGetNumericAttribute(node, "p", 16);
-		uint16_t pmtpid = xmlGetNumericAttribute(node, "pmt", 16);
-		uint16_t txpid = xmlGetNumericAttribute(node, "tx", 16);
-		uint16_t vtype = xmlGetNumericAttribute(node, "vt", 16);
-		uint16_t scrambled = xmlGetNumericAttribute(node, "s", 16);
-		int number = xmlGetNumericAttribute(node, "num", 10);
-		int flags = xmlGetNumericAttribute(node, "f", 10);
-		/* default if no flags present */
-		if (flags == 0)
-			flags = CZapitChannel::UPDATED;
-
-		t_channel_id chid = CREATE_CHANNEL_ID64;
-		const char *ptr = xmlGetAttribute(node, "action");
-		bool remove = ptr ? (!strcmp(ptr, "remove") || !strcmp(ptr, "replace")) : false;
-		bool add    = ptr ? (!strcmp(ptr, "add")    || !strcmp(ptr, "replace")) : true;
-
-		if (remove) {
-			int result = allchans.erase(chid);
-			printf("[getservices]: %s '%s' (sid=0x%x): %s", add ? "replacing" : "removing",
-					name.c_str(), service_id, result ? "succeded.\n" : "FAILED!\n");
-
-			if(!result && remove && add)
-				add = false;//dont replace not existing channel
-		}
-		if(!add) {
-			node = xmlNextNode(node);
-			continue;
-		}
-		audio_map_set_t * pidmap = CZapit::getInstance()->GetSavedPids(chid);
-		if(pidmap)
-			apid = pidmap->apid;
+		sit->second.have_channels = 1;
+
+	t_service_id service_id = xmlGetNumericAttribute(atts, "i", 16);
+	std::string name;
+	const char *nptr = xmlGetAttribute(atts, "n");
+	if(nptr)
+		name = nptr;
+	uint8_t service_type = xmlGetNumericAttribute(atts, "t", 16);
+	uint16_t vpid = xmlGetNumericAttribute(atts, "v", 16);
+	uint16_t apid = xmlGetNumericAttribute(atts, "a", 16);
+	uint16_t pcrpid = xmlGetNumericAttribute(atts, "p", 16);
+	uint16_t pmtpid = xmlGetNumericAttribute(atts, "pmt", 16);
+	uint16_t txpid = xmlGetNumericAttribute(atts, "tx", 16);
+	uint16_t vtype = xmlGetNumericAttribute(atts, "vt", 16);
+	uint16_t scrambled = xmlGetNumericAttribute(atts, "s", 16);
+	int number = xmlGetNumericAttribute(atts, "num", 10);
+	int flags = xmlGetNumericAttribute(atts, "f", 10);
+	/* default if no flags present */
+	if (flags == 0)
+		flags = CZapitChannel::UPDATED;
+
+	t_channel_id chid = CREATE_CHANNEL_ID64;
+	const char *ptr = xmlGetAttribute(atts, "action");
+	bool remove = ptr ? (!strcmp(ptr, "remove") || !strcmp(ptr, "replace")) : false;
+	bool add    = ptr ? (!strcmp(ptr, "add")    || !strcmp(ptr, "replace")) : true;
+
+	if (remove) {
+		channel_map_iterator_t cit = allchans.find(chid);
+		if (cit != allchans.end())
+			NameIndexRemove(&cit->second);
+		int result = allchans.erase(chid);
+		printf("[getservices]: %s '%s' (sid=0x%x): %s", add ? "replacing" : "removing",
+				name.c_str(), service_id, result ? "succeded.\n" : "FAILED!\n");
+
+		if(!result && remove && add)
+			add = false;//dont replace not existing channel
+	}
+	if(!add)
+		return;
+	audio_map_set_t * pidmap = CZapit::getInstance()->GetSavedPids(chid);
+	if(pidmap)
+		apid = pidmap->apid;
 
-		CZapitChannel * channel = new CZapitChannel(name, chid, service_type,
-				satellitePosition, freq);
+	CZapitChannel * channel = new CZapitChannel(name, chid, service_type,
+			satellitePosition, freq);
 
-		channel->delsys = delsys;
+	channel->delsys = delsys;
 
-		service_number_map_t * channel_numbers = (service_type == ST_DIGITAL_RADIO_SOUND_SERVICE) ? &radio_numbers : &tv_numbers;
+	service_number_map_t * channel_numbers = (service_type == ST_DIGITAL_RADIO_SOUND_SERVICE) ? &radio_numbers : &tv_numbers;
 
-		if(!keep_numbers)
-			number = 0;
+	if(!keep_numbers)
+		number = 0;
 
-		if(number) {
-			have_numbers = true;
-			service_number_map_t::iterator it = channel_numbers->find(number);
-			if(it != channel_numbers->end()) {
-				printf("[zapit] duplicate channel number %d: %s id %" PRIx64 " freq %d\n", number,
-						name.c_str(), chid, freq);
-				number = 0;
-				dup_numbers = true; // force save after loading
-			} else
-				channel_numbers->insert(number);
-		}
+	if(number) {
+		have_numbers = true;
+		service_number_map_t::iterator it = channel_numbers->find(number);
+		if(it != channel_numbers->end()) {
+			printf("[zapit] duplicate channel number %d: %s id %" PRIx64 " freq %d\n", number,
+					name.c_str(), chid, freq);
+			number = 0;
+			dup_numbers = true; // force save after loading
+		} else
+			channel_numbers->insert(number);
+	}
 
-		bool ret = AddChannel(channel);
-		//printf("INS CHANNEL %s %x\n", name.c_str(), (int) &ret.first->second);
-		if(ret == false) {
-			printf("[zapit] duplicate channel %s id %" PRIx64 " freq %d (old %s at %d)\n",
-					name.c_str(), chid, freq, channel->getName().c_str(), channel->getFreqId());
-		} else {
-			service_count++;
-			channel->number = number;
-			channel->flags = flags;
-			channel->scrambled = scrambled;
-			channel->polarization = polarization;
-			if(pmtpid != 0 && (((channel->getServiceType() == ST_DIGITAL_RADIO_SOUND_SERVICE) && (apid > 0))
-						|| ( (channel->getServiceType() == ST_DIGITAL_TELEVISION_SERVICE)  && (vpid > 0) && (apid > 0))) ) {
-				DBG("[getserv] preset chan %s vpid %X sid %X tpid %X onid %X\n", name.c_str(), vpid, service_id, transport_stream_id, transport_stream_id);
-				channel->setVideoPid(vpid);
-				channel->setAudioPid(apid);
-				channel->setPcrPid(pcrpid);
-				channel->setPmtPid(pmtpid);
-				channel->setTeletextPid(txpid);
-				channel->setPidsFlag();
-				channel->type = vtype;
-			}
+	bool ret = AddChannel(channel);
+	//printf("INS CHANNEL %s %x\n", name.c_str(), (int) &ret.first->second);
+	if(ret == false) {
+		printf("[zapit] duplicate channel %s id %" PRIx64 " freq %d (old %s at %d)\n",
+				name.c_str(), chid, freq, channel->getName().c_str(), channel->getFreqId());
+	} else {
+		service_count++;
+		channel->number = number;
+		channel->flags = flags;
+		channel->scrambled = scrambled;
+		channel->polarization = polarization;
+		if(pmtpid != 0 && (((channel->getServiceType() == ST_DIGITAL_RADIO_SOUND_SERVICE) && (apid > 0))
+					|| ( (channel->getServiceType() == ST_DIGITAL_TELEVISION_SERVICE)  && (vpid > 0) && (apid > 0))) ) {
+			DBG("[getserv] preset chan %s vpid %X sid %X tpid %X onid %X\n", name.c_str(), vpid, service_id, transport_stream_id, transport_stream_id);
+			channel->setVideoPid(vpid);
+			channel->setAudioPid(apid);
+			channel->setPcrPid(pcrpid);
+			channel->setPmtPid(pmtpid);
+			channel->setTeletextPid(txpid);
+			channel->setPidsFlag();
+			channel->type = vtype;
 		}
-		node = xmlNextNode(node);
 	}
-	return;
 }
 
-void CServiceManager::FindTransponder(xmlNodePtr search)
+bool CServiceManager::ParseProvider(const char *type, const char **atts, bool init, t_satellite_position &satellitePosition, delivery_system_t &delsys)
 {
-	delivery_system_t delsys;
-
-	while (search) {
-		t_satellite_position satellitePosition;
-		std::string delivery_name = xmlGetName(search);
+	const char *name = xmlGetAttribute(atts, "name");
+	std::string delivery_name = type;
 
-		if (delivery_name == "cable") {
-			const char *name = xmlGetAttribute(search, "name");
-			satellitePosition = GetSatellitePosition(name);
-			delsys = ALL_CABLE;
+	if (delivery_name == "cable") {
+		if (init) {
+			t_satellite_position position = GetSatellitePosition(name);
+			if (!position)
+				position = fake_c_pos++;
+			InitSatPosition(position, name, false, ALL_CABLE);
 		}
-		else if (delivery_name == "terrestrial") {
-			const char *name = xmlGetAttribute(search, "name");
-			satellitePosition = GetSatellitePosition(name);
-			delsys = ALL_TERR;
+		satellitePosition = GetSatellitePosition(name);
+		delsys = ALL_CABLE;
+	}
+	else if (delivery_name == "terrestrial") {
+		if (init) {
+			t_satellite_position position = GetSatellitePosition(name);
+			if (!position)
+				position = fake_t_pos++;
+			InitSatPosition(position, name, false, ALL_TERR);
 		}
-		else if (delivery_name == "sat") {
-			satellitePosition = xmlGetSignedNumericAttribute(search, "position", 10);
+		satellitePosition = GetSatellitePosition(name);
+		delsys = ALL_TERR;
+	}
+	else if (delivery_name == "sat") {
+		satellitePosition = xmlGetSignedNumericAttribute(atts, "position", 10);
+		if (init)
+			InitSatPosition(satellitePosition, name, false, ALL_SAT);
+		delsys = ALL_SAT;
+	}
+	else
+		return false;
+
+	INFO("going to parse dvb-%c provider %s", type[0], name);
+	newfound++;
+	return true;
+}
+
+/* services.xml: <zapit> <sat|cable|terrestrial> <TS> <S/> ... </TS> ... </zapit>,
+ * read as a stream without building a tree of all channels */
+class CServicesXmlReader : public CXMLSaxHandler
+{
+	private:
+		CServiceManager *manager;
+		bool init_positions;
+		int depth;
+		bool in_provider;
+		bool in_ts;
+		t_satellite_position position;
+		delivery_system_t delsys;
+		t_transport_stream_id transport_stream_id;
+		t_original_network_id original_network_id;
+		freq_id_t freq;
+		uint8_t polarization;
+		const char *n_ts, *n_s;
+	public:
+		CServicesXmlReader(CServiceManager *m, bool init)
+		{
+			manager = m;
+			init_positions = init;
+			depth = 0;
+			in_provider = in_ts = false;
+			position = 0;
 			delsys = ALL_SAT;
+			transport_stream_id = original_network_id = 0;
+			freq = 0;
+			polarization = 0;
+			n_ts = xmlIntern("TS");
+			n_s = xmlIntern("S");
 		}
-		else {
-			search = xmlNextNode(search);
-			continue;
+		void StartElement(const char *name, const char **atts)
+		{
+			depth++;
+			if (depth == 2)
+				in_provider = manager->ParseProvider(name, atts, init_positions, position, delsys);
+			else if (depth == 3 && in_provider && name == n_ts) {
+				manager->ParseTransponder(atts, position, delsys, transport_stream_id, original_network_id, freq, polarization);
+				in_ts = true;
+			}
+			else if (depth == 4 && in_ts && name == n_s)
+				manager->ParseChannel(atts, transport_stream_id, original_network_id, position, freq, polarization, delsys);
 		}
-#if 0
-		//t_satellite_position satellitePosition = xmlGetSignedNumericAttribute(search, "position", 10);
-		const char * name = xmlGetAttribute(search, "name");
-		t_satellite_position satellitePosition = GetSatellitePosition(name);
-#endif
-		INFO("going to parse dvb-%c provider %s", xmlGetName(search)[0], xmlGetAttribute(search, "name"));
-		ParseTransponders(xmlChildrenNode(search), satellitePosition, delsys);
-		newfound++;
-		search = xmlNextNode(search);
-	}
+		void EndElement(const char * /*name*/)
+		{
+			if (depth == 3)
+				in_ts = false;
+			else if (depth == 2 && in_provider) {
+				manager->UpdateSatTransponders(position);
+				in_provider = false;
+			}
+			depth--;
+		}
+};
+
+bool CServiceManager::ReadServicesXml(const char *filename, bool init_positions)
+{
+	CServicesXmlReader reader(this, init_positions);
+	return parseXmlFileSax(filename, reader, false);
 }
 
 void CServiceManager::ParseSatTransponders(delivery_system_t delsys, xmlNodePtr search, t_satellite_position satellitePosition)
@@ -931,7 +1056,6 @@ bool CServiceManager::LoadServices(bool only_current)
 	if(CFEManager::getInstance()->getLiveFE() == NULL)
 		return false;
 
-	xmlDocPtr parser;
 	service_count = 0;
 	printf("[zapit] Loading services, channel size %d ..\n", (int)sizeof(CZapitChannel));
 
@@ -940,6 +1064,7 @@ bool CServiceManager::LoadServices(bool only_current)
 
 	TIMER_START();
 	allchans.clear();
+	InvalidateNameIndex();
 	transponders.clear();
 	tv_numbers.clear();
 	radio_numbers.clear();
@@ -965,35 +1090,7 @@ bool CServiceManager::LoadServices(bool only_current)
 		LoadScanXml(ALL_TERR);
 	}
 
-	parser = parseXmlFile(SERVICES_XML);
-	if (parser != NULL) {
-		xmlNodePtr search = xmlDocGetRootElement(parser);
-		search = xmlChildrenNode(search);
-		while (search) {
-			const char * name = xmlGetAttribute(search, "name");
-			t_satellite_position position;
-			std::string delivery_name = xmlGetName(search);
-			if (delivery_name == "sat") {
-				position = xmlGetSignedNumericAttribute(search, "position", 10);
-				InitSatPosition(position, name, false, ALL_SAT);
-			} else if (delivery_name == "terrestrial") {
-				position = GetSatellitePosition(name);
-				if (!position)
-					position = fake_t_pos++;
-				InitSatPosition(position, name, false, ALL_TERR);
-			} else if (delivery_name == "cable") {
-				position = GetSatellitePosition(name);
-				if (!position)
-					position = fake_c_pos++;
-				InitSatPosition(position, name, false, ALL_CABLE);
-			} else {
-			}
-
-			search = xmlNextNode(search);
-		}
-		FindTransponder(xmlChildrenNode(xmlDocGetRootElement(parser)));
-		xmlFreeDoc(parser);
-	}
+	ReadServicesXml(SERVICES_XML, true);
 
 	LoadProviderMap();
 	printf("[zapit] %d services loaded (%d)...\n", service_count, (int)allchans.size());
@@ -1009,11 +1106,9 @@ bool CServiceManager::LoadServices(bool only_current)
 do_current:
 #if 0
 	DBG("Loading current..\n");
-	if (CZapit::getInstance()->scanSDT() && (parser = parseXmlFile(CURRENTSERVICES_XML))) {
-		newfound = 0;
+	newfound = 0;
+	if (CZapit::getInstance()->scanSDT() && ReadServicesXml(CURRENTSERVICES_XML, false)) {
 		printf("[getservices] " CURRENTSERVICES_XML "  found.\n");
-		FindTransponder(xmlChildrenNode(xmlDocGetRootElement(parser)));
-		xmlFreeDoc(parser);
 		unlink(CURRENTSERVICES_XML);
 		if(newfound) {
 			//SaveServices(true);
@@ -1021,13 +1116,8 @@ do_current:
 		}
 	}
 #endif
-	if(!only_current) {
-		parser = parseXmlFile(MYSERVICES_XML);
-		if (parser != NULL) {
-			FindTransponder(xmlChildrenNode(xmlDocGetRootElement(parser)));
-			xmlFreeDoc(parser);
-		}
-	}
+	if(!only_current)
+		ReadServicesXml(MYSERVICES_XML, false);
 	/* if no numbers, zapit will save after loading bouquets, with numbers */
 	if(service_count && keep_numbers && (!have_numbers || dup_numbers))
 		services_changed = true;
@@ -1167,6 +1257,7 @@ bool CServiceManager::CopyCurrentServices(transponder_id_t tpid)
 		if(aI == allchans.end()) {
 			channel_insert_res_t ret = allchans.insert(channel_pair_t (cI->second.getChannelID(), cI->second));
 			ret.first->second.flags = CZapitChannel::NEW;
+			NameIndexAdd(&ret.first->second);
 			updated = true;
 			printf("CServiceManager::CopyCurrentServices: [%s] add\n", cI->second.getName().c_str());
 		} else {
@@ -1175,7 +1266,9 @@ bool CServiceManager::CopyCurrentServices(transponder_id_t tpid)
 					|| cI->second.scrambled != aI->second.scrambled
 #endif
 				) {
+				NameIndexRemove(&aI->second);
 				aI->second.setName(cI->second.getName());
+				NameIndexAdd(&aI->second);
 				aI->second.scrambled = cI->second.scrambled;
 				aI->second.flags = CZapitChannel::UPDATED;
 				updated = true;
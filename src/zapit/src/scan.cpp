@@ -37,6 +37,7 @@
 #include <zapit/scannit.h>
 #include <zapit/scanbat.h>
 #include <system/set_threadname.h>
+#include <driver/abstime.h>
 
 //#define USE_BAT
 
@@ -47,6 +48,11 @@ extern int motorRotationSpeed;
 
 CBouquetManager* scanBouquetManager;
 
+#ifdef USE_BAT
+static bouquet_map_t bat_bouquet_map;
+static channel_number_map_t bat_logical_map;
+#endif
+
 CServiceScan * CServiceScan::scan = NULL;
 
 CServiceScan * CServiceScan::getInstance()
@@ -112,6 +118,8 @@ void CServiceScan::run()
 	found_data_chans = 0;
 	failed_transponders = 0;
 	fake_tid = fake_nid = 0;
+	tuner_time = 0;
+	int64_t scan_start = time_monotonic_ms();
 
 	switch(scan_mode) {
 		case SCAN_PROVIDER:
@@ -134,6 +142,17 @@ void CServiceScan::run()
 		default:
 			break;
 	}
+	/* time of all tuners, as one frontend alone would need it, against real time */
+	int64_t scan_time = time_monotonic_ms() - scan_start;
+	printf("[scan] %u transponders scanned in %" PRId64 " ms, tuners busy %" PRId64 " ms, speedup %d.%02d\n",
+			processed_transponders, scan_time, tuner_time,
+			(int) (scan_time ? tuner_time / scan_time : 0), (int) (scan_time ? (tuner_time * 100 / scan_time) % 100 : 0));
+}
+
+void CServiceScan::AddTunerTime(int64_t ms)
+{
+	OpenThreads::ScopedLock<OpenThreads::ReentrantMutex> m_lock(scan_mutex);
+	tuner_time += ms;
 }
 
 void CServiceScan::CleanAllMaps()
@@ -145,8 +164,9 @@ void CServiceScan::CleanAllMaps()
 	service_types.clear();
 }
 
-bool CServiceScan::tuneFrequency(FrontendParameters *feparams, t_satellite_position satellitePosition)
+bool CServiceScan::tuneFrequency(FrontendParameters *feparams, t_satellite_position satellitePosition, CFrontend * fe)
 {
+	CFrontend * frontend = fe ? fe : this->frontend;
 	if (! frontend->supportsDelivery(feparams->delsys)) {
 		printf("[scan] [fe%d] does not support delivery system %d, skipping\n",
 			frontend->getNumber(), feparams->delsys);
@@ -156,7 +176,9 @@ bool CServiceScan::tuneFrequency(FrontendParameters *feparams, t_satellite_posit
 	int ret = frontend->driveToSatellitePosition(satellitePosition, false); //true);
 	if(ret > 0) {
 		printf("[scan] waiting %d seconds for motor to turn satellite dish.\n", ret);
+		Lock();
 		CZapit::getInstance()->SendEvent(CZapitClient::EVT_SCAN_PROVIDER, (void *) "moving rotor", 13);
+		Unlock();
 		for(int i = 0; i < ret; i++) {
 			sleep(1);
 			if(abort_scan)
@@ -183,6 +205,7 @@ bool CServiceScan::tuneFrequency(FrontendParameters *feparams, t_satellite_posit
 
 bool CServiceScan::AddTransponder(transponder_id_t TsidOnid, FrontendParameters *feparams,  bool fromnit)
 {
+	OpenThreads::ScopedLock<OpenThreads::ReentrantMutex> m_lock(scan_mutex);
 	stiterator tI;
 	transponder t(TsidOnid, *feparams);
 	if (fromnit) {
@@ -245,117 +268,250 @@ bool CServiceScan::AddFromNit()
 	return !scantransponders.empty();
 }
 
-bool CServiceScan::ReadNitSdt(t_satellite_position satellitePosition)
+CScanWorker::CScanWorker(CServiceScan * s, CFrontend * fe, int dnum, t_satellite_position spos)
 {
-	stiterator tI;
-	printf("[scan] scanning tp from sat/service\n");
-#ifdef USE_BAT
-	bouquet_map_t bouquet_map;
-	channel_number_map_t logical_map;
-#endif
-	std::string networkName;
-	channel_number_map_t nit_logical_map;
-	channel_number_map_t nit_hd_logical_map;
-_repeat:
-	found_transponders += scantransponders.size();
-	CZapit::getInstance()->SendEvent ( CZapitClient::EVT_SCAN_NUM_TRANSPONDERS,
-			&found_transponders, sizeof(found_transponders));
+	scan = s;
+	frontend = fe;
+	dmxnum = dnum;
+	dmxsource = cDemux::GetSource(dnum);
+	satellitePosition = spos;
+}
+
+bool CScanWorker::Start()
+{
+	int ret = start();
+	return (ret == 0);
+}
+
+bool CScanWorker::Stop()
+{
+	int ret = join();
+	return (ret == 0);
+}
 
-	for (tI = scantransponders.begin(); tI != scantransponders.end(); ++tI) {
-		if(abort_scan)
-			return false;
+void CScanWorker::run()
+{
+	char name[32];
+	snprintf(name, sizeof(name), "zap:scan%d", frontend->getNumber());
+	set_threadname(name);
+
+	transponder_pair_t tp;
+	int count = 0;
+	int64_t busy = 0;
+	while (scan->GetNextTransponder(frontend, tp)) {
+		int64_t start = time_monotonic_ms();
+		scan->ScanOneTransponder(tp, satellitePosition, frontend, dmxnum);
+		busy += time_monotonic_ms() - start;
+		count++;
+	}
+	scan->AddTunerTime(busy);
+	printf("[scan] [fe%d] done, %d transponders in %" PRId64 " ms\n", frontend->getNumber(), count, busy);
+}
 
+/* get next not yet scanned transponder, supported by fe */
+bool CServiceScan::GetNextTransponder(CFrontend * fe, transponder_pair_t &tp)
+{
+	OpenThreads::ScopedLock<OpenThreads::ReentrantMutex> m_lock(scan_mutex);
+	std::list<transponder_pair_t>::iterator it = pending_transponders.begin();
+	while (!abort_scan && it != pending_transponders.end()) {
+		if (!fe->supportsDelivery(it->second.feparams.delsys)) {
+			++it;
+			continue;
+		}
 		processed_transponders++;
+		tp = *it;
+		pending_transponders.erase(it);
+
 		/* partial compare with already scanned, skip duplicate */
 		bool skip = false;
 		for (stiterator ntI = scanedtransponders.begin(); ntI != scanedtransponders.end(); ++ntI) {
-			if (ntI->second == tI->second) {
+			if (ntI->second == tp.second) {
 				skip = true;
 				break;
 			}
 		}
-		if(skip) {
-			tI->second.dump("[scan] skip");
-			continue;
-		}
+		if (!skip)
+			return true;
 
-		transponder t(tI->first, tI->second.feparams);
-		t.dump("[scan] scanning:");
-		SendTransponderInfo(tI->second);
+		tp.second.dump("[scan] skip");
+		it = pending_transponders.begin();
+	}
+	return false;
+}
 
-		if (!tuneFrequency(&(tI->second.feparams), satellitePosition)) {
-			failed_transponders++;
-			failedtransponders.insert(transponder_pair_t(t.transponder_id, t));
-			continue;
-		}
+bool CServiceScan::ScanOneTransponder(transponder_pair_t &tp, t_satellite_position satellitePosition, CFrontend * fe, int dmxnum)
+{
+	transponder t(tp.first, tp.second.feparams);
+	t.dump("[scan] scanning:");
+	Lock();
+	SendTransponderInfo(tp.second);
+	Unlock();
+
+	if (!tuneFrequency(&(tp.second.feparams), satellitePosition, fe)) {
+		OpenThreads::ScopedLock<OpenThreads::ReentrantMutex> m_lock(scan_mutex);
+		failed_transponders++;
+		failedtransponders.insert(transponder_pair_t(t.transponder_id, t));
+		return false;
+	}
 
-		if(abort_scan)
-			return false;
+	if(abort_scan)
+		return false;
 
-		freq_id_t freq = CREATE_FREQ_ID(tI->second.feparams.frequency, CFrontend::isCable(tI->second.feparams.delsys));
-		if (CFrontend::isTerr(tI->second.feparams.delsys))
-			freq = (freq_id_t) (tI->second.feparams.frequency/(1000*1000));
+	freq_id_t freq = CREATE_FREQ_ID(tp.second.feparams.frequency, CFrontend::isCable(tp.second.feparams.delsys));
+	if (CFrontend::isTerr(tp.second.feparams.delsys))
+		freq = (freq_id_t) (tp.second.feparams.frequency/(1000*1000));
 
-		CNit nit(satellitePosition, freq, cable_nid);
-		if(flags & SCAN_NIT)
-			nit.Start();
+	CNit nit(satellitePosition, freq, cable_nid, dmxnum);
+	if(flags & SCAN_NIT)
+		nit.Start();
 
 #ifdef USE_BAT
-		CBat bat(satellitePosition, freq);
-		if(flags & SCAN_BAT)
-			bat.Start();
+	CBat bat(satellitePosition, freq, dmxnum);
+	if(flags & SCAN_BAT)
+		bat.Start();
 #endif
-		CSdt sdt(satellitePosition, freq);
-		bool sdt_parsed = sdt.Parse(tI->second.transport_stream_id, tI->second.original_network_id);
-
-		if(flags & SCAN_NIT) {
-			nit.Stop();
-			networkName = nit.GetNetworkName();
-			channel_number_map_t &lcn = nit.getLogicalMap();
-			nit_logical_map.insert(lcn.begin(), lcn.end());
-			channel_number_map_t &hdlcn = nit.getHDLogicalMap();
-			nit_hd_logical_map.insert(hdlcn.begin(), hdlcn.end());
-		}
+	/* sdt takes scan lock itself, while adding services */
+	CSdt sdt(satellitePosition, freq, false, dmxnum, fe);
+	bool sdt_parsed = sdt.Parse(tp.second.transport_stream_id, tp.second.original_network_id);
 
+	/* join outside of lock: nit thread add transponders under lock */
+	if(flags & SCAN_NIT)
+		nit.Stop();
 #ifdef USE_BAT
-		if(flags & SCAN_BAT) {
-			bat.Stop();
-			bouquet_map_t & tmp = bat.getBouquets();
-			for(bouquet_map_t::iterator it = tmp.begin(); it != tmp.end(); ++it) {
-				bouquet_map[it->first].insert(it->second.begin(), it->second.end());
-				printf("########### CServiceScan::ReadNitSdt: bouquet_map [%s] size %d ###########\n", it->first.c_str(), (int)bouquet_map[it->first].size());
-			}
-			channel_number_map_t &lcn = bat.getLogicalMap();
-			logical_map.insert(lcn.begin(), lcn.end());
-		}
+	if(flags & SCAN_BAT)
+		bat.Stop();
 #endif
-		if(!sdt_parsed) {
-			printf("[scan] SDT failed !\n");
-			failed_transponders++;
-			failedtransponders.insert(transponder_pair_t(t.transponder_id, t));
-			continue;
+	OpenThreads::ScopedLock<OpenThreads::ReentrantMutex> m_lock(scan_mutex);
+	if(flags & SCAN_NIT) {
+		networkName = nit.GetNetworkName();
+		channel_number_map_t &lcn = nit.getLogicalMap();
+		nit_logical_map.insert(lcn.begin(), lcn.end());
+		channel_number_map_t &hdlcn = nit.getHDLogicalMap();
+		nit_hd_logical_map.insert(hdlcn.begin(), hdlcn.end());
+	}
+
+#ifdef USE_BAT
+	if(flags & SCAN_BAT) {
+		bouquet_map_t & tmp = bat.getBouquets();
+		for(bouquet_map_t::iterator it = tmp.begin(); it != tmp.end(); ++it) {
+			bat_bouquet_map[it->first].insert(it->second.begin(), it->second.end());
+			printf("########### CServiceScan::ReadNitSdt: bouquet_map [%s] size %d ###########\n", it->first.c_str(), (int)bat_bouquet_map[it->first].size());
 		}
-		scanedtransponders.insert(transponder_pair_t(t.transponder_id, t));
-		/* partial compare with existent transponders, update params if found */
-		for (stiterator ttI = transponders.begin(); ttI != transponders.end(); ++ttI) {
-			if(t == ttI->second) {
-				ttI->second.dump("[scan] similar tp, old");
-				t.dump("[scan] similar tp, new");
-				ttI->second.feparams = t.feparams;
-				break;
-			}
+		channel_number_map_t &lcn = bat.getLogicalMap();
+		bat_logical_map.insert(lcn.begin(), lcn.end());
+	}
+#endif
+	if(!sdt_parsed) {
+		printf("[scan] SDT failed !\n");
+		failed_transponders++;
+		failedtransponders.insert(transponder_pair_t(t.transponder_id, t));
+		return false;
+	}
+	scanedtransponders.insert(transponder_pair_t(t.transponder_id, t));
+	/* partial compare with existent transponders, update params if found */
+	for (stiterator ttI = transponders.begin(); ttI != transponders.end(); ++ttI) {
+		if(t == ttI->second) {
+			ttI->second.dump("[scan] similar tp, old");
+			t.dump("[scan] similar tp, new");
+			ttI->second.feparams = t.feparams;
+			break;
 		}
+	}
+
+	transponder_id_t TsidOnid = CREATE_TRANSPONDER_ID64(freq, satellitePosition,
+			tp.second.original_network_id, tp.second.transport_stream_id);
 
-		transponder_id_t TsidOnid = CREATE_TRANSPONDER_ID64(freq, satellitePosition,
-				tI->second.original_network_id, tI->second.transport_stream_id);
+	stiterator stI = transponders.find(TsidOnid);
+	if(stI == transponders.end()) {
+		transponder t2(TsidOnid, tp.second.feparams);
+		transponders.insert(transponder_pair_t(TsidOnid, t2));
+	}
+	printf("[scan] [fe%d] tpid ready: %" PRIx64 "\n", fe->getNumber(), TsidOnid);
+	return true;
+}
 
-		stiterator stI = transponders.find(TsidOnid);
-		if(stI == transponders.end()) {
-			transponder t2(TsidOnid, tI->second.feparams);
-			transponders.insert(transponder_pair_t(TsidOnid, t2));
+/* scan pending transponders on primary frontend in this thread,
+ * and on every additional frontend from felist in own worker thread */
+void CServiceScan::ScanParallel(t_satellite_position satellitePosition, std::vector<CFrontend*> &felist)
+{
+	std::vector<CScanWorker*> workers;
+	for (std::vector<CFrontend*>::iterator it = felist.begin(); it != felist.end(); ++it) {
+		CFrontend * fe = *it;
+		/* same demux as for record on this frontend */
+		int dnum = fe->getNumber() + 1;
+		CFEManager::getInstance()->lockFrontend(fe);
+		CScanWorker * worker = new CScanWorker(this, fe, dnum, satellitePosition);
+		cDemux::SetSource(dnum, fe->getNumber());
+		if (worker->Start()) {
+			workers.push_back(worker);
+		} else {
+			cDemux::SetSource(dnum, worker->GetDemuxSource());
+			CFEManager::getInstance()->unlockFrontend(fe);
+			delete worker;
 		}
-		printf("[scan] tpid ready: %" PRIx64 "\n", TsidOnid);
 	}
+	if (!workers.empty())
+		printf("[scan] scanning with %d frontends\n", (int) workers.size() + 1);
+
+	transponder_pair_t tp;
+	int count = 0;
+	int64_t busy = 0;
+	int64_t start = time_monotonic_ms();
+	while (GetNextTransponder(frontend, tp)) {
+		int64_t tp_start = time_monotonic_ms();
+		ScanOneTransponder(tp, satellitePosition, frontend, 0);
+		busy += time_monotonic_ms() - tp_start;
+		count++;
+	}
+	AddTunerTime(busy);
+	printf("[scan] [fe%d] done, %d transponders in %" PRId64 " ms\n", frontend->getNumber(), count, busy);
+
+	for (std::vector<CScanWorker*>::iterator it = workers.begin(); it != workers.end(); ++it) {
+		(*it)->Stop();
+		/* back to the mapping live and record use */
+		cDemux::SetSource((*it)->GetDemux(), (*it)->GetDemuxSource());
+		CFEManager::getInstance()->unlockFrontend((*it)->GetFrontend());
+		delete *it;
+	}
+	if (!workers.empty())
+		printf("[scan] %d frontends done in %" PRId64 " ms\n", (int) workers.size() + 1, time_monotonic_ms() - start);
+
+	/* left transponders not supported by any frontend */
+	for (std::list<transponder_pair_t>::iterator it = pending_transponders.begin(); it != pending_transponders.end(); ++it) {
+		it->second.dump("[scan] no frontend for");
+		failed_transponders++;
+		failedtransponders.insert(*it);
+	}
+	pending_transponders.clear();
+}
+
+bool CServiceScan::ReadNitSdt(t_satellite_position satellitePosition)
+{
+	printf("[scan] scanning tp from sat/service\n");
+#ifdef USE_BAT
+	bat_bouquet_map.clear();
+	bat_logical_map.clear();
+#endif
+	networkName.clear();
+	nit_logical_map.clear();
+	nit_hd_logical_map.clear();
+_repeat:
+	found_transponders += scantransponders.size();
+	CZapit::getInstance()->SendEvent ( CZapitClient::EVT_SCAN_NUM_TRANSPONDERS,
+			&found_transponders, sizeof(found_transponders));
+
+	pending_transponders.clear();
+	for (stiterator tI = scantransponders.begin(); tI != scantransponders.end(); ++tI)
+		pending_transponders.push_back(*tI);
+
+	std::vector<CFrontend*> felist;
+	if (pending_transponders.size() > 1)
+		CFEManager::getInstance()->getScanFrontends(satellitePosition, frontend, felist);
+
+	ScanParallel(satellitePosition, felist);
+	if(abort_scan)
+		return false;
+
 	if((flags & SCAN_NIT) && AddFromNit())
 		goto _repeat;
 
@@ -397,9 +553,9 @@ _repeat:
 #ifdef USE_BAT
 	if(flags & SCAN_BAT) {
 		bool have_lcn = false;
-		if((flags & SCAN_LOGICAL_NUMBERS) && !logical_map.empty()) {
+		if((flags & SCAN_LOGICAL_NUMBERS) && !bat_logical_map.empty()) {
 			CServiceManager::getInstance()->ResetChannelNumbers(true, true);
-			for(channel_number_map_t::iterator lit = logical_map.begin(); lit != logical_map.end(); ++lit) {
+			for(channel_number_map_t::iterator lit = bat_logical_map.begin(); lit != bat_logical_map.end(); ++lit) {
 				CZapitChannel * channel = CServiceManager::getInstance()->FindChannel48(lit->first);
 				if(channel) {
 					channel->number = lit->second;
@@ -409,11 +565,11 @@ _repeat:
 			}
 		}
 #if 1
-		for(bouquet_map_t::iterator it = bouquet_map.begin(); it != bouquet_map.end(); ++it) {
+		for(bouquet_map_t::iterator it = bat_bouquet_map.begin(); it != bat_bouquet_map.end(); ++it) {
 			CZapitBouquet* bouquet;
 			std::string pname = it->first;
 			int bouquetId = g_bouquetManager->existsUBouquet(pname.c_str());
-			printf("########### CServiceScan::ReadNitSdt: bouquet [%s] size %d id %d ###########\n", it->first.c_str(), (int)bouquet_map[it->first].size(), bouquetId);
+			printf("########### CServiceScan::ReadNitSdt: bouquet [%s] size %d id %d ###########\n", it->first.c_str(), (int)bat_bouquet_map[it->first].size(), bouquetId);
 			if (bouquetId == -1)
 				bouquet = g_bouquetManager->addBouquet(pname, true);
 			else
@@ -705,6 +861,7 @@ void CServiceScan::SendTransponderInfo(transponder &t)
 
 void CServiceScan::ChannelFound(uint8_t service_type, std::string providerName, std::string serviceName)
 {
+	OpenThreads::ScopedLock<OpenThreads::ReentrantMutex> m_lock(scan_mutex);
 	CZapit::getInstance()->SendEvent(CZapitClient::EVT_SCAN_PROVIDER, (void *) providerName.c_str(), providerName.length() + 1);
 
 	found_channels++;
@@ -737,5 +894,6 @@ void CServiceScan::ChannelFound(uint8_t service_type, std::string providerName,
 
 void CServiceScan::AddServiceType(t_channel_id channel_id, uint8_t service_type)
 {
+	OpenThreads::ScopedLock<OpenThreads::ReentrantMutex> m_lock(scan_mutex);
 	service_types[channel_id] = service_type;
 }
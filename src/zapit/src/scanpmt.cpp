@@ -91,6 +91,25 @@ bool CPmt::Parse(CZapitChannel * const channel)
 	if(!Read(channel->getPmtPid(), channel->getServiceId()))
 		return false;
 
+	return ParseBuffer(channel);
+}
+
+/* parse pmt, saved from last Parse(), without reading demux */
+bool CPmt::ParseCached(CZapitChannel * const channel)
+{
+	int len;
+	unsigned char * raw = channel->getRawPmt(len);
+	if (!raw || len < 12 || len > PMT_SECTION_SIZE || channel->getPmtPid() == 0)
+		return false;
+
+	/* raw pmt will be replaced while parsing */
+	memmove(buffer, raw, len);
+	printf("[zapit] parsing cached pmt pid 0x%X version %d (%s)\n", channel->getPmtPid(), (buffer[5] >> 1) & 0x1F, channel->getName().c_str());
+	return ParseBuffer(channel);
+}
+
+bool CPmt::ParseBuffer(CZapitChannel * const channel)
+{
 	ProgramMapSection pmt(buffer);
 
 	DBG("[pmt] pcr pid: old 0x%x new 0x%x\n", channel->getPcrPid(), pmt.getPcrPid());
@@ -41,7 +41,8 @@
 //#define DEBUG_SDT_UNUSED
 //#define DEBUG_SDT_SERVICE
 
-CSdt::CSdt(t_satellite_position spos, freq_id_t frq, bool curr, int dnum)
+CSdt::CSdt(t_satellite_position spos, freq_id_t frq, bool curr, int dnum, CFrontend * fe)
+	: pat(dnum)
 {
 	satellitePosition = spos;
 	freq_id = frq;
@@ -49,8 +50,10 @@ CSdt::CSdt(t_satellite_position spos, freq_id_t frq, bool curr, int dnum)
 	current = curr;
 	transport_stream_id = 0;
 	original_network_id = 0;
+	/* frontend, this sdt is read from */
+	frontend = fe ? fe : CFEManager::getInstance()->getLiveFE();
 	//FIXME sdt update ??
-	cable = CFEManager::getInstance()->getLiveFE()->getCurrentDeliverySystem() == DVB_C;
+	cable = frontend->getCurrentDeliverySystem() == DVB_C;
 }
 
 CSdt::~CSdt()
@@ -159,6 +162,12 @@ bool CSdt::Parse(t_transport_stream_id &tsid, t_original_network_id &onid)
 	if(!Read())
 		return false;
 
+	/* other frontends may scan in parallel, the services are added to the maps
+	   under scan lock. pat/pmt reads are done after, without it */
+	OpenThreads::ReentrantMutex * scan_mutex = current ? NULL : &CServiceScan::getInstance()->GetMutex();
+	if (scan_mutex)
+		scan_mutex->lock();
+	pid_channels.clear();
 	bool updated = false;
 	for (it = sections.begin(); it != sections.end(); ++it) {
 		ServiceDescriptionSection * sdt = *it;
@@ -225,6 +234,10 @@ bool CSdt::Parse(t_transport_stream_id &tsid, t_original_network_id &onid)
 				break;
 		}
 	}
+	if (scan_mutex) {
+		scan_mutex->unlock();
+		ParsePids();
+	}
 	tsid = transport_stream_id;
 	onid = original_network_id;
 	if(current && current_tp_id != CFEManager::getInstance()->getLiveFE()->getTsidOnid())
@@ -281,7 +294,7 @@ bool CSdt::ParseServiceDescriptor(ServiceDescription * service, ServiceDescripto
 		CZapitChannel * channel = new CZapitChannel(serviceName, channel_id,
 				real_type, satellitePosition, freq_id);
 
-		channel->delsys = CServiceScan::getInstance()->GetFrontend()->getCurrentDeliverySystem();
+		channel->delsys = frontend->getCurrentDeliverySystem();
 		CServiceManager::getInstance()->AddCurrentChannel(channel);
 
 		channel->scrambled = free_ca;
@@ -321,7 +334,10 @@ bool CSdt::ParseServiceDescriptor(ServiceDescription * service, ServiceDescripto
 
 	CZapitChannel *channel = CheckChannelId(service_id);
 	if (channel) {
-		channel->setName(serviceName);
+		if (channel->getName() != serviceName) {
+			channel->setName(serviceName);
+			CServiceManager::getInstance()->InvalidateNameIndex();
+		}
 		channel->setServiceType(real_type);
 		channel->freq = freq_id;
 		if (CServiceScan::getInstance()->SatHaveChannels() && (channel->flags & CZapitChannel::NOT_FOUND))
@@ -333,7 +349,7 @@ bool CSdt::ParseServiceDescriptor(ServiceDescription * service, ServiceDescripto
 				real_type, satellitePosition, freq_id);
 		CServiceManager::getInstance()->AddChannel(channel);
 
-		channel->delsys = CServiceScan::getInstance()->GetFrontend()->getCurrentDeliverySystem();
+		channel->delsys = frontend->getCurrentDeliverySystem();
 		channel->flags = CZapitChannel::UPDATED;
 		/* mark channel as new, if this satellite already have channels */
 		if (CServiceScan::getInstance()->SatHaveChannels())
@@ -342,23 +358,34 @@ bool CSdt::ParseServiceDescriptor(ServiceDescription * service, ServiceDescripto
 	channel->scrambled = free_ca;
 
 	AddToBouquet(providerName, channel);
+	pid_channels.push_back(sdt_channel_pair_t(channel, service_type));
+
+	return true;
+}
 
+/* read pat/pmt of the services found in sdt, these reads wait for timeouts,
+   so scan lock is taken only to set current channel */
+void CSdt::ParsePids()
+{
 	if (CZapit::getInstance()->scanPids()) {
-		if(pat.Parse(channel)) {
-			CPmt pmt;
-			pmt.Parse(channel);
+		for (sdt_channel_list_t::iterator it = pid_channels.begin(); it != pid_channels.end(); ++it) {
+			CZapitChannel * channel = it->first;
+			if(pat.Parse(channel)) {
+				CPmt pmt(dmxnum);
+				pmt.Parse(channel);
 #ifdef DEBUG_SDT_SERVICE
-			if(free_ca != channel->scrambled)
-				printf("[SDT] provider [%s] service [%s] free_ca %d scrambled %d camap.size %d\n", providerName.c_str(),
-						serviceName.c_str(), free_ca, channel->scrambled, channel->camap.size());
+				printf("[SDT] service [%s] scrambled %d camap.size %d\n",
+						channel->getName().c_str(), channel->scrambled, channel->camap.size());
 #endif
+			}
 		}
 	}
-	if(service_type == ST_DIGITAL_TELEVISION_SERVICE && !channel->scrambled) {
-		CZapit::getInstance()->SetCurrentChannelID(channel->getChannelID());
+	OpenThreads::ScopedLock<OpenThreads::ReentrantMutex> m_lock(CServiceScan::getInstance()->GetMutex());
+	for (sdt_channel_list_t::iterator it = pid_channels.begin(); it != pid_channels.end(); ++it) {
+		if(it->second == ST_DIGITAL_TELEVISION_SERVICE && !it->first->scrambled)
+			CZapit::getInstance()->SetCurrentChannelID(it->first->getChannelID());
 	}
-
-	return true;
+	pid_channels.clear();
 }
 
 /* check current freq from -2 to +2 to find if channel already exist */
@@ -58,6 +58,7 @@
 
 #include <zapit/satconfig.h>
 #include <zapit/femanager.h>
+#include <zapit/fesampler.h>
 #include <dmx.h>
 #if HAVE_COOL_HARDWARE
 #include <record_cs.h>
@@ -75,6 +76,7 @@
 #include <driver/abstime.h>
 #include <driver/rcinput.h>
 #include <system/set_threadname.h>
+#include <system/metrics.h>
 #include <libdvbsub/dvbsub.h>
 #include <OpenThreads/ScopedLock>
 #include <libtuxtxt/teletext.h>
@@ -147,6 +149,9 @@ CZapit::CZapit()
 	pip_channel_id = 0;
 	lock_channel_id = 0;
 	pip_fe = NULL;
+	fastzap_verify = false;
+	zap_start_ms = 0;
+	zap_wait_video = false;
 }
 
 CZapit::~CZapit()
@@ -190,13 +195,15 @@ void CZapit::SaveSettings(bool write)
 		configfile.setBool("makeRemainingChannelsBouquet", config.makeRemainingChannelsBouquet);
 		configfile.setInt32("feTimeout", config.feTimeout);
 		configfile.setInt32("feRetries", config.feRetries);
+		configfile.setInt32("feSampleInterval", config.feSampleInterval);
 
 		configfile.setInt32("rezapTimeout", config.rezapTimeout);
 		configfile.setBool("scanPids", config.scanPids);
 		configfile.setInt32("scanSDT", config.scanSDT);
 		configfile.setInt32("cam_ci", config.cam_ci);
-#if 0 // unused
 		configfile.setBool("fastZap", config.fastZap);
+		configfile.setInt32("preTune", config.preTune);
+#if 0 // unused
 		configfile.setBool("sortNames", config.sortNames);
 #endif
 
@@ -326,8 +333,9 @@ void CZapit::LoadSettings()
 	lastChannelTV				= configfile.getInt64("lastChannelTV", 0);
 	last_channel_id				= configfile.getInt64("lastOTAChannel", 0);
 
+	config.fastZap				= configfile.getBool("fastZap", 0);
+	config.preTune				= configfile.getInt32("preTune", 0);
 #if 0 //unused
-	config.fastZap				= configfile.getBool("fastZap", 1);
 	config.sortNames			= configfile.getBool("sortNames", 0);
 	voltageOff				= configfile.getBool("voltageOff", 0);
 #endif
@@ -343,6 +351,7 @@ void CZapit::LoadSettings()
 
 	config.feTimeout			= configfile.getInt32("feTimeout", 40);
 	config.feRetries			= configfile.getInt32("feRetries", 1);
+	config.feSampleInterval			= configfile.getInt32("feSampleInterval", FE_SAMPLE_INTERVAL);
 	config.noSameFE				= configfile.getInt32("noSameFE", 0);
 	config.highVoltage			= configfile.getBool("highVoltage", 0);
 
@@ -374,6 +383,7 @@ void CZapit::ConfigFrontend()
 			continue;
 
 		fe->setTimeout(config.feTimeout);
+		fe->getSampler()->setInterval(config.feSampleInterval);
 		fe->configUsals(config.gotoXXLatitude, config.gotoXXLongitude,
 				config.gotoXXLaDirection, config.gotoXXLoDirection, config.repeatUsals);
 
@@ -497,14 +507,18 @@ bool CZapit::ParsePatPmt(CZapitChannel * channel)
 	CPmt pmt(channel->getRecordDemux());
 	DBG("looking up pids for channel_id " PRINTF_CHANNEL_ID_TYPE "\n", channel->getChannelID());
 
+	uint64_t start = time_monotonic_us();
 	if(!pat.Parse(channel)) {
 		printf("[zapit] pat parsing failed\n");
 		return false;
 	}
+	uint64_t pat_us = time_monotonic_us();
+	METRIC_TIME(METRIC_ZAP_PAT, pat_us - start);
 	if (!pmt.Parse(channel)) {
 		printf("[zapit] pmt parsing failed\n");
 		return false;
 	}
+	METRIC_TIME(METRIC_ZAP_PMT, time_monotonic_us() - pat_us);
 
 	return true;
 }
@@ -522,6 +536,10 @@ bool CZapit::ZapIt(const t_channel_id channel_id, bool forupdate, bool startplay
 	}
 
 	INFO("[zapit] zap to %s (%" PRIx64 " tp %" PRIx64 ")", newchannel->getName().c_str(), newchannel->getChannelID(), newchannel->getTransponderId());
+	uint64_t start_us = time_monotonic_us();
+	zap_start_ms = start_us / 1000;
+	zap_wait_video = false;
+	fastzap_verify = false;
 	if (!firstzap && current_channel)
 		SaveChannelPids(current_channel);
 
@@ -610,6 +628,7 @@ bool CZapit::ZapIt(const t_channel_id channel_id, bool forupdate, bool startplay
 		goto again;
 	}
 	SendEvent(CZapitClient::EVT_TUNE_COMPLETE, &live_channel_id, sizeof(t_channel_id));
+	int64_t tune_ms = time_monotonic_ms();
 
 #ifdef ENABLE_PIP
 	if (transponder_change && (live_fe == pip_fe))
@@ -626,7 +645,15 @@ bool CZapit::ZapIt(const t_channel_id channel_id, bool forupdate, bool startplay
 		return true;
 	}
 
-	failed = !ParsePatPmt(current_channel);
+	/* start with pids from last known pmt, changes are verified after playback started */
+	bool fast = false;
+	if (config.fastZap && !forupdate) {
+		CPmt pmt(current_channel->getRecordDemux());
+		fast = pmt.ParseCached(current_channel);
+		if (fast && (current_channel->getAudioPid() == 0) && (current_channel->getVideoPid() == 0))
+			fast = false;
+	}
+	failed = fast ? false : !ParsePatPmt(current_channel);
 
 	if (failed && retry > 0) {
 		int rand_us = (rand() * 1000000LL / RAND_MAX);
@@ -654,22 +681,106 @@ bool CZapit::ZapIt(const t_channel_id channel_id, bool forupdate, bool startplay
 
 	RestoreChannelPids(current_channel);
 
+	uint64_t pids_us = time_monotonic_us();
 	if (startplayback /* && !we_playing*/)
 		StartPlayBack(current_channel);
 
 	//printf("[zapit] sending capmt....\n");
 
+	uint64_t play_us = time_monotonic_us();
 	SendPMT(forupdate);
+	uint64_t capmt_us = time_monotonic_us();
 	//play:
 	int caid = 1;
 	SendEvent(CZapitClient::EVT_ZAP_CA_ID, &caid, sizeof(int));
 
-	if (update_pmt)
+	/* update filter also catch changed pmt version after fast zap */
+	if (update_pmt || fast)
 		pmt_set_update_filter(current_channel, &pmt_update_fd);
 
+	uint64_t now = time_monotonic_us();
+	INFO("[zapit] zap time: tune %d ms, pids %d ms (%s), playback %d ms, capmt %d ms, total %d ms",
+			(int) (tune_ms - zap_start_ms), (int) (pids_us / 1000 - tune_ms), fast ? "cached" : "demux",
+			(int) ((play_us - pids_us) / 1000), (int) ((capmt_us - play_us) / 1000), (int) ((now - start_us) / 1000));
+	if (startplayback)
+		METRIC_TIME(METRIC_ZAP_PLAYBACK, play_us - pids_us);
+	METRIC_TIME(METRIC_ZAP_CAPMT, capmt_us - play_us);
+	METRIC_TIME(METRIC_ZAP_TOTAL, now - start_us);
+	zap_wait_video = startplayback && playing && (currentMode & TV_MODE) && current_channel->getVideoPid();
+	/* pmt pid could change without new pmt version, check pat once after fast zap */
+	fastzap_verify = fast;
+	if (fast)
+		PreTuner.Verify(current_channel);
+
+	CZapitChannel * next, * prev;
+	if (config.preTune && GetNeighbours(current_channel, next, prev))
+		PreTuner.Wakeup(current_channel, next, prev);
+
 	return true;
 }
 
+/* previous and next channel in the first bouquet with live channel */
+bool CZapit::GetNeighbours(CZapitChannel * live, CZapitChannel * &next, CZapitChannel * &prev)
+{
+	next = prev = NULL;
+	if (CFEManager::getInstance()->getFrontendCount() < 2)
+		return false;
+
+	bool tv = (live->getServiceType() != ST_DIGITAL_RADIO_SOUND_SERVICE);
+	for (unsigned int i = 0; (i < g_bouquetManager->Bouquets.size()) && !next; i++) {
+		ZapitChannelList &list = tv ? g_bouquetManager->Bouquets[i]->tvChannels : g_bouquetManager->Bouquets[i]->radioChannels;
+		unsigned int size = list.size();
+		for (unsigned int j = 0; j < size; j++) {
+			if (list[j] == live) {
+				next = list[(j + 1) % size];
+				prev = list[(j + size - 1) % size];
+				break;
+			}
+		}
+	}
+	return next != NULL;
+}
+
+/* result of pat check in pretune thread */
+void CZapit::VerifyFastZap()
+{
+	if (!current_channel) {
+		fastzap_verify = false;
+		return;
+	}
+	t_channel_id channel_id = current_channel->getChannelID();
+	unsigned short pmt_pid;
+	if (!PreTuner.VerifyResult(channel_id, pmt_pid))
+		return;
+
+	fastzap_verify = false;
+	if (!pmt_pid || (pmt_pid == current_channel->getPmtPid()))
+		return;
+
+	INFO("[zapit] fast zap: pmt pid changed 0x%x -> 0x%x, rezap", current_channel->getPmtPid(), pmt_pid);
+	pmt_stop_update_filter(&pmt_update_fd);
+	current_channel->setRawPmt(NULL);
+	ZapIt(channel_id, true);
+	SendEvent(CZapitClient::EVT_PMT_CHANGED, &channel_id, sizeof(channel_id));
+}
+
+/* report time from zap start until decoder report picture */
+void CZapit::CheckZapTime()
+{
+	int xres = 0, yres = 0, framerate = 0;
+	int64_t msec = time_monotonic_ms() - zap_start_ms;
+
+	videoDecoder->getPictureInfo(xres, yres, framerate);
+	if (xres > 0) {
+		INFO("[zapit] zap time: first frame after %d ms (%dx%d)", (int) msec, xres, yres);
+		METRIC_TIME(METRIC_ZAP_TIME, msec * 1000);
+		zap_wait_video = false;
+	} else if (msec > 5000) {
+		INFO("[zapit] zap time: no picture after %d ms", (int) msec);
+		zap_wait_video = false;
+	}
+}
+
 #ifdef ENABLE_PIP
 bool CZapit::StopPip()
 {
@@ -802,7 +913,7 @@ bool CZapit::ZapForRecord(const t_channel_id channel_id)
 	return true;
 }
 
-bool CZapit::ZapForEpg(const t_channel_id channel_id, bool instandby)
+bool CZapit::ZapForEpg(const t_channel_id channel_id, bool instandby, uint32_t busy_fe)
 {
 	CZapitChannel* newchannel;
 	bool transponder_change;
@@ -826,7 +937,18 @@ bool CZapit::ZapForEpg(const t_channel_id channel_id, bool instandby)
 			CFEManager::getInstance()->lockFrontend(pip_fe);
 #endif
 	}
+	/* frontends of other epg scans */
+	std::vector<CFrontend *> busy;
+	for (int i = 0; busy_fe && i < CFEManager::getInstance()->getFrontendCount(); i++) {
+		CFrontend * fe = CFEManager::getInstance()->getFE(i);
+		if (fe && fe->getNumber() < 32 && (busy_fe & (1U << fe->getNumber()))) {
+			CFEManager::getInstance()->lockFrontend(fe);
+			busy.push_back(fe);
+		}
+	}
 	CFrontend * frontend = CFEManager::getInstance()->allocateFE(newchannel);
+	for (unsigned int i = 0; i < busy.size(); i++)
+		CFEManager::getInstance()->unlockFrontend(busy[i]);
 
 	if (!instandby) {
 		if (!IS_WEBCHAN(live_channel_id))
@@ -1216,7 +1338,7 @@ bool CZapit::ParseCommand(CBasicMessage::Header &rmsg, int connfd)
 		CBasicServer::receive_data(connfd, &msg, sizeof(msg));
 		msgResponseZapComplete.zapStatus = 0;
 		CBasicServer::send_data(connfd, &msgResponseZapComplete, sizeof(msgResponseZapComplete));
-		bool ret = ZapForEpg(msg.channel_id, msg.standby);
+		bool ret = ZapForEpg(msg.channel_id, msg.standby, msg.busy_fe);
 		if (!ret)
 			msg.channel_id = 0;
 		SendEvent(CZapitClient::EVT_BACK_ZAP_COMPLETE, &msg.channel_id, sizeof(t_channel_id));
@@ -2649,6 +2771,7 @@ void CZapit::run()
 	}
 #endif
 	SdtMonitor.Start();
+	PreTuner.Start();
 	while (started && zapit_server.run(zapit_parse_command, CZapitMessages::ACTVERSION, true))
 	{
 		if (pmt_update_fd != -1) {
@@ -2682,6 +2805,10 @@ void CZapit::run()
 				}
 			}
 		}
+		if (zap_wait_video)
+			CheckZapTime();
+		if (fastzap_verify)
+			VerifyFastZap();
 		/* yuck, don't waste that much cpu time :) */
 		usleep(0);
 #if 0
@@ -2712,6 +2839,7 @@ void CZapit::run()
 	CServiceManager::getInstance()->SaveServices(true, true);
 
 	SdtMonitor.Stop();
+	PreTuner.Stop();
 	INFO("shutdown started");
 #ifdef USE_VBI
 	videoDecoder->CloseVBI();
@@ -2881,3 +3009,202 @@ void CZapitSdtMonitor::run()
 	}
 	return;
 }
+
+CZapitPreTune::CZapitPreTune()
+{
+	started = false;
+	pretune_wakeup = false;
+	pretune_next = pretune_prev = NULL;
+	live_tp = 0;
+	verify_pending = verify_done = false;
+	verify_channel_id = 0;
+	verify_sid = 0;
+	verify_demux = 0;
+	verify_pmt_pid = 0;
+}
+
+CZapitPreTune::~CZapitPreTune()
+{
+	Stop();
+	ClearPreTune();
+}
+
+/* copy of the channel with what tune needs, the original can be removed
+   by the command thread any time. feparams gets the parameters of its
+   transponder, scan and reload change the transponder list */
+static CZapitChannel * PreTuneCopy(CZapitChannel * channel, FrontendParameters &feparams)
+{
+	if (!channel || IS_WEBCHAN(channel->getChannelID()))
+		return NULL;
+	transponder_list_t::iterator tI = transponders.find(channel->getTransponderId());
+	if (tI == transponders.end())
+		return NULL;
+	feparams = tI->second.feparams;
+	CZapitChannel * copy = new CZapitChannel(channel->getName(), channel->getChannelID(),
+			channel->getServiceType(true), channel->getSatellitePosition(), channel->getFreqId());
+	copy->delsys = channel->delsys;
+	return copy;
+}
+
+/* call with mutex locked */
+void CZapitPreTune::ClearPreTune()
+{
+	delete pretune_next;
+	delete pretune_prev;
+	pretune_next = pretune_prev = NULL;
+}
+
+void CZapitPreTune::Wakeup(CZapitChannel * live, CZapitChannel * next, CZapitChannel * prev)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(mutex);
+	ClearPreTune();
+	pretune_next = PreTuneCopy(next, pretune_next_params);
+	pretune_prev = PreTuneCopy(prev, pretune_prev_params);
+	live_tp = live->getTransponderId();
+	pretune_wakeup = true;
+	cond.signal();
+}
+
+void CZapitPreTune::Verify(CZapitChannel * channel)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(mutex);
+	verify_channel_id = channel->getChannelID();
+	verify_sid = channel->getServiceId();
+	verify_demux = channel->getRecordDemux();
+	verify_pmt_pid = 0;
+	verify_done = false;
+	verify_pending = true;
+	cond.signal();
+}
+
+/* true, if pat of channel_id was read. pmt_pid is 0, if service not found */
+bool CZapitPreTune::VerifyResult(t_channel_id channel_id, unsigned short &pmt_pid)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(mutex);
+	if (!verify_done || (verify_channel_id != channel_id))
+		return false;
+	verify_done = false;
+	pmt_pid = verify_pmt_pid;
+	return true;
+}
+
+bool CZapitPreTune::Pending()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> m_lock(mutex);
+	return pretune_wakeup;
+}
+
+bool CZapitPreTune::Start()
+{
+	started = true;
+	int ret = start();
+	return (ret == 0);
+}
+
+bool CZapitPreTune::Stop()
+{
+	if (!started)
+		return false;
+	mutex.lock();
+	started = false;
+	cond.signal();
+	mutex.unlock();
+	int ret = join();
+	return (ret == 0);
+}
+
+void CZapitPreTune::PreTune(CZapitChannel * channel, FrontendParameters * feparams, transponder_id_t live, CFrontend * &used)
+{
+	/* new zap pending, neighbours changed */
+	if (!channel || Pending())
+		return;
+
+	if (live == channel->getTransponderId())
+		return;
+
+	CFEManager::getInstance()->Lock();
+	CFrontend * fe = CFEManager::getInstance()->getPreTuneFrontend(channel, used);
+	bool tune = false;
+	if (fe) {
+		CFEManager::getInstance()->lockFrontend(fe);
+		/* getFrontend skips it, until tuned */
+		tune = !(fe->tuned && fe->sameTsidOnid(channel->getTransponderId()));
+		if (tune) {
+			fe->pretuning = true;
+			fe->tuned = false;
+		}
+	}
+	CFEManager::getInstance()->Unlock();
+	if (fe == NULL)
+		return;
+
+	used = fe;
+	if (!tune) {
+		CFEManager::getInstance()->unlockFrontend(fe);
+		return;
+	}
+	int64_t start = time_monotonic_ms();
+	bool ret = fe->tuneTransponder(channel->getTransponderId(), channel->getSatellitePosition(), feparams);
+	CFEManager::getInstance()->Lock();
+	fe->pretuning = false;
+	CFEManager::getInstance()->unlockFrontend(fe);
+	CFEManager::getInstance()->Unlock();
+	INFO("[pretune] fe%d tp %" PRIx64 " (%s): %s, %d ms", fe->getNumber(), channel->getTransponderId(),
+			channel->getName().c_str(), ret ? "ok" : "failed", (int) (time_monotonic_ms() - start));
+}
+
+void CZapitPreTune::run()
+{
+	set_threadname("zap:pretune");
+	while (true) {
+		mutex.lock();
+		while (started && !pretune_wakeup && !verify_pending)
+			cond.wait(&mutex);
+		if (!started) {
+			mutex.unlock();
+			break;
+		}
+		bool verify = verify_pending;
+		verify_pending = false;
+		t_channel_id channel_id = verify_channel_id;
+		t_service_id sid = verify_sid;
+		int demux = verify_demux;
+		mutex.unlock();
+
+		/* blocking section read, not done in command thread */
+		if (verify) {
+			CPat pat(demux);
+			unsigned short pmt_pid = pat.GetPmtPid(sid);
+			mutex.lock();
+			/* not if zapped to other channel meanwhile */
+			if (!verify_pending && verify_channel_id == channel_id) {
+				verify_pmt_pid = pmt_pid;
+				verify_done = true;
+			}
+			mutex.unlock();
+		}
+
+		/* let zapping settle, before frontends are moved */
+		if (!Pending())
+			continue;
+		usleep(200*1000);
+
+		mutex.lock();
+		pretune_wakeup = false;
+		CZapitChannel * next = pretune_next;
+		CZapitChannel * prev = pretune_prev;
+		FrontendParameters next_params = pretune_next_params;
+		FrontendParameters prev_params = pretune_prev_params;
+		transponder_id_t live = live_tp;
+		pretune_next = pretune_prev = NULL;
+		mutex.unlock();
+
+		if (!CServiceScan::getInstance()->Scanning()) {
+			CFrontend * used = NULL;
+			PreTune(next, &next_params, live, used);
+			PreTune(prev, &prev_params, live, used);
+		}
+		delete next;
+		delete prev;
+	}
+}